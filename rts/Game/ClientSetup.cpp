@@ -54,18 +54,22 @@ void ClientSetup::Init(const std::string& setup)
 	std::string sourceport, autohostip, autohostport;
 	if (file.SGetValue(sourceport, "GAME\\SourcePort")) {
 		configHandler->SetString("SourcePort", sourceport, true);
+		configOverlayKeys.push_back("SourcePort");
 	}
 	if (file.SGetValue(autohostip, "GAME\\AutohostIP")) {
 		configHandler->SetString("AutohostIP", autohostip, true);
+		configOverlayKeys.push_back("AutohostIP");
 	}
 	if (file.SGetValue(autohostport, "GAME\\AutohostPort")) {
 		configHandler->SetString("AutohostPort", autohostport, true);
+		configOverlayKeys.push_back("AutohostPort");
 	}
 
 	if (file.SectionExist("OPTIONS")) {
 		const std::map<std::string, std::string>& options = file.GetAllValues("OPTIONS");
 		for (std::map<std::string,std::string>::const_iterator it = options.begin(); it != options.end(); ++it) {
 			configHandler->SetString(it->first, it->second, true);
+			configOverlayKeys.push_back(it->first);
 		}
 	}
 }
@@ -4,6 +4,7 @@
 #define CLIENT_SETUP_H
 
 #include <string>
+#include <vector>
 
 class ClientSetup
 {
@@ -23,6 +24,9 @@ public:
 	int hostPort;
 
 	bool isHost;
+
+	//! the config keys Init set (in memory only) from the script
+	std::vector<std::string> configOverlayKeys;
 };
 
 #endif // CLIENT_SETUP_H
@@ -27,6 +27,7 @@
 #include "GameServer.h"
 #include "GameVersion.h"
 #include "GameSetup.h"
+#include "SimBenchmark.h"
 #include "GlobalUnsynced.h"
 #include "LoadScreen.h"
 #include "SelectedUnits.h"
@@ -152,6 +153,7 @@
 #include "System/LoadSave/DemoRecorder.h"
 #include "System/Log/ILog.h"
 #include "System/Net/PackPacket.h"
+#include "System/SlabPool.h"
 #include "System/Platform/CrashHandler.h"
 #include "System/Platform/Watchdog.h"
 #include "System/Sound/ISound.h"
@@ -1449,10 +1451,14 @@ void CGame::SimFrame() {
 
 	ScopedTimer cputimer("Game::SimFrame", true); // SimFrame
 
+	if (simBenchmark != NULL)
+		simBenchmark->StartFrame();
+
 	good_fpu_control_registers("CGame::SimFrame");
 	lastFrameTime = spring_gettime();
 
 	gs->frameNum++;
+	TraceProfiler::SetFrameNum(gs->frameNum);
 
 #ifdef TRACE_SYNC
 	tracefile << "New frame:" << gs->frameNum << " " << gs->GetRandSeed() << "\n";
@@ -1496,15 +1502,23 @@ void CGame::SimFrame() {
 	wind.Update();
 	loshandler->Update();
 	interceptHandler.Update(false);
+	// deliver the batched UnitDamaged etc. call-ins of this frame
+	CLuaHandle::FlushCallInBatches();
 
 	teamHandler->GameFrame(gs->frameNum);
 	playerHandler->GameFrame(gs->frameNum);
 
+	// objects deleted during this frame can be reused from now on
+	CSlabPool::ReleaseFreedAll();
+
 	lastSimFrameTime = spring_gettime();
 	gu->avgSimFrameTime = mix(gu->avgSimFrameTime, float(spring_tomsecs(lastSimFrameTime - lastFrameTime)), 0.05f);
 
+	if (simBenchmark != NULL)
+		simBenchmark->EndFrame(gs->frameNum);
+
 	#ifdef HEADLESS
-	{
+	if (simBenchmark == NULL) {
 		const float msecMaxSimFrameTime = 1000.0f / (GAME_SPEED * gs->userSpeedFactor);
 		const float msecDifSimFrameTime = spring_tomsecs(lastSimFrameTime) - spring_tomsecs(lastFrameTime);
 		// multiply by 0.5 to give unsynced code some execution time (50% of our sleep-budget)
@@ -1900,6 +1914,11 @@ void CGame::GameEnd(const std::vector<unsigned char>& winningAllyTeams, bool tim
 	profiler.PrintProfilingInfo();
 #endif // HEADLESS
 
+	if (simBenchmark != NULL) {
+		simBenchmark->WriteResults();
+		gu->globalQuit = true;
+	}
+
 	CDemoRecorder* record = net->GetDemoRecorder();
 
 	if (record != NULL) {
@@ -377,8 +377,8 @@ static inline void QueryUnits(TFilter filter, TQuery& query)
 			if (!filter.Team(t)) {
 				continue;
 			}
-			std::list<CUnit*>::const_iterator ui;
-			const std::list<CUnit*>& allyTeamUnits = quad.teamUnits[t];
+			std::vector<CUnit*>::const_iterator ui;
+			const std::vector<CUnit*>& allyTeamUnits = quad.teamUnits[t];
 			for (ui = allyTeamUnits.begin(); ui != allyTeamUnits.end(); ++ui) {
 				if ((*ui)->tempNum != tempNum) {
 					(*ui)->tempNum = tempNum;
@@ -391,6 +391,39 @@ static inline void QueryUnits(TFilter filter, TQuery& query)
 	}
 }
 
+/**
+ * Same as QueryUnits for filters derived from Filter::Enemy, visits the
+ * units in the same order but reads them from the shared per-allyteam
+ * lists of CQuadField::GetEnemyUnits.
+ */
+template<typename TFilter, typename TQuery>
+static inline void QueryEnemyUnits(TFilter filter, TQuery& query)
+{
+	GML_RECMUTEX_LOCK(qnum);
+
+	const vector<int> &quads = qf->GetQuads(query.pos, query.radius);
+	const int tempNum = gs->tempNum++;
+
+	for (vector<int>::const_iterator qi = quads.begin(); qi != quads.end(); ++qi) {
+		const vector<CUnit*>& quadUnits = qf->GetEnemyUnits(*qi, filter.searchAllyteam);
+
+		// not the vector itself, the filter might (indirectly) cause a rebuild
+		CUnit* const* units = quadUnits.empty()? NULL: &quadUnits[0];
+		const int numUnits = quadUnits.size();
+
+		for (int ui = 0; ui < numUnits; ++ui) {
+			CUnit* unit = units[ui];
+
+			if (unit->tempNum != tempNum) {
+				unit->tempNum = tempNum;
+				if (filter.Unit(unit)) {
+					query.AddUnit(unit);
+				}
+			}
+		}
+	}
+}
+
 
 namespace {
 namespace Filter {
@@ -640,7 +673,7 @@ public:
 static int tempTargetUnits[MAX_UNITS] = {0};
 static int targetTempNum = 2;
 
-void CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* lastTargetUnit, std::multimap<float, CUnit*>& targets)
+void CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* lastTargetUnit, std::vector<WeaponTarget>& targets)
 {
 	const CUnit* attacker = weapon->owner;
 	const float radius    = weapon->range;
@@ -652,119 +685,135 @@ void CGameHelper::GenerateWeaponTargets(const CWeapon* weapon, const CUnit* last
 	const float secDamage = weapon->weaponDef->damages.GetDefaultDamage() * weapon->salvoSize / weapon->reloadTime * GAME_SPEED;
 	const bool paralyzer  = !!weapon->weaponDef->damages.paralyzeDamageTime;
 
-	const std::vector<int>& quads = qf->GetQuads(pos, radius + (aHeight - std::max(0.f, readmap->initMinHeight)) * heightMod);
+	qf->GetQuads(pos, radius + (aHeight - std::max(0.f, readmap->initMinHeight)) * heightMod, targetQuads);
 
 	const int tempNum = targetTempNum++;
 
 	typedef std::vector<int>::const_iterator VectorIt;
-	typedef std::list<CUnit*>::const_iterator ListIt;
 
-	for (VectorIt qi = quads.begin(); qi != quads.end(); ++qi) {
-		for (int t = 0; t < teamHandler->ActiveAllyTeams(); ++t) {
-			if (teamHandler->Ally(attacker->allyteam, t)) {
-				continue;
-			}
+	targets.clear();
+	targetCandidates.clear();
+	targetCandidatePositions.clear();
 
-			const std::list<CUnit*>& allyTeamUnits = qf->GetQuad(*qi).teamUnits[t];
+	// pass 1: collect the enemy units in range (in the same order
+	// as before, pass 2 draws random numbers for each of them)
+	for (VectorIt qi = targetQuads.begin(); qi != targetQuads.end(); ++qi) {
+		const std::vector<CUnit*>& quadUnits = qf->GetEnemyUnits(*qi, attacker->allyteam);
 
-			for (ListIt ui = allyTeamUnits.begin(); ui != allyTeamUnits.end(); ++ui) {
-				CUnit* targetUnit = *ui;
-				float targetPriority = 1.0f;
+		for (std::vector<CUnit*>::const_iterator ui = quadUnits.begin(); ui != quadUnits.end(); ++ui) {
+			CUnit* targetUnit = *ui;
 
-				if (!(targetUnit->category & weapon->onlyTargetCategory)) {
+			if (!(targetUnit->category & weapon->onlyTargetCategory)) {
+				continue;
+			}
+			if (targetUnit->GetTransporter() != NULL) {
+				if (!modInfo.targetableTransportedUnits)
 					continue;
-				}
-				if (targetUnit->GetTransporter() != NULL) {
-					if (!modInfo.targetableTransportedUnits)
-						continue;
-					// the transportee might be "hidden" below terrain, in which case we can't target it
-					if (targetUnit->pos.y < ground->GetHeightReal(targetUnit->pos.x, targetUnit->pos.z))
-						continue;
-				}
-				if (tempTargetUnits[targetUnit->id] == tempNum) {
+				// the transportee might be "hidden" below terrain, in which case we can't target it
+				if (targetUnit->pos.y < ground->GetHeightReal(targetUnit->pos.x, targetUnit->pos.z))
 					continue;
-				}
+			}
+			if (tempTargetUnits[targetUnit->id] == tempNum) {
+				continue;
+			}
 
-				tempTargetUnits[targetUnit->id] = tempNum;
+			tempTargetUnits[targetUnit->id] = tempNum;
 
-				if (targetUnit->isUnderWater && !weapon->weaponDef->waterweapon) {
-					continue;
-				}
-				if (targetUnit->isDead) {
-					continue;
-				}
+			if (targetUnit->isUnderWater && !weapon->weaponDef->waterweapon) {
+				continue;
+			}
+			if (targetUnit->isDead) {
+				continue;
+			}
 
-				float3 targPos;
-				const unsigned short targetLOSState = targetUnit->losStatus[attacker->allyteam];
+			float3 targPos;
+			const unsigned short targetLOSState = targetUnit->losStatus[attacker->allyteam];
 
-				if (targetLOSState & LOS_INLOS) {
-					targPos = targetUnit->aimPos;
-				} else if (targetLOSState & LOS_INRADAR) {
-					targPos = targetUnit->aimPos + (targetUnit->posErrorVector * radarhandler->radarErrorSize[attacker->allyteam]);
-					targetPriority *= 10.0f;
-				} else {
-					continue;
-				}
+			if (targetLOSState & LOS_INLOS) {
+				targPos = targetUnit->aimPos;
+			} else if (targetLOSState & LOS_INRADAR) {
+				targPos = targetUnit->aimPos + (targetUnit->posErrorVector * radarhandler->radarErrorSize[attacker->allyteam]);
+			} else {
+				continue;
+			}
 
-				const float modRange = radius + (aHeight - targPos.y) * heightMod;
+			const float modRange = radius + (aHeight - targPos.y) * heightMod;
 
-				if ((pos - targPos).SqLength2D() > modRange * modRange) {
-					continue;
-				}
+			if ((pos - targPos).SqLength2D() > modRange * modRange) {
+				continue;
+			}
 
-				const float dist2D = (pos - targPos).Length2D();
-				const float rangeMul = (dist2D * weapon->weaponDef->proximityPriority + modRange * 0.4f + 100.0f);
-				const float damageMul = weapon->weaponDef->damages[targetUnit->armorType] * targetUnit->curArmorMultiple;
+			targetCandidates.push_back(targetUnit);
+			targetCandidatePositions.push_back(targPos);
+		}
+	}
 
-				targetPriority *= rangeMul;
+	// pass 2: score the candidates
+	for (unsigned int n = 0; n < targetCandidates.size(); n++) {
+		CUnit* targetUnit = targetCandidates[n];
 
-				if (targetLOSState & LOS_INLOS) {
-					targetPriority *= (secDamage + targetUnit->health);
+		// LuaRules might have killed it while scoring an earlier candidate
+		if (targetUnit->isDead) {
+			continue;
+		}
 
-					if (targetUnit == lastTargetUnit) {
-						targetPriority *= weapon->avoidTarget ? 10.0f : 0.4f;
-					}
+		const float3& targPos = targetCandidatePositions[n];
+		const unsigned short targetLOSState = targetUnit->losStatus[attacker->allyteam];
 
-					if (paralyzer && targetUnit->paralyzeDamage > (modInfo.paralyzeOnMaxHealth? targetUnit->maxHealth: targetUnit->health)) {
-						targetPriority *= 4.0f;
-					}
+		const float modRange = radius + (aHeight - targPos.y) * heightMod;
+		const float dist2D = (pos - targPos).Length2D();
+		const float rangeMul = (dist2D * weapon->weaponDef->proximityPriority + modRange * 0.4f + 100.0f);
+		const float damageMul = weapon->weaponDef->damages[targetUnit->armorType] * targetUnit->curArmorMultiple;
 
-					if (weapon->hasTargetWeight) {
-						targetPriority *= weapon->TargetWeight(targetUnit);
-					}
-				} else {
-					targetPriority *= (secDamage + 10000.0f);
-				}
+		float targetPriority = (targetLOSState & LOS_INLOS)? 1.0f: 10.0f;
 
-				if (targetLOSState & LOS_PREVLOS) {
-					targetPriority /= (damageMul * targetUnit->power * (0.7f + gs->randFloat() * 0.6f));
+		targetPriority *= rangeMul;
 
-					if (targetUnit->category & weapon->badTargetCategory) {
-						targetPriority *= 100.0f;
-					}
-					if (targetUnit->crashing) {
-						targetPriority *= 1000.0f;
-					}
-				}
+		if (targetLOSState & LOS_INLOS) {
+			targetPriority *= (secDamage + targetUnit->health);
 
-				if (luaRules != NULL) {
-					const bool targetAllowed = luaRules->AllowWeaponTarget(attacker->id, targetUnit->id, weapon->weaponNum, weapon->weaponDef->id, &targetPriority);
-					if (!targetAllowed) {
-						continue;
-					}
-				}
+			if (targetUnit == lastTargetUnit) {
+				targetPriority *= weapon->avoidTarget ? 10.0f : 0.4f;
+			}
+
+			if (paralyzer && targetUnit->paralyzeDamage > (modInfo.paralyzeOnMaxHealth? targetUnit->maxHealth: targetUnit->health)) {
+				targetPriority *= 4.0f;
+			}
+
+			if (weapon->hasTargetWeight) {
+				targetPriority *= weapon->TargetWeight(targetUnit);
+			}
+		} else {
+			targetPriority *= (secDamage + 10000.0f);
+		}
+
+		if (targetLOSState & LOS_PREVLOS) {
+			targetPriority /= (damageMul * targetUnit->power * (0.7f + gs->randFloat() * 0.6f));
 
-				targets.insert(std::pair<float, CUnit*>(targetPriority, targetUnit));
+			if (targetUnit->category & weapon->badTargetCategory) {
+				targetPriority *= 100.0f;
+			}
+			if (targetUnit->crashing) {
+				targetPriority *= 1000.0f;
 			}
 		}
+
+		if (luaRules != NULL) {
+			const bool targetAllowed = luaRules->AllowWeaponTarget(attacker->id, targetUnit->id, weapon->weaponNum, weapon->weaponDef->id, &targetPriority);
+			if (!targetAllowed) {
+				continue;
+			}
+		}
+
+		targets.push_back(WeaponTarget(targetPriority, targets.size(), targetUnit));
 	}
 
 #ifdef TRACE_SYNC
 	{
 		tracefile << "[GenerateWeaponTargets] attackerID, attackRadius: " << attacker->id << ", " << radius << " ";
 
-		for (std::multimap<float, CUnit*>::const_iterator ti = targets.begin(); ti != targets.end(); ++ti)
-			tracefile << "\tpriority: " << (ti->first) <<  ", targetID: " << (ti->second)->id <<  " ";
+		for (std::vector<WeaponTarget>::const_iterator ti = targets.begin(); ti != targets.end(); ++ti)
+			tracefile << "\tpriority: " << (ti->priority) <<  ", targetID: " << (ti->unit)->id <<  " ";
 
 		tracefile << "\n";
 	}
@@ -781,14 +830,14 @@ CUnit* CGameHelper::GetClosestUnit(const float3 &pos, float searchRadius)
 CUnit* CGameHelper::GetClosestEnemyUnit(const float3& pos, float searchRadius, int searchAllyteam)
 {
 	Query::ClosestUnit q(pos, searchRadius);
-	QueryUnits(Filter::Enemy_InLos(searchAllyteam), q);
+	QueryEnemyUnits(Filter::Enemy_InLos(searchAllyteam), q);
 	return q.GetClosestUnit();
 }
 
 CUnit* CGameHelper::GetClosestValidTarget(const float3& pos, float searchRadius, int searchAllyteam, const CMobileCAI* cai)
 {
 	Query::ClosestUnit q(pos, searchRadius);
-	QueryUnits(Filter::Enemy_InLos_ValidTarget(searchAllyteam, cai), q);
+	QueryEnemyUnits(Filter::Enemy_InLos_ValidTarget(searchAllyteam, cai), q);
 	return q.GetClosestUnit();
 }
 
@@ -798,13 +847,13 @@ CUnit* CGameHelper::GetClosestEnemyUnitNoLosTest(const float3 &pos, float search
 	if (sphere) { // includes target radius
 
 		Query::ClosestUnit_InLos q(pos, searchRadius, canBeBlind);
-		QueryUnits(Filter::Enemy(searchAllyteam), q);
+		QueryEnemyUnits(Filter::Enemy(searchAllyteam), q);
 		return q.GetClosestUnit();
 
 	} else { // cylinder  (doesn't include target radius)
 
 		Query::ClosestUnit_InLos_Cylinder q(pos, searchRadius, canBeBlind);
-		QueryUnits(Filter::Enemy(searchAllyteam), q);
+		QueryEnemyUnits(Filter::Enemy(searchAllyteam), q);
 		return q.GetClosestUnit();
 
 	}
@@ -820,20 +869,20 @@ CUnit* CGameHelper::GetClosestFriendlyUnit(const float3 &pos, float searchRadius
 CUnit* CGameHelper::GetClosestEnemyAircraft(const float3 &pos, float searchRadius, int searchAllyteam)
 {
 	Query::ClosestUnit q(pos, searchRadius);
-	QueryUnits(Filter::EnemyAircraft(searchAllyteam), q);
+	QueryEnemyUnits(Filter::EnemyAircraft(searchAllyteam), q);
 	return q.GetClosestUnit();
 }
 
 void CGameHelper::GetEnemyUnits(const float3 &pos, float searchRadius, int searchAllyteam, vector<int> &found)
 {
 	Query::AllUnitsById q(pos, searchRadius, found);
-	QueryUnits(Filter::Enemy_InLos(searchAllyteam), q);
+	QueryEnemyUnits(Filter::Enemy_InLos(searchAllyteam), q);
 }
 
 void CGameHelper::GetEnemyUnitsNoLosTest(const float3 &pos, float searchRadius, int searchAllyteam, vector<int> &found)
 {
 	Query::AllUnitsById q(pos, searchRadius, found);
-	QueryUnits(Filter::Enemy(searchAllyteam), q);
+	QueryEnemyUnits(Filter::Enemy(searchAllyteam), q);
 }
 
 
@@ -5,6 +5,7 @@
 
 #include "Sim/Misc/DamageArray.h"
 #include "Sim/Projectiles/ExplosionListener.h"
+#include "Sim/Weapons/WeaponTarget.h"
 #include "System/float3.h"
 #include "System/MemPool.h"
 
@@ -75,7 +76,12 @@ public:
 	float3 ClosestBuildSite(int team, const UnitDef* unitDef, float3 pos, float searchRadius, int minDist, int facing = 0);
 
 	void Update();
-	void GenerateWeaponTargets(const CWeapon* weapon, const CUnit* lastTargetUnit, std::multimap<float, CUnit*>& targets);
+	/**
+	 * Clears <targets> and fills it with all units <weapon> could target,
+	 * unsorted (see SortWeaponTargets). Reuses internal buffers, so this
+	 * does not allocate once they have grown large enough.
+	 */
+	void GenerateWeaponTargets(const CWeapon* weapon, const CUnit* lastTargetUnit, std::vector<WeaponTarget>& targets);
 
 	void DoExplosionDamage(CUnit* unit, CUnit* owner, const float3& expPos, float expRad, float expSpeed, float edgeEffectiveness, bool ignoreOwner, const DamageArray& damages, const int weaponDefID);
 	void DoExplosionDamage(CFeature* feature, const float3& expPos, float expRad, const DamageArray& damages, const int weaponDefID);
@@ -85,6 +91,11 @@ public:
 private:
 	CStdExplosionGenerator* stdExplosionGenerator;
 
+	// scratch buffers of GenerateWeaponTargets
+	std::vector<int> targetQuads;
+	std::vector<CUnit*> targetCandidates;
+	std::vector<float3> targetCandidatePositions;
+
 	struct WaitingDamage{
 #if !defined(SYNCIFY) && !defined(USE_MMGR)
 		inline void* operator new(size_t size) {
@@ -119,8 +119,9 @@ void SetBoolArg(bool& value, const std::string& str)
 
 CGameServer* gameServer = 0;
 
-CGameServer::CGameServer(const std::string& hostIP, int hostPort, const GameData* const newGameData, const CGameSetup* const mysetup)
+CGameServer::CGameServer(const std::string& hostIP, int hostPort, const GameData* const newGameData, const CGameSetup* const mysetup, const bool ownThread)
 : setup(mysetup)
+, thread(NULL)
 {
 	assert(setup);
 	serverStartTime = spring_gettime();
@@ -134,6 +135,7 @@ CGameServer::CGameServer(const std::string& hostIP, int hostPort, const GameData
 	gameTime = 0.0f;
 	startTime = 0.0f;
 	quitServer=false;
+	shutdownStage = SHUTDOWN_NONE;
 	hasLocalClient = false;
 	localClientNumber = 0;
 	isPaused = false;
@@ -247,7 +249,9 @@ CGameServer::CGameServer(const std::string& hostIP, int hostPort, const GameData
 	linkMinPacketSize = globalConfig->linkIncomingMaxPacketRate > 0 ? (globalConfig->linkIncomingSustainedBandwidth / globalConfig->linkIncomingMaxPacketRate) : 1;
 	lastBandwidthUpdate = spring_gettime();
 
-	thread = new boost::thread(boost::bind<void, CGameServer, CGameServer*>(&CGameServer::UpdateLoop, this));
+	if (ownThread) {
+		thread = new boost::thread(boost::bind<void, CGameServer, CGameServer*>(&CGameServer::UpdateLoop, this));
+	}
 
 #ifdef STREFLOP_H
 	// Something in CGameServer::CGameServer borks the FPU control word
@@ -260,8 +264,12 @@ CGameServer::CGameServer(const std::string& hostIP, int hostPort, const GameData
 CGameServer::~CGameServer()
 {
 	quitServer=true;
-	thread->join();
-	delete thread;
+	if (thread) {
+		thread->join();
+		delete thread;
+	} else {
+		Shutdown();
+	}
 #ifdef DEDICATED
 	// TODO: move this to a method in CTeamHandler
 	int numTeams = (int)setup->teamStartingData.size();
@@ -555,6 +563,10 @@ bool CGameServer::SendDemoData(int targetFrameNum)
 		Message(DemoEnd);
 		gameEndTime = spring_gettime();
 		ret = false;
+#ifdef HEADLESS_BENCHMARK
+		// the quit message reaches the client after the last frame
+		quitServer = true;
+#endif
 	}
 
 	return ret;
@@ -752,6 +764,13 @@ void CGameServer::Update()
 		// <modGameTime>
 		if (!demoReader || !hasLocalClient || (serverFrameNum - players[localClientNumber].lastFrameResponse) < GAME_SPEED)
 			modGameTime += (tdif * internalSpeed);
+
+#ifdef HEADLESS_BENCHMARK
+		// replay as fast as the local client can simulate: whenever it
+		// is less than <GAME_SPEED> frames behind, queue another second
+		if (demoReader && hasLocalClient && (serverFrameNum - players[localClientNumber].lastFrameResponse) < GAME_SPEED)
+			modGameTime = std::max(modGameTime, demoReader->GetModGameTime() + 1.0f);
+#endif
 	}
 
 	if (lastPlayerInfo < (spring_gettime() - playerInfoTime)) {
@@ -2249,27 +2268,74 @@ void CGameServer::UpdateLoop()
 
 		while (!quitServer) {
 			spring_sleep(spring_msecs(10));
+			Poll();
+		}
 
-			if (UDPNet)
-				UDPNet->Update();
+		Shutdown();
+	} CATCH_SPRING_ERRORS
+}
 
-			Threading::RecursiveScopedLock scoped_lock(gameServerMutex);
-			ServerReadNet();
-			Update();
-		}
+bool CGameServer::Poll()
+{
+	if (quitServer)
+		return PollShutdown();
 
-		if (hostif)
-			hostif->SendQuit();
-		Broadcast(CBaseNetProtocol::Get().SendQuit("Server shutdown"));
+	if (UDPNet)
+		UDPNet->Update();
 
-		// flush the quit messages to reduce ugly network error messages on the client side
-		spring_sleep(spring_msecs(1000)); // this is to make sure the Flush has any effect at all (we don't want a forced flush)
-		for (size_t i = 0; i < players.size(); ++i) {
-			if (players[i].link)
-				players[i].link->Flush();
-		}
-		spring_sleep(spring_msecs(3000)); // now let clients close their connections
-	} CATCH_SPRING_ERRORS
+	Threading::RecursiveScopedLock scoped_lock(gameServerMutex);
+	ServerReadNet();
+	Update();
+
+	return true;
+}
+
+void CGameServer::Shutdown()
+{
+	while (PollShutdown()) {
+		spring_sleep(spring_msecs(10));
+	}
+}
+
+bool CGameServer::PollShutdown()
+{
+	Threading::RecursiveScopedLock scoped_lock(gameServerMutex);
+
+	const spring_time now = spring_gettime();
+
+	switch (shutdownStage) {
+		case SHUTDOWN_NONE: {
+			if (hostif)
+				hostif->SendQuit();
+			Broadcast(CBaseNetProtocol::Get().SendQuit("Server shutdown"));
+
+			shutdownStage = SHUTDOWN_QUIT_SENT;
+			shutdownTime = now;
+		} break;
+		case SHUTDOWN_QUIT_SENT: {
+			// flush the quit messages to reduce ugly network error messages on the client side
+			// wait a bit before, to make sure the Flush has any effect at all (we don't want a forced flush)
+			if (now - shutdownTime < spring_msecs(1000))
+				break;
+
+			for (size_t i = 0; i < players.size(); ++i) {
+				if (players[i].link)
+					players[i].link->Flush();
+			}
+
+			shutdownStage = SHUTDOWN_FLUSHED;
+			shutdownTime = now;
+		} break;
+		case SHUTDOWN_FLUSHED: {
+			// now let clients close their connections
+			if (now - shutdownTime >= spring_msecs(3000))
+				shutdownStage = SHUTDOWN_DONE;
+		} break;
+		case SHUTDOWN_DONE: {
+		} break;
+	}
+
+	return (shutdownStage != SHUTDOWN_DONE);
 }
 
 bool CGameServer::WaitsOnCon() const
@@ -2509,5 +2575,11 @@ void CGameServer::AddToPacketCache(boost::shared_ptr<const netcode::RawPacket> &
 		packetCache.push_back(std::vector<boost::shared_ptr<const netcode::RawPacket> >());
 		packetCache.back().reserve(PKTCACHE_VECSIZE);
 	}
-	packetCache.back().push_back(pckt);
+	if (pckt->IsReference()) {
+		// forwarded packets reference the whole datagram they were received
+		// in, do not keep that alive for the rest of the game
+		packetCache.back().push_back(boost::shared_ptr<const netcode::RawPacket>(new netcode::RawPacket(pckt->data, pckt->length)));
+	} else {
+		packetCache.back().push_back(pckt);
+	}
 }
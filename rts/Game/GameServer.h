@@ -62,7 +62,12 @@ class CGameServer
 {
 	friend class CCregLoadSaveHandler; // For initializing server state after load
 public:
-	CGameServer(const std::string& hostIP, int hostPort, const GameData* const gameData, const CGameSetup* const setup);
+	/**
+	 * @param ownThread if false, no server thread is started and the owner
+	 *   has to call Poll() regularly instead (spring-dedicated does this to
+	 *   drive many servers from a single network loop)
+	 */
+	CGameServer(const std::string& hostIP, int hostPort, const GameData* const gameData, const CGameSetup* const setup, const bool ownThread = true);
 	~CGameServer();
 
 	void AddLocalClient(const std::string& myName, const std::string& myVersion);
@@ -86,6 +91,15 @@ public:
 	/// Is the server still running?
 	bool HasFinished() const;
 
+	/**
+	 * @brief receive, process and send network data once
+	 * Has to be called about every 10ms for servers without their own thread.
+	 * Once the game has ended, this says goodbye to the clients over the
+	 * next few seconds of calls instead of blocking like the destructor.
+	 * @return false once the server has finished and said goodbye
+	 */
+	bool Poll();
+
 	void UpdateSpeedControl(int speedCtrl);
 	static std::string SpeedControlToString(int speedCtrl);
 
@@ -112,6 +126,10 @@ private:
 	void CheckForGameStart(bool forced=false);
 	void StartGame();
 	void UpdateLoop();
+	/// say goodbye to the clients and give them time to disconnect
+	void Shutdown();
+	/// one step of Shutdown, @return false when it is complete
+	bool PollShutdown();
 	void Update();
 	void ProcessPacket(const unsigned playerNum, boost::shared_ptr<const netcode::RawPacket> packet);
 	void CheckSync();
@@ -148,6 +166,15 @@ private:
 
 	unsigned char playerNumberMap[256];
 	volatile bool quitServer;
+
+	enum ShutdownStage {
+		SHUTDOWN_NONE,
+		SHUTDOWN_QUIT_SENT,
+		SHUTDOWN_FLUSHED,
+		SHUTDOWN_DONE
+	};
+	ShutdownStage shutdownStage;
+	spring_time shutdownTime;
 	int serverFrameNum;
 
 	spring_time serverStartTime;
@@ -12,6 +12,7 @@
 #include "Sim/Misc/QuadField.h"
 #include "Sim/Misc/TeamHandler.h"
 #include "Sim/MoveTypes/MoveType.h"
+#include "Sim/Path/IPathManager.h"
 #include "Sim/Units/UnitHandler.h"
 #include "Sim/Units/CommandAI/CommandAI.h"
 #include "Sim/Units/Unit.h"
@@ -109,6 +110,14 @@ void CSelectedUnitsAI::GiveCommandNet(Command &c, int player)
 	const int nbrOfSelectedUnits = netSelected.size();
 	const int& cmd_id = c.GetID();
 
+	// paths requested by the units while they receive the order
+	// are searched together (see IPathManager::RequestPaths)
+	const bool batchPaths = (nbrOfSelectedUnits > 1);
+
+	if (batchPaths) {
+		pathManager->BeginPathBatch();
+	}
+
 	if (nbrOfSelectedUnits < 1) {
 		// no units to command
 	}
@@ -248,6 +257,10 @@ void CSelectedUnitsAI::GiveCommandNet(Command &c, int player)
 			}
 		}
 	}
+
+	if (batchPaths) {
+		pathManager->EndPathBatch();
+	}
 }
 
 
@@ -0,0 +1,202 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "SimBenchmark.h"
+
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#if !defined(WIN32)
+	#include <sys/resource.h>
+#endif
+
+#include "System/mmgr.h"
+#include "System/Log/ILog.h"
+#include "System/TimeProfiler.h"
+#include "System/TraceProfiler.h"
+
+CSimBenchmark* simBenchmark = NULL;
+
+
+static const char* subsystems[] = {"units", "projectiles", "path", "los", "lua"};
+
+// the outermost profiler sections of every subsystem (its time is their
+// sum); sections nested in another one of the same subsystem, such as
+// PathManager::ExecuteQueuedSearches in PathManager::Update, must not be
+// listed or they would be counted twice
+static const struct {
+	unsigned int subsystem;
+	const char* section;
+} subsystemSections[] = {
+	{0, "Unit::MoveType::Update"},
+	{0, "Unit::Update"},
+	{0, "Unit::SlowUpdate"},
+	{1, "ProjectileHandler::CheckCollisions"},
+	{1, "ProjectileHandler::Update"},
+	{2, "PathManager::Update"},
+	{2, "PathManager::TerrainChange"},
+	{2, "PathManager::RequestPath"},
+	{2, "PathManager::RequestPaths"},
+	{2, "PathManager::NextWayPoint"},
+	{3, "LOSHandler::MoveUnit"},
+	{3, "LOSHandler::LosAdd"},
+	{4, "Lua"},
+};
+
+static std::string Quote(const std::string& str)
+{
+	std::string ret = "\"";
+
+	for (size_t n = 0; n < str.size(); n++) {
+		if (str[n] == '"' || str[n] == '\\')
+			ret += '\\';
+		ret += str[n];
+	}
+
+	return (ret + "\"");
+}
+
+/// @return peak resident set size in KB, or -1 if unknown
+static long GetPeakRSS()
+{
+#if defined(WIN32)
+	return -1;
+#else
+	rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return -1;
+
+	#if defined(__APPLE__)
+	// bytes on OS X, KB everywhere else
+	return (usage.ru_maxrss / 1024);
+	#else
+	return usage.ru_maxrss;
+	#endif
+#endif
+}
+
+
+
+CSimBenchmark::CSimBenchmark(const std::string& demoFile, const std::string& outputFile)
+	: demoFile(demoFile)
+	, outputFile(outputFile)
+	, startTime(0)
+	, frameStartTime(0)
+	, totalFrameTime(0)
+	, maxFrameTime(0)
+	, numFrames(0)
+	, maxFrameNum(0)
+	, written(false)
+{
+}
+
+CSimBenchmark::~CSimBenchmark()
+{
+	WriteResults();
+}
+
+
+void CSimBenchmark::StartFrame()
+{
+	frameStartTime = TraceProfiler::GetTime();
+
+	if (numFrames > 0)
+		return;
+
+	// loading time does not count
+	startTime = frameStartTime;
+
+	std::map<std::string, CTimeProfiler::TimeRecord>::const_iterator pi;
+	for (pi = profiler.profile.begin(); pi != profiler.profile.end(); ++pi) {
+		startTotals[pi->first] = pi->second.preciseTotal;
+		startCalls[pi->first] = pi->second.calls;
+	}
+}
+
+void CSimBenchmark::EndFrame(int frameNum)
+{
+	const boost::int64_t frameTime = TraceProfiler::GetTime() - frameStartTime;
+
+	if (frameTime > maxFrameTime) {
+		maxFrameTime = frameTime;
+		maxFrameNum = frameNum;
+	}
+
+	totalFrameTime += frameTime;
+	numFrames += 1;
+}
+
+
+void CSimBenchmark::WriteResults()
+{
+	if (written)
+		return;
+
+	written = true;
+
+	const double wallTime = (numFrames > 0)? ((TraceProfiler::GetTime() - startTime) * 1e-6): 0.0;
+	const double simTime = totalFrameTime * 1e-6;
+	const unsigned int numSubsystems = sizeof(subsystems) / sizeof(subsystems[0]);
+	const unsigned int numSubsystemSections = sizeof(subsystemSections) / sizeof(subsystemSections[0]);
+
+	std::map<std::string, double> sectionTimes;
+	std::map<std::string, unsigned> sectionCalls;
+	std::vector<double> subsystemTimes(numSubsystems, 0.0);
+
+	std::map<std::string, CTimeProfiler::TimeRecord>::const_iterator pi;
+	for (pi = profiler.profile.begin(); pi != profiler.profile.end(); ++pi) {
+		// sections missing from the start totals were first used in-game
+		const double time = (pi->second.preciseTotal - startTotals[pi->first]) * 1e-6;
+
+		if (pi->second.calls == startCalls[pi->first])
+			continue;
+
+		sectionTimes[pi->first] = time;
+		sectionCalls[pi->first] = pi->second.calls - startCalls[pi->first];
+
+		for (unsigned int n = 0; n < numSubsystemSections; n++) {
+			if (pi->first == subsystemSections[n].section) {
+				subsystemTimes[subsystemSections[n].subsystem] += time;
+			}
+		}
+	}
+
+	std::ofstream out(outputFile.c_str());
+
+	if (!out.good()) {
+		LOG_L(L_ERROR, "[SimBenchmark] could not write results to \"%s\"", outputFile.c_str());
+		return;
+	}
+
+	// times are in seconds
+	out << std::fixed << std::setprecision(6);
+	out << "{\n";
+	out << "  \"demo\": " << Quote(demoFile) << ",\n";
+	out << "  \"frames\": " << numFrames << ",\n";
+	out << "  \"wallTime\": " << wallTime << ",\n";
+	out << "  \"fps\": " << ((wallTime > 0.0)? (numFrames / wallTime): 0.0) << ",\n";
+	out << "  \"simTime\": " << simTime << ",\n";
+	out << "  \"simFps\": " << ((simTime > 0.0)? (numFrames / simTime): 0.0) << ",\n";
+	out << "  \"maxFrameTime\": " << (maxFrameTime * 1e-6) << ",\n";
+	out << "  \"maxFrameNum\": " << maxFrameNum << ",\n";
+	out << "  \"peakRSS\": " << GetPeakRSS() << ",\n";
+
+	out << "  \"subsystems\": {\n";
+	for (unsigned int n = 0; n < numSubsystems; n++) {
+		out << "    " << Quote(subsystems[n]) << ": " << subsystemTimes[n] << ((n + 1 < numSubsystems)? ",\n": "\n");
+	}
+	out << "  },\n";
+
+	out << "  \"sections\": {\n";
+	for (std::map<std::string, double>::const_iterator it = sectionTimes.begin(); it != sectionTimes.end(); ++it) {
+		if (it != sectionTimes.begin())
+			out << ",\n";
+
+		out << "    " << Quote(it->first) << ": {\"time\": " << it->second << ", \"calls\": " << sectionCalls[it->first] << "}";
+	}
+	out << "\n  }\n";
+	out << "}\n";
+
+	LOG("[SimBenchmark] %d frames in %.2fs (%.1f fps), results written to %s",
+			numFrames, wallTime, ((wallTime > 0.0)? (numFrames / wallTime): 0.0), outputFile.c_str());
+}
@@ -0,0 +1,54 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef SIM_BENCHMARK_H
+#define SIM_BENCHMARK_H
+
+#include <map>
+#include <string>
+#include <boost/cstdint.hpp>
+
+/**
+ * Measures simulation throughput while a demo is replayed (only created
+ * by the spring-headless-bench build, which also removes all frame
+ * limiting) and writes the results as JSON:
+ *  - number of frames, wall-clock time and frames per second
+ *  - total and slowest SimFrame time
+ *  - inclusive time of every SCOPED_TIMER section and of the subsystems
+ *    they belong to (sections nest, e.g. path requests are made from
+ *    unit updates, so subsystem times can overlap)
+ *  - peak resident set size of the process
+ */
+class CSimBenchmark
+{
+public:
+	CSimBenchmark(const std::string& demoFile, const std::string& outputFile);
+	~CSimBenchmark();
+
+	void StartFrame();
+	void EndFrame(int frameNum);
+
+	/// writes the results (only once), called on game end or on exit
+	void WriteResults();
+
+private:
+	std::string demoFile;
+	std::string outputFile;
+
+	/// profiler section totals (microseconds) and call counts when the first frame started
+	std::map<std::string, boost::int64_t> startTotals;
+	std::map<std::string, unsigned> startCalls;
+
+	boost::int64_t startTime;
+	boost::int64_t frameStartTime;
+	boost::int64_t totalFrameTime;
+	boost::int64_t maxFrameTime;
+
+	int numFrames;
+	int maxFrameNum;
+
+	bool written;
+};
+
+extern CSimBenchmark* simBenchmark;
+
+#endif // SIM_BENCHMARK_H
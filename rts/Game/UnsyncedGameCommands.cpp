@@ -47,6 +47,7 @@
 #include "Rendering/TeamHighlight.h"
 #include "Rendering/UnitDrawer.h"
 #include "Rendering/VerticalSync.h"
+#include "Lua/LuaCallInCheck.h"
 #include "Lua/LuaOpenGL.h"
 #include "Lua/LuaUI.h"
 #include "Sim/Misc/TeamHandler.h"
@@ -3072,6 +3073,66 @@ public:
 
 
 
+class TraceProfileActionExecutor : public IUnsyncedActionExecutor {
+public:
+	TraceProfileActionExecutor() : IUnsyncedActionExecutor("TraceProfile",
+			"Records all profiled sections per thread and writes them in"
+			" Chrome trace format: start, stop, dump [file]") {}
+
+	bool Execute(const UnsyncedAction& action) const {
+		const std::vector<std::string>& args = _local_strSpaceTokenize(action.GetArgs());
+
+		if (args.empty()) {
+			LOG_L(L_WARNING, "Give either of these as argument: start, stop, dump [file]");
+		} else if (args[0] == "start") {
+			TraceProfiler::Start();
+			LOG("[TraceProfiler] recording");
+		} else if (args[0] == "stop") {
+			TraceProfiler::Stop();
+			LOG("[TraceProfiler] stopped");
+		} else if (args[0] == "dump") {
+			TraceProfiler::Dump((args.size() > 1)? args[1]: "trace.json");
+		} else {
+			LOG_L(L_WARNING, "Give either of these as argument: start, stop, dump [file]");
+		}
+		return true;
+	}
+};
+
+
+
+class LuaProfileActionExecutor : public IUnsyncedActionExecutor {
+public:
+	LuaProfileActionExecutor() : IUnsyncedActionExecutor("LuaProfile",
+			"Collects wall-time and allocation counters per Lua handle and"
+			" call-in: start, stop, reset, print [lines], dump [file]") {}
+
+	bool Execute(const UnsyncedAction& action) const {
+		const std::vector<std::string>& args = _local_strSpaceTokenize(action.GetArgs());
+
+		if (args.empty()) {
+			LOG_L(L_WARNING, "Give either of these as argument: start, stop, reset, print [lines], dump [file]");
+		} else if (args[0] == "start") {
+			LuaCallInProfiler::Start();
+			LOG("[LuaCallInProfiler] collecting");
+		} else if (args[0] == "stop") {
+			LuaCallInProfiler::Stop();
+			LOG("[LuaCallInProfiler] stopped");
+		} else if (args[0] == "reset") {
+			LuaCallInProfiler::Reset();
+		} else if (args[0] == "print") {
+			LuaCallInProfiler::Print((args.size() > 1)? std::max(1, atoi(args[1].c_str())): 20);
+		} else if (args[0] == "dump") {
+			LuaCallInProfiler::Dump((args.size() > 1)? args[1]: "luaprofile.json");
+		} else {
+			LOG_L(L_WARNING, "Give either of these as argument: start, stop, reset, print [lines], dump [file]");
+		}
+		return true;
+	}
+};
+
+
+
 class BenchmarkScriptActionExecutor : public IUnsyncedActionExecutor {
 public:
 	// XXX '-' in command name is inconsistent with the rest of the commands, which only use "[a-zA-Z]" -> remove it
@@ -3413,6 +3474,8 @@ void UnsyncedGameCommands::AddDefaultActionExecutors() {
 	AddActionExecutor(new SaveActionExecutor());
 	AddActionExecutor(new ReloadGameActionExecutor());
 	AddActionExecutor(new DebugInfoActionExecutor());
+	AddActionExecutor(new TraceProfileActionExecutor());
+	AddActionExecutor(new LuaProfileActionExecutor());
 	AddActionExecutor(new BenchmarkScriptActionExecutor());
 	// XXX are these redirects really required?
 	AddActionExecutor(new RedirectToSyncedActionExecutor("ATM"));
@@ -3,14 +3,26 @@
 #include "System/mmgr.h"
 
 #include "LuaCallInCheck.h"
+#include "LuaHandle.h"
 #include "LuaInclude.h"
+#include "System/TraceProfiler.h"
+#include "System/FileSystem/DataDirsAccess.h"
+#include "System/FileSystem/FileQueryFlags.h"
 #include "System/Log/ILog.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
 
 /******************************************************************************/
 /******************************************************************************/
 
-LuaCallInCheck::LuaCallInCheck(lua_State* _L, const char* name)
+void LuaCallInCheck::CheckBegin(lua_State* _L, const char* name)
 {
 	L = _L;
 	startTop = lua_gettop(L);
@@ -18,7 +30,7 @@ LuaCallInCheck::LuaCallInCheck(lua_State* _L, const char* name)
 }
 
 
-LuaCallInCheck::~LuaCallInCheck()
+void LuaCallInCheck::CheckEnd()
 {
 	const int endTop = lua_gettop(L);
 	if (startTop != endTop) {
@@ -32,3 +44,274 @@ LuaCallInCheck::~LuaCallInCheck()
 /******************************************************************************/
 /******************************************************************************/
 
+namespace LuaCallInProfiler {
+	struct CallInStats {
+		CallInStats(): calls(0), totalTime(0), selfTime(0), maxTime(0), numAllocs(0), allocBytes(0), selfAllocs(0), selfAllocBytes(0) {}
+
+		boost::uint64_t calls;
+		/// microseconds
+		boost::int64_t totalTime;
+		boost::int64_t selfTime;
+		boost::int64_t maxTime;
+		boost::uint64_t numAllocs;
+		boost::uint64_t allocBytes;
+		boost::uint64_t selfAllocs;
+		boost::uint64_t selfAllocBytes;
+	};
+
+	struct CStrLess {
+		bool operator() (const char* a, const char* b) const { return (strcmp(a, b) < 0); }
+	};
+
+	// call-in name (a __FUNCTION__ literal) -> counters
+	typedef std::map<const char*, CallInStats, CStrLess> HandleStats;
+
+	struct StatsLine {
+		StatsLine(const std::string* handleName, const char* callInName, const CallInStats* stats)
+			: handleName(handleName), callInName(callInName), stats(stats) {}
+
+		bool operator < (const StatsLine& l) const { return (stats->selfTime > l.stats->selfTime); }
+
+		const std::string* handleName;
+		const char* callInName;
+		const CallInStats* stats;
+	};
+
+
+	volatile bool enabled = false;
+
+	static boost::int64_t startTime = 0;
+	static boost::int64_t stopTime = 0;
+
+	static boost::mutex statsMutex;
+	static std::map<std::string, HandleStats> handleStats;
+
+	// innermost running (profiled) call-in of each thread
+	static void KeepCallInCheck(LuaCallInCheck*) {}
+	static boost::thread_specific_ptr<LuaCallInCheck> activeCallIn(&KeepCallInCheck);
+
+
+	static const std::string& GetHandleName(const lua_State* L)
+	{
+		static const std::string unknownName = "unknown";
+
+		if (L == NULL || L->lcd == NULL || L->lcd->owner == NULL)
+			return unknownName;
+
+		return L->lcd->owner->GetName();
+	}
+
+	static void AddCallIn(
+		const lua_State* L,
+		const char* callInName,
+		boost::int64_t time,
+		boost::int64_t selfTime,
+		boost::uint64_t numAllocs,
+		boost::uint64_t allocBytes,
+		boost::uint64_t selfAllocs,
+		boost::uint64_t selfAllocBytes
+	) {
+		boost::mutex::scoped_lock lock(statsMutex);
+
+		const std::string& handleName = GetHandleName(L);
+		std::map<std::string, HandleStats>::iterator hit = handleStats.find(handleName);
+
+		if (hit == handleStats.end())
+			hit = handleStats.insert(std::make_pair(handleName, HandleStats())).first;
+
+		CallInStats& stats = hit->second[callInName];
+
+		stats.calls++;
+		stats.totalTime += time;
+		stats.selfTime += selfTime;
+		stats.maxTime = std::max(stats.maxTime, time);
+		stats.numAllocs += numAllocs;
+		stats.allocBytes += allocBytes;
+		stats.selfAllocs += selfAllocs;
+		stats.selfAllocBytes += selfAllocBytes;
+	}
+
+	static void GetStatsLines(std::vector<StatsLine>& lines)
+	{
+		std::map<std::string, HandleStats>::const_iterator hit;
+		HandleStats::const_iterator cit;
+
+		for (hit = handleStats.begin(); hit != handleStats.end(); ++hit) {
+			for (cit = hit->second.begin(); cit != hit->second.end(); ++cit) {
+				lines.push_back(StatsLine(&hit->first, cit->first, &cit->second));
+			}
+		}
+
+		std::stable_sort(lines.begin(), lines.end());
+	}
+
+	static boost::int64_t GetDuration()
+	{
+		return ((enabled? TraceProfiler::GetTime(): stopTime) - startTime);
+	}
+
+	static void WriteEscaped(FILE* file, const char* str)
+	{
+		for (; *str != 0; ++str) {
+			if (*str == '"' || *str == '\\') {
+				fputc('\\', file);
+			}
+			if (static_cast<unsigned char>(*str) >= 0x20) {
+				fputc(*str, file);
+			}
+		}
+	}
+
+
+	void Start()
+	{
+		Reset();
+		enabled = true;
+	}
+
+	void Stop()
+	{
+		if (enabled)
+			stopTime = TraceProfiler::GetTime();
+
+		enabled = false;
+	}
+
+	void Reset()
+	{
+		boost::mutex::scoped_lock lock(statsMutex);
+
+		handleStats.clear();
+		startTime = TraceProfiler::GetTime();
+		stopTime = startTime;
+	}
+
+	void Print(unsigned int numLines)
+	{
+		boost::mutex::scoped_lock lock(statsMutex);
+		std::vector<StatsLine> lines;
+
+		GetStatsLines(lines);
+
+		const float duration = std::max(boost::int64_t(1), GetDuration()) * 0.001f;
+
+		LOG("[LuaCallInProfiler] %.1fs, %u call-ins profiled", duration * 0.001f, (unsigned int) lines.size());
+		LOG("%-20s %-28s %9s %10s %10s %8s %8s %10s", "handle", "call-in", "calls", "self (ms)", "total (ms)", "max (ms)", "self %", "self kB");
+
+		for (unsigned int n = 0; n < std::min(numLines, (unsigned int) lines.size()); n++) {
+			const StatsLine& l = lines[n];
+			const CallInStats& s = *l.stats;
+
+			LOG("%-20s %-28s %9llu %10.2f %10.2f %8.2f %8.2f %10.1f",
+					l.handleName->c_str(), l.callInName, (unsigned long long) s.calls,
+					s.selfTime * 0.001f, s.totalTime * 0.001f, s.maxTime * 0.001f,
+					(s.selfTime * 0.001f * 100.0f) / duration, s.selfAllocBytes / 1024.0f);
+		}
+	}
+
+	std::string Dump(const std::string& fileName)
+	{
+		const std::string filePath = dataDirsAccess.LocateFile(fileName, FileQueryFlags::WRITE | FileQueryFlags::CREATE_DIRS);
+		FILE* file = fopen(filePath.c_str(), "w");
+
+		if (file == NULL) {
+			LOG_L(L_ERROR, "[LuaCallInProfiler::%s] could not open \"%s\" for writing", __FUNCTION__, filePath.c_str());
+			return "";
+		}
+
+		boost::mutex::scoped_lock lock(statsMutex);
+
+		// times in microseconds, sorted by self time
+		fprintf(file, "{\"duration\":%lld,\"handles\":[", (long long) GetDuration());
+
+		std::map<std::string, HandleStats>::const_iterator hit;
+
+		for (hit = handleStats.begin(); hit != handleStats.end(); ++hit) {
+			std::vector<StatsLine> lines;
+			HandleStats::const_iterator cit;
+			CallInStats handleTotal;
+
+			for (cit = hit->second.begin(); cit != hit->second.end(); ++cit) {
+				lines.push_back(StatsLine(&hit->first, cit->first, &cit->second));
+
+				handleTotal.calls += cit->second.calls;
+				handleTotal.selfTime += cit->second.selfTime;
+				handleTotal.selfAllocs += cit->second.selfAllocs;
+				handleTotal.selfAllocBytes += cit->second.selfAllocBytes;
+			}
+
+			std::stable_sort(lines.begin(), lines.end());
+
+			fprintf(file, "%s\n{\"name\":\"", (hit == handleStats.begin())? "": ",");
+			WriteEscaped(file, hit->first.c_str());
+			fprintf(file, "\",\"calls\":%llu,\"selfTime\":%lld,\"selfAllocs\":%llu,\"selfAllocBytes\":%llu,\"callIns\":[",
+					(unsigned long long) handleTotal.calls, (long long) handleTotal.selfTime,
+					(unsigned long long) handleTotal.selfAllocs, (unsigned long long) handleTotal.selfAllocBytes);
+
+			for (unsigned int n = 0; n < lines.size(); n++) {
+				const CallInStats& s = *lines[n].stats;
+
+				fprintf(file, "%s\n\t{\"name\":\"", (n == 0)? "": ",");
+				WriteEscaped(file, lines[n].callInName);
+				fprintf(file, "\",\"calls\":%llu,\"totalTime\":%lld,\"selfTime\":%lld,\"maxTime\":%lld,"
+						"\"allocs\":%llu,\"allocBytes\":%llu,\"selfAllocs\":%llu,\"selfAllocBytes\":%llu}",
+						(unsigned long long) s.calls, (long long) s.totalTime, (long long) s.selfTime, (long long) s.maxTime,
+						(unsigned long long) s.numAllocs, (unsigned long long) s.allocBytes,
+						(unsigned long long) s.selfAllocs, (unsigned long long) s.selfAllocBytes);
+			}
+
+			fprintf(file, "]}");
+		}
+
+		fprintf(file, "\n]}\n");
+		fclose(file);
+
+		LOG("[LuaCallInProfiler] wrote %s", filePath.c_str());
+		return filePath;
+	}
+};
+
+
+void LuaCallInCheck::ProfileBegin(lua_State* _L, const char* name)
+{
+	L = _L;
+	funcName = name;
+	profiling = true;
+
+	parent = LuaCallInProfiler::activeCallIn.get();
+	LuaCallInProfiler::activeCallIn.reset(this);
+
+	childTime = 0;
+	childAllocs = 0;
+	childAllocBytes = 0;
+	startAllocs = (L->lcd != NULL)? L->lcd->numAllocs: 0;
+	startAllocBytes = (L->lcd != NULL)? L->lcd->allocBytes: 0;
+	startTime = TraceProfiler::GetTime();
+}
+
+
+void LuaCallInCheck::ProfileEnd()
+{
+	const boost::int64_t time = TraceProfiler::GetTime() - startTime;
+	const boost::uint64_t numAllocs = (L->lcd != NULL)? (L->lcd->numAllocs - startAllocs): 0;
+	const boost::uint64_t allocBytes = (L->lcd != NULL)? (L->lcd->allocBytes - startAllocBytes): 0;
+
+	LuaCallInProfiler::activeCallIn.reset(parent);
+
+	if (parent != NULL) {
+		parent->childTime += time;
+
+		// only the parent's own state counted these
+		if (parent->L->lcd == L->lcd) {
+			parent->childAllocs += numAllocs;
+			parent->childAllocBytes += allocBytes;
+		}
+	}
+
+	// a Stop in between still completes the running call-ins
+	LuaCallInProfiler::AddCallIn(L, funcName, time, time - childTime, numAllocs, allocBytes, numAllocs - childAllocs, allocBytes - childAllocBytes);
+}
+
+
+/******************************************************************************/
+/******************************************************************************/
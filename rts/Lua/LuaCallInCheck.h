@@ -3,40 +3,91 @@
 #ifndef LUA_CALL_IN_CHECK_H
 #define LUA_CALL_IN_CHECK_H
 
+#include <string>
+#include <boost/cstdint.hpp>
+
 #include "LuaEventBatch.h"
 #include "System/TimeProfiler.h"
 
 struct lua_State;
 
 
+/**
+ * Per call-in and per LuaHandle wall-time and allocation counters, collected
+ * by LuaCallInCheck (i.e. every LUA_CALL_IN_CHECK) while enabled.
+ *
+ * Total time and allocations include nested call-ins (e.g. a gadget's
+ * UnitDamaged triggered from another gadget's call-in), self time and
+ * allocations do not. Allocations are counted by the allocator of the
+ * handle's lua_State, in number of (re)allocations and bytes.
+ */
+namespace LuaCallInProfiler {
+	/// starts collecting, discards all previously collected counters
+	void Start();
+	void Stop();
+	void Reset();
+
+	extern volatile bool enabled;
+	inline bool IsEnabled() { return enabled; }
+
+	/// logs the <numLines> call-ins with the highest self time
+	void Print(unsigned int numLines = 20);
+	/**
+	 * Writes all counters as JSON to <fileName> (a path relative to the
+	 * writable data-dir); can be called while collecting.
+	 * @return the full path that was written, or an empty string on failure
+	 */
+	std::string Dump(const std::string& fileName);
+};
+
+
 class LuaCallInCheck {
 	public:
-		LuaCallInCheck(lua_State* L, const char* funcName);
-		~LuaCallInCheck();
+		LuaCallInCheck(lua_State* L, const char* funcName): profiling(false) {
+		#if DEBUG_LUA
+			CheckBegin(L, funcName);
+		#endif
+			if (LuaCallInProfiler::IsEnabled())
+				ProfileBegin(L, funcName);
+		}
+		~LuaCallInCheck() {
+		#if DEBUG_LUA
+			CheckEnd();
+		#endif
+			if (profiling)
+				ProfileEnd();
+		}
+
+	private:
+		void CheckBegin(lua_State* L, const char* funcName);
+		void CheckEnd();
+		void ProfileBegin(lua_State* L, const char* funcName);
+		void ProfileEnd();
 
 	private:
 		lua_State* L;
 		int startTop;
 		const char* funcName;
+
+		bool profiling;
+		LuaCallInCheck* parent;
+		boost::int64_t startTime;
+		boost::int64_t childTime;
+		boost::uint64_t startAllocs;
+		boost::uint64_t startAllocBytes;
+		boost::uint64_t childAllocs;
+		boost::uint64_t childAllocBytes;
 };
 
 
-#if DEBUG_LUA
-#  define LUA_CALL_IN_CHECK(L, ...) SELECT_LUA_STATE(); LuaCallInCheck ciCheck((L), __FUNCTION__)
-#else
-#  define LUA_CALL_IN_CHECK(L, ...) SCOPED_TIMER("Lua"); SELECT_LUA_STATE()
-#endif
+#define LUA_CALL_IN_CHECK(L, ...) SCOPED_TIMER("Lua"); SELECT_LUA_STATE(); LuaCallInCheck ciCheck((L), __FUNCTION__)
 
 #ifdef USE_GML // hack to add some degree of thread safety to LUA
 #	include "Rendering/GL/myGL.h"
 #	include "lib/gml/gmlsrv.h"
 #	if GML_ENABLE_SIM
 #		undef LUA_CALL_IN_CHECK
-#		if DEBUG_LUA
-#			define LUA_CALL_IN_CHECK(L, ...) SELECT_LUA_STATE(); GML_CHECK_CALL_CHAIN(L, __VA_ARGS__); GML_DRCMUTEX_LOCK(lua); GML_CALL_DEBUGGER(); LuaCallInCheck ciCheck((L), __FUNCTION__);
-#		else
-#			define LUA_CALL_IN_CHECK(L, ...) SELECT_LUA_STATE(); GML_CHECK_CALL_CHAIN(L, __VA_ARGS__); GML_DRCMUTEX_LOCK(lua); GML_CALL_DEBUGGER();
-#		endif
+#		define LUA_CALL_IN_CHECK(L, ...) SELECT_LUA_STATE(); GML_CHECK_CALL_CHAIN(L, __VA_ARGS__); GML_DRCMUTEX_LOCK(lua); GML_CALL_DEBUGGER(); LuaCallInCheck ciCheck((L), __FUNCTION__);
 #	endif
 #endif
 
@@ -45,6 +45,7 @@
 #include <SDL_mouse.h>
 #include <SDL_timer.h>
 
+#include <algorithm>
 #include <string>
 
 
@@ -53,9 +54,32 @@ bool CLuaHandle::modUICtrl = true;
 bool CLuaHandle::useDualStates = false;
 
 
+std::vector<CLuaHandle*> CLuaHandle::batchingHandles;
+/// handles whose batches FlushCallInBatches is delivering right now
+static std::vector<CLuaHandle*> flushingHandles;
+
+
 /******************************************************************************/
 /******************************************************************************/
 
+/// the default lua allocator, counting into the luaContextData
+static void* LuaCountingAlloc(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+	if (nsize == 0) {
+		free(ptr);
+		return NULL;
+	}
+
+	if (nsize > osize) {
+		luaContextData* lcd = static_cast<luaContextData*>(ud);
+		lcd->numAllocs++;
+		lcd->allocBytes += (nsize - osize);
+	}
+
+	return realloc(ptr, nsize);
+}
+
+
 CLuaHandle::CLuaHandle(const string& _name, int _order, bool _userMode)
 	: CEventClient(_name, _order, false) // FIXME
 	, userMode   (_userMode)
@@ -66,15 +90,22 @@ CLuaHandle::CLuaHandle(const string& _name, int _order, bool _userMode)
 	, printTracebacks(false)
 #endif
 	, callinErrors(0)
+	, haveCallInBatches(false)
 {
+	for (int n = 0; n < BATCH_COUNT; n++) {
+		haveBatchedCallIn[n] = false;
+	}
+
 	UpdateThreading();
 
 	SetSynced(false, true);
 	D_Sim.owner = this;
 	L_Sim = LUA_OPEN(&D_Sim, GetUserMode(), true);
+	lua_setallocf(L_Sim, LuaCountingAlloc, &D_Sim);
 	LUA_OPEN_LIB(L_Sim, luaopen_debug);
 	D_Draw.owner = this;
 	L_Draw = LUA_OPEN(&D_Draw, GetUserMode(), false);
+	lua_setallocf(L_Draw, LuaCountingAlloc, &D_Draw);
 	LUA_OPEN_LIB(L_Draw, luaopen_debug);
 }
 
@@ -83,6 +114,12 @@ CLuaHandle::~CLuaHandle()
 {
 	eventHandler.RemoveClient(this);
 
+	if (haveCallInBatches) {
+		batchingHandles.erase(std::find(batchingHandles.begin(), batchingHandles.end(), this));
+	}
+
+	std::replace(flushingHandles.begin(), flushingHandles.end(), this, (CLuaHandle*) NULL);
+
 	// free the lua state
 	KillLua();
 
@@ -997,6 +1034,14 @@ void CLuaHandle::UnitDamaged(const CUnit* unit, const CUnit* attacker,
                              float damage, int weaponID, bool paralyzer)
 {
 	LUA_UNIT_BATCH_PUSH(,UNIT_DAMAGED, unit, attacker, damage, weaponID, paralyzer);
+
+	BatchedUnitEvent e(unit, attacker, weaponID);
+	e.damage = damage;
+	e.flag = paralyzer;
+
+	if (BatchCallIn(BATCH_UNIT_DAMAGED, e))
+		return;
+
 	LUA_CALL_IN_CHECK(L);
 	lua_checkstack(L, 11);
 
@@ -1122,6 +1167,9 @@ void CLuaHandle::UnitEnteredRadar(const CUnit* unit, int allyTeam)
 void CLuaHandle::UnitEnteredLos(const CUnit* unit, int allyTeam)
 {
 	LUA_UNIT_BATCH_PUSH(,UNIT_ENTERED_LOS, unit, allyTeam);
+	if (BatchCallIn(BATCH_UNIT_ENTERED_LOS, BatchedUnitEvent(unit, NULL, allyTeam)))
+		return;
+
 	static const LuaHashString hs("UnitEnteredLos");
 	LosCallIn(hs, unit, allyTeam);
 }
@@ -1138,6 +1186,9 @@ void CLuaHandle::UnitLeftRadar(const CUnit* unit, int allyTeam)
 void CLuaHandle::UnitLeftLos(const CUnit* unit, int allyTeam)
 {
 	LUA_UNIT_BATCH_PUSH(,UNIT_LEFT_LOS, unit, allyTeam);
+	if (BatchCallIn(BATCH_UNIT_LEFT_LOS, BatchedUnitEvent(unit, NULL, allyTeam)))
+		return;
+
 	static const LuaHashString hs("UnitLeftLos");
 	LosCallIn(hs, unit, allyTeam);
 }
@@ -1258,6 +1309,13 @@ void CLuaHandle::UnitUnitCollision(const CUnit* collider, const CUnit* collidee)
 	if (!watchUnitDefs[collidee->unitDef->id]) return;
 
 	LUA_UNIT_BATCH_PUSH(,UNIT_UNIT_COLLISION, collider, collidee);
+
+	BatchedUnitEvent e(collider, collidee, 0);
+	e.flag = collidee->crushKilled;
+
+	if (BatchCallIn(BATCH_UNIT_UNIT_COLLISION, e))
+		return;
+
 	LUA_CALL_IN_CHECK(L);
 	lua_checkstack(L, 5);
 
@@ -1497,6 +1555,244 @@ void CLuaHandle::StockpileChanged(const CUnit* unit,
 }
 
 
+/******************************************************************************/
+/******************************************************************************/
+//
+//  Batched call-ins
+//
+
+static const char* batchedCallInNames[] = {
+	"UnitDamaged",
+	"UnitEnteredLos",
+	"UnitLeftLos",
+	"UnitUnitCollision",
+};
+
+
+int CLuaHandle::GetBatchableCallIn(const string& name)
+{
+	for (int n = 0; n < BATCH_COUNT; n++) {
+		if (name == batchedCallInNames[n])
+			return n;
+	}
+
+	return BATCH_COUNT;
+}
+
+
+bool CLuaHandle::HasCallInOrBatch(lua_State* L, const string& name)
+{
+	const int callIn = GetBatchableCallIn(name);
+
+	if (callIn == BATCH_COUNT)
+		return HasCallIn(L, name);
+
+	const bool haveBatched = HasCallIn(L, name + "Batch");
+
+	// batches are only collected (and delivered) by the sim thread
+	if (L == L_Sim)
+		haveBatchedCallIn[callIn] = haveBatched;
+
+	return (haveBatched || HasCallIn(L, name));
+}
+
+
+string CLuaHandle::GetBatchedCallInName(const string& name)
+{
+	const string suffix = "Batch";
+
+	if (name.size() <= suffix.size())
+		return name;
+	if (name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)
+		return name;
+
+	const string batchedName = name.substr(0, name.size() - suffix.size());
+
+	if (!IsBatchableCallIn(batchedName))
+		return name;
+
+	return batchedName;
+}
+
+
+CLuaHandle::BatchedUnitEvent::BatchedUnitEvent(const CUnit* unit, const CUnit* other, int _param)
+	: unitID(unit->id)
+	, unitDefID(unit->unitDef->id)
+	, unitTeam(unit->team)
+	, otherID(-1)
+	, otherDefID(-1)
+	, otherTeam(-1)
+	, param(_param)
+	, damage(0.0f)
+	, flag(false)
+{
+	if (other != NULL) {
+		otherID = other->id;
+		otherDefID = other->unitDef->id;
+		otherTeam = other->team;
+	}
+}
+
+
+bool CLuaHandle::BatchCallIn(BatchedCallIn callIn, const BatchedUnitEvent& e)
+{
+	// batches are delivered by the sim thread
+	if (!Threading::IsSimThread())
+		return false;
+
+	// RunCallInBatch copes with the function being removed since
+	if (!haveBatchedCallIn[callIn])
+		return false;
+
+	if (!haveCallInBatches) {
+		haveCallInBatches = true;
+		batchingHandles.push_back(this);
+	}
+
+	callInBatches[callIn].push_back(e);
+	return true;
+}
+
+
+static inline void PushBatchValue(lua_State* L, int value) { lua_pushnumber(L, value); }
+static inline void PushBatchValue(lua_State* L, float value) { lua_pushnumber(L, value); }
+static inline void PushBatchValue(lua_State* L, bool value) { lua_pushboolean(L, value); }
+
+/// pushes an array of the <field> values of all events, nil where an event has no <other> unit if <needOther>
+template<typename Event, typename Value>
+static void PushBatchColumn(lua_State* L, const std::vector<Event>& events, Value Event::* field, bool needOther = false)
+{
+	lua_createtable(L, events.size(), 0);
+
+	for (size_t n = 0; n < events.size(); n++) {
+		if (needOther && events[n].otherID == -1)
+			continue;
+
+		PushBatchValue(L, events[n].*field);
+		lua_rawseti(L, -2, n + 1);
+	}
+}
+
+
+void CLuaHandle::RunCallInBatch(BatchedCallIn callIn)
+{
+	// the call-in can cause new events, they go into the next batch
+	static std::vector<BatchedUnitEvent> events;
+
+	events.clear();
+	events.swap(callInBatches[callIn]);
+
+	if (events.empty() || !IsValid())
+		return;
+
+	static const LuaHashString batchNames[] = {
+		LuaHashString("UnitDamagedBatch"),
+		LuaHashString("UnitEnteredLosBatch"),
+		LuaHashString("UnitLeftLosBatch"),
+		LuaHashString("UnitUnitCollisionBatch"),
+	};
+
+	LUA_CALL_IN_CHECK(L);
+	lua_checkstack(L, 13);
+
+	const int errfunc = SetupTraceback(L);
+	const LuaHashString& cmdStr = batchNames[callIn];
+
+	if (!cmdStr.GetGlobalFunc(L)) {
+		if (errfunc) // remove error handler
+			lua_pop(L, 1);
+		return; // removed since the events were batched
+	}
+
+	const bool fullRead = GetHandleFullRead(L);
+	int argCount = 1;
+
+	lua_pushnumber(L, events.size());
+
+	switch (callIn) {
+		case BATCH_UNIT_DAMAGED: {
+			// unitIDs, unitDefIDs, unitTeams, damages, paralyzers
+			// [, weaponDefIDs, attackerIDs, attackerDefIDs, attackerTeams]
+			PushBatchColumn(L, events, &BatchedUnitEvent::unitID);
+			PushBatchColumn(L, events, &BatchedUnitEvent::unitDefID);
+			PushBatchColumn(L, events, &BatchedUnitEvent::unitTeam);
+			PushBatchColumn(L, events, &BatchedUnitEvent::damage);
+			PushBatchColumn(L, events, &BatchedUnitEvent::flag);
+			argCount += 5;
+
+			if (fullRead) {
+				PushBatchColumn(L, events, &BatchedUnitEvent::param);
+				PushBatchColumn(L, events, &BatchedUnitEvent::otherID, true);
+				PushBatchColumn(L, events, &BatchedUnitEvent::otherDefID, true);
+				PushBatchColumn(L, events, &BatchedUnitEvent::otherTeam, true);
+				argCount += 4;
+			}
+		} break;
+
+		case BATCH_UNIT_ENTERED_LOS:
+		case BATCH_UNIT_LEFT_LOS: {
+			// unitIDs, unitTeams [, allyTeams, unitDefIDs]
+			PushBatchColumn(L, events, &BatchedUnitEvent::unitID);
+			PushBatchColumn(L, events, &BatchedUnitEvent::unitTeam);
+			argCount += 2;
+
+			if (fullRead) {
+				PushBatchColumn(L, events, &BatchedUnitEvent::param);
+				PushBatchColumn(L, events, &BatchedUnitEvent::unitDefID);
+				argCount += 2;
+			}
+		} break;
+
+		case BATCH_UNIT_UNIT_COLLISION: {
+			// colliderIDs, collideeIDs, crushKilleds
+			PushBatchColumn(L, events, &BatchedUnitEvent::unitID);
+			PushBatchColumn(L, events, &BatchedUnitEvent::otherID);
+			PushBatchColumn(L, events, &BatchedUnitEvent::flag);
+			argCount += 3;
+		} break;
+
+		default: {
+		} break;
+	}
+
+	// call the routine
+	RunCallInTraceback(cmdStr, argCount, 0, errfunc);
+}
+
+
+static bool CompareHandleOrder(const CLuaHandle* a, const CLuaHandle* b)
+{
+	return (a->GetOrder() < b->GetOrder());
+}
+
+void CLuaHandle::FlushCallInBatches()
+{
+	if (batchingHandles.empty() || !flushingHandles.empty())
+		return;
+
+	// handles that get new events during the call-ins re-add themselves
+	// (to be flushed next frame), handles deleted meanwhile are set to NULL
+	flushingHandles.swap(batchingHandles);
+
+	std::sort(flushingHandles.begin(), flushingHandles.end(), CompareHandleOrder);
+
+	for (size_t n = 0; n < flushingHandles.size(); n++) {
+		flushingHandles[n]->haveCallInBatches = false;
+	}
+
+	for (size_t n = 0; n < flushingHandles.size(); n++) {
+		for (int callIn = 0; callIn < BATCH_COUNT; callIn++) {
+			if (flushingHandles[n] == NULL)
+				break;
+
+			flushingHandles[n]->RunCallInBatch(BatchedCallIn(callIn));
+		}
+	}
+
+	flushingHandles.clear();
+}
+
+
 void CLuaHandle::ExecuteUnitEventBatch() {
 	if(!UseEventBatch()) return;
 
@@ -2982,7 +3278,7 @@ int CLuaHandle::CallOutSyncedUpdateCallIn(lua_State* L)
 	if ((args != 1) || !lua_isstring(L, 1)) {
 		luaL_error(L, "Incorrect arguments to UpdateCallIn()");
 	}
-	const string name = lua_tostring(L, 1);
+	const string name = GetBatchedCallInName(lua_tostring(L, 1));
 	CLuaHandle* lh = GetHandle(L);
 	lh->SyncedUpdateCallIn(lh->GetActiveState(), name);
 	return 0;
@@ -2997,7 +3293,7 @@ int CLuaHandle::CallOutUnsyncedUpdateCallIn(lua_State* L)
 	if ((args != 1) || !lua_isstring(L, 1)) {
 		luaL_error(L, "Incorrect arguments to UpdateCallIn()");
 	}
-	const string name = lua_tostring(L, 1);
+	const string name = GetBatchedCallInName(lua_tostring(L, 1));
 	CLuaHandle* lh = GetHandle(L);
 	lh->UnsyncedUpdateCallIn(lh->GetActiveState(), name);
 	return 0;
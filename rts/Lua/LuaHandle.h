@@ -47,7 +47,7 @@ class CLuaHandle;
 struct luaContextData {
 	luaContextData() : fullCtrl(false), fullRead(false), ctrlTeam(CEventClient::NoAccessTeam),
 		readTeam(0), readAllyTeam(0), selectTeam(CEventClient::NoAccessTeam), synced(false),
-		owner(NULL), drawingEnabled(false), running(0) {}
+		owner(NULL), drawingEnabled(false), running(0), numAllocs(0), allocBytes(0) {}
 	bool fullCtrl;
 	bool fullRead;
 	int  ctrlTeam;
@@ -65,6 +65,9 @@ struct luaContextData {
 	CLuaHandle *owner;
 	bool drawingEnabled;
 	int running; //< is currently running? (0: not running; >0: is running)
+	/// allocations of the lua_State, for LuaCallInProfiler
+	boost::uint64_t numAllocs;
+	boost::uint64_t allocBytes;
 };
 
 class CLuaHandle : public CEventClient
@@ -141,7 +144,7 @@ class CLuaHandle : public CEventClient
 			{
 				GML_DRCMUTEX_LOCK(lua); // WantsEvent
 
-				if (HasCallIn(L, name))
+				if (HasCallInOrBatch(L, name))
 					return true;
 			}
 			END_ITERATE_LUA_STATES();
@@ -149,6 +152,13 @@ class CLuaHandle : public CEventClient
 		}
 
 		virtual bool HasCallIn(lua_State* L, const string& name) { return false; } // FIXME
+		/**
+		 * Also true if only the batched version of a batchable call-in is
+		 * defined. Called whenever the handle (re)decides if it wants an
+		 * event, so this also caches for BatchCallIn whether the batched
+		 * version exists.
+		 */
+		bool HasCallInOrBatch(lua_State* L, const string& name);
 		virtual bool SyncedUpdateCallIn(lua_State* L, const string& name) { return false; }
 		virtual bool UnsyncedUpdateCallIn(lua_State* L, const string& name) { return false; }
 
@@ -273,6 +283,21 @@ class CLuaHandle : public CEventClient
 
 		void GameProgress(int frameNum);
 
+	public: // batched call-ins
+		/**
+		 * UnitDamaged, UnitEnteredLos, UnitLeftLos and UnitUnitCollision are
+		 * opt-in batchable: a handle that defines e.g. UnitDamagedBatch gets
+		 * all UnitDamaged events of a sim frame in one call (with an array
+		 * per argument) instead of one UnitDamaged call per event.
+		 */
+		static bool IsBatchableCallIn(const string& name) { return (GetBatchableCallIn(name) != BATCH_COUNT); }
+		/// @return the BatchedCallIn for <name>, or BATCH_COUNT if it is not batchable
+		static int GetBatchableCallIn(const string& name);
+		/// @return the name of the call-in <name> batches, or <name> itself
+		static string GetBatchedCallInName(const string& name);
+		/// delivers the events collected by all handles, in handle order
+		static void FlushCallInBatches();
+
 	public: // custom call-in  (inter-script calls)
 		virtual bool HasSyncedXCall(const string& funcName) { return false; }
 		virtual bool HasUnsyncedXCall(lua_State* srcState, const string& funcName) { return false; }
@@ -322,6 +347,35 @@ class CLuaHandle : public CEventClient
 		bool RunCallInUnsynced(const LuaHashString& hs, int inArgs, int outArgs);
 
 		void LosCallIn(const LuaHashString& hs, const CUnit* unit, int allyTeam);
+
+		enum BatchedCallIn {
+			BATCH_UNIT_DAMAGED,
+			BATCH_UNIT_ENTERED_LOS,
+			BATCH_UNIT_LEFT_LOS,
+			BATCH_UNIT_UNIT_COLLISION,
+			BATCH_COUNT
+		};
+		/// everything the batched call-ins pass on, copied when the event happens
+		struct BatchedUnitEvent {
+			BatchedUnitEvent(const CUnit* unit, const CUnit* other, int param);
+
+			int unitID;
+			int unitDefID;
+			int unitTeam;
+			/// attacker or collidee, -1 if none
+			int otherID;
+			int otherDefID;
+			int otherTeam;
+			/// weaponDefID or allyTeam
+			int param;
+			float damage;
+			/// paralyzer or crushKilled
+			bool flag;
+		};
+
+		/// @return true if the event was added to a batch instead of being delivered now
+		bool BatchCallIn(BatchedCallIn callIn, const BatchedUnitEvent& e);
+		void RunCallInBatch(BatchedCallIn callIn);
 		void UnitCallIn(const LuaHashString& hs, const CUnit* unit);
 		bool PushUnsyncedCallIn(lua_State* L, const LuaHashString& hs);
 
@@ -426,6 +480,14 @@ class CLuaHandle : public CEventClient
 		std::vector<int> luaFrameEventBatch;
 		std::vector<LuaLogEvent> luaLogEventBatch;
 
+		/// events for the batched call-ins, kept allocated between frames
+		std::vector<BatchedUnitEvent> callInBatches[BATCH_COUNT];
+		bool haveCallInBatches;
+		/// whether the sim state defined the batched version when last checked, see HasCallInOrBatch
+		bool haveBatchedCallIn[BATCH_COUNT];
+		/// handles with pending batches
+		static std::vector<CLuaHandle*> batchingHandles;
+
 		// FIXME: because CLuaUnitScript needs to access RunCallIn
 		friend class CLuaUnitScript;
 };
@@ -620,7 +620,7 @@ bool CLuaHandleSynced::SyncedUpdateCallIn(lua_State *L, const string& name)
 	    eventHandler.IsUnsynced(name)) {
 		return false;
 	}
-	if (HasCallIn(L, name)) {
+	if (HasCallInOrBatch(L, name)) {
 		eventHandler.InsertEvent(this, name);
 	} else {
 		eventHandler.RemoveEvent(this, name);
@@ -636,7 +636,7 @@ bool CLuaHandleSynced::UnsyncedUpdateCallIn(lua_State *L, const string& name)
 		  return false;
 	}
 	if (name != "RecvFromSynced") {
-		if (HasCallIn(L, name)) {
+		if (HasCallInOrBatch(L, name)) {
 			eventHandler.InsertEvent(this, name);
 		} else {
 			eventHandler.RemoveEvent(this, name);
@@ -39,6 +39,7 @@
 #include "Sim/Misc/TeamHandler.h"
 #include "Sim/Misc/QuadField.h"
 #include "Sim/MoveTypes/AAirMoveType.h"
+#include "Sim/MoveTypes/MoveMath/MoveMath.h"
 #include "Sim/Path/IPathManager.h"
 #include "Sim/Projectiles/ExplosionGenerator.h"
 #include "Sim/Projectiles/Projectile.h"
@@ -1679,6 +1680,7 @@ int LuaSyncedCtrl::SetUnitNeutral(lua_State* L)
 	}
 	if (lua_isboolean(L, 2)) {
 		unit->neutral = lua_toboolean(L, 2);
+		qf->MarkObjectChanged(unit);
 	}
 	return 0;
 }
@@ -1798,6 +1800,7 @@ int LuaSyncedCtrl::SetUnitCollisionVolumeData(lua_State* L)
 	if (pAxis >= CollisionVolume::COLVOL_NUM_AXES  )   { luaL_argerror(L, 10, "invalid pAxis"); }
 
 	unit->collisionVolume->Init(scales, offsets, vType, tType, pAxis);
+	qf->MarkObjectChanged(unit);
 	return 0;
 }
 
@@ -1840,6 +1843,7 @@ int LuaSyncedCtrl::SetUnitPieceCollisionVolumeData(lua_State* L)
 	}
 	if (!enable) {
 		lmp->GetCollisionVolume()->Disable();
+		qf->MarkObjectChanged(unit);
 		return 0;
 	}
 
@@ -1867,6 +1871,7 @@ int LuaSyncedCtrl::SetUnitPieceCollisionVolumeData(lua_State* L)
 	// finish
 	lmp->GetCollisionVolume()->Init(scales, offset, vType, tType, pAxis);
 	lmp->GetCollisionVolume()->Enable();
+	qf->MarkObjectChanged(unit);
 
 	return 0;
 }
@@ -2514,6 +2519,7 @@ int LuaSyncedCtrl::SetFeatureCollisionVolumeData(lua_State* L)
 	const float3 offsets(xo, yo, zo);
 
 	feature->collisionVolume->Init(scales, offsets, vType, tType, pAxis);
+	qf->MarkObjectChanged(feature);
 
 	return 0;
 }
@@ -3342,6 +3348,7 @@ int LuaSyncedCtrl::SetMapSquareTerrainType(lua_State* L)
 	const int ntt = luaL_checkint(L, 3);
 
 	readmap->GetTypeMapSynced()[tz * gs->hmapx + tx] = std::max(0, std::min(ntt, (CMapInfo::NUM_TERRAIN_TYPES - 1)));
+	CMoveMath::UpdateSpeedModRasters(hx, hz,  hx + 1, hz + 1);
 	pathManager->TerrainChange(hx, hz,  hx + 1, hz + 1);
 
 	lua_pushnumber(L, ott);
@@ -3378,6 +3385,8 @@ int LuaSyncedCtrl::SetTerrainTypeData(lua_State* L)
 
 	const unsigned char* typeMap = readmap->GetTypeMapSynced();
 
+	CMoveMath::UpdateSpeedModRasters(0, 0, gs->mapx - 1, gs->mapy - 1);
+
 	// update all map-squares set to this terrain-type (slow)
 	for (int tx = 0; tx < gs->hmapx; tx++) {
 		for (int tz = 0; tz < gs->hmapy; tz++) {
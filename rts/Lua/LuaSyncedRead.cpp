@@ -1490,31 +1490,133 @@ int LuaSyncedRead::ArePlayersAllied(lua_State* L)
 //  Grouped Unit Queries
 //
 
+/**
+ * The unit queries accept two optional tables after their regular arguments
+ * that are filled and returned instead of a new table, so widgets polling
+ * every frame do not create garbage:
+ *   ids, count = Spring.GetUnitsInCylinder(x, z, r, allegiance, ids [, data])
+ * Entries of a reused table past the new results are cleared. If <data> is
+ * given it receives UNIT_QUERY_DATA_STRIDE numbers per unit, in the order of
+ * <ids>: the base position (with radar error for enemies) and the health and
+ * max. health (-1 if not visible to the caller, as for GetUnitHealth).
+ */
+static const int UNIT_QUERY_DATA_STRIDE = 5;
+
+struct UnitQueryOutput {
+	UnitQueryOutput(): idsIndex(0), dataIndex(0), oldCount(0), oldDataSize(0), count(0), reused(false) {}
+
+	int idsIndex;
+	int dataIndex;
+	int oldCount;
+	int oldDataSize;
+	int count;
+	bool reused;
+};
+
+
+static void ParseUnitQueryOutput(lua_State* L, int index, UnitQueryOutput& output, int sizeHint = 0)
+{
+	if (lua_istable(L, index)) {
+		output.idsIndex = index;
+		output.oldCount = lua_objlen(L, index);
+		output.reused = true;
+	}
+	if (lua_istable(L, index + 1)) {
+		output.dataIndex = index + 1;
+		output.oldDataSize = lua_objlen(L, index + 1);
+	}
+	if (output.idsIndex == 0) {
+		lua_createtable(L, sizeHint, 0);
+		output.idsIndex = lua_gettop(L);
+	}
+}
+
+
+static void AddQueryUnit(lua_State* L, UnitQueryOutput& output, const CUnit* unit)
+{
+	output.count++;
+	lua_pushnumber(L, unit->id);
+	lua_rawseti(L, output.idsIndex, output.count);
+
+	if (output.dataIndex == 0)
+		return;
+
+	float3 pos = unit->pos;
+	float health = -1.0f;
+	float maxHealth = -1.0f;
+
+	if (!IsAllyUnit(L, unit)) {
+		pos += helper->GetUnitErrorPos(unit, CLuaHandle::GetHandleReadAllyTeam(L));
+		pos -= unit->midPos;
+	}
+
+	if (IsUnitInLos(L, unit)) {
+		// see GetUnitHealth
+		const UnitDef* ud = unit->unitDef;
+		const bool enemyUnit = IsEnemyUnit(L, unit);
+
+		if (!ud->hideDamage || !enemyUnit) {
+			const float scale = (enemyUnit && ud->decoyDef != NULL)? (ud->decoyDef->health / ud->health): 1.0f;
+
+			health = scale * unit->health;
+			maxHealth = scale * unit->maxHealth;
+		}
+	}
+
+	const float values[UNIT_QUERY_DATA_STRIDE] = {pos.x, pos.y, pos.z, health, maxHealth};
+	const int offset = (output.count - 1) * UNIT_QUERY_DATA_STRIDE;
+
+	for (int n = 0; n < UNIT_QUERY_DATA_STRIDE; n++) {
+		lua_pushnumber(L, values[n]);
+		lua_rawseti(L, output.dataIndex, offset + n + 1);
+	}
+}
+
+
+/// @return the number of values the query returns
+static int FinishUnitQuery(lua_State* L, const UnitQueryOutput& output)
+{
+	for (int n = output.count + 1; n <= output.oldCount; n++) {
+		lua_pushnil(L);
+		lua_rawseti(L, output.idsIndex, n);
+	}
+
+	if (output.dataIndex != 0) {
+		for (int n = output.count * UNIT_QUERY_DATA_STRIDE + 1; n <= output.oldDataSize; n++) {
+			lua_pushnil(L);
+			lua_rawseti(L, output.dataIndex, n);
+		}
+	}
+
+	if (!output.reused)
+		return 1; // the new table is on top
+
+	lua_pushvalue(L, output.idsIndex);
+	lua_pushnumber(L, output.count);
+	return 2;
+}
+
+
 int LuaSyncedRead::GetAllUnits(lua_State* L)
 {
-	CheckNoArgs(L, __FUNCTION__);
-	int count = 0;
 	std::list<CUnit*>::const_iterator uit;
+	UnitQueryOutput output;
+
+	ParseUnitQueryOutput(L, 1, output, uh->activeUnits.size());
+
 	if (CLuaHandle::GetHandleFullRead(L)) {
-		lua_createtable(L, uh->activeUnits.size(), 0);
 		for (uit = uh->activeUnits.begin(); uit != uh->activeUnits.end(); ++uit) {
-			// t[count] = id
-			lua_pushnumber(L, (*uit)->id);
-			lua_rawseti(L, -2, ++count);
+			AddQueryUnit(L, output, *uit);
 		}
 	} else {
-		lua_newtable(L);
 		for (uit = uh->activeUnits.begin(); uit != uh->activeUnits.end(); ++uit) {
 			if (IsUnitVisible(L, *uit)) {
-				count++;
-				lua_pushnumber(L, count);
-				lua_pushnumber(L, (*uit)->id);
-				lua_rawset(L, -3);
+				AddQueryUnit(L, output, *uit);
 			}
 		}
 	}
 
-	return 1;
+	return FinishUnitQuery(L, output);
 }
 
 
@@ -1533,35 +1635,28 @@ int LuaSyncedRead::GetTeamUnits(lua_State* L)
 
 	const CUnitSet& units = team->units;
 	CUnitSet::const_iterator uit;
+	UnitQueryOutput output;
+
+	ParseUnitQueryOutput(L, 2, output, units.size());
 
 	// raw push for allies
 	if (IsAlliedTeam(L, teamID)) {
-		lua_newtable(L);
-		int count = 0;
 		for (uit = units.begin(); uit != units.end(); ++uit) {
-			count++;
-			lua_pushnumber(L, count);
-			lua_pushnumber(L, (*uit)->id);
-			lua_rawset(L, -3);
+			AddQueryUnit(L, output, *uit);
 		}
 
-		return 1;
+		return FinishUnitQuery(L, output);
 	}
 
 	// check visibility for enemies
-	lua_newtable(L);
-	int count = 0;
 	for (uit = units.begin(); uit != units.end(); ++uit) {
 		const CUnit* unit = *uit;
 		if (IsUnitVisible(L, unit)) {
-			count++;
-			lua_pushnumber(L, count);
-			lua_pushnumber(L, unit->id);
-			lua_rawset(L, -3);
+			AddQueryUnit(L, output, unit);
 		}
 	}
 
-	return 1;
+	return FinishUnitQuery(L, output);
 }
 
 
@@ -1905,17 +2000,14 @@ int LuaSyncedRead::GetTeamUnitCount(lua_State* L)
 //
 
 // Macro Requirements:
-//   L, it, units, and count
+//   L, it, units, and output
 
 #define LOOP_UNIT_CONTAINER(ALLEGIANCE_TEST, CUSTOM_TEST) \
 	for (it = units.begin(); it != units.end(); ++it) {     \
 		const CUnit* unit = *it;                              \
 		ALLEGIANCE_TEST;                                      \
 		CUSTOM_TEST;                                          \
-		count++;                                              \
-		lua_pushnumber(L, count);                             \
-		lua_pushnumber(L, unit->id);                          \
-		lua_rawset(L, -3);                                    \
+		AddQueryUnit(L, output, unit);                        \
 	}
 
 // Macro Requirements:
@@ -1982,8 +2074,8 @@ int LuaSyncedRead::GetUnitsInRectangle(lua_State* L)
 	vector<CUnit*>::const_iterator it;
 	const vector<CUnit*> &units = qf->GetUnitsExact(mins, maxs);
 
-	lua_newtable(L);
-	int count = 0;
+	UnitQueryOutput output;
+	ParseUnitQueryOutput(L, 6, output);
 
 	if (allegiance >= 0) {
 		if (IsAlliedTeam(L, allegiance)) {
@@ -2006,7 +2098,7 @@ int LuaSyncedRead::GetUnitsInRectangle(lua_State* L)
 		LOOP_UNIT_CONTAINER(VISIBLE_TEST, RECTANGLE_TEST);
 	}
 
-	return 1;
+	return FinishUnitQuery(L, output);
 }
 
 
@@ -2033,8 +2125,8 @@ int LuaSyncedRead::GetUnitsInBox(lua_State* L)
 	vector<CUnit*>::const_iterator it;
 	const vector<CUnit*> &units = qf->GetUnitsExact(mins, maxs);
 
-	lua_newtable(L);
-	int count = 0;
+	UnitQueryOutput output;
+	ParseUnitQueryOutput(L, 8, output);
 
 	if (allegiance >= 0) {
 		if (IsAlliedTeam(L, allegiance)) {
@@ -2057,7 +2149,7 @@ int LuaSyncedRead::GetUnitsInBox(lua_State* L)
 		LOOP_UNIT_CONTAINER(VISIBLE_TEST, BOX_TEST);
 	}
 
-	return 1;
+	return FinishUnitQuery(L, output);
 }
 
 
@@ -2085,8 +2177,8 @@ int LuaSyncedRead::GetUnitsInCylinder(lua_State* L)
 	vector<CUnit*>::const_iterator it;
 	const vector<CUnit*> &units = qf->GetUnitsExact(mins, maxs);
 
-	lua_newtable(L);
-	int count = 0;
+	UnitQueryOutput output;
+	ParseUnitQueryOutput(L, 5, output);
 
 	if (allegiance >= 0) {
 		if (IsAlliedTeam(L, allegiance)) {
@@ -2109,7 +2201,7 @@ int LuaSyncedRead::GetUnitsInCylinder(lua_State* L)
 		LOOP_UNIT_CONTAINER(VISIBLE_TEST, CYLINDER_TEST);
 	}
 
-	return 1;
+	return FinishUnitQuery(L, output);
 }
 
 
@@ -2141,8 +2233,8 @@ int LuaSyncedRead::GetUnitsInSphere(lua_State* L)
 	vector<CUnit*>::const_iterator it;
 	const vector<CUnit*> &units = qf->GetUnitsExact(mins, maxs);
 
-	lua_newtable(L);
-	int count = 0;
+	UnitQueryOutput output;
+	ParseUnitQueryOutput(L, 6, output);
 
 	if (allegiance >= 0) {
 		if (IsAlliedTeam(L, allegiance)) {
@@ -2165,7 +2257,7 @@ int LuaSyncedRead::GetUnitsInSphere(lua_State* L)
 		LOOP_UNIT_CONTAINER(VISIBLE_TEST, SPHERE_TEST);
 	}
 
-	return 1;
+	return FinishUnitQuery(L, output);
 }
 
 
@@ -2196,7 +2288,7 @@ int LuaSyncedRead::GetUnitsInPlanes(lua_State* L)
 
 	// parse the planes
 	vector<Plane> planes;
-	const int table = lua_gettop(L);
+	const int table = 1;
 	for (lua_pushnil(L); lua_next(L, table) != 0; lua_pop(L, 1)) {
 		if (lua_istable(L, -1)) {
 			float values[4];
@@ -2230,8 +2322,8 @@ int LuaSyncedRead::GetUnitsInPlanes(lua_State* L)
 		continue;                        \
 	}
 
-	lua_newtable(L);
-	int count = 0;
+	UnitQueryOutput output;
+	ParseUnitQueryOutput(L, 3, output);
 
 	const int readTeam = CLuaHandle::GetHandleReadTeam(L);
 
@@ -2272,7 +2364,7 @@ int LuaSyncedRead::GetUnitsInPlanes(lua_State* L)
 		}
 	}
 
-	return 1;
+	return FinishUnitQuery(L, output);
 }
 
 
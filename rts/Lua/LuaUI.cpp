@@ -311,7 +311,7 @@ bool CLuaUI::UnsyncedUpdateCallIn(lua_State *L, const string& name)
 		return false;
 	}
 
-	if (HasCallIn(L, name)) {
+	if (HasCallInOrBatch(L, name)) {
 		eventHandler.InsertEvent(this, name);
 	} else {
 		eventHandler.RemoveEvent(this, name);
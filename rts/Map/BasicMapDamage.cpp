@@ -12,6 +12,7 @@
 #include "Sim/Misc/GroundBlockingObjectMap.h"
 #include "Sim/Misc/LosHandler.h"
 #include "Sim/Misc/QuadField.h"
+#include "Sim/MoveTypes/MoveMath/MoveMath.h"
 #include "Sim/Units/Unit.h"
 #include "Sim/Units/UnitHandler.h"
 #include "Sim/Path/IPathManager.h"
@@ -200,6 +201,7 @@ void CBasicMapDamage::RecalcArea(int x1, int x2, int y1, int y2)
 	}
 
 	readmap->UpdateHeightMapSynced(SRectangle(x1, y1, x2, y2));
+	CMoveMath::UpdateSpeedModRasters(x1, y1, x2, y2);
 	pathManager->TerrainChange(x1, y1, x2, y2);
 	featureHandler->TerrainChanged(x1, y1, x2, y2);
 }
@@ -272,9 +274,9 @@ void CBasicMapDamage::UpdateLos()
 		}
 
 		RelosSquare* rs = &relosQue.front();
-		const std::list<CUnit*>& units = qf->GetQuadAt(rs->x, rs->y).units;
+		const std::vector<CUnit*>& units = qf->GetQuadAt(rs->x, rs->y).units;
 
-		std::list<CUnit*>::const_iterator ui;
+		std::vector<CUnit*>::const_iterator ui;
 		for (ui = units.begin(); ui != units.end(); ++ui) {
 			relosUnits.push_back((*ui)->id);
 		}
@@ -2,6 +2,7 @@
 
 
 #include <cstdlib>
+#include <boost/bind.hpp>
 #include "System/mmgr.h"
 
 #include "ReadMap.h"
@@ -22,6 +23,7 @@
 #include "System/FileSystem/FileSystem.h"
 #include "System/LoadSave/LoadSaveInterface.h"
 #include "System/Misc/RectangleOptimizer.h"
+#include "System/Platform/ThreadPool.h"
 
 #ifdef USE_UNSYNCED_HEIGHTMAP
 #include "Game/GlobalUnsynced.h"
@@ -373,64 +375,65 @@ void CReadMap::UpdateMipHeightmaps(const SRectangle& rect)
 
 void CReadMap::UpdateFaceNormals(const SRectangle& rect)
 {
-	const float* heightmapSynced = GetCornerHeightMapSynced();
-
 	const int z1 = std::max(         0, rect.z1 - 1);
 	const int x1 = std::max(         0, rect.x1 - 1);
 	const int z2 = std::min(gs->mapym1, rect.z2 + 1);
 	const int x2 = std::min(gs->mapxm1, rect.x2 + 1);
 
-	int y;
-	#pragma omp parallel for private(y)
-	for (y = z1; y <= z2; y++) {
-		float3 fnTL;
-		float3 fnBR;
-
-		for (int x = x1; x <= x2; x++) {
-			const int idxTL = (y    ) * gs->mapxp1 + x; // TL
-			const int idxBL = (y + 1) * gs->mapxp1 + x; // BL
-
-			const float& hTL = heightmapSynced[idxTL    ];
-			const float& hTR = heightmapSynced[idxTL + 1];
-			const float& hBL = heightmapSynced[idxBL    ];
-			const float& hBR = heightmapSynced[idxBL + 1];
-
-			// normal of top-left triangle (face) in square
-			//
-			//  *---> e1
-			//  |
-			//  |
-			//  v
-			//  e2
-			//const float3 e1( SQUARE_SIZE, hTR - hTL,           0);
-			//const float3 e2(           0, hBL - hTL, SQUARE_SIZE);
-			//const float3 fnTL = (e2.cross(e1)).Normalize();
-			fnTL.y = SQUARE_SIZE;
-			fnTL.x = - (hTR - hTL);
-			fnTL.z = - (hBL - hTL);
-			fnTL.Normalize();
-
-			// normal of bottom-right triangle (face) in square
-			//
-			//         e3
-			//         ^
-			//         |
-			//         |
-			//  e4 <---*
-			//const float3 e3(-SQUARE_SIZE, hBL - hBR,           0);
-			//const float3 e4(           0, hTR - hBR,-SQUARE_SIZE);
-			//const float3 fnBR = (e4.cross(e3)).Normalize();
-			fnBR.y = SQUARE_SIZE;
-			fnBR.x = (hBL - hBR);
-			fnBR.z = (hTR - hBR);
-			fnBR.Normalize();
-
-			faceNormalsSynced[(y * gs->mapx + x) * 2    ] = fnTL;
-			faceNormalsSynced[(y * gs->mapx + x) * 2 + 1] = fnBR;
-
-			// square-normal
-			centerNormalsSynced[y * gs->mapx + x] = (fnTL + fnBR).Normalize();
-		}
+	ThreadPool::parallel_for(z1, z2 + 1, boost::bind(&CReadMap::UpdateFaceNormalsRow, this, x1, x2, _1));
+}
+
+void CReadMap::UpdateFaceNormalsRow(int x1, int x2, int y)
+{
+	const float* heightmapSynced = GetCornerHeightMapSynced();
+
+	float3 fnTL;
+	float3 fnBR;
+
+	for (int x = x1; x <= x2; x++) {
+		const int idxTL = (y    ) * gs->mapxp1 + x; // TL
+		const int idxBL = (y + 1) * gs->mapxp1 + x; // BL
+
+		const float& hTL = heightmapSynced[idxTL    ];
+		const float& hTR = heightmapSynced[idxTL + 1];
+		const float& hBL = heightmapSynced[idxBL    ];
+		const float& hBR = heightmapSynced[idxBL + 1];
+
+		// normal of top-left triangle (face) in square
+		//
+		//  *---> e1
+		//  |
+		//  |
+		//  v
+		//  e2
+		//const float3 e1( SQUARE_SIZE, hTR - hTL,           0);
+		//const float3 e2(           0, hBL - hTL, SQUARE_SIZE);
+		//const float3 fnTL = (e2.cross(e1)).Normalize();
+		fnTL.y = SQUARE_SIZE;
+		fnTL.x = - (hTR - hTL);
+		fnTL.z = - (hBL - hTL);
+		fnTL.Normalize();
+
+		// normal of bottom-right triangle (face) in square
+		//
+		//         e3
+		//         ^
+		//         |
+		//         |
+		//  e4 <---*
+		//const float3 e3(-SQUARE_SIZE, hBL - hBR,           0);
+		//const float3 e4(           0, hTR - hBR,-SQUARE_SIZE);
+		//const float3 fnBR = (e4.cross(e3)).Normalize();
+		fnBR.y = SQUARE_SIZE;
+		fnBR.x = (hBL - hBR);
+		fnBR.z = (hTR - hBR);
+		fnBR.Normalize();
+
+		faceNormalsSynced[(y * gs->mapx + x) * 2    ] = fnTL;
+		faceNormalsSynced[(y * gs->mapx + x) * 2 + 1] = fnBR;
+
+		// square-normal
+		centerNormalsSynced[y * gs->mapx + x] = (fnTL + fnBR).Normalize();
 	}
 }
 
@@ -176,6 +176,7 @@ private:
 	void UpdateCenterHeightmap(const SRectangle& rect);
 	void UpdateMipHeightmaps(const SRectangle& rect);
 	void UpdateFaceNormals(const SRectangle& rect);
+	void UpdateFaceNormalsRow(int x1, int x2, int y);
 	void UpdateSlopemap(const SRectangle& rect);
 	
 	inline void HeightMapUpdateLOSCheck(const SRectangle& rect);
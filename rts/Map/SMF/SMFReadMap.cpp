@@ -17,10 +17,12 @@
 #include "System/EventHandler.h"
 #include "System/Exceptions.h"
 #include "System/FileSystem/FileHandler.h"
-#include "System/OpenMP_cond.h"
 #include "System/mmgr.h"
 #include "System/myMath.h"
 #include "System/Util.h"
+#include "System/Platform/ThreadPool.h"
+
+#include <boost/bind.hpp>
 
 #define SSMF_UNCOMPRESSED_NORMALS 0
 
@@ -349,13 +351,8 @@ void CSMFReadMap::UpdateHeightMapUnsynced(const SRectangle& update)
 void CSMFReadMap::UpdateVertexNormals(const SRectangle& update)
 {
 	#ifdef USE_UNSYNCED_HEIGHTMAP
-	const float*  shm = &cornerHeightMapSynced[0];
-		float*  uhm = &cornerHeightMapUnsynced[0];
-		float3* vvn = &visVertexNormals[0];
-
 	const int W = gs->mapxp1;
 	const int H = gs->mapyp1;
-	static const int SS = SQUARE_SIZE;
 
 	// a heightmap update over (x1, y1) - (x2, y2) implies the
 	// normals change over (x1 - 1, y1 - 1) - (x2 + 1, y2 + 1)
@@ -364,65 +361,76 @@ void CSMFReadMap::UpdateVertexNormals(const SRectangle& update)
 	const int maxx = std::min(update.x2 + 1, W - 1);
 	const int maxz = std::min(update.y2 + 1, H - 1);
 
-	int z;
-	#pragma omp parallel for private(z)
-	for (z = minz; z <= maxz; z++) {
-		for (int x = minx; x <= maxx; x++) {
-			const int vIdxTL = (z    ) * W + x;
-
-			const int xOffL = (x >     0)? 1: 0;
-			const int xOffR = (x < W - 1)? 1: 0;
-			const int zOffT = (z >     0)? 1: 0;
-			const int zOffB = (z < H - 1)? 1: 0;
-
-			const float sxm1 = (x - 1) * SS;
-			const float sx   =       x * SS;
-			const float sxp1 = (x + 1) * SS;
-
-			const float szm1 = (z - 1) * SS;
-			const float sz   =       z * SS;
-			const float szp1 = (z + 1) * SS;
-
-			const int shxm1 = x - xOffL;
-			const int shx   = x;
-			const int shxp1 = x + xOffR;
-
-			const int shzm1 = (z - zOffT) * W;
-			const int shz   =           z * W;
-			const int shzp1 = (z + zOffB) * W;
-
-			// pretend there are 8 incident triangle faces per vertex
-			// for each these triangles, calculate the surface normal,
-			// then average the 8 normals (this stays closest to the
-			// heightmap data)
-			// if edge vertex, don't add virtual neighbor normals to vn
-			const float3 vmm = float3(sx  ,  shm[shz   + shx  ],  sz  );
-
-			const float3 vtl = float3(sxm1,  shm[shzm1 + shxm1],  szm1) - vmm;
-			const float3 vtm = float3(sx  ,  shm[shzm1 + shx  ],  szm1) - vmm;
-			const float3 vtr = float3(sxp1,  shm[shzm1 + shxp1],  szm1) - vmm;
-
-			const float3 vml = float3(sxm1,  shm[shz   + shxm1],  sz  ) - vmm;
-			const float3 vmr = float3(sxp1,  shm[shz   + shxp1],  sz  ) - vmm;
-
-			const float3 vbl = float3(sxm1,  shm[shzp1 + shxm1],  szp1) - vmm;
-			const float3 vbm = float3(sx  ,  shm[shzp1 + shx  ],  szp1) - vmm;
-			const float3 vbr = float3(sxp1,  shm[shzp1 + shxp1],  szp1) - vmm;
-
-			float3 vn(0.0f, 0.0f, 0.0f);
-			vn += vtm.cross(vtl) * (zOffT & xOffL); assert(vtm.cross(vtl).y >= 0.0f);
-			vn += vtr.cross(vtm) * (zOffT        ); assert(vtr.cross(vtm).y >= 0.0f);
-			vn += vmr.cross(vtr) * (zOffT & xOffR); assert(vmr.cross(vtr).y >= 0.0f);
-			vn += vbr.cross(vmr) * (        xOffR); assert(vbr.cross(vmr).y >= 0.0f);
-			vn += vtl.cross(vml) * (        xOffL); assert(vtl.cross(vml).y >= 0.0f);
-			vn += vbm.cross(vbr) * (zOffB & xOffR); assert(vbm.cross(vbr).y >= 0.0f);
-			vn += vbl.cross(vbm) * (zOffB        ); assert(vbl.cross(vbm).y >= 0.0f);
-			vn += vml.cross(vbl) * (zOffB & xOffL); assert(vml.cross(vbl).y >= 0.0f);
-
-			// update the visible vertex/face height/normal
-			uhm[vIdxTL] = shm[vIdxTL];
-			vvn[vIdxTL] = vn.ANormalize();
-		}
+	ThreadPool::parallel_for(minz, maxz + 1, boost::bind(&CSMFReadMap::UpdateVertexNormalsRow, this, minx, maxx, _1));
+	#endif
+}
+
+void CSMFReadMap::UpdateVertexNormalsRow(int minx, int maxx, int z)
+{
+	#ifdef USE_UNSYNCED_HEIGHTMAP
+	const float*  shm = &cornerHeightMapSynced[0];
+		float*  uhm = &cornerHeightMapUnsynced[0];
+		float3* vvn = &visVertexNormals[0];
+
+	const int W = gs->mapxp1;
+	const int H = gs->mapyp1;
+	static const int SS = SQUARE_SIZE;
+
+	for (int x = minx; x <= maxx; x++) {
+		const int vIdxTL = (z    ) * W + x;
+
+		const int xOffL = (x >     0)? 1: 0;
+		const int xOffR = (x < W - 1)? 1: 0;
+		const int zOffT = (z >     0)? 1: 0;
+		const int zOffB = (z < H - 1)? 1: 0;
+
+		const float sxm1 = (x - 1) * SS;
+		const float sx   =       x * SS;
+		const float sxp1 = (x + 1) * SS;
+
+		const float szm1 = (z - 1) * SS;
+		const float sz   =       z * SS;
+		const float szp1 = (z + 1) * SS;
+
+		const int shxm1 = x - xOffL;
+		const int shx   = x;
+		const int shxp1 = x + xOffR;
+
+		const int shzm1 = (z - zOffT) * W;
+		const int shz   =           z * W;
+		const int shzp1 = (z + zOffB) * W;
+
+		// pretend there are 8 incident triangle faces per vertex
+		// for each these triangles, calculate the surface normal,
+		// then average the 8 normals (this stays closest to the
+		// heightmap data)
+		// if edge vertex, don't add virtual neighbor normals to vn
+		const float3 vmm = float3(sx  ,  shm[shz   + shx  ],  sz  );
+
+		const float3 vtl = float3(sxm1,  shm[shzm1 + shxm1],  szm1) - vmm;
+		const float3 vtm = float3(sx  ,  shm[shzm1 + shx  ],  szm1) - vmm;
+		const float3 vtr = float3(sxp1,  shm[shzm1 + shxp1],  szm1) - vmm;
+
+		const float3 vml = float3(sxm1,  shm[shz   + shxm1],  sz  ) - vmm;
+		const float3 vmr = float3(sxp1,  shm[shz   + shxp1],  sz  ) - vmm;
+
+		const float3 vbl = float3(sxm1,  shm[shzp1 + shxm1],  szp1) - vmm;
+		const float3 vbm = float3(sx  ,  shm[shzp1 + shx  ],  szp1) - vmm;
+		const float3 vbr = float3(sxp1,  shm[shzp1 + shxp1],  szp1) - vmm;
+
+		float3 vn(0.0f, 0.0f, 0.0f);
+		vn += vtm.cross(vtl) * (zOffT & xOffL); assert(vtm.cross(vtl).y >= 0.0f);
+		vn += vtr.cross(vtm) * (zOffT        ); assert(vtr.cross(vtm).y >= 0.0f);
+		vn += vmr.cross(vtr) * (zOffT & xOffR); assert(vmr.cross(vtr).y >= 0.0f);
+		vn += vbr.cross(vmr) * (        xOffR); assert(vbr.cross(vmr).y >= 0.0f);
+		vn += vtl.cross(vml) * (        xOffL); assert(vtl.cross(vml).y >= 0.0f);
+		vn += vbm.cross(vbr) * (zOffB & xOffR); assert(vbm.cross(vbr).y >= 0.0f);
+		vn += vbl.cross(vbm) * (zOffB        ); assert(vbl.cross(vbm).y >= 0.0f);
+		vn += vml.cross(vbl) * (zOffB & xOffL); assert(vml.cross(vbl).y >= 0.0f);
+
+		// update the visible vertex/face height/normal
+		uhm[vIdxTL] = shm[vIdxTL];
+		vvn[vIdxTL] = vn.ANormalize();
 	}
 	#endif
 }
@@ -532,19 +540,13 @@ void CSMFReadMap::UpdateShadingTexture(const SRectangle& update)
 		//TODO switch to PBO?
 		std::vector<unsigned char> pixels(xsize * ysize * 4, 0.0f);
 
-		int y;
-		#pragma omp parallel for private(y)
-		for (y = 0; y < ysize; ++y) {
-			const int idx1 = (y + y1) * gs->mapx + x1;
-			const int idx2 = (y + y1) * gs->mapx + x2;
-			UpdateShadingTexPart(idx1, idx2, &pixels[y * xsize * 4]);
-		}
+		ThreadPool::parallel_for(0, ysize, boost::bind(&CSMFReadMap::UpdateShadingTexRow, this, x1, x2, y1, xsize, &pixels[0], _1));
 
 		// check if we were in a dynamic sun issued shadingTex update
 		// and our updaterect was already updated (buffered, not send to the GPU yet!)
 		// if so update it in that buffer, too
 		if (shadingTexUpdateProgress > (y1 * gs->mapx + x1)) {
-			for (y = 0; y < ysize; ++y) {
+			for (int y = 0; y < ysize; ++y) {
 				const int idx = (y + y1) * gs->mapx + x1;
 				memcpy(&shadingTexBuffer[idx * 4] , &pixels[y * xsize * 4], xsize);
 			}
@@ -609,6 +611,20 @@ void CSMFReadMap::UpdateShadingTexPart(int idx1, int idx2, unsigned char* dst) c
 	}
 }
 
+void CSMFReadMap::UpdateShadingTexRow(int x1, int x2, int y1, int xsize, unsigned char* pixels, int y)
+{
+	const int idx1 = (y + y1) * gs->mapx + x1;
+	const int idx2 = (y + y1) * gs->mapx + x2;
+	UpdateShadingTexPart(idx1, idx2, &pixels[y * xsize * 4]);
+}
+
+void CSMFReadMap::UpdateShadingTexChunk(int idx1, int idx2, int chunk)
+{
+	const int idx = idx1 + chunk * 1025;
+	const int idx3 = std::min(idx2, idx + 1024);
+	UpdateShadingTexPart(idx, idx3, &shadingTexBuffer[idx * 4]);
+}
+
 
 float CSMFReadMap::DiffuseSunCoeff(const int& x, const int& y) const
 {
@@ -677,12 +693,9 @@ void CSMFReadMap::UpdateShadingTexture()
 	const int idx1 = shadingTexUpdateProgress;
 	const int idx2 = std::min(idx1 + update_rate, pixels - 1);
 
-	int idx;
-	#pragma omp parallel for private(idx)
-	for (idx = idx1; idx <= idx2; idx += 1025) {
-		const int idx3 = std::min(idx2, idx + 1024);
-		UpdateShadingTexPart(idx, idx3, &shadingTexBuffer[idx * 4]);
-	}
+	const int numChunks = (idx2 >= idx1)? ((idx2 - idx1) / 1025 + 1): 0;
+
+	ThreadPool::parallel_for(0, numChunks, boost::bind(&CSMFReadMap::UpdateShadingTexChunk, this, idx1, idx2, _1));
 
 	shadingTexUpdateProgress += update_rate;
 }
@@ -80,11 +80,14 @@ private:
 	void CreateNormalTex();
 
 	void UpdateVertexNormals(const SRectangle& update);
+	void UpdateVertexNormalsRow(int minx, int maxx, int z);
 	void UpdateFaceNormals(const SRectangle& update);
 	void UpdateNormalTexture(const SRectangle& update);
 	void UpdateShadingTexture(const SRectangle& update);
 
 	inline void UpdateShadingTexPart(int idx1, int idx2, unsigned char* dst) const;
+	void UpdateShadingTexRow(int x1, int x2, int y1, int xsize, unsigned char* pixels, int y);
+	void UpdateShadingTexChunk(int idx1, int idx2, int chunk);
 	inline CBaseGroundDrawer* GetGroundDrawer();
 
 	inline const float GetCenterHeightUnsynced(const int& x, const int& y) const;
@@ -47,6 +47,7 @@ CR_REG_METADATA(CFeature, (
 	CR_MEMBER(fireTime),
 	CR_MEMBER(emitSmokeTime),
 	CR_RESERVED(64),
+	CR_ALLOCATOR(operator new, operator delete),
 	CR_POSTLOAD(PostLoad)
 ));
 
@@ -11,6 +11,7 @@
 #include "Sim/Objects/SolidObject.h"
 #include "Sim/Units/UnitHandler.h"
 #include "System/Matrix44f.h"
+#include "System/SlabPool.h"
 #include "Sim/Misc/LosHandler.h"
 #include "Sim/Misc/ModInfo.h"
 
@@ -28,6 +29,11 @@ class CFeature: public CSolidObject, public boost::noncopyable
 	CR_DECLARE(CFeature);
 
 public:
+	inline void* operator new(size_t size) { return featureMemPool.Alloc(size); }
+	inline void* operator new(size_t size, void* p) { return p; } // used by creg
+	inline void operator delete(void* p, size_t size) { featureMemPool.Free(p, size); }
+	inline void operator delete(void* p, void*) {}
+
 	CFeature();
 	~CFeature();
 
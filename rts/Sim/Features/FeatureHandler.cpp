@@ -485,8 +485,8 @@ void CFeatureHandler::TerrainChanged(int x1, int y1, int x2, int y2)
 		float3(x2 * SQUARE_SIZE, 0, y2 * SQUARE_SIZE));
 
 	for (vector<int>::const_iterator qi = quads.begin(); qi != quads.end(); ++qi) {
-		list<CFeature*>::const_iterator fi;
-		const list<CFeature*>& features = qf->GetQuad(*qi).features;
+		vector<CFeature*>::const_iterator fi;
+		const vector<CFeature*>& features = qf->GetQuad(*qi).features;
 
 		for (fi = features.begin(); fi != features.end(); ++fi) {
 			CFeature* feature = *fi;
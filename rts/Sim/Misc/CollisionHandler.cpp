@@ -17,8 +17,8 @@ CR_BIND(CCollisionHandler, );
 
 static const float3 WORLD_TO_OBJECT_SPACE = float3(-1.0f, 1.0f, 1.0f);
 
-unsigned int CCollisionHandler::numCollisionTests = 0;
-unsigned int CCollisionHandler::numIntersectionTests = 0;
+boost::detail::atomic_count CCollisionHandler::numCollisionTests(0);
+boost::detail::atomic_count CCollisionHandler::numIntersectionTests(0);
 
 
 
@@ -41,8 +41,8 @@ bool CCollisionHandler::DetectHit(const CUnit* u, const float3& p0, const float3
 
 	switch (u->collisionVolume->GetTestType()) {
 		// Collision(CUnit*) does not need p1 or q
-		case CollisionVolume::COLVOL_HITTEST_DISC: { hit = CCollisionHandler::Collision(u, p0       ); numCollisionTests    += 1; } break;
-		case CollisionVolume::COLVOL_HITTEST_CONT: { hit = CCollisionHandler::Intersect(u, p0, p1, q); numIntersectionTests += 1; } break;
+		case CollisionVolume::COLVOL_HITTEST_DISC: { hit = CCollisionHandler::Collision(u, p0       ); ++numCollisionTests;    } break;
+		case CollisionVolume::COLVOL_HITTEST_CONT: { hit = CCollisionHandler::Intersect(u, p0, p1, q); ++numIntersectionTests; } break;
 	}
 
 	return hit;
@@ -80,7 +80,7 @@ bool CCollisionHandler::Collision(const CUnit* u, const float3& p)
 		return false;
 	}
 
-	numCollisionTests += 1;
+	++numCollisionTests;
 
 	switch (u->collisionVolume->GetVolumeType()) {
 		case CollisionVolume::COLVOL_TYPE_SPHERE: {
@@ -111,7 +111,7 @@ bool CCollisionHandler::Collision(const CFeature* f, const float3& p)
 		return false;
 	}
 
-	numCollisionTests += 1;
+	++numCollisionTests;
 
 	switch (f->collisionVolume->GetVolumeType()) {
 		case CollisionVolume::COLVOL_TYPE_SPHERE: {
@@ -290,7 +290,7 @@ bool CCollisionHandler::Intersect(const CUnit* u, const float3& p0, const float3
 	m.Translate(u->relMidPos * WORLD_TO_OBJECT_SPACE);
 	m.Translate(v->GetOffsets());
 
-	numIntersectionTests += 1;
+	++numIntersectionTests;
 	return CCollisionHandler::Intersect(v, m, p0, p1, q);
 }
 
@@ -302,7 +302,7 @@ bool CCollisionHandler::Intersect(const CFeature* f, const float3& p0, const flo
 	m.Translate(f->relMidPos * WORLD_TO_OBJECT_SPACE);
 	m.Translate(v->GetOffsets());
 
-	numIntersectionTests += 1;
+	++numIntersectionTests;
 	return CCollisionHandler::Intersect(v, m, p0, p1, q);
 }
 
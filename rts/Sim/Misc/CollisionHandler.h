@@ -6,6 +6,7 @@
 #include "System/creg/creg_cond.h"
 #include "System/float3.h"
 #include <list>
+#include <boost/detail/atomic_count.hpp>
 
 struct CollisionVolume;
 class CMatrix44f;
@@ -87,8 +88,9 @@ class CCollisionHandler {
 		static bool IntersectBox(const CollisionVolume* v, const float3& pi0, const float3& pi1, CollisionQuery* q);
 
 	private:
-		static unsigned int numCollisionTests;
-		static unsigned int numIntersectionTests;
+		// projectile collision queries run on several threads at once
+		static boost::detail::atomic_count numCollisionTests;
+		static boost::detail::atomic_count numIntersectionTests;
 };
 
 #endif // COLLISION_HANDLER_H
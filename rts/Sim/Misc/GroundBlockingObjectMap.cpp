@@ -1,6 +1,7 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
 #include <assert.h>
+#include <algorithm>
 #include "System/mmgr.h"
 
 #include "GroundBlockingObjectMap.h"
@@ -9,16 +10,22 @@
 #include "GlobalConstants.h"
 #include "Sim/Objects/SolidObject.h"
 #include "Sim/Path/IPathManager.h"
-#include "System/creg/STL_Map.h"
 #include "lib/gml/gmlmut.h"
 
 CGroundBlockingObjectMap* groundBlockingObjectMap;
 
 CR_BIND(CGroundBlockingObjectMap, (1))
 CR_REG_METADATA(CGroundBlockingObjectMap, (
-	CR_MEMBER(groundBlockingMap)
+	CR_SERIALIZER(Serialize),
+	CR_POSTLOAD(PostLoad)
 ));
 
+const unsigned int CGroundBlockingObjectMap::INLINE_ENTRIES;
+const unsigned int CGroundBlockingObjectMap::CELL_COUNT_BITS;
+const unsigned int CGroundBlockingObjectMap::CELL_COUNT_MASK;
+const unsigned int CGroundBlockingObjectMap::CELL_STRUCTURE_BIT;
+const unsigned int CGroundBlockingObjectMap::CELL_SLOT_SHIFT;
+
 
 
 inline static const int GetObjectID(CSolidObject* obj)
@@ -30,6 +37,190 @@ inline static const int GetObjectID(CSolidObject* obj)
 }
 
 
+CGroundBlockingObjectMap::CGroundBlockingObjectMap(int numSquares)
+{
+	cellWords.resize(numSquares, 0);
+}
+
+
+unsigned int CGroundBlockingObjectMap::MakeCellWord(unsigned int slotIdx, const CellSlot& slot)
+{
+	const BlockingMapEntry* entries = slot.GetEntries();
+
+	unsigned int cellWord = (slotIdx << CELL_SLOT_SHIFT) | std::min(slot.numEntries, CELL_COUNT_MASK);
+
+	for (unsigned int n = 0; n < slot.numEntries; n++) {
+		if (entries[n].second->immobile) {
+			cellWord |= CELL_STRUCTURE_BIT;
+			break;
+		}
+	}
+
+	return cellWord;
+}
+
+void CGroundBlockingObjectMap::InsertEntry(int mapSquare, int objID, CSolidObject* object)
+{
+	unsigned int& cellWord = cellWords[mapSquare];
+
+	if (cellWord == 0) {
+		unsigned int slotIdx = cellSlots.size();
+
+		if (!freeCellSlots.empty()) {
+			slotIdx = freeCellSlots.back();
+			freeCellSlots.pop_back();
+		} else {
+			cellSlots.push_back(CellSlot());
+		}
+
+		CellSlot& slot = cellSlots[slotIdx];
+		slot.numEntries = 1;
+		slot.inlineEntries[0] = BlockingMapEntry(objID, object);
+
+		cellWord = MakeCellWord(slotIdx, slot);
+		return;
+	}
+
+	const unsigned int slotIdx = cellWord >> CELL_SLOT_SHIFT;
+
+	CellSlot& slot = cellSlots[slotIdx];
+	BlockingMapEntry* entries = const_cast<BlockingMapEntry*>(slot.GetEntries());
+
+	// keep the entries sorted by ID (like the std::map they replace)
+	unsigned int pos = 0;
+
+	while (pos < slot.numEntries && entries[pos].first < objID)
+		pos++;
+
+	if (pos < slot.numEntries && entries[pos].first == objID) {
+		entries[pos].second = object;
+		cellWord = MakeCellWord(slotIdx, slot);
+		return;
+	}
+
+	if (slot.numEntries < INLINE_ENTRIES) {
+		for (unsigned int n = slot.numEntries; n > pos; n--) {
+			entries[n] = entries[n - 1];
+		}
+
+		entries[pos] = BlockingMapEntry(objID, object);
+	} else {
+		if (slot.numEntries == INLINE_ENTRIES)
+			slot.overflowEntries.assign(&slot.inlineEntries[0], &slot.inlineEntries[INLINE_ENTRIES]);
+
+		slot.overflowEntries.insert(slot.overflowEntries.begin() + pos, BlockingMapEntry(objID, object));
+	}
+
+	slot.numEntries += 1;
+	cellWord = MakeCellWord(slotIdx, slot);
+}
+
+void CGroundBlockingObjectMap::EraseEntry(int mapSquare, int objID)
+{
+	unsigned int& cellWord = cellWords[mapSquare];
+
+	if (cellWord == 0)
+		return;
+
+	const unsigned int slotIdx = cellWord >> CELL_SLOT_SHIFT;
+
+	CellSlot& slot = cellSlots[slotIdx];
+	BlockingMapEntry* entries = const_cast<BlockingMapEntry*>(slot.GetEntries());
+
+	unsigned int pos = 0;
+
+	while (pos < slot.numEntries && entries[pos].first != objID)
+		pos++;
+
+	if (pos == slot.numEntries)
+		return;
+
+	if (slot.numEntries == 1) {
+		slot.numEntries = 0;
+		slot.inlineEntries[0] = BlockingMapEntry(0, NULL);
+		freeCellSlots.push_back(slotIdx);
+
+		cellWord = 0;
+		return;
+	}
+
+	if (slot.numEntries <= INLINE_ENTRIES) {
+		for (unsigned int n = pos; n < (slot.numEntries - 1); n++) {
+			entries[n] = entries[n + 1];
+		}
+	} else {
+		slot.overflowEntries.erase(slot.overflowEntries.begin() + pos);
+
+		if (slot.overflowEntries.size() == INLINE_ENTRIES) {
+			std::copy(slot.overflowEntries.begin(), slot.overflowEntries.end(), &slot.inlineEntries[0]);
+			slot.overflowEntries.clear();
+		}
+	}
+
+	slot.numEntries -= 1;
+	cellWord = MakeCellWord(slotIdx, slot);
+}
+
+
+void CGroundBlockingObjectMap::Serialize(creg::ISerializer& s)
+{
+	// only occupied squares are saved, as (square, ID, object) triples
+	int numSquares = cellWords.size();
+	int numEntries = 0;
+
+	s.SerializeInt(&numSquares, sizeof(int));
+
+	if (s.IsWriting()) {
+		for (int sq = 0; sq < numSquares; sq++) {
+			numEntries += GetCell(sq).size();
+		}
+
+		s.SerializeInt(&numEntries, sizeof(int));
+
+		for (int sq = 0; sq < numSquares; sq++) {
+			const BlockingMapCell cell = GetCell(sq);
+
+			for (BlockingMapCellIt it = cell.begin(); it != cell.end(); ++it) {
+				int mapSquare = sq;
+				int objID = it->first;
+				void* object = it->second;
+
+				s.SerializeInt(&mapSquare, sizeof(int));
+				s.SerializeInt(&objID, sizeof(int));
+				s.SerializeObjectPtr(&object, it->second->GetClass());
+			}
+		}
+	} else {
+		s.SerializeInt(&numEntries, sizeof(int));
+
+		cellWords.clear();
+		cellWords.resize(numSquares, 0);
+		cellSlots.clear();
+		freeCellSlots.clear();
+
+		// object pointers are only fixed up after all objects have
+		// been read, so they need to stay at the same address until
+		// PostLoad inserts them
+		savedEntries.resize(numEntries);
+
+		for (int n = 0; n < numEntries; n++) {
+			s.SerializeInt(&savedEntries[n].mapSquare, sizeof(int));
+			s.SerializeInt(&savedEntries[n].objID, sizeof(int));
+			s.SerializeObjectPtr(reinterpret_cast<void**>(&savedEntries[n].object), CSolidObject::StaticClass());
+		}
+	}
+}
+
+void CGroundBlockingObjectMap::PostLoad()
+{
+	for (size_t n = 0; n < savedEntries.size(); n++) {
+		InsertEntry(savedEntries[n].mapSquare, savedEntries[n].objID, savedEntries[n].object);
+	}
+
+	savedEntries.clear();
+}
+
+
 void CGroundBlockingObjectMap::AddGroundBlockingObject(CSolidObject* object)
 {
 	if (object->blockMap) {
@@ -56,10 +247,7 @@ void CGroundBlockingObjectMap::AddGroundBlockingObject(CSolidObject* object)
 
 	for (int zSqr = minZSqr; zSqr < maxZSqr; zSqr++) {
 		for (int xSqr = minXSqr; xSqr < maxXSqr; xSqr++) {
-			const int idx = xSqr + zSqr * gs->mapx;
-
-			BlockingMapCell& cell = groundBlockingMap[idx];
-			cell[objID] = object;
+			InsertEntry(xSqr + zSqr * gs->mapx, objID, object);
 		}
 	}
 
@@ -95,10 +283,7 @@ void CGroundBlockingObjectMap::AddGroundBlockingObject(CSolidObject* object, con
 			// cells (the unit->moveDef footprint can have different dimensions)
 			const float3 testPos = float3(x, 0.0f, z) * SQUARE_SIZE;
 			if (object->GetGroundBlockingAtPos(testPos) & mask) {
-				const int idx = x + (z) * gs->mapx;
-
-				BlockingMapCell& cell = groundBlockingMap[idx];
-				cell[objID] = object;
+				InsertEntry(x + z * gs->mapx, objID, object);
 			}
 		}
 	}
@@ -125,10 +310,7 @@ void CGroundBlockingObjectMap::RemoveGroundBlockingObject(CSolidObject* object)
 
 	for (int z = bz; z < bz + sz; ++z) {
 		for (int x = bx; x < bx + sx; ++x) {
-			const int idx = x + z * gs->mapx;
-
-			BlockingMapCell& cell = groundBlockingMap[idx];
-			cell.erase(objID);
+			EraseEntry(x + z * gs->mapx, objID);
 		}
 	}
 
@@ -147,7 +329,7 @@ void CGroundBlockingObjectMap::RemoveGroundBlockingObject(CSolidObject* object)
 CSolidObject* CGroundBlockingObjectMap::GroundBlockedUnsafe(int mapSquare) const {
 	GML_STDMUTEX_LOCK(block); // GroundBlockedUnsafe
 
-	const BlockingMapCell& cell = groundBlockingMap[mapSquare];
+	const BlockingMapCell cell = GetCell(mapSquare);
 
 	if (cell.empty()) {
 		return NULL;
@@ -181,25 +363,17 @@ bool CGroundBlockingObjectMap::GroundBlocked(int x, int z, CSolidObject* ignoreO
 
 	GML_STDMUTEX_LOCK(block); // GroundBlockedUnsafe
 
-	if (groundBlockingMap[mapSquare].empty()) {
+	const unsigned int cellWord = cellWords[mapSquare];
+
+	if (cellWord == 0) {
 		return false;
 	}
-
-	const int objID = GetObjectID(ignoreObj);
-
-	const BlockingMapCell& cell = groundBlockingMap[mapSquare];
-	BlockingMapCellIt it = cell.begin();
-	if (it != cell.end()) {
-		if (it->first != objID) {
-			// there are other objects blocking the square
-			return true;
-		} else {
-			// ignoreObj is in the square. Check if there are other objects, too
-			return (cell.size() >= 2);
-		}
+	if ((cellWord & CELL_COUNT_MASK) >= 2) {
+		// ignoreObj can not be the only object in the square
+		return true;
 	}
 
-	return false;
+	return (GetCell(mapSquare).begin()->first != GetObjectID(ignoreObj));
 }
 
 
@@ -212,6 +386,35 @@ bool CGroundBlockingObjectMap::GroundBlocked(const float3& pos, CSolidObject* ig
 
 
 
+bool CGroundBlockingObjectMap::FootprintFree(int xmin, int zmin, int xmax, int zmax, int step, unsigned int mask) const
+{
+	if (xmin < 0 || zmin < 0 || xmax >= gs->mapx || zmax >= gs->mapy)
+		return false;
+
+	for (int z = zmin; z <= zmax; z += step) {
+		const unsigned int* rowWords = &cellWords[z * gs->mapx];
+
+		for (int x = xmin; x <= xmax; x += step) {
+			if ((rowWords[x] & mask) != 0)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+bool CGroundBlockingObjectMap::FootprintEmpty(int xmin, int zmin, int xmax, int zmax, int step) const
+{
+	return FootprintFree(xmin, zmin, xmax, zmax, step, ~0u);
+}
+
+bool CGroundBlockingObjectMap::FootprintStructureFree(int xmin, int zmin, int xmax, int zmax, int step) const
+{
+	return FootprintFree(xmin, zmin, xmax, zmax, step, CELL_STRUCTURE_BIT);
+}
+
+
+
 /**
   * Opens up a yard in a blocked area.
   * When a factory opens up, for example.
@@ -3,26 +3,69 @@
 #ifndef GROUNDBLOCKINGOBJECTMAP_H
 #define GROUNDBLOCKINGOBJECTMAP_H
 
-#include <map>
+#include <vector>
+#include <utility>
 #include "System/creg/creg_cond.h"
 
 #include "Sim/Objects/SolidObject.h"
 #include "System/float3.h"
 
 
-typedef std::map<int, CSolidObject*> BlockingMapCell;
+/// (blocking-map ID, object) pair, the entries of a cell are sorted by ID
+typedef std::pair<int, CSolidObject*> BlockingMapEntry;
+
+/**
+ * Read-only view of the objects blocking a single map square, behaves
+ * like the std::map<int, CSolidObject*> that was used to store them.
+ * Only valid until the next Add- or RemoveGroundBlockingObject call.
+ */
+class BlockingMapCell
+{
+public:
+	typedef const BlockingMapEntry* const_iterator;
+
+	BlockingMapCell(): first(NULL), last(NULL) {}
+	BlockingMapCell(const BlockingMapEntry* first, const BlockingMapEntry* last): first(first), last(last) {}
+
+	const_iterator begin() const { return first; }
+	const_iterator end() const { return last; }
+
+	bool empty() const { return (first == last); }
+	size_t size() const { return (last - first); }
+
+	const_iterator find(int objID) const {
+		for (const_iterator it = first; it != last; ++it) {
+			if (it->first == objID)
+				return it;
+		}
+		return last;
+	}
+
+private:
+	const BlockingMapEntry* first;
+	const BlockingMapEntry* last;
+};
+
 typedef BlockingMapCell::const_iterator BlockingMapCellIt;
-typedef std::vector<BlockingMapCell> BlockingMap;
 
 
+/**
+ * Keeps track of which objects block which map squares.
+ *
+ * Every square has one occupancy word, which is zero for empty squares
+ * (by far the most common case) and otherwise holds the index of the
+ * slot storing the square's objects, their number (saturated to
+ * CELL_COUNT_MASK) and whether any of them is immobile (a structure or
+ * feature). Slots store up to INLINE_ENTRIES objects in place,
+ * squares blocked by more objects than that keep them in an overflow
+ * vector of their slot.
+ */
 class CGroundBlockingObjectMap
 {
 	CR_DECLARE(CGroundBlockingObjectMap);
 
 public:
-	CGroundBlockingObjectMap(int numSquares) {
-		groundBlockingMap.resize(numSquares);
-	}
+	CGroundBlockingObjectMap(int numSquares);
 
 	void AddGroundBlockingObject(CSolidObject* object);
 	void AddGroundBlockingObject(CSolidObject* object, const YardMapStatus& mask);
@@ -44,16 +87,72 @@ public:
 	bool GroundBlocked(int x, int z, CSolidObject* ignoreObj) const;
 	bool GroundBlocked(const float3& pos, CSolidObject* ignoreObj) const;
 
+	/**
+	 * @return true if every <step>'th square of the (inclusive) rectangle
+	 *   [xmin, xmax] x [zmin, zmax] lies on the map and is not blocked by
+	 *   any object, false otherwise (also if only partially on the map)
+	 */
+	bool FootprintEmpty(int xmin, int zmin, int xmax, int zmax, int step) const;
+	/// same as FootprintEmpty(), but only immobile objects are taken into account
+	bool FootprintStructureFree(int xmin, int zmin, int xmax, int zmax, int step) const;
+
 	// for full thread safety, access via GetCell would need to be mutexed, but it appears only sim thread uses it
-	const BlockingMapCell& GetCell(int mapSquare) const {
-		return groundBlockingMap[mapSquare];
+	BlockingMapCell GetCell(int mapSquare) const {
+		const unsigned int cellWord = cellWords[mapSquare];
+
+		if (cellWord == 0)
+			return BlockingMapCell();
+
+		const CellSlot& slot = cellSlots[cellWord >> CELL_SLOT_SHIFT];
+		const BlockingMapEntry* entries = slot.GetEntries();
+		return BlockingMapCell(entries, entries + slot.numEntries);
 	}
 
+	void Serialize(creg::ISerializer& s);
+	void PostLoad();
+
 private:
+	static const unsigned int INLINE_ENTRIES = 3;
+	static const unsigned int CELL_COUNT_BITS = 4;
+	static const unsigned int CELL_COUNT_MASK = (1 << CELL_COUNT_BITS) - 1;
+	static const unsigned int CELL_STRUCTURE_BIT = (1 << CELL_COUNT_BITS);
+	static const unsigned int CELL_SLOT_SHIFT = CELL_COUNT_BITS + 1;
+
+	struct CellSlot {
+		CellSlot(): numEntries(0) {}
+
+		const BlockingMapEntry* GetEntries() const {
+			return (numEntries <= INLINE_ENTRIES)? &inlineEntries[0]: &overflowEntries[0];
+		}
+
+		unsigned int numEntries;
+
+		BlockingMapEntry inlineEntries[INLINE_ENTRIES];
+		std::vector<BlockingMapEntry> overflowEntries;
+	};
+
+	/// object stored in a saved game, read into stable memory for creg's pointer fix-ups
+	struct SavedEntry {
+		int mapSquare;
+		int objID;
+		CSolidObject* object;
+	};
+
 	bool CheckYard(CSolidObject* yardUnit, const YardMapStatus& mask) const;
+	bool FootprintFree(int xmin, int zmin, int xmax, int zmax, int step, unsigned int mask) const;
+
+	void InsertEntry(int mapSquare, int objID, CSolidObject* object);
+	void EraseEntry(int mapSquare, int objID);
+
+	static unsigned int MakeCellWord(unsigned int slotIdx, const CellSlot& slot);
 
 private:
-	BlockingMap groundBlockingMap;
+	/// one per map square, 0 if empty, (slotIndex << CELL_SLOT_SHIFT) | structureBit | numEntries otherwise
+	std::vector<unsigned int> cellWords;
+	std::vector<CellSlot> cellSlots;
+	std::vector<unsigned int> freeCellSlots;
+
+	std::vector<SavedEntry> savedEntries;
 };
 
 extern CGroundBlockingObjectMap* groundBlockingObjectMap;
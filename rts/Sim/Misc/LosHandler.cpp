@@ -2,6 +2,7 @@
 
 #include "System/mmgr.h"
 
+#include <algorithm>
 #include <list>
 #include <cstdlib>
 #include <cstring>
@@ -13,16 +14,20 @@
 #include "Sim/Misc/TeamHandler.h"
 #include "Map/ReadMap.h"
 #include "System/Log/ILog.h"
+#include "System/Platform/ThreadPool.h"
 #include "System/TimeProfiler.h"
 #include "System/creg/STL_Deque.h"
 #include "System/creg/STL_List.h"
 
+#include <boost/bind.hpp>
+
 using std::min;
 using std::max;
 
 CR_BIND(LosInstance, );
 CR_BIND(CLosHandler, );
 CR_BIND(CLosHandler::DelayedInstance, );
+CR_BIND(CLosHandler::QueuedRemoval, );
 
 CR_REG_METADATA(LosInstance,(
 //		CR_MEMBER(losSquares),
@@ -41,6 +46,18 @@ CR_REG_METADATA(LosInstance,(
 
 void CLosHandler::PostLoad()
 {
+	// instances that were still queued when saving stay queued, so they
+	// reach the LOS maps in the same frame as they would have without
+	// the save; LosAdd skips them
+	std::vector<LosInstance*> savedQueue;
+	std::vector<QueuedRemoval> savedRemovals;
+	savedQueue.swap(queuedInstances);
+	savedRemovals.swap(queuedRemovals);
+
+	for (size_t i = 0; i < savedQueue.size(); ++i) {
+		savedQueue[i]->queueIndex = i;
+	}
+
 	for (int a = 0; a < LOSHANDLER_MAGIC_PRIME; ++a) {
 		for (std::list<LosInstance*>::iterator li = instanceHash[a].begin(); li != instanceHash[a].end(); ++li) {
 			if ((*li)->refCount) {
@@ -48,12 +65,27 @@ void CLosHandler::PostLoad()
 			}
 		}
 	}
+
+	UpdateQueuedInstances();
+
+	// LOS that was still waiting to be removed was on the maps as well
+	for (size_t i = 0; i < savedRemovals.size(); ++i) {
+		const QueuedRemoval& r = savedRemovals[i];
+
+		if (r.losSize > 0) { losMaps[r.allyteam].AddMapSquares(r.losSquares, r.allyteam, 1); }
+		if (r.airLosSize > 0) { airLosMaps[r.allyteam].AddMapArea(r.baseAirPos, r.allyteam, r.airLosSize, 1); }
+	}
+
+	queuedInstances.swap(savedQueue);
+	queuedRemovals.swap(savedRemovals);
 }
 
 CR_REG_METADATA(CLosHandler,(
 		CR_MEMBER(instanceHash),
 		CR_MEMBER(toBeDeleted),
 		CR_MEMBER(delayQue),
+		CR_MEMBER(queuedInstances),
+		CR_MEMBER(queuedRemovals),
 		CR_RESERVED(8),
 		CR_POSTLOAD(PostLoad)
 		));
@@ -62,6 +94,13 @@ CR_REG_METADATA_SUB(CLosHandler,DelayedInstance,(
 		CR_MEMBER(instance),
 		CR_MEMBER(timeoutTime)));
 
+CR_REG_METADATA_SUB(CLosHandler,QueuedRemoval,(
+		CR_MEMBER(losSquares),
+		CR_MEMBER(losSize),
+		CR_MEMBER(airLosSize),
+		CR_MEMBER(allyteam),
+		CR_MEMBER(baseAirPos)));
+
 
 //////////////////////////////////////////////////////////////////////
 // Construction/Destruction
@@ -190,10 +229,59 @@ void CLosHandler::LosAdd(LosInstance* instance)
 	assert(instance);
 	assert(teamHandler->IsValidAllyTeam(instance->allyteam));
 
+	if (instance->queueIndex >= 0)
+		return;
+
+	instance->queueIndex = queuedInstances.size();
+	queuedInstances.push_back(instance);
+}
+
+
+void CLosHandler::CastQueuedInstance(int i)
+{
+	LosInstance* instance = queuedInstances[i];
+
 	losAlgo.LosAdd(instance->basePos, instance->losSize, instance->baseHeight, instance->losSquares);
+}
+
+void CLosHandler::ApplyQueuedRemovals()
+{
+	for (size_t i = 0; i < queuedRemovals.size(); ++i) {
+		const QueuedRemoval& r = queuedRemovals[i];
+
+		if (r.losSize > 0) { losMaps[r.allyteam].AddMapSquares(r.losSquares, r.allyteam, -1); }
+		if (r.airLosSize > 0) { airLosMaps[r.allyteam].AddMapArea(r.baseAirPos, r.allyteam, r.airLosSize, -1); }
+	}
 
-	if (instance->losSize > 0) { losMaps[instance->allyteam].AddMapSquares(instance->losSquares, instance->allyteam, 1); }
-	if (instance->airLosSize > 0) { airLosMaps[instance->allyteam].AddMapArea(instance->baseAirPos, instance->allyteam, instance->airLosSize, 1); }
+	queuedRemovals.clear();
+}
+
+void CLosHandler::UpdateQueuedInstances()
+{
+	ApplyQueuedRemovals();
+
+	if (queuedInstances.empty())
+		return;
+
+	SCOPED_TIMER("LOSHandler::LosAdd");
+
+	// the raycasts only read the heightmap and each writes
+	// to its own instance, so they can run concurrently
+	const int numInstances = queuedInstances.size();
+
+	ThreadPool::parallel_for(0, numInstances, boost::bind(&CLosHandler::CastQueuedInstance, this, _1), 16);
+
+	// applying them in queue order keeps this deterministic
+	for (int i = 0; i < numInstances; ++i) {
+		LosInstance* instance = queuedInstances[i];
+
+		if (instance->losSize > 0) { losMaps[instance->allyteam].AddMapSquares(instance->losSquares, instance->allyteam, 1); }
+		if (instance->airLosSize > 0) { airLosMaps[instance->allyteam].AddMapArea(instance->baseAirPos, instance->allyteam, instance->airLosSize, 1); }
+
+		instance->queueIndex = -1;
+	}
+
+	queuedInstances.clear();
 }
 
 
@@ -269,8 +357,26 @@ void CLosHandler::AllocInstance(LosInstance* instance)
 
 void CLosHandler::CleanupInstance(LosInstance* instance)
 {
-	if (instance->losSize > 0) { losMaps[instance->allyteam].AddMapSquares(instance->losSquares, instance->allyteam, -1); }
-	if (instance->airLosSize > 0) { airLosMaps[instance->allyteam].AddMapArea(instance->baseAirPos, instance->allyteam, instance->airLosSize, -1); }
+	if (instance->queueIndex >= 0) {
+		// nothing was added to the maps yet; the maps are reference
+		// counts, so the order of the queue does not matter
+		LosInstance* last = queuedInstances.back();
+		queuedInstances[instance->queueIndex] = last;
+		last->queueIndex = instance->queueIndex;
+		queuedInstances.pop_back();
+		instance->queueIndex = -1;
+		return;
+	}
+
+	// taken off the maps together with the queued additions
+	queuedRemovals.push_back(QueuedRemoval());
+
+	QueuedRemoval& r = queuedRemovals.back();
+	r.losSquares.swap(instance->losSquares);
+	r.losSize = instance->losSize;
+	r.airLosSize = instance->airLosSize;
+	r.allyteam = instance->allyteam;
+	r.baseAirPos = instance->baseAirPos;
 }
 
 
@@ -280,6 +386,8 @@ void CLosHandler::Update(void)
 		FreeInstance(delayQue.front().instance);
 		delayQue.pop_front();
 	}
+
+	UpdateQueuedInstances();
 }
 
 
@@ -48,6 +48,7 @@ private:
 		, hashNum(-1)
 		, baseHeight(0.0f)
 		, toBeDeleted(false)
+		, queueIndex(-1)
 	{}
 
 public:
@@ -63,6 +64,7 @@ public:
 		, hashNum(hashNum)
 		, baseHeight(baseHeight)
 		, toBeDeleted(false)
+		, queueIndex(-1)
 	{}
 
  	std::vector<int> losSquares;
@@ -76,6 +78,9 @@ public:
 	int hashNum;
 	float baseHeight;
 	bool toBeDeleted;
+	/// position in CLosHandler::queuedInstances while waiting there
+	/// (not yet on the LOS maps), -1 otherwise
+	int queueIndex;
 };
 
 /**
@@ -98,12 +103,19 @@ public:
  * LOS is not removed immediately when a unit gets killed. Instead,
  * DelayedFreeInstance is called. This keeps the LosInstance (including the
  * actual sight) alive until 1.5 game seconds after the unit got killed.
+ *
+ * Adding LOS is batched: LosInstances that need their squares (re)computed
+ * are queued during the frame, raycast in parallel by Update, and then put
+ * on the LOS maps in queue order. Removing LOS is queued as well and done
+ * by Update right before that, so a unit that moves keeps seeing its old
+ * squares until its new ones are on the maps.
  */
 class CLosHandler : public boost::noncopyable
 {
 	CR_DECLARE(CLosHandler);
 //	CR_DECLARE_SUB(CPoint);
 	CR_DECLARE_SUB(DelayedInstance);
+	CR_DECLARE_SUB(QueuedRemoval);
 
 public:
 	void MoveUnit(CUnit* unit, bool redoCurrent);
@@ -191,6 +203,9 @@ private:
 
 	void PostLoad();
 	void LosAdd(LosInstance* instance);
+	void CastQueuedInstance(int i);
+	void UpdateQueuedInstances();
+	void ApplyQueuedRemovals();
 	int GetHashNum(CUnit* unit);
 	void AllocInstance(LosInstance* instance);
 	void CleanupInstance(LosInstance* instance);
@@ -201,6 +216,24 @@ private:
 
 	std::deque<LosInstance*> toBeDeleted;
 
+	/// instances waiting for UpdateQueuedInstances, this can be non-empty
+	/// between frames (MoveUnit is also called after Update)
+	std::vector<LosInstance*> queuedInstances;
+
+	/// LOS of an instance that is still on the maps, but has to be removed
+	/// by UpdateQueuedInstances (the instance itself may be re-used or
+	/// deleted before that, so its squares are moved here)
+	struct QueuedRemoval {
+		CR_DECLARE_STRUCT(QueuedRemoval);
+		std::vector<int> losSquares;
+		int losSize;
+		int airLosSize;
+		int allyteam;
+		int2 baseAirPos;
+	};
+
+	std::vector<QueuedRemoval> queuedRemovals;
+
 	struct DelayedInstance {
 		CR_DECLARE_STRUCT(DelayedInstance);
 		LosInstance* instance;
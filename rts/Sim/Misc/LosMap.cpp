@@ -307,17 +307,75 @@ void CLosAlgorithm::LosAdd(int2 pos, int radius, float baseHeight, std::vector<i
 #define MAP_SQUARE(pos) \
 	((pos).y * size.x + (pos).x)
 
-#define LOS_ADD(_square, _maxAng) \
-	{ \
-		const int square = _square; \
-		const float dh = heightmap[square] - baseHeight; \
-		float ang = (dh + extraHeight) * invR; \
-		if(ang > _maxAng) { \
-			squares.push_back(square); \
-			ang = dh * invR; \
-			if(ang > _maxAng) _maxAng = ang; \
-		} \
+
+/**
+ * Casts the four rays that are mirror images of each line in <table>
+ * in lockstep. The lanes share <invR> and are otherwise independent,
+ * so the inner per-lane loops contain no cross-lane dependencies and
+ * can be vectorized; the per-lane arithmetic is identical to that of
+ * the original one-ray-at-a-time version, so are the results.
+ *
+ * <clip> is false when the caller guarantees that every ray stays
+ * within the map (the common case), in which case the bounds checks
+ * compile away.
+ */
+template<bool clip>
+static inline void CastLosRays(
+	const LosTable& table,
+	const float* heightmap,
+	int2 size,
+	int2 pos,
+	float baseHeight,
+	float minMaxAng,
+	float extraHeight,
+	std::vector<int>& squares)
+{
+	const int mapSquare = MAP_SQUARE(pos);
+
+	for (LosTable::const_iterator li = table.begin(); li != table.end(); ++li) {
+		const LosLine& line = *li;
+
+		float maxAng[4] = {minMaxAng, minMaxAng, minMaxAng, minMaxAng};
+		float r = 1;
+
+		for (LosLine::const_iterator linei = line.begin(); linei != line.end(); ++linei) {
+			const float invR = 1.0f / r;
+			const int lx = linei->x;
+			const int ly = linei->y;
+
+			const int laneSquares[4] = {
+				mapSquare + lx + ly * size.x,
+				mapSquare - lx - ly * size.x,
+				mapSquare - lx * size.x + ly,
+				mapSquare + lx * size.x - ly,
+			};
+			const bool laneValid[4] = {
+				!clip || ((pos.x + lx <  size.x) && (pos.y + ly <  size.y)),
+				!clip || ((pos.x - lx >= 0     ) && (pos.y - ly >= 0     )),
+				!clip || ((pos.x + ly <  size.x) && (pos.y - lx >= 0     )),
+				!clip || ((pos.x - ly >= 0     ) && (pos.y + lx <  size.y)),
+			};
+
+			float dh[4];
+			bool visible[4];
+
+			for (int k = 0; k < 4; k++) {
+				dh[k] = heightmap[laneValid[k]? laneSquares[k]: mapSquare] - baseHeight;
+			}
+			for (int k = 0; k < 4; k++) {
+				visible[k] = laneValid[k] && (((dh[k] + extraHeight) * invR) > maxAng[k]);
+				maxAng[k] = (visible[k])? std::max(maxAng[k], dh[k] * invR): maxAng[k];
+			}
+			for (int k = 0; k < 4; k++) {
+				if (visible[k]) {
+					squares.push_back(laneSquares[k]);
+				}
+			}
+
+			r++;
+		}
 	}
+}
 
 
 void CLosAlgorithm::UnsafeLosAdd(int2 pos, int radius, float baseHeight, std::vector<int>& squares)
@@ -335,25 +393,7 @@ void CLosAlgorithm::UnsafeLosAdd(int2 pos, int radius, float baseHeight, std::ve
 
 	squares.push_back(mapSquare);
 
-	for(LosTable::const_iterator li = table.begin(); li != table.end(); ++li) {
-		const LosLine& line = *li;
-		float maxAng1 = minMaxAng;
-		float maxAng2 = minMaxAng;
-		float maxAng3 = minMaxAng;
-		float maxAng4 = minMaxAng;
-		float r = 1;
-
-		for(LosLine::const_iterator linei = line.begin(); linei != line.end(); ++linei) {
-			const float invR = 1.0f / r;
-
-			LOS_ADD(mapSquare + linei->x + linei->y * size.x, maxAng1);
-			LOS_ADD(mapSquare - linei->x - linei->y * size.x, maxAng2);
-			LOS_ADD(mapSquare - linei->x * size.x + linei->y, maxAng3);
-			LOS_ADD(mapSquare + linei->x * size.x - linei->y, maxAng4);
-
-			r++;
-		}
-	}
+	CastLosRays<false>(table, heightmap, size, pos, baseHeight, minMaxAng, extraHeight, squares);
 }
 
 
@@ -366,31 +406,5 @@ void CLosAlgorithm::SafeLosAdd(int2 pos, int radius, float baseHeight, std::vect
 
 	squares.push_back(mapSquare);
 
-	for (LosTable::const_iterator li = table.begin(); li != table.end(); ++li) {
-		const LosLine& line = *li;
-		float maxAng1 = minMaxAng;
-		float maxAng2 = minMaxAng;
-		float maxAng3 = minMaxAng;
-		float maxAng4 = minMaxAng;
-		float r = 1;
-
-		for(LosLine::const_iterator linei = line.begin(); linei != line.end(); ++linei) {
-			const float invR = 1.0f / r;
-
-			if ((pos.x + linei->x < size.x) && (pos.y + linei->y < size.y)) {
-				LOS_ADD(mapSquare + linei->x + linei->y * size.x, maxAng1);
-			}
-			if ((pos.x - linei->x >= 0) && (pos.y - linei->y >= 0)) {
-				LOS_ADD(mapSquare - linei->x - linei->y * size.x, maxAng2);
-			}
-			if ((pos.x + linei->y < size.x) && (pos.y - linei->x >= 0)) {
-				LOS_ADD(mapSquare - linei->x * size.x + linei->y, maxAng3);
-			}
-			if ((pos.x - linei->y >= 0) && (pos.y + linei->x < size.y)) {
-				LOS_ADD(mapSquare + linei->x * size.x - linei->y, maxAng4);
-			}
-
-			r++;
-		}
-	}
+	CastLosRays<true>(table, heightmap, size, pos, baseHeight, minMaxAng, extraHeight, squares);
 }
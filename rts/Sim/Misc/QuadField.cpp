@@ -10,9 +10,9 @@
 #include "Sim/Features/Feature.h"
 #include "Sim/Units/Unit.h"
 #include "Sim/Projectiles/Projectile.h"
-#include "System/creg/STL_List.h"
+#include "System/Util.h"
 
-#define REMOVE_PROJECTILE_FAST
+#include <algorithm>
 
 CR_BIND(CQuadField, );
 CR_REG_METADATA(CQuadField, (
@@ -68,6 +68,12 @@ CQuadField::CQuadField()
 
 	baseQuads.resize(numQuadsX * numQuadsZ);
 	tempQuads.resize(std::max(numTempQuads, numQuadsX * numQuadsZ));
+	quadChangeNums.resize(numQuadsX * numQuadsZ, 0);
+	// the lists in enemyUnits start out at 0, so they are built on first use
+	quadUnitChangeNums.resize(numQuadsX * numQuadsZ, 1);
+
+	changeNum = 0;
+	unitChangeNum = 1;
 }
 
 CQuadField::~CQuadField()
@@ -78,13 +84,20 @@ CQuadField::~CQuadField()
 
 
 std::vector<int> CQuadField::GetQuads(float3 pos, float radius) const
+{
+	std::vector<int> ret;
+	GetQuads(pos, radius, ret);
+	return ret;
+}
+
+void CQuadField::GetQuads(float3 pos, float radius, std::vector<int>& quads) const
 {
 	pos.ClampInBounds();
 	assert(!math::isnan(pos.x));
 	assert(!math::isnan(pos.y));
 	assert(!math::isnan(pos.z));
 
-	std::vector<int> ret;
+	quads.clear();
 
 	const int maxx = std::min(((int)(pos.x + radius)) / QUAD_SIZE + 1, numQuadsX - 1);
 	const int maxz = std::min(((int)(pos.z + radius)) / QUAD_SIZE + 1, numQuadsZ - 1);
@@ -93,20 +106,18 @@ std::vector<int> CQuadField::GetQuads(float3 pos, float radius) const
 	const int minz = std::max(((int)(pos.z - radius)) / QUAD_SIZE, 0);
 
 	if (maxz < minz || maxx < minx) {
-		return ret;
+		return;
 	}
 
 	const float maxSqLength = (radius + QUAD_SIZE * 0.72f) * (radius + QUAD_SIZE * 0.72f);
-	ret.reserve((maxz - minz) * (maxx - minx));
+	quads.reserve((maxz - minz) * (maxx - minx));
 	for (int z = minz; z <= maxz; ++z) {
 		for (int x = minx; x <= maxx; ++x) {
 			if ((pos - float3(x * QUAD_SIZE + QUAD_SIZE * 0.5f, 0, z * QUAD_SIZE + QUAD_SIZE * 0.5f)).SqLength2D() < maxSqLength) {
-				ret.push_back(z * numQuadsX + x);
+				quads.push_back(z * numQuadsX + x);
 			}
 		}
 	}
-
-	return ret;
 }
 
 
@@ -147,6 +158,28 @@ unsigned int CQuadField::GetQuads(float3 pos, float radius, int*& begQuad, int*&
 
 
 std::vector<CUnit*> CQuadField::GetUnits(const float3& pos, float radius)
+{
+	std::vector<CUnit*> units;
+	GetUnits(pos, radius, units);
+	return units;
+}
+
+std::vector<CUnit*> CQuadField::GetUnitsExact(const float3& pos, float radius, bool spherical)
+{
+	std::vector<CUnit*> units;
+	GetUnitsExact(pos, radius, units, spherical);
+	return units;
+}
+
+std::vector<CUnit*> CQuadField::GetUnitsExact(const float3& mins, const float3& maxs)
+{
+	std::vector<CUnit*> units;
+	GetUnitsExact(mins, maxs, units);
+	return units;
+}
+
+
+void CQuadField::GetUnits(const float3& pos, float radius, std::vector<CUnit*>& units)
 {
 	GML_RECMUTEX_LOCK(qnum); // GetUnits
 
@@ -157,24 +190,21 @@ std::vector<CUnit*> CQuadField::GetUnits(const float3& pos, float radius)
 
 	GetQuads(pos, radius, begQuad, endQuad);
 
-	std::vector<CUnit*> units;
-	std::list<CUnit*>::iterator ui;
+	units.clear();
 
 	for (int* a = begQuad; a != endQuad; ++a) {
-		Quad& quad = baseQuads[*a];
+		const std::vector<CUnit*>& quadUnits = baseQuads[*a].units;
 
-		for (ui = quad.units.begin(); ui != quad.units.end(); ++ui) {
+		for (std::vector<CUnit*>::const_iterator ui = quadUnits.begin(); ui != quadUnits.end(); ++ui) {
 			if ((*ui)->tempNum == tempNum) { continue; }
 
 			(*ui)->tempNum = tempNum;
 			units.push_back(*ui);
 		}
 	}
-
-	return units;
 }
 
-std::vector<CUnit*> CQuadField::GetUnitsExact(const float3& pos, float radius, bool spherical)
+void CQuadField::GetUnitsExact(const float3& pos, float radius, std::vector<CUnit*>& units, bool spherical)
 {
 	GML_RECMUTEX_LOCK(qnum); // GetUnitsExact
 
@@ -185,13 +215,12 @@ std::vector<CUnit*> CQuadField::GetUnitsExact(const float3& pos, float radius, b
 
 	GetQuads(pos, radius, begQuad, endQuad);
 
-	std::vector<CUnit*> units;
-	std::list<CUnit*>::iterator ui;
+	units.clear();
 
 	for (int* a = begQuad; a != endQuad; ++a) {
-		Quad& quad = baseQuads[*a];
+		const std::vector<CUnit*>& quadUnits = baseQuads[*a].units;
 
-		for (ui = quad.units.begin(); ui != quad.units.end(); ++ui) {
+		for (std::vector<CUnit*>::const_iterator ui = quadUnits.begin(); ui != quadUnits.end(); ++ui) {
 			if ((*ui)->tempNum == tempNum) { continue; }
 
 			const float totRad       = radius + (*ui)->radius;
@@ -206,38 +235,36 @@ std::vector<CUnit*> CQuadField::GetUnitsExact(const float3& pos, float radius, b
 			units.push_back(*ui);
 		}
 	}
-
-	return units;
 }
 
-std::vector<CUnit*> CQuadField::GetUnitsExact(const float3& mins, const float3& maxs)
+void CQuadField::GetUnitsExact(const float3& mins, const float3& maxs, std::vector<CUnit*>& units)
 {
 	GML_RECMUTEX_LOCK(qnum); // GetUnitsExact
 
-	const std::vector<int>& quads = GetQuadsRectangle(mins, maxs);
 	const int tempNum = gs->tempNum++;
 
-	std::vector<CUnit*> units;
-	std::vector<int>::const_iterator qi;
+	int* begQuad = &tempQuads[0];
+	int* endQuad = &tempQuads[0];
 
-	for (qi = quads.begin(); qi != quads.end(); ++qi) {
-		std::list<CUnit*>& quadUnits = baseQuads[*qi].units;
-		std::list<CUnit*>::iterator ui;
+	GetQuadsRectangle(mins, maxs, begQuad, endQuad);
+
+	units.clear();
+
+	for (int* a = begQuad; a != endQuad; ++a) {
+		const std::vector<CUnit*>& quadUnits = baseQuads[*a].units;
 
-		for (ui = quadUnits.begin(); ui != quadUnits.end(); ++ui) {
+		for (std::vector<CUnit*>::const_iterator ui = quadUnits.begin(); ui != quadUnits.end(); ++ui) {
 			CUnit* unit = *ui;
 			const float3& pos = unit->midPos;
 
 			if (unit->tempNum == tempNum) { continue; }
 			if (pos.x < mins.x || pos.x > maxs.x) { continue; }
 			if (pos.z < mins.z || pos.z > maxs.z) { continue; }
-			
+
 			unit->tempNum = tempNum;
 			units.push_back(unit);
 		}
 	}
-
-	return units;
 }
 
 
@@ -413,6 +440,10 @@ void CQuadField::MovedUnit(CUnit* unit)
 			++qi1;
 		}
 		if (qi2 == newQuads.end()) {
+			// the unit still moved within its quads
+			for (qi2 = newQuads.begin(); qi2 != newQuads.end(); ++qi2) {
+				MarkQuadChanged(*qi2);
+			}
 			return;
 		}
 	}
@@ -421,23 +452,16 @@ void CQuadField::MovedUnit(CUnit* unit)
 
 	std::vector<int>::const_iterator qi;
 	for (qi = unit->quads.begin(); qi != unit->quads.end(); ++qi) {
-		std::list<CUnit*>::iterator ui;
-		for (ui = baseQuads[*qi].units.begin(); ui != baseQuads[*qi].units.end(); ++ui) {
-			if (*ui == unit) {
-				baseQuads[*qi].units.erase(ui);
-				break;
-			}
-		}
-		for (ui = baseQuads[*qi].teamUnits[unit->allyteam].begin(); ui != baseQuads[*qi].teamUnits[unit->allyteam].end(); ++ui) {
-			if (*ui == unit) {
-				baseQuads[*qi].teamUnits[unit->allyteam].erase(ui);
-				break;
-			}
-		}
+		VectorEraseUnordered(baseQuads[*qi].units, unit);
+		VectorEraseUnordered(baseQuads[*qi].teamUnits[unit->allyteam], unit);
+		MarkQuadChanged(*qi);
+		MarkQuadUnitsChanged(*qi);
 	}
 	for (qi = newQuads.begin(); qi != newQuads.end(); ++qi) {
-		baseQuads[*qi].units.push_front(unit);
-		baseQuads[*qi].teamUnits[unit->allyteam].push_front(unit);
+		baseQuads[*qi].units.push_back(unit);
+		baseQuads[*qi].teamUnits[unit->allyteam].push_back(unit);
+		MarkQuadChanged(*qi);
+		MarkQuadUnitsChanged(*qi);
 	}
 	unit->quads = newQuads;
 }
@@ -448,21 +472,68 @@ void CQuadField::RemoveUnit(CUnit* unit)
 
 	std::vector<int>::const_iterator qi;
 	for (qi = unit->quads.begin(); qi != unit->quads.end(); ++qi) {
-		std::list<CUnit*>::iterator ui;
-		for (ui = baseQuads[*qi].units.begin(); ui != baseQuads[*qi].units.end(); ++ui) {
-			if (*ui == unit) {
-				baseQuads[*qi].units.erase(ui);
-				break;
-			}
+		VectorEraseUnordered(baseQuads[*qi].units, unit);
+		VectorEraseUnordered(baseQuads[*qi].teamUnits[unit->allyteam], unit);
+		MarkQuadChanged(*qi);
+		MarkQuadUnitsChanged(*qi);
+	}
+	unit->quads.clear();
+}
+
+
+const std::vector<CUnit*>& CQuadField::GetEnemyUnits(int quadIdx, int allyTeam)
+{
+	GML_RECMUTEX_LOCK(qnum); // GetEnemyUnits
+
+	const unsigned int numAllyTeams = teamHandler->ActiveAllyTeams();
+
+	if (enemyUnits.size() < numAllyTeams)
+		enemyUnits.resize(numAllyTeams);
+
+	EnemyUnits& eu = enemyUnits[allyTeam];
+
+	if (eu.enemies.size() != numAllyTeams || eu.allianceChangeNum != teamHandler->GetAllianceChangeNum()) {
+		bool alliancesChanged = (eu.enemies.size() != numAllyTeams);
+
+		eu.enemies.resize(numAllyTeams);
+
+		for (unsigned int t = 0; t < numAllyTeams; ++t) {
+			const bool enemy = !teamHandler->Ally(allyTeam, t);
+
+			alliancesChanged |= (eu.enemies[t] != enemy);
+			eu.enemies[t] = enemy;
 		}
-		for (ui = baseQuads[*qi].teamUnits[unit->allyteam].begin(); ui != baseQuads[*qi].teamUnits[unit->allyteam].end(); ++ui) {
-			if (*ui == unit) {
-				baseQuads[*qi].teamUnits[unit->allyteam].erase(ui);
-				break;
+
+		if (eu.quads.empty()) {
+			eu.quads.resize(baseQuads.size());
+		} else if (alliancesChanged) {
+			for (unsigned int q = 0; q < eu.quads.size(); ++q) {
+				eu.quads[q].changeNum = 0;
 			}
 		}
+
+		eu.allianceChangeNum = teamHandler->GetAllianceChangeNum();
 	}
-	unit->quads.clear();
+
+	EnemyQuadUnits& equ = eu.quads[quadIdx];
+
+	if (equ.changeNum == quadUnitChangeNums[quadIdx])
+		return equ.units;
+
+	equ.prevUnits.swap(equ.units);
+	equ.units.clear();
+
+	for (unsigned int t = 0; t < numAllyTeams; ++t) {
+		if (!eu.enemies[t]) {
+			continue;
+		}
+
+		const std::vector<CUnit*>& allyTeamUnits = baseQuads[quadIdx].teamUnits[t];
+		equ.units.insert(equ.units.end(), allyTeamUnits.begin(), allyTeamUnits.end());
+	}
+
+	equ.changeNum = quadUnitChangeNums[quadIdx];
+	return equ.units;
 }
 
 
@@ -475,7 +546,8 @@ void CQuadField::AddFeature(CFeature* feature)
 
 	std::vector<int>::const_iterator qi;
 	for (qi = newQuads.begin(); qi != newQuads.end(); ++qi) {
-		baseQuads[*qi].features.push_front(feature);
+		baseQuads[*qi].features.push_back(feature);
+		MarkQuadChanged(*qi);
 	}
 }
 
@@ -487,7 +559,8 @@ void CQuadField::RemoveFeature(CFeature* feature)
 
 	std::vector<int>::const_iterator qi;
 	for (qi = quads.begin(); qi != quads.end(); ++qi) {
-		baseQuads[*qi].features.remove(feature);
+		VectorEraseUnordered(baseQuads[*qi].features, feature);
+		MarkQuadChanged(*qi);
 	}
 }
 
@@ -522,10 +595,11 @@ void CQuadField::AddProjectile(CProjectile* p)
 	GML_RECMUTEX_LOCK(quad);
 
 	Quad& q = baseQuads[numQuadsX * cellCoors.y + cellCoors.x];
-	std::list<CProjectile*>& projectiles = q.projectiles;
+	std::vector<CProjectile*>& projectiles = q.projectiles;
 
 	p->SetQuadFieldCellCoors(cellCoors);
-	p->SetQuadFieldCellIter(projectiles.insert(projectiles.end(), p));
+	p->SetQuadFieldCellIdx(projectiles.size());
+	projectiles.push_back(p);
 }
 
 void CQuadField::RemoveProjectile(CProjectile* p)
@@ -539,44 +613,85 @@ void CQuadField::RemoveProjectile(CProjectile* p)
 
 	Quad& q = baseQuads[cellIdx];
 
-	std::list<CProjectile*>& projectiles = q.projectiles;
-	std::list<CProjectile*>::iterator pi = p->GetQuadFieldCellIter();
+	std::vector<CProjectile*>& projectiles = q.projectiles;
+	const int projIdx = p->GetQuadFieldCellIdx();
 
-	#ifdef REMOVE_PROJECTILE_FAST
-	if (pi != projectiles.end()) {
-		// this is O(1) instead of O(n) and crucially
-		// important for projectiles, but less clean
-		projectiles.erase(pi);
+	if (projIdx >= 0 && projIdx < int(projectiles.size()) && projectiles[projIdx] == p) {
+		// this is O(1) instead of O(n) and crucially important
+		// for projectiles; the back element takes over our slot
+		projectiles[projIdx] = projectiles.back();
+		projectiles[projIdx]->SetQuadFieldCellIdx(projIdx);
+		projectiles.pop_back();
 	} else {
 		assert(false);
 	}
-	#else
-	for (pi = projectiles.begin(); pi != projectiles.end(); ++pi) {
-		if ((*pi) == p) {
-			projectiles.erase(pi);
-			break;
-		}
-	}
-	#endif
 
-	p->SetQuadFieldCellIter(projectiles.end());
+	p->SetQuadFieldCellIdx(-1);
 }
 
 
 
 std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& pos, float radius)
+{
+	std::vector<CFeature*> features;
+	GetFeaturesExact(pos, radius, features);
+	return features;
+}
+
+std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& pos, float radius, bool spherical)
+{
+	std::vector<CFeature*> features;
+	GetFeaturesExact(pos, radius, features, spherical);
+	return features;
+}
+
+std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& mins, const float3& maxs)
+{
+	std::vector<CFeature*> features;
+	GetFeaturesExact(mins, maxs, features);
+	return features;
+}
+
+std::vector<CProjectile*> CQuadField::GetProjectilesExact(const float3& pos, float radius)
+{
+	std::vector<CProjectile*> projectiles;
+	GetProjectilesExact(pos, radius, projectiles);
+	return projectiles;
+}
+
+std::vector<CProjectile*> CQuadField::GetProjectilesExact(const float3& mins, const float3& maxs)
+{
+	std::vector<CProjectile*> projectiles;
+	GetProjectilesExact(mins, maxs, projectiles);
+	return projectiles;
+}
+
+std::vector<CSolidObject*> CQuadField::GetSolidsExact(const float3& pos, float radius)
+{
+	std::vector<CSolidObject*> solids;
+	GetSolidsExact(pos, radius, solids);
+	return solids;
+}
+
+
+
+void CQuadField::GetFeaturesExact(const float3& pos, float radius, std::vector<CFeature*>& features)
 {
 	GML_RECMUTEX_LOCK(qnum); // GetFeaturesExact
 
-	const std::vector<int>& quads = GetQuads(pos, radius);
 	const int tempNum = gs->tempNum++;
 
-	std::vector<CFeature*> features;
-	std::vector<int>::const_iterator qi;
-	std::list<CFeature*>::iterator fi;
+	int* begQuad = &tempQuads[0];
+	int* endQuad = &tempQuads[0];
 
-	for (qi = quads.begin(); qi != quads.end(); ++qi) {
-		for (fi = baseQuads[*qi].features.begin(); fi != baseQuads[*qi].features.end(); ++fi) {
+	GetQuads(pos, radius, begQuad, endQuad);
+
+	features.clear();
+
+	for (int* a = begQuad; a != endQuad; ++a) {
+		const std::vector<CFeature*>& quadFeatures = baseQuads[*a].features;
+
+		for (std::vector<CFeature*>::const_iterator fi = quadFeatures.begin(); fi != quadFeatures.end(); ++fi) {
 			const float totRad = radius + (*fi)->radius;
 
 			if ((*fi)->tempNum == tempNum) { continue; }
@@ -586,25 +701,26 @@ std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& pos, float rad
 			features.push_back(*fi);
 		}
 	}
-
-	return features;
 }
 
-std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& pos, float radius, bool spherical)
+void CQuadField::GetFeaturesExact(const float3& pos, float radius, std::vector<CFeature*>& features, bool spherical)
 {
 	GML_RECMUTEX_LOCK(qnum); // GetFeaturesExact
 
-	const std::vector<int>& quads = GetQuads(pos, radius);
 	const int tempNum = gs->tempNum++;
-
-	std::vector<CFeature*> features;
-	std::vector<int>::const_iterator qi;
-	std::list<CFeature*>::iterator fi;
 	const float totRadSq = radius * radius;
 
-	for (qi = quads.begin(); qi != quads.end(); ++qi) {
-		for (fi = baseQuads[*qi].features.begin(); fi != baseQuads[*qi].features.end(); ++fi) {
+	int* begQuad = &tempQuads[0];
+	int* endQuad = &tempQuads[0];
+
+	GetQuads(pos, radius, begQuad, endQuad);
+
+	features.clear();
 
+	for (int* a = begQuad; a != endQuad; ++a) {
+		const std::vector<CFeature*>& quadFeatures = baseQuads[*a].features;
+
+		for (std::vector<CFeature*>::const_iterator fi = quadFeatures.begin(); fi != quadFeatures.end(); ++fi) {
 			if ((*fi)->tempNum == tempNum) { continue; }
 			if ((spherical ?
 				(pos - (*fi)->midPos).SqLength() :
@@ -614,25 +730,25 @@ std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& pos, float rad
 			features.push_back(*fi);
 		}
 	}
-
-	return features;
 }
 
-std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& mins, const float3& maxs)
+void CQuadField::GetFeaturesExact(const float3& mins, const float3& maxs, std::vector<CFeature*>& features)
 {
 	GML_RECMUTEX_LOCK(qnum); // GetFeaturesExact
 
-	const std::vector<int>& quads = GetQuadsRectangle(mins, maxs);
 	const int tempNum = gs->tempNum++;
 
-	std::vector<CFeature*> features;
-	std::vector<int>::const_iterator qi;
-	std::list<CFeature*>::iterator fi;
+	int* begQuad = &tempQuads[0];
+	int* endQuad = &tempQuads[0];
 
-	for (qi = quads.begin(); qi != quads.end(); ++qi) {
-		std::list<CFeature*>& quadFeatures = baseQuads[*qi].features;
+	GetQuadsRectangle(mins, maxs, begQuad, endQuad);
+
+	features.clear();
 
-		for (fi = quadFeatures.begin(); fi != quadFeatures.end(); ++fi) {
+	for (int* a = begQuad; a != endQuad; ++a) {
+		const std::vector<CFeature*>& quadFeatures = baseQuads[*a].features;
+
+		for (std::vector<CFeature*>::const_iterator fi = quadFeatures.begin(); fi != quadFeatures.end(); ++fi) {
 			CFeature* feature = *fi;
 			const float3& pos = feature->midPos;
 
@@ -644,26 +760,25 @@ std::vector<CFeature*> CQuadField::GetFeaturesExact(const float3& mins, const fl
 			features.push_back(feature);
 		}
 	}
-
-	return features;
 }
 
 
 
-std::vector<CProjectile*> CQuadField::GetProjectilesExact(const float3& pos, float radius)
+void CQuadField::GetProjectilesExact(const float3& pos, float radius, std::vector<CProjectile*>& projectiles)
 {
 	GML_RECMUTEX_LOCK(qnum);
 
-	const std::vector<int>& quads = GetQuads(pos, radius);
+	int* begQuad = &tempQuads[0];
+	int* endQuad = &tempQuads[0];
 
-	std::vector<CProjectile*> projectiles;
-	std::vector<int>::const_iterator qi;
-	std::list<CProjectile*>::iterator pi;
+	GetQuads(pos, radius, begQuad, endQuad);
 
-	for (qi = quads.begin(); qi != quads.end(); ++qi) {
-		std::list<CProjectile*>& quadProjectiles = baseQuads[*qi].projectiles;
+	projectiles.clear();
 
-		for (pi = quadProjectiles.begin(); pi != quadProjectiles.end(); ++pi) {
+	for (int* a = begQuad; a != endQuad; ++a) {
+		const std::vector<CProjectile*>& quadProjectiles = baseQuads[*a].projectiles;
+
+		for (std::vector<CProjectile*>::const_iterator pi = quadProjectiles.begin(); pi != quadProjectiles.end(); ++pi) {
 			const float totRad = radius + (*pi)->radius;
 
 			if ((pos - (*pi)->pos).SqLength() >= (totRad * totRad)) {
@@ -673,24 +788,23 @@ std::vector<CProjectile*> CQuadField::GetProjectilesExact(const float3& pos, flo
 			projectiles.push_back(*pi);
 		}
 	}
-
-	return projectiles;
 }
 
-std::vector<CProjectile*> CQuadField::GetProjectilesExact(const float3& mins, const float3& maxs)
+void CQuadField::GetProjectilesExact(const float3& mins, const float3& maxs, std::vector<CProjectile*>& projectiles)
 {
 	GML_RECMUTEX_LOCK(qnum);
 
-	const std::vector<int>& quads = GetQuadsRectangle(mins, maxs);
+	int* begQuad = &tempQuads[0];
+	int* endQuad = &tempQuads[0];
 
-	std::vector<CProjectile*> projectiles;
-	std::vector<int>::const_iterator qi;
-	std::list<CProjectile*>::iterator pi;
+	GetQuadsRectangle(mins, maxs, begQuad, endQuad);
 
-	for (qi = quads.begin(); qi != quads.end(); ++qi) {
-		std::list<CProjectile*>& quadProjectiles = baseQuads[*qi].projectiles;
+	projectiles.clear();
+
+	for (int* a = begQuad; a != endQuad; ++a) {
+		const std::vector<CProjectile*>& quadProjectiles = baseQuads[*a].projectiles;
 
-		for (pi = quadProjectiles.begin(); pi != quadProjectiles.end(); ++pi) {
+		for (std::vector<CProjectile*>::const_iterator pi = quadProjectiles.begin(); pi != quadProjectiles.end(); ++pi) {
 			CProjectile* projectile = *pi;
 			const float3& pos = projectile->pos;
 
@@ -700,25 +814,27 @@ std::vector<CProjectile*> CQuadField::GetProjectilesExact(const float3& mins, co
 			projectiles.push_back(projectile);
 		}
 	}
-
-	return projectiles;
 }
 
 
 
-std::vector<CSolidObject*> CQuadField::GetSolidsExact(const float3& pos, float radius)
+void CQuadField::GetSolidsExact(const float3& pos, float radius, std::vector<CSolidObject*>& solids)
 {
 	GML_RECMUTEX_LOCK(qnum); // GetSolidsExact
 
-	const std::vector<int>& quads = GetQuads(pos, radius);
 	const int tempNum = gs->tempNum++;
 
-	std::vector<CSolidObject*> solids;
-	std::vector<int>::const_iterator qi;
-	std::list<CUnit*>::iterator ui;
+	int* begQuad = &tempQuads[0];
+	int* endQuad = &tempQuads[0];
 
-	for (qi = quads.begin(); qi != quads.end(); ++qi) {
-		for (ui = baseQuads[*qi].units.begin(); ui != baseQuads[*qi].units.end(); ++ui) {
+	GetQuads(pos, radius, begQuad, endQuad);
+
+	solids.clear();
+
+	for (int* a = begQuad; a != endQuad; ++a) {
+		const Quad& quad = baseQuads[*a];
+
+		for (std::vector<CUnit*>::const_iterator ui = quad.units.begin(); ui != quad.units.end(); ++ui) {
 			const float totRad = radius + (*ui)->radius;
 
 			if (!(*ui)->blocking) { continue; }
@@ -729,8 +845,7 @@ std::vector<CSolidObject*> CQuadField::GetSolidsExact(const float3& pos, float r
 			solids.push_back(*ui);
 		}
 
-		std::list<CFeature*>::iterator fi;
-		for (fi = baseQuads[*qi].features.begin(); fi != baseQuads[*qi].features.end(); ++fi) {
+		for (std::vector<CFeature*>::const_iterator fi = quad.features.begin(); fi != quad.features.end(); ++fi) {
 			const float totRad = radius + (*fi)->radius;
 
 			if (!(*fi)->blocking) { continue; }
@@ -741,8 +856,6 @@ std::vector<CSolidObject*> CQuadField::GetSolidsExact(const float3& pos, float r
 			solids.push_back(*fi);
 		}
 	}
-
-	return solids;
 }
 
 
@@ -779,6 +892,31 @@ std::vector<int> CQuadField::GetQuadsRectangle(const float3& pos1, const float3&
 
 
 
+unsigned int CQuadField::GetQuadsRectangle(const float3& pos1, const float3& pos2, int*& begQuad, int*& endQuad) const
+{
+	assert(begQuad == &tempQuads[0]);
+	assert(endQuad == &tempQuads[0]);
+
+	const int maxx = std::max(0, std::min(((int)(pos2.x)) / QUAD_SIZE + 1, numQuadsX - 1));
+	const int maxz = std::max(0, std::min(((int)(pos2.z)) / QUAD_SIZE + 1, numQuadsZ - 1));
+
+	const int minx = std::max(0, std::min(((int)(pos1.x)) / QUAD_SIZE, numQuadsX - 1));
+	const int minz = std::max(0, std::min(((int)(pos1.z)) / QUAD_SIZE, numQuadsZ - 1));
+
+	if (maxz < minz || maxx < minx)
+		return 0;
+
+	for (int z = minz; z <= maxz; ++z) {
+		for (int x = minx; x <= maxx; ++x) {
+			*endQuad = z * numQuadsX + x; ++endQuad;
+		}
+	}
+
+	return (endQuad - begQuad);
+}
+
+
+
 // optimization specifically for projectile collisions
 void CQuadField::GetUnitsAndFeaturesExact(const float3& pos, float radius, CUnit**& dstUnit, CFeature**& dstFeature)
 {
@@ -791,11 +929,11 @@ void CQuadField::GetUnitsAndFeaturesExact(const float3& pos, float radius, CUnit
 
 	GetQuads(pos, radius, begQuad, endQuad);
 
-	std::list<CUnit*>::iterator ui;
-	std::list<CFeature*>::iterator fi;
+	std::vector<CUnit*>::const_iterator ui;
+	std::vector<CFeature*>::const_iterator fi;
 
 	for (int* a = begQuad; a != endQuad; ++a) {
-		Quad& quad = baseQuads[*a];
+		const Quad& quad = baseQuads[*a];
 
 		for (ui = quad.units.begin(); ui != quad.units.end(); ++ui) {
 			if ((*ui)->tempNum == tempNum) { continue; }
@@ -817,3 +955,106 @@ void CQuadField::GetUnitsAndFeaturesExact(const float3& pos, float radius, CUnit
 		}
 	}
 }
+
+namespace {
+	// order-preserving duplicate removal in O(n log n), for queries
+	// that cannot stamp tempNum because they run on several threads
+	template<typename T> void RemoveDuplicates(std::vector<T*>& objects)
+	{
+		if (objects.size() < 2)
+			return;
+
+		std::vector<T*> sorted(objects);
+		std::sort(sorted.begin(), sorted.end());
+
+		if (std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end())
+			return;
+
+		sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+		std::vector<bool> seen(sorted.size(), false);
+		typename std::vector<T*>::iterator dst = objects.begin();
+
+		for (typename std::vector<T*>::const_iterator it = objects.begin(); it != objects.end(); ++it) {
+			const size_t idx = std::lower_bound(sorted.begin(), sorted.end(), *it) - sorted.begin();
+
+			if (seen[idx])
+				continue;
+
+			seen[idx] = true;
+			*(dst++) = *it;
+		}
+
+		objects.erase(dst, objects.end());
+	}
+}
+
+void CQuadField::GetUnitsAndFeaturesExactMT(
+	const float3& pos,
+	float radius,
+	std::vector<int>& quads,
+	std::vector<CUnit*>& units,
+	std::vector<CFeature*>& features
+) const {
+	GetQuads(pos, radius, quads);
+
+	units.clear();
+	features.clear();
+
+	std::vector<CUnit*>::const_iterator ui;
+	std::vector<CFeature*>::const_iterator fi;
+
+	for (std::vector<int>::const_iterator qi = quads.begin(); qi != quads.end(); ++qi) {
+		const Quad& quad = baseQuads[*qi];
+
+		units.insert(units.end(), quad.units.begin(), quad.units.end());
+
+		for (fi = quad.features.begin(); fi != quad.features.end(); ++fi) {
+			const float totRad = radius + (*fi)->radius;
+
+			if ((pos - (*fi)->midPos).SqLength() >= (totRad * totRad)) { continue; }
+
+			features.push_back(*fi);
+		}
+	}
+
+	// objects spanning several quads are kept at their first
+	// occurrence, which is what the tempNum check yields too
+	RemoveDuplicates(units);
+	RemoveDuplicates(features);
+}
+
+void CQuadField::MarkObjectChanged(const CSolidObject* object)
+{
+	GML_RECMUTEX_LOCK(qnum); // MarkObjectChanged
+
+	int* begQuad = &tempQuads[0];
+	int* endQuad = &tempQuads[0];
+
+	GetQuads(object->pos, object->radius, begQuad, endQuad);
+
+	for (int* a = begQuad; a != endQuad; ++a) {
+		MarkQuadChanged(*a);
+	}
+}
+
+bool CQuadField::QuadsChangedSince(const float3& pos, float radius, unsigned int num)
+{
+	if (changeNum == num)
+		return false;
+
+	GML_RECMUTEX_LOCK(qnum); // QuadsChangedSince
+
+	int* begQuad = &tempQuads[0];
+	int* endQuad = &tempQuads[0];
+
+	GetQuads(pos, radius, begQuad, endQuad);
+
+	for (int* a = begQuad; a != endQuad; ++a) {
+		if (quadChangeNums[*a] > num) {
+			return true;
+		}
+	}
+
+	return false;
+}
@@ -3,9 +3,7 @@
 #ifndef QUAD_FIELD_H
 #define QUAD_FIELD_H
 
-#include <set>
 #include <vector>
-#include <list>
 #include <boost/noncopyable.hpp>
 
 #include "System/creg/creg_cond.h"
@@ -26,6 +24,8 @@ public:
 	~CQuadField();
 
 	std::vector<int> GetQuads(float3 pos, float radius) const;
+	/// same as above, but fills (and first clears) a buffer owned by the caller
+	void GetQuads(float3 pos, float radius, std::vector<int>& quads) const;
 	std::vector<int> GetQuadsRectangle(const float3& pos1, const float3& pos2) const;
 
 	// optimized functions, somewhat less userfriendly
@@ -39,6 +39,32 @@ public:
 	unsigned int GetQuadsOnRay(float3 start, float3 dir, float length, int*& begQuad, int*& endQuad);
 	void GetUnitsAndFeaturesExact(const float3& pos, float radius, CUnit**& dstUnit, CFeature**& dstFeature);
 
+	/**
+	 * Read-only variant of GetUnitsAndFeaturesExact which may be called
+	 * from several threads at once: it does not touch gs->tempNum or the
+	 * objects' tempNum's, and writes the quad indices to the caller's
+	 * <quads> buffer instead of tempQuads. Returns the objects in the
+	 * same order as GetUnitsAndFeaturesExact.
+	 */
+	void GetUnitsAndFeaturesExactMT(
+		const float3& pos,
+		float radius,
+		std::vector<int>& quads,
+		std::vector<CUnit*>& units,
+		std::vector<CFeature*>& features
+	) const;
+
+	/// incremented every time the contents of a quad change
+	unsigned int GetChangeNum() const { return changeNum; }
+	/// true if any quad overlapped by (pos, radius) changed after <num>
+	bool QuadsChangedSince(const float3& pos, float radius, unsigned int num);
+	/**
+	 * Marks the quads of an object as changed without it having moved,
+	 * for changes that affect collision tests against it (ally-team,
+	 * neutrality, collision volumes, death)
+	 */
+	void MarkObjectChanged(const CSolidObject* object);
+
 	/**
 	 * Returns all units within @c radius of @c pos,
 	 * and treats each unit as a 3D point object
@@ -77,9 +103,38 @@ public:
 
 	std::vector<CSolidObject*> GetSolidsExact(const float3& pos, float radius);
 
+	// allocation-free variants of the above
+	//
+	// results are written to the caller-supplied buffer, which is cleared
+	// first; callers that keep the buffer around between queries (instead
+	// of constructing a new one every time) never touch the heap once its
+	// capacity has grown large enough
+	//
+	void GetUnits(const float3& pos, float radius, std::vector<CUnit*>& units);
+	void GetUnitsExact(const float3& pos, float radius, std::vector<CUnit*>& units, bool spherical = true);
+	void GetUnitsExact(const float3& mins, const float3& maxs, std::vector<CUnit*>& units);
+	void GetFeaturesExact(const float3& pos, float radius, std::vector<CFeature*>& features);
+	void GetFeaturesExact(const float3& pos, float radius, std::vector<CFeature*>& features, bool spherical);
+	void GetFeaturesExact(const float3& mins, const float3& maxs, std::vector<CFeature*>& features);
+	void GetProjectilesExact(const float3& pos, float radius, std::vector<CProjectile*>& projectiles);
+	void GetProjectilesExact(const float3& mins, const float3& maxs, std::vector<CProjectile*>& projectiles);
+	void GetSolidsExact(const float3& pos, float radius, std::vector<CSolidObject*>& solids);
+
 	void MovedUnit(CUnit* unit);
 	void RemoveUnit(CUnit* unit);
 
+	/**
+	 * Returns the enemy units of <allyTeam> in quad <quadIdx>, in the same
+	 * order as a scan over the teamUnits[t] of all enemy ally-teams t
+	 * (ascending) visits them. The list is shared by all queries of that
+	 * ally-team (weapon retargeting, CAI auto-targeting) and only rebuilt
+	 * after a unit entered or left the quad, or the alliances changed; the
+	 * storage of the one before is kept until the next rebuild of the same
+	 * list, so queries that iterate through pointers to it are safe.
+	 * Callers have to check LOS themselves.
+	 */
+	const std::vector<CUnit*>& GetEnemyUnits(int quadIdx, int allyTeam);
+
 	void AddFeature(CFeature* feature);
 	void RemoveFeature(CFeature* feature);
 
@@ -87,18 +142,24 @@ public:
 	void AddProjectile(CProjectile* projectile);
 	void RemoveProjectile(CProjectile* projectile);
 
+	/**
+	 * Objects are stored in contiguous arrays; removal swaps the
+	 * last element into the vacated slot, so the iteration order
+	 * within a quad is deterministic but not insertion-ordered.
+	 * Each projectile caches its own index into <projectiles>.
+	 */
 	struct Quad {
 		CR_DECLARE_STRUCT(Quad);
 		Quad();
-		std::list<CUnit*> units;
-		std::vector< std::list<CUnit*> > teamUnits;
-		std::list<CFeature*> features;
-		std::list<CProjectile*> projectiles;
+		std::vector<CUnit*> units;
+		std::vector< std::vector<CUnit*> > teamUnits;
+		std::vector<CFeature*> features;
+		std::vector<CProjectile*> projectiles;
 	};
 
 	const Quad& GetQuad(int i) const {
 		assert(i >= 0);
-		assert(i < baseQuads.size());
+		assert(i < int(baseQuads.size()));
 		return baseQuads[i];
 	}
 	const Quad& GetQuadAt(int x, int z) const {
@@ -114,8 +175,41 @@ public:
 private:
 	void Serialize(creg::ISerializer& s);
 
+	unsigned int GetQuadsRectangle(const float3& pos1, const float3& pos2, int*& begQuad, int*& endQuad) const;
+
+	void MarkQuadChanged(int quadIdx) { quadChangeNums[quadIdx] = ++changeNum; }
+	void MarkQuadUnitsChanged(int quadIdx) { quadUnitChangeNums[quadIdx] = ++unitChangeNum; }
+
+	struct EnemyQuadUnits {
+		EnemyQuadUnits(): changeNum(0) {}
+
+		std::vector<CUnit*> units;
+		std::vector<CUnit*> prevUnits;
+
+		/// quadUnitChangeNums value of the quad when <units> was built
+		unsigned int changeNum;
+	};
+
+	struct EnemyUnits {
+		EnemyUnits(): allianceChangeNum(0) {}
+
+		std::vector<EnemyQuadUnits> quads;
+		/// which ally-teams were enemies when the lists were built
+		std::vector<bool> enemies;
+		/// teamHandler alliance change number <enemies> was last checked at
+		unsigned int allianceChangeNum;
+	};
+
 	std::vector<Quad> baseQuads;
 	std::vector<int> tempQuads;
+
+	// not saved, only meaningful within a single frame
+	std::vector<unsigned int> quadChangeNums;
+	/// set when a unit enters or leaves a quad
+	std::vector<unsigned int> quadUnitChangeNums;
+	std::vector<EnemyUnits> enemyUnits;
+	unsigned int changeNum;
+	unsigned int unitChangeNum;
 	int numQuadsX;
 	int numQuadsZ;
 };
@@ -3,6 +3,7 @@
 #include <vector>
 #include <cassert>
 #include <limits>
+#include <boost/bind.hpp>
 
 #include "SmoothHeightMesh.h"
 
@@ -10,7 +11,7 @@
 #include "Map/ReadMap.h"
 #include "System/float3.h"
 #include "System/myMath.h"
-#include "System/OpenMP_cond.h"
+#include "System/Platform/ThreadPool.h"
 #include "System/TimeProfiler.h"
 
 #include "System/mmgr.h"
@@ -252,61 +253,59 @@ inline static void FixRemainingMaxima(
 
 
 
-inline static void BlurHorizontal(
+static void BlurHorizontalLine(
 	const int maxx,
 	const int maxy,
 	const int smoothrad,
 	const float resolution,
-	const std::vector<float>& mesh,
-	std::vector<float>& smoothed)
+	const float recipn,
+	const std::vector<float>* meshPtr,
+	std::vector<float>* smoothedPtr,
+	const int y)
 {
-	const float n = 2.0f * smoothrad + 1.0f;
-	const float recipn = 1.0f / n;
+	const std::vector<float>& mesh = *meshPtr;
+	std::vector<float>& smoothed = *smoothedPtr;
 
-	int y;
-	#pragma omp parallel for private(y) schedule(static, 1000)
-	for (y = 0; y <= maxy; ++y) {
-		float avg = 0.0f;
+	float avg = 0.0f;
 
-		for (int x = 0; x <= 2 * smoothrad; ++x) {
-			avg += mesh[x + y * maxx];
-		}
-
-		for (int x = 0; x <= maxx; ++x) {
-			const int idx = x + y * maxx;
+	for (int x = 0; x <= 2 * smoothrad; ++x) {
+		avg += mesh[x + y * maxx];
+	}
 
-			if (x <= smoothrad || x > (maxx - smoothrad)) {
-				// map-border case
-				smoothed[idx] = 0.0f;
+	for (int x = 0; x <= maxx; ++x) {
+		const int idx = x + y * maxx;
 
-				const int xstart = std::max(x - smoothrad, 0);
-				const int xend   = std::min(x + smoothrad, maxx);
+		if (x <= smoothrad || x > (maxx - smoothrad)) {
+			// map-border case
+			smoothed[idx] = 0.0f;
 
-				for (int x1 = xstart; x1 <= xend; ++x1) {
-					smoothed[idx] += mesh[x1 + y * maxx];
-				}
+			const int xstart = std::max(x - smoothrad, 0);
+			const int xend   = std::min(x + smoothrad, maxx);
 
-				const float gh = ground->GetHeightAboveWater(x * resolution, y * resolution);
-				const float sh = smoothed[idx] / (xend - xstart + 1);
+			for (int x1 = xstart; x1 <= xend; ++x1) {
+				smoothed[idx] += mesh[x1 + y * maxx];
+			}
 
-				smoothed[idx] = std::min(readmap->currMaxHeight, std::max(gh, sh));
-			} else {
-				// non-border case
-				avg += mesh[idx + smoothrad] - mesh[idx - smoothrad - 1];
+			const float gh = ground->GetHeightAboveWater(x * resolution, y * resolution);
+			const float sh = smoothed[idx] / (xend - xstart + 1);
 
-				const float gh = ground->GetHeightAboveWater(x * resolution, y * resolution);
-				const float sh = recipn * avg;
+			smoothed[idx] = std::min(readmap->currMaxHeight, std::max(gh, sh));
+		} else {
+			// non-border case
+			avg += mesh[idx + smoothrad] - mesh[idx - smoothrad - 1];
 
-				smoothed[idx] = std::min(readmap->currMaxHeight, std::max(gh, sh));
-			}
+			const float gh = ground->GetHeightAboveWater(x * resolution, y * resolution);
+			const float sh = recipn * avg;
 
-			assert(smoothed[idx] <= std::max(readmap->currMaxHeight, 0.0f));
-			assert(smoothed[idx] >=          readmap->currMinHeight       );
+			smoothed[idx] = std::min(readmap->currMaxHeight, std::max(gh, sh));
 		}
+
+		assert(smoothed[idx] <= std::max(readmap->currMaxHeight, 0.0f));
+		assert(smoothed[idx] >=          readmap->currMinHeight       );
 	}
 }
 
-inline static void BlurVertical(
+inline static void BlurHorizontal(
 	const int maxx,
 	const int maxy,
 	const int smoothrad,
@@ -317,49 +316,75 @@ inline static void BlurVertical(
 	const float n = 2.0f * smoothrad + 1.0f;
 	const float recipn = 1.0f / n;
 
-	int x;
-	#pragma omp parallel for private(x) schedule(static, 1000)
-	for (x = 0; x <= maxx; ++x) {
-		float avg = 0.0f;
+	ThreadPool::parallel_for(0, maxy + 1, boost::bind(&BlurHorizontalLine, maxx, maxy, smoothrad, resolution, recipn, &mesh, &smoothed, _1));
+}
 
-		for (int y = 0; y <= 2 * smoothrad; ++y) {
-			avg += mesh[x + y * maxx];
-		}
+static void BlurVerticalLine(
+	const int maxx,
+	const int maxy,
+	const int smoothrad,
+	const float resolution,
+	const float recipn,
+	const std::vector<float>* meshPtr,
+	std::vector<float>* smoothedPtr,
+	const int x)
+{
+	const std::vector<float>& mesh = *meshPtr;
+	std::vector<float>& smoothed = *smoothedPtr;
 
-		for (int y = 0; y <= maxy; ++y) {
-			const int idx = x + y * maxx;
+	float avg = 0.0f;
 
-			if (y <= smoothrad || y > (maxy - smoothrad)) {
-				// map-border case
-				smoothed[idx] = 0.0f;
+	for (int y = 0; y <= 2 * smoothrad; ++y) {
+		avg += mesh[x + y * maxx];
+	}
 
-				const int ystart = std::max(y - smoothrad, 0);
-				const int yend   = std::min(y + smoothrad, maxy);
+	for (int y = 0; y <= maxy; ++y) {
+		const int idx = x + y * maxx;
 
-				for (int y1 = ystart; y1 <= yend; ++y1) {
-					smoothed[idx] += mesh[x + y1 * maxx];
-				}
+		if (y <= smoothrad || y > (maxy - smoothrad)) {
+			// map-border case
+			smoothed[idx] = 0.0f;
 
-				const float gh = ground->GetHeightAboveWater(x * resolution, y * resolution);
-				const float sh = smoothed[idx] / (yend - ystart + 1);
+			const int ystart = std::max(y - smoothrad, 0);
+			const int yend   = std::min(y + smoothrad, maxy);
 
-				smoothed[idx] = std::min(readmap->currMaxHeight, std::max(gh, sh));
-			} else {
-				// non-border case
-				avg += mesh[x + (y + smoothrad) * maxx] - mesh[x + (y - smoothrad - 1) * maxx];
+			for (int y1 = ystart; y1 <= yend; ++y1) {
+				smoothed[idx] += mesh[x + y1 * maxx];
+			}
 
-				const float gh = ground->GetHeightAboveWater(x * resolution, y * resolution);
-				const float sh = recipn * avg;
+			const float gh = ground->GetHeightAboveWater(x * resolution, y * resolution);
+			const float sh = smoothed[idx] / (yend - ystart + 1);
 
-				smoothed[idx] = std::min(readmap->currMaxHeight, std::max(gh, sh));
-			}
+			smoothed[idx] = std::min(readmap->currMaxHeight, std::max(gh, sh));
+		} else {
+			// non-border case
+			avg += mesh[x + (y + smoothrad) * maxx] - mesh[x + (y - smoothrad - 1) * maxx];
 
-			assert(smoothed[idx] <= std::max(readmap->currMaxHeight, 0.0f));
-			assert(smoothed[idx] >=          readmap->currMinHeight       );
+			const float gh = ground->GetHeightAboveWater(x * resolution, y * resolution);
+			const float sh = recipn * avg;
+
+			smoothed[idx] = std::min(readmap->currMaxHeight, std::max(gh, sh));
 		}
+
+		assert(smoothed[idx] <= std::max(readmap->currMaxHeight, 0.0f));
+		assert(smoothed[idx] >=          readmap->currMinHeight       );
 	}
 }
 
+inline static void BlurVertical(
+	const int maxx,
+	const int maxy,
+	const int smoothrad,
+	const float resolution,
+	const std::vector<float>& mesh,
+	std::vector<float>& smoothed)
+{
+	const float n = 2.0f * smoothrad + 1.0f;
+	const float recipn = 1.0f / n;
+
+	ThreadPool::parallel_for(0, maxx + 1, boost::bind(&BlurVerticalLine, maxx, maxy, smoothrad, resolution, recipn, &mesh, &smoothed, _1));
+}
+
 
 
 inline static void CheckInvariants(
@@ -27,7 +27,8 @@ CTeamHandler* teamHandler = NULL;
 
 CTeamHandler::CTeamHandler():
 	gaiaTeamID(-1),
-	gaiaAllyTeamID(-1)
+	gaiaAllyTeamID(-1),
+	allianceChangeNum(0)
 {
 }
 
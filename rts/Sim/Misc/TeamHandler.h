@@ -84,7 +84,19 @@ public:
 	 *
 	 * Sets two allyteams to be allied or not
 	 */
-	void SetAlly(int allyteamA, int allyteamB, bool allied) { allyTeams[allyteamA].allies[allyteamB] = allied; }
+	void SetAlly(int allyteamA, int allyteamB, bool allied) {
+		allyTeams[allyteamA].allies[allyteamB] = allied;
+		allianceChangeNum++;
+	}
+
+	/**
+	 * @brief alliance change number
+	 * @return a number that changes whenever SetAlly is called
+	 *
+	 * Lets caches of ally-dependent data notice alliance changes
+	 * (SetAlly can be called at any time, e.g. by Lua)
+	 */
+	unsigned int GetAllianceChangeNum() const { return allianceChangeNum; }
 
 	// accessors
 
@@ -133,6 +145,8 @@ private:
 	 */
 	std::vector<CTeam *> teams;
 	std::vector< ::AllyTeam > allyTeams;
+
+	unsigned int allianceChangeNum;
 };
 
 extern CTeamHandler* teamHandler;
@@ -169,7 +169,10 @@ CGroundMoveType::CGroundMoveType(CUnit* owner):
 	numIdlingUpdates(0),
 	numIdlingSlowUpdates(0),
 
-	wantedHeading(0)
+	wantedHeading(0),
+
+	numBatchedPaths(0),
+	wantBatchedPath(false)
 {
 	assert(owner != NULL);
 	assert(owner->unitDef != NULL);
@@ -190,6 +193,9 @@ CGroundMoveType::~CGroundMoveType()
 	if (pathId != 0) {
 		pathManager->DeletePath(pathId);
 	}
+	if (numBatchedPaths != 0) {
+		pathManager->RemoveFromPathBatch(this);
+	}
 
 	IPathController::FreeInstance(pathController);
 }
@@ -197,7 +203,8 @@ CGroundMoveType::~CGroundMoveType()
 void CGroundMoveType::PostLoad()
 {
 	// HACK: re-initialize path after load
-	if (pathId != 0) {
+	// (requests that were still queued are restored by the path-manager)
+	if (pathId != 0 && !pathManager->IsPathQueued(pathId)) {
 		pathId = pathManager->RequestPath(owner->moveDef, owner->pos, goalPos, goalRadius, owner);
 	}
 }
@@ -1177,7 +1184,25 @@ float CGroundMoveType::Distance2D(CSolidObject* object1, CSolidObject* object2,
 void CGroundMoveType::GetNewPath()
 {
 	assert(pathId == 0);
-	pathId = pathManager->RequestPath(owner->moveDef, owner->pos, goalPos, goalRadius, owner);
+
+	if (pathManager->IsPathBatchOpen()) {
+		// part of a group order, the path arrives in PathBatched
+		// once all units of the group have asked for theirs
+		pathManager->AddToPathBatch(IPathManager::PathRequest(owner->moveDef, owner->pos, goalPos, goalRadius, owner), this);
+
+		numBatchedPaths += 1;
+		wantBatchedPath = true;
+	} else {
+		SetNewPath(pathManager->RequestPath(owner->moveDef, owner->pos, goalPos, goalRadius, owner));
+	}
+
+	// limit frequency of (case B) path-requests from SlowUpdate's
+	pathRequestDelay = gs->frameNum + (UNIT_SLOWUPDATE_RATE << 1);
+}
+
+void CGroundMoveType::SetNewPath(unsigned int newPathId)
+{
+	pathId = newPathId;
 
 	// if new path received, can't be at waypoint
 	if (pathId != 0) {
@@ -1189,12 +1214,30 @@ void CGroundMoveType::GetNewPath()
 
 		pathController->SetRealGoalPosition(pathId, goalPos);
 		pathController->SetTempGoalPosition(pathId, currWayPoint);
+
+		// activate "engine" only if a path was found
+		pathManager->UpdatePath(owner, pathId);
+
+		owner->isMoving = true;
+		owner->script->StartMoving();
 	} else {
 		Fail();
 	}
+}
 
-	// limit frequency of (case B) path-requests from SlowUpdate's
-	pathRequestDelay = gs->frameNum + (UNIT_SLOWUPDATE_RATE << 1);
+void CGroundMoveType::PathBatched(unsigned int newPathId)
+{
+	assert(numBatchedPaths > 0);
+
+	// only the last request is still of interest, and
+	// only if the engine was not stopped in the meantime
+	if ((numBatchedPaths -= 1) > 0 || !wantBatchedPath || pathId != 0) {
+		pathManager->DeletePath(newPathId);
+		return;
+	}
+
+	wantBatchedPath = false;
+	SetNewPath(newPathId);
 }
 
 
@@ -1337,20 +1380,14 @@ void CGroundMoveType::StartEngine() {
 	// ran only if the unit has no path and is not already at goal
 	if (pathId == 0 && !atGoal) {
 		GetNewPath();
-
-		// activate "engine" only if a path was found
-		if (pathId != 0) {
-			pathManager->UpdatePath(owner, pathId);
-
-			owner->isMoving = true;
-			owner->script->StartMoving();
-		}
 	}
 
 	nextObstacleAvoidanceUpdate = gs->frameNum;
 }
 
 void CGroundMoveType::StopEngine() {
+	wantBatchedPath = false;
+
 	if (pathId != 0) {
 		pathManager->DeletePath(pathId);
 		pathId = 0;
@@ -5,13 +5,14 @@
 
 #include "MoveType.h"
 #include "Sim/Objects/SolidObject.h"
+#include "Sim/Path/IPathManager.h"
 
 struct UnitDef;
 struct MoveDef;
 class CMoveMath;
 class IPathController;
 
-class CGroundMoveType : public AMoveType
+class CGroundMoveType : public AMoveType, public IPathManager::IPathBatchCaller
 {
 	CR_DECLARE(CGroundMoveType);
 
@@ -43,6 +44,8 @@ public:
 	bool IsFlying() const { return flying; }
 	bool IsReversing() const { return reversing; }
 
+	void PathBatched(unsigned int newPathId);
+
 	static void CreateLineTable();
 	static void DeleteLineTable();
 
@@ -51,6 +54,7 @@ private:
 	float Distance2D(CSolidObject* object1, CSolidObject* object2, float marginal = 0.0f);
 
 	void GetNewPath();
+	void SetNewPath(unsigned int newPathId);
 	void GetNextWayPoint();
 	bool CanGetNextWayPoint();
 
@@ -171,6 +175,11 @@ private:
 	int moveSquareY;
 
 	short wantedHeading;
+
+	/// requests in the open path batch (never saved, batches do not outlive a command)
+	unsigned int numBatchedPaths;
+	/// false if the last batched request was cancelled by StopEngine
+	bool wantBatchedPath;
 };
 
 #endif // GROUNDMOVETYPE_H
@@ -132,11 +132,16 @@ MoveDefHandler::MoveDefHandler()
 	crc << CHoverMoveMath::noWaterMove;
 
 	checksum = crc.GetDigest();
+
+	// needs the water-parameters above
+	CMoveMath::InitSpeedModRasters(moveDefs);
 }
 
 
 MoveDefHandler::~MoveDefHandler()
 {
+	CMoveMath::FreeSpeedModRasters();
+
 	while (!moveDefs.empty()) {
 		delete moveDefs.back();
 		moveDefs.pop_back();
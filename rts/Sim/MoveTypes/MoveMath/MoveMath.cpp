@@ -1,5 +1,8 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
+#include <algorithm>
+#include <cassert>
+
 #include "MoveMath.h"
 #include "Map/ReadMap.h"
 #include "Map/MapInfo.h"
@@ -18,13 +21,86 @@ float CMoveMath::yLevel(const float3& pos) const
 }
 
 
-/* calculate the local speed-modifier for this MoveDef */
-float CMoveMath::GetPosSpeedMod(const MoveDef& moveDef, int xSquare, int zSquare) const
+std::vector<unsigned int> CMoveMath::speedModRasterIndices;
+std::vector< std::vector<float> > CMoveMath::speedModRasters;
+std::vector<const MoveDef*> CMoveMath::speedModRasterDefs;
+
+
+static bool EqualSpeedModParams(const MoveDef& md1, const MoveDef& md2)
 {
-	if (xSquare < 0 || zSquare < 0 || xSquare >= gs->mapx || zSquare >= gs->mapy) {
-		return 0.0f;
+	if (md1.moveMath != md2.moveMath) return false;
+	if (md1.moveFamily != md2.moveFamily) return false;
+	if (md1.depth != md2.depth) return false;
+	if (md1.maxSlope != md2.maxSlope) return false;
+	if (md1.slopeMod != md2.slopeMod) return false;
+
+	for (int n = 0; n < MoveDef::DEPTHMOD_NUM_PARAMS; n++) {
+		if (md1.depthModParams[n] != md2.depthModParams[n])
+			return false;
+	}
+
+	return true;
+}
+
+
+void CMoveMath::InitSpeedModRasters(const std::vector<MoveDef*>& moveDefs)
+{
+	FreeSpeedModRasters();
+
+	for (unsigned int n = 0; n < moveDefs.size(); n++) {
+		const MoveDef* md = moveDefs[n];
+
+		// pathType is the index of the MoveDef
+		assert(md->pathType == n);
+
+		unsigned int rasterIdx = 0;
+
+		while (rasterIdx < speedModRasterDefs.size() && !EqualSpeedModParams(*md, *speedModRasterDefs[rasterIdx]))
+			rasterIdx++;
+
+		if (rasterIdx == speedModRasterDefs.size()) {
+			speedModRasterDefs.push_back(md);
+			speedModRasters.push_back(std::vector<float>(gs->hmapx * gs->hmapy, 0.0f));
+		}
+
+		speedModRasterIndices.push_back(rasterIdx);
+	}
+
+	UpdateSpeedModRasters(0, 0, gs->mapx - 1, gs->mapy - 1);
+}
+
+void CMoveMath::FreeSpeedModRasters()
+{
+	speedModRasterIndices.clear();
+	speedModRasters.clear();
+	speedModRasterDefs.clear();
+}
+
+void CMoveMath::UpdateSpeedModRasters(int x1, int z1, int x2, int z2)
+{
+	// CReadMap::UpdateHeightMapSynced also updates the
+	// slope-map for a few squares around each rectangle
+	const int hx1 = std::max(0, (std::min(x1, x2) >> 1) - 2);
+	const int hz1 = std::max(0, (std::min(z1, z2) >> 1) - 2);
+	const int hx2 = std::min(gs->hmapx - 1, (std::max(x1, x2) >> 1) + 2);
+	const int hz2 = std::min(gs->hmapy - 1, (std::max(z1, z2) >> 1) + 2);
+
+	for (unsigned int n = 0; n < speedModRasters.size(); n++) {
+		const MoveDef& md = *speedModRasterDefs[n];
+		std::vector<float>& raster = speedModRasters[n];
+
+		for (int hz = hz1; hz <= hz2; hz++) {
+			for (int hx = hx1; hx <= hx2; hx++) {
+				raster[hx + hz * gs->hmapx] = md.moveMath->CalcPosSpeedMod(md, hx << 1, hz << 1);
+			}
+		}
 	}
+}
+
 
+/* calculate the local speed-modifier for this MoveDef */
+float CMoveMath::CalcPosSpeedMod(const MoveDef& moveDef, int xSquare, int zSquare) const
+{
 	const int square = (xSquare >> 1) + ((zSquare >> 1) * gs->hmapx);
 	const int squareTerrType = readmap->GetTypeMapSynced()[square];
 
@@ -82,6 +158,11 @@ CMoveMath::BlockType CMoveMath::IsBlockedNoSpeedModCheck(const MoveDef& moveDef,
 	const int xmin = xSquare - moveDef.xsizeh, xmax = xSquare + moveDef.xsizeh;
 	const int zmin = zSquare - moveDef.zsizeh, zmax = zSquare + moveDef.zsizeh;
 	const int xstep = 2, zstep = 2;
+
+	// most footprints are not touched by any object at all
+	if (groundBlockingObjectMap->FootprintEmpty(xmin, zmin, xmax, zmax, xstep))
+		return ret;
+
 	// (footprints are point-symmetric around <xSquare, zSquare>)
 	for (int x = xmin; x <= xmax; x += xstep) {
 		for (int z = zmin; z <= zmax; z += zstep) {
@@ -98,6 +179,10 @@ bool CMoveMath::IsBlockedStructure(const MoveDef& moveDef, int xSquare, int zSqu
 	const int xmin = xSquare - moveDef.xsizeh, xmax = xSquare + moveDef.xsizeh;
 	const int zmin = zSquare - moveDef.zsizeh, zmax = zSquare + moveDef.zsizeh;
 	const int xstep = 2, zstep = 2;
+
+	if (groundBlockingObjectMap->FootprintStructureFree(xmin, zmin, xmax, zmax, xstep))
+		return false;
+
 	// (footprints are point-symmetric around <xSquare, zSquare>)
 	for (int x = xmin; x <= xmax; x += xstep) {
 		for (int z = zmin; z <= zmax; z += zstep) {
@@ -116,6 +201,10 @@ bool CMoveMath::IsBlockedStructureXmax(const MoveDef& moveDef, int xSquare, int
 	const int                                  xmax = xSquare + moveDef.xsizeh;
 	const int zmin = zSquare - moveDef.zsizeh, zmax = zSquare + moveDef.zsizeh;
 	const int zstep = 2;
+
+	if (groundBlockingObjectMap->FootprintStructureFree(xmax, zmin, xmax, zmax, zstep))
+		return false;
+
 	// (footprints are point-symmetric around <xSquare, zSquare>)
 	for (int z = zmin; z <= zmax; z += zstep) {
 		if (SquareIsBlocked(moveDef, xmax, z) & BLOCK_STRUCTURE)
@@ -132,6 +221,10 @@ bool CMoveMath::IsBlockedStructureZmax(const MoveDef& moveDef, int xSquare, int
 	const int xmin = xSquare - moveDef.xsizeh, xmax = xSquare + moveDef.xsizeh;
 	const int                                  zmax = zSquare + moveDef.zsizeh;
 	const int xstep = 2;
+
+	if (groundBlockingObjectMap->FootprintStructureFree(xmin, zmax, xmax, zmax, xstep))
+		return false;
+
 	// (footprints are point-symmetric around <xSquare, zSquare>)
 	for (int x = xmin; x <= xmax; x += xstep) {
 		if (SquareIsBlocked(moveDef, x, zmax) & BLOCK_STRUCTURE)
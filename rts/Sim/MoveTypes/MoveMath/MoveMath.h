@@ -3,6 +3,9 @@
 #ifndef MOVEMATH_H
 #define MOVEMATH_H
 
+#include <vector>
+
+#include "Sim/Misc/GlobalSynced.h"
 #include "Sim/MoveTypes/MoveInfo.h"
 #include "Sim/Objects/SolidObject.h"
 #include "System/float3.h"
@@ -34,7 +37,7 @@ public:
 	
 
 	// returns a speed-multiplier for given position or data
-	float GetPosSpeedMod(const MoveDef& moveDef, int xSquare, int zSquare) const;
+	inline float GetPosSpeedMod(const MoveDef& moveDef, int xSquare, int zSquare) const;
 	float GetPosSpeedMod(const MoveDef& moveDef, int xSquare, int zSquare, const float3& moveDir) const;
 	float GetPosSpeedMod(const MoveDef& moveDef, const float3& pos) const
 	{
@@ -60,9 +63,46 @@ public:
 	// returns the block-status of a single quare
 	static BlockType SquareIsBlocked(const MoveDef& moveDef, int xSquare, int zSquare);
 
+	/**
+	 * The (direction-less) speed-mod of a square only depends on the terrain
+	 * and on the parameters of the MoveDef, so it is cached in one raster
+	 * (at half heightmap resolution, like the slope- and type-maps) per set
+	 * of MoveDefs with equal speed-mod parameters, which usually differ in
+	 * footprint size only.
+	 */
+	static void InitSpeedModRasters(const std::vector<MoveDef*>& moveDefs);
+	static void FreeSpeedModRasters();
+	/// must be called for heightmap-square rectangles whose height or terrain-type changed
+	static void UpdateSpeedModRasters(int x1, int z1, int x2, int z2);
+
 	virtual ~CMoveMath() {}
+
+private:
+	float CalcPosSpeedMod(const MoveDef& moveDef, int xSquare, int zSquare) const;
+
+	/// raster index for each MoveDef::pathType
+	static std::vector<unsigned int> speedModRasterIndices;
+	/// one hmapx * hmapy raster and the first MoveDef using it per set
+	static std::vector< std::vector<float> > speedModRasters;
+	static std::vector<const MoveDef*> speedModRasterDefs;
 };
 
+
+/* Look up the local speed-modifier for this MoveDef. */
+inline float CMoveMath::GetPosSpeedMod(const MoveDef& moveDef, int xSquare, int zSquare) const
+{
+	if (xSquare < 0 || zSquare < 0 || xSquare >= gs->mapx || zSquare >= gs->mapy) {
+		return 0.0f;
+	}
+
+	if (moveDef.pathType >= speedModRasterIndices.size()) {
+		return CalcPosSpeedMod(moveDef, xSquare, zSquare);
+	}
+
+	const std::vector<float>& raster = speedModRasters[speedModRasterIndices[moveDef.pathType]];
+	return raster[(xSquare >> 1) + ((zSquare >> 1) * gs->hmapx)];
+}
+
 /* Check if a given square-position is accessable by the MoveDef footprint. */
 inline CMoveMath::BlockType CMoveMath::IsBlocked(const MoveDef& moveDef, int xSquare, int zSquare) const
 {
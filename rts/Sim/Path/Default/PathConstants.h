@@ -22,6 +22,9 @@ const float DETAILED_DISTANCE     = 25;
 const float MIN_DETAILED_DISTANCE = 12;
 
 const unsigned int PATHESTIMATOR_VERSION = 51;
+const unsigned int PATHDELTA_VERSION = 1;
+// per-frame budget for recalculating obsolete PE blocks; this is shared
+// by all the update threads and MUST NOT depend on their number (sync)
 const unsigned int SQUARES_TO_UPDATE = 600;
 const unsigned int MAX_SEARCHED_NODES_ON_REFINE = 2000;
 
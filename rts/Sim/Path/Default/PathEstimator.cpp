@@ -8,8 +8,6 @@
 
 #include <fstream>
 #include <boost/bind.hpp>
-#include <boost/version.hpp>
-#include <boost/version.hpp>
 
 #include "minizip/zip.h"
 #include "System/mmgr.h"
@@ -19,9 +17,12 @@
 #include "PathFinder.h"
 #include "PathFinderDef.h"
 #include "PathLog.h"
+#include "Map/MapInfo.h"
 #include "Map/ReadMap.h"
 #include "Game/LoadScreen.h"
+#include "Sim/Misc/GroundBlockingObjectMap.h"
 #include "Sim/MoveTypes/MoveInfo.h"
+#include "Sim/MoveTypes/MoveMath/GroundMoveMath.h"
 #include "Sim/MoveTypes/MoveMath/MoveMath.h"
 #include "Sim/Units/Unit.h"
 #include "Sim/Units/UnitDef.h"
@@ -31,29 +32,56 @@
 #include "System/FileSystem/FileSystem.h"
 #include "System/FileSystem/FileQueryFlags.h"
 #include "System/Config/ConfigHandler.h"
+#include "System/CRC.h"
 #include "System/NetProtocol.h"
+#include "System/Platform/ThreadPool.h"
 
 CONFIG(int, MaxPathCostsMemoryFootPrint).defaultValue(512 * 1024 * 1024);
 
 static const std::string PATH_CACHE_DIR = "cache/paths/";
 
-static size_t GetNumThreads() {
-	size_t numThreads = std::max(0, configHandler->GetInt("HardwareThreadCount"));
+static unsigned int GetNumActiveMoveDefs() {
+	unsigned int n = 0;
 
-	if (numThreads == 0) {
-		// auto-detect
-		#if (BOOST_VERSION >= 103500)
-		numThreads = boost::thread::hardware_concurrency();
-		#elif defined(USE_GML)
-		numThreads = gmlCPUCount();
-		#else
-		numThreads = 1;
-		#endif
+	for (vector<MoveDef*>::const_iterator mi = moveDefHandler->moveDefs.begin(); mi != moveDefHandler->moveDefs.end(); ++mi) {
+		n += ((*mi)->unitDefRefCount > 0);
 	}
 
-	return numThreads;
+	return n;
 }
 
+
+/**
+ * Hashes the input of a block signature twice (CRC and FNV-1a), a
+ * false match would make clients with and without the delta-cache
+ * disagree about the estimator data
+ */
+struct SignatureHasher {
+	SignatureHasher(): fnv(2166136261U) {}
+
+	void Update(const void* data, unsigned int size) {
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+
+		for (unsigned int n = 0; n < size; n++) {
+			fnv = (fnv ^ bytes[n]) * 16777619U;
+		}
+
+		crc.Update(data, size);
+	}
+
+	template<typename T> SignatureHasher& operator << (const T& data) {
+		Update(&data, sizeof(T));
+		return *this;
+	}
+
+	boost::uint64_t GetDigest() const {
+		return ((boost::uint64_t(crc.GetDigest()) << 32) | fnv);
+	}
+
+	CRC crc;
+	unsigned int fnv;
+};
+
 #if !defined(USE_MMGR)
 void* CPathEstimator::operator new(size_t size) { return PathAllocator::Alloc(size); }
 void CPathEstimator::operator delete(void* p, size_t size) { PathAllocator::Free(p, size); }
@@ -68,6 +96,9 @@ CPathEstimator::CPathEstimator(CPathFinder* pf, unsigned int BSIZE, const std::s
 	nbrOfBlocksX(gs->mapx / BLOCK_SIZE),
 	nbrOfBlocksZ(gs->mapy / BLOCK_SIZE),
 	blockStates(int2(nbrOfBlocksX, nbrOfBlocksZ), int2(gs->mapx, gs->mapy)),
+	deltasChanged(false),
+	haveUpdated(false),
+	signatureMargin(0),
 	pathFinder(pf),
 	pathChecksum(0),
 	offsetBlockNum(nbrOfBlocksX * nbrOfBlocksZ),
@@ -99,6 +130,12 @@ CPathEstimator::CPathEstimator(CPathFinder* pf, unsigned int BSIZE, const std::s
 
 	vertices.resize(moveDefHandler->moveDefs.size() * blockStates.GetSize() * PATH_DIRECTION_VERTICES, 0.0f);
 
+	// the blocking checks look at the whole footprint around a square,
+	// and the slopes and normals at the surrounding corner heights
+	for (vector<MoveDef*>::const_iterator mi = moveDefHandler->moveDefs.begin(); mi != moveDefHandler->moveDefs.end(); ++mi) {
+		signatureMargin = std::max(signatureMargin, std::max((*mi)->xsizeh, (*mi)->zsizeh) + 2);
+	}
+
 	// load precalculated data if it exists
 	InitEstimator(cacheFileName, map);
 
@@ -120,16 +157,21 @@ CPathEstimator::CPathEstimator(CPathFinder* pf, unsigned int BSIZE, const std::s
 
 CPathEstimator::~CPathEstimator()
 {
+	if (deltasChanged)
+		WriteDeltaFile();
+
+	for (unsigned int i = 0; i < updatePathFinders.size(); i++)
+		delete updatePathFinders[i];
+
 	delete pathCache;
 }
 
 
 void CPathEstimator::InitEstimator(const std::string& cacheFileName, const std::string& map)
 {
-	const unsigned int numThreads = GetNumThreads();
+	const unsigned int numThreads = ThreadPool::GetNumThreads();
 
-	if (threads.size() != numThreads) {
-		threads.resize(numThreads);
+	if (pathFinders.size() != numThreads) {
 		pathFinders.resize(numThreads);
 	}
 
@@ -140,7 +182,7 @@ void CPathEstimator::InitEstimator(const std::string& cacheFileName, const std::
 	InitBlocks();
 
 	if (!ReadFile(cacheFileName, map)) {
-		// start extra threads if applicable, but always keep the total
+		// use extra threads if applicable, but always keep the total
 		// memory-footprint made by CPathFinder instances within bounds
 		const unsigned int minMemFootPrint = sizeof(CPathFinder) + pathFinder->GetMemFootPrint();
 		const unsigned int maxMemFootPrint = configHandler->GetInt("MaxPathCostsMemoryFootPrint");
@@ -157,29 +199,67 @@ void CPathEstimator::InitEstimator(const std::string& cacheFileName, const std::
 			loadscreen->SetLoadMessage(calcMsg);
 		}
 
-		// note: only really needed if numExtraThreads > 0
-		pathBarrier = new boost::barrier(numExtraThreads + 1);
-
 		for (unsigned int i = 1; i <= numExtraThreads; i++) {
 			pathFinders[i] = new CPathFinder();
-			threads[i] = new boost::thread(boost::bind(&CPathEstimator::CalcOffsetsAndPathCosts, this, i));
 		}
 
-		// Use the current thread as thread zero
-		CalcOffsetsAndPathCosts(0);
+		// NOTE: EstimatePathCosts() [B] is temporally dependent on CalculateBlockOffsets() [A],
+		// A must be completely finished before B_i can be safely called. This means we cannot
+		// let task i execute (A_i, B_i), but instead have to split the work such that every
+		// task finishes its part of A before any starts B_i.
+		ThreadPool::TaskGroup tasks;
+		std::vector<ThreadPool::TaskGroup::TaskID> offsetTasks;
+
+		for (unsigned int i = 0; i <= numExtraThreads; i++) {
+			offsetTasks.push_back(tasks.AddTask(boost::bind(&CPathEstimator::CalcOffsets, this, i)));
+		}
+		for (unsigned int i = 0; i <= numExtraThreads; i++) {
+			const ThreadPool::TaskGroup::TaskID costTask = tasks.AddTask(boost::bind(&CPathEstimator::CalcPathCosts, this, i));
+
+			for (unsigned int j = 0; j <= numExtraThreads; j++) {
+				tasks.AddDependency(costTask, offsetTasks[j]);
+			}
+		}
+
+		tasks.Wait();
 
 		for (unsigned int i = 1; i <= numExtraThreads; i++) {
-			threads[i]->join();
-			delete threads[i];
 			delete pathFinders[i];
 		}
 
-		delete pathBarrier;
-
 		loadscreen->SetLoadMessage("PathCosts: writing", true);
 		WriteFile(cacheFileName, map);
 		loadscreen->SetLoadMessage("PathCosts: written", true);
 	}
+
+	{
+		char hashString[64] = {0};
+		sprintf(hashString, "%u", Hash());
+
+		deltaFileName = std::string(PATH_CACHE_DIR) + map + hashString + "." + cacheFileName + ".delta.zip";
+	}
+
+	ReadDeltaFile();
+}
+
+
+void CPathEstimator::InitUpdatePathFinders()
+{
+	// unlike the threads used by InitEstimator, these instances are kept for
+	// the whole game (by both estimators), so each estimator may only use up
+	// half of the memory-footprint allowed for CPathFinder instances
+	const unsigned int minMemFootPrint = sizeof(CPathFinder) + pathFinder->GetMemFootPrint();
+	const unsigned int maxMemFootPrint = configHandler->GetInt("MaxPathCostsMemoryFootPrint") / 2;
+	const unsigned int numPathFinders = std::max(1, std::min(int(ThreadPool::GetNumThreads()), int(maxMemFootPrint / minMemFootPrint)));
+
+	// the instances read the heat map and Lua extra costs of the shared
+	// path-finder, so recalculated vertices cost the same as they would
+	// if that one did the work
+	for (unsigned int i = 0; i < numPathFinders; i++) {
+		CPathFinder* pf = new CPathFinder();
+		pf->SetCostSource(pathFinder);
+		updatePathFinders.push_back(pf);
+	}
 }
 
 
@@ -199,21 +279,17 @@ void CPathEstimator::InitBlocks() {
 }
 
 
-void CPathEstimator::CalcOffsetsAndPathCosts(int thread) {
-	//! reset FPU state for synced computations
-	streflop_init<streflop::Simple>();
-
-	// NOTE: EstimatePathCosts() [B] is temporally dependent on CalculateBlockOffsets() [A],
-	// A must be completely finished before B_i can be safely called. This means we cannot
-	// let thread i execute (A_i, B_i), but instead have to split the work such that every
-	// thread finishes its part of A before any starts B_i.
+void CPathEstimator::CalcOffsets(int thread) {
 	const int nbr = blockStates.GetSize() - 1;
 	int i;
 
 	while ((i = --offsetBlockNum) >= 0)
 		CalculateBlockOffsets(nbr - i, thread);
+}
 
-	pathBarrier->wait();
+void CPathEstimator::CalcPathCosts(int thread) {
+	const int nbr = blockStates.GetSize() - 1;
+	int i;
 
 	while ((i = --costBlockNum) >= 0)
 		EstimatePathCosts(nbr - i, thread);
@@ -251,7 +327,7 @@ void CPathEstimator::EstimatePathCosts(int idx, int thread) {
 
 	for (vector<MoveDef*>::iterator mi = moveDefHandler->moveDefs.begin(); mi != moveDefHandler->moveDefs.end(); ++mi) {
 		if ((*mi)->unitDefRefCount > 0) {
-			CalculateVertices(**mi, x, z, thread);
+			CalculateVertices(**mi, x, z, pathFinders[thread]);
 		}
 	}
 }
@@ -319,16 +395,16 @@ void CPathEstimator::FindOffset(const MoveDef& moveDef, int blockX, int blockZ)
  * Calculate all vertices connected from the given block
  * (always 4 out of 8 vertices connected to the block)
  */
-void CPathEstimator::CalculateVertices(const MoveDef& moveDef, int blockX, int blockZ, int thread) {
+void CPathEstimator::CalculateVertices(const MoveDef& moveDef, int blockX, int blockZ, CPathFinder* pf) {
 	for (int dir = 0; dir < PATH_DIRECTION_VERTICES; dir++)
-		CalculateVertex(moveDef, blockX, blockZ, dir, thread);
+		CalculateVertex(moveDef, blockX, blockZ, dir, pf);
 }
 
 
 /**
  * Calculate requested vertex
  */
-void CPathEstimator::CalculateVertex(const MoveDef& moveDef, int parentBlockX, int parentBlockZ, unsigned int direction, int thread) {
+void CPathEstimator::CalculateVertex(const MoveDef& moveDef, int parentBlockX, int parentBlockZ, unsigned int direction, CPathFinder* pf) {
 	// initial calculations
 	const int parentBlocknr = parentBlockZ * nbrOfBlocksX + parentBlockX;
 	const int childBlockX = parentBlockX + directionVector[direction].x;
@@ -362,7 +438,7 @@ void CPathEstimator::CalculateVertex(const MoveDef& moveDef, int parentBlockX, i
 	// use this thread's "private" CPathFinder instance
 	// (rather than locking pathFinder->GetPath()) if we
 	// are in one
-	result = pathFinders[thread]->GetPath(moveDef, startPos, pfDef, path, false, true, MAX_SEARCHED_NODES_PF >> 2, false, 0, true);
+	result = pf->GetPath(moveDef, startPos, pfDef, path, false, true, MAX_SEARCHED_NODES_PF >> 2, false, 0, true);
 
 	// store the result
 	if (result == IPath::Ok)
@@ -405,19 +481,11 @@ void CPathEstimator::MapChanged(unsigned int x1, unsigned int z1, unsigned int x
 	// bi-directional vertices
 	for (int z = upperZ; z >= lowerZ; z--) {
 		for (int x = upperX; x >= lowerX; x--) {
-			if (!(blockStates.nodeMask[z * nbrOfBlocksX + x] & PATHOPT_OBSOLETE)) {
-				vector<MoveDef*>::iterator mi;
-
-				for (mi = moveDefHandler->moveDefs.begin(); mi < moveDefHandler->moveDefs.end(); ++mi) {
-					if ((*mi)->unitDefRefCount > 0) {
-						SingleBlock sb;
-							sb.block.x = x;
-							sb.block.y = z;
-							sb.moveDef = *mi;
-						needUpdate.push_back(sb);
-						blockStates.nodeMask[z * nbrOfBlocksX + x] |= PATHOPT_OBSOLETE;
-					}
-				}
+			const int blockN = z * nbrOfBlocksX + x;
+
+			if (!(blockStates.nodeMask[blockN] & PATHOPT_OBSOLETE)) {
+				needUpdate.push_back(blockN);
+				blockStates.nodeMask[blockN] |= PATHOPT_OBSOLETE;
 			}
 		}
 	}
@@ -430,37 +498,215 @@ void CPathEstimator::MapChanged(unsigned int x1, unsigned int z1, unsigned int x
 void CPathEstimator::Update() {
 	pathCache->Update();
 
-	for (unsigned int n = 0; !needUpdate.empty() && n < BLOCKS_TO_UPDATE; ) {
-		// copy the next block in line
-		const SingleBlock sb = needUpdate.front();
+	if (needUpdate.empty()) {
+		haveUpdated = true;
+		return;
+	}
+
+	if (updatePathFinders.empty())
+		InitUpdatePathFinders();
+
+	// BLOCKS_TO_UPDATE is counted in (block, MoveDef) pairs; blocks queued
+	// while loading (eg. by a savegame that deformed the map) are all done
+	// in the first update so the game does not start with a stale estimator
+	const unsigned int numMoveDefs = GetNumActiveMoveDefs();
 
-		const unsigned int blockX = sb.block.x;
-		const unsigned int blockZ = sb.block.y;
-		const unsigned int blockN = blockZ * nbrOfBlocksX + blockX;
+	updateBlocks.clear();
 
+	for (unsigned int n = 0; !needUpdate.empty() && (n < BLOCKS_TO_UPDATE || !haveUpdated); n += numMoveDefs) {
+		updateBlocks.push_back(needUpdate.front());
 		needUpdate.pop_front();
+	}
+
+	haveUpdated = true;
+
+	const int numBlocks = updateBlocks.size();
+	const int numThreads = updatePathFinders.size();
+
+	updateDeltas.clear();
+	updateDeltas.resize(numBlocks);
+
+	// all offsets must be known before the vertices between them are
+	// calculated, each block only writes its own offsets and vertices
+	ThreadPool::parallel_for(0, numBlocks, boost::bind(&CPathEstimator::UpdateBlockOffsets, this, _1), 1);
+
+	{
+		// one task per path-finder instance, task t does every t-th block
+		ThreadPool::TaskGroup tasks;
+
+		for (int t = 0; t < numThreads; t++) {
+			tasks.AddTask(boost::bind(&CPathEstimator::UpdateBlocksVertices, this, t, numThreads));
+		}
+
+		tasks.Wait();
+	}
+
+	for (int i = 0; i < numBlocks; i++) {
+		const int blockN = updateBlocks[i];
+
+		blockDeltas[blockN] = updateDeltas[i];
+		blockStates.nodeMask[blockN] &= ~PATHOPT_OBSOLETE;
+	}
+
+	deltasChanged = true;
+}
+
+
+/**
+ * Recalculates the offsets of the idx'th block in updateBlocks, or
+ * reuses the cached ones if its surroundings did not change since
+ */
+void CPathEstimator::UpdateBlockOffsets(int idx) {
+	const int blockN = updateBlocks[idx];
+	const int blockX = blockN % nbrOfBlocksX;
+	const int blockZ = blockN / nbrOfBlocksX;
+
+	BlockDelta& delta = updateDeltas[idx];
+	const boost::uint64_t signature = GetBlockSignature(blockX, blockZ);
+	const std::map<int, BlockDelta>::const_iterator it = blockDeltas.find(blockN);
+
+	if (it != blockDeltas.end() && it->second.signature == signature) {
+		delta = it->second;
+
+		for (vector<MoveDef*>::iterator mi = moveDefHandler->moveDefs.begin(); mi != moveDefHandler->moveDefs.end(); ++mi) {
+			if ((*mi)->unitDefRefCount > 0) {
+				blockStates.peNodeOffsets[blockN][(*mi)->pathType] = delta.offsets[(*mi)->pathType];
+			}
+		}
+	} else {
+		for (vector<MoveDef*>::iterator mi = moveDefHandler->moveDefs.begin(); mi != moveDefHandler->moveDefs.end(); ++mi) {
+			if ((*mi)->unitDefRefCount > 0) {
+				FindOffset(**mi, blockX, blockZ);
+			}
+		}
+
+		delta.signature = signature;
+		delta.offsets = blockStates.peNodeOffsets[blockN];
+	}
+}
+
+void CPathEstimator::UpdateBlocksVertices(int firstIdx, int stride) {
+	for (int i = firstIdx; i < int(updateBlocks.size()); i += stride) {
+		UpdateBlockVertices(i, updatePathFinders[firstIdx]);
+	}
+}
+
+/**
+ * Recalculates the vertices of the idx'th block in updateBlocks; a
+ * cached vertex is reused if neither the surroundings of the block
+ * nor the offsets at both of its ends changed
+ */
+void CPathEstimator::UpdateBlockVertices(int idx, CPathFinder* pf) {
+	const int blockN = updateBlocks[idx];
+	const int blockX = blockN % nbrOfBlocksX;
+	const int blockZ = blockN / nbrOfBlocksX;
+
+	BlockDelta& delta = updateDeltas[idx];
+	const bool haveCachedVertices = !delta.vertices.empty();
+
+	delta.childOffsets.resize(moveDefHandler->moveDefs.size() * PATH_DIRECTION_VERTICES, int2(-1, -1));
+	delta.vertices.resize(moveDefHandler->moveDefs.size() * PATH_DIRECTION_VERTICES, PATHCOST_INFINITY);
+
+	for (vector<MoveDef*>::iterator mi = moveDefHandler->moveDefs.begin(); mi != moveDefHandler->moveDefs.end(); ++mi) {
+		if ((*mi)->unitDefRefCount <= 0)
+			continue;
+
+		const int pathType = (*mi)->pathType;
+
+		for (int dir = 0; dir < PATH_DIRECTION_VERTICES; dir++) {
+			const int childBlockX = blockX + directionVector[dir].x;
+			const int childBlockZ = blockZ + directionVector[dir].y;
+			const int vertexNbr = pathType * blockStates.GetSize() * PATH_DIRECTION_VERTICES + blockN * PATH_DIRECTION_VERTICES + dir;
+			const int deltaIdx = pathType * PATH_DIRECTION_VERTICES + dir;
+
+			int2 childOffset(-1, -1);
+
+			if (childBlockX >= 0 && childBlockZ >= 0 && childBlockX < nbrOfBlocksX && childBlockZ < nbrOfBlocksZ) {
+				childOffset = blockStates.peNodeOffsets[childBlockZ * nbrOfBlocksX + childBlockX][pathType];
+			}
+
+			const int2& cachedOffset = delta.childOffsets[deltaIdx];
+
+			if (haveCachedVertices && cachedOffset.x == childOffset.x && cachedOffset.y == childOffset.y) {
+				vertices[vertexNbr] = delta.vertices[deltaIdx];
+			} else {
+				CalculateVertex(**mi, blockX, blockZ, dir, pf);
 
-		// check if it's not already updated
-		if (blockStates.nodeMask[blockN] & PATHOPT_OBSOLETE) {
-			const MoveDef* currBlockMD = sb.moveDef;
-			const MoveDef* nextBlockMD = (needUpdate.empty())? NULL: (needUpdate.front()).moveDef;
-
-			// no, update the block
-			FindOffset(*currBlockMD, blockX, blockZ);
-			CalculateVertices(*currBlockMD, blockX, blockZ);
-
-			// each MapChanged() call adds AT MOST <moveDefs.size()> SingleBlock's
-			// in ascending pathType order per (x, z) PE-block, therefore when the
-			// next SingleBlock's pathType is less or equal to the current we know
-			// that all have been processed (for one PE-block)
-			if (nextBlockMD == NULL || nextBlockMD->pathType <= currBlockMD->pathType) {
-				blockStates.nodeMask[blockN] &= ~PATHOPT_OBSOLETE;
+				delta.childOffsets[deltaIdx] = childOffset;
+				delta.vertices[deltaIdx] = vertices[vertexNbr];
 			}
+		}
+	}
+}
+
+
+/**
+ * Returns a signature of everything the offsets and vertices of a
+ * block are calculated from: the corner heights (which the slopes,
+ * normals and MIP heights are derived from), the terrain types, the
+ * immobile objects blocking the squares around it and the (synced)
+ * extra costs and heat-map values the path-finder adds to them
+ */
+boost::uint64_t CPathEstimator::GetBlockSignature(int blockX, int blockZ) const {
+	// the vertices connect a block to its neighbours at (+1, 0), (+1, +1),
+	// (0, +1) and (-1, +1), and the path-finder is constrained to a circle
+	// through both offsets; two more blocks on every side cover all of it
+	const int bsize = BLOCK_SIZE;
+	const int xmin = std::max(           0, (blockX - 3) * bsize     - signatureMargin);
+	const int zmin = std::max(           0, (blockZ - 2) * bsize     - signatureMargin);
+	const int xmax = std::min(gs->mapx - 1, (blockX + 4) * bsize - 1 + signatureMargin);
+	const int zmax = std::min(gs->mapy - 1, (blockZ + 4) * bsize - 1 + signatureMargin);
+
+	const float* heightMap = readmap->GetCornerHeightMapSynced();
+	const unsigned char* typeMap = readmap->GetTypeMapSynced();
+	const PathNodeStateBuffer& costs = pathFinder->GetNodeStateBuffer();
+	const bool heatMapping = pathFinder->GetHeatMapState();
+
+	SignatureHasher hasher;
+
+	for (int z = zmin; z <= zmax + 1; z++) {
+		hasher.Update(&heightMap[z * gs->mapxp1 + xmin], (xmax + 2 - xmin) * sizeof(float));
+	}
+	for (int z = (zmin >> 1); z <= (zmax >> 1); z++) {
+		hasher.Update(&typeMap[z * gs->hmapx + (xmin >> 1)], (xmax >> 1) + 1 - (xmin >> 1));
+	}
 
-			// one stale SingleBlock consumed
-			n++;
+	for (int z = zmin; z <= zmax; z++) {
+		for (int x = xmin; x <= xmax; x++) {
+			// vertices are searched for with ownerId 0 in synced context
+			hasher << costs.GetNodeExtraCost(x, z, true);
+
+			if (heatMapping) {
+				hasher << ((pathFinder->GetHeatOwner(x, z) != 0)? pathFinder->GetHeatValue(x, z): 0);
+			}
 		}
 	}
+
+	for (int z = zmin; z <= zmax; z++) {
+		for (int x = xmin; x <= xmax; x++) {
+			const BlockingMapCell& cell = groundBlockingObjectMap->GetCell(z * gs->mapx + x);
+
+			for (BlockingMapCellIt it = cell.begin(); it != cell.end(); ++it) {
+				const CSolidObject* obj = it->second;
+
+				// mobile objects are ignored by the estimator
+				if (!obj->immobile)
+					continue;
+
+				const unsigned int flags =
+					(obj->blocking     << 0) |
+					(obj->crushable    << 1) |
+					(obj->isUnderWater << 2) |
+					((obj->moveDef != NULL && obj->moveDef->subMarine) << 3);
+
+				hasher << x << z << it->first << flags;
+				hasher << obj->pos.x << obj->pos.y << obj->pos.z;
+				hasher << obj->height << obj->crushResistance;
+			}
+		}
+	}
+
+	return hasher.GetDigest();
 }
 
 
@@ -907,6 +1153,119 @@ void CPathEstimator::WriteFile(const std::string& cacheFileName, const std::stri
 }
 
 
+/**
+ * Try to read the cached block recalculations, return false on failure
+ */
+bool CPathEstimator::ReadDeltaFile()
+{
+	if (!FileSystem::FileExists(deltaFileName))
+		return false;
+
+	IArchive* pfile = archiveLoader.OpenArchive(dataDirsAccess.LocateFile(deltaFileName), "sdz");
+
+	if (!pfile || !pfile->IsOpen()) {
+		delete pfile;
+		return false;
+	}
+
+	std::auto_ptr<IArchive> auto_pfile(pfile);
+	IArchive& file(*pfile);
+
+	const unsigned fid = file.FindFile("pathdelta");
+
+	if (fid >= file.NumFiles())
+		return false;
+
+	std::vector<boost::uint8_t> buffer;
+	file.GetFile(fid, buffer);
+
+	if (buffer.size() < 3 * sizeof(unsigned))
+		return false;
+
+	const unsigned int fileVersion = *((unsigned*) &buffer[0]);
+	const unsigned int fileHash = *((unsigned*) &buffer[sizeof(unsigned)]);
+	const unsigned int numDeltas = *((unsigned*) &buffer[2 * sizeof(unsigned)]);
+
+	// older files hold signatures computed from different inputs
+	if (fileVersion != PATHDELTA_VERSION)
+		return false;
+	if (fileHash != DeltaHash())
+		return false;
+
+	const unsigned int numMoveDefs = moveDefHandler->moveDefs.size();
+	const unsigned int deltaSize =
+		sizeof(int) + sizeof(boost::uint64_t) +
+		numMoveDefs * sizeof(int2) +
+		numMoveDefs * PATH_DIRECTION_VERTICES * (sizeof(int2) + sizeof(float));
+
+	if (buffer.size() != (3 * sizeof(unsigned) + numDeltas * deltaSize))
+		return false;
+
+	unsigned int pos = 3 * sizeof(unsigned);
+
+	for (unsigned int n = 0; n < numDeltas; n++) {
+		int blockNr;
+		BlockDelta delta;
+
+		delta.offsets.resize(numMoveDefs);
+		delta.childOffsets.resize(numMoveDefs * PATH_DIRECTION_VERTICES);
+		delta.vertices.resize(numMoveDefs * PATH_DIRECTION_VERTICES);
+
+		std::memcpy(&blockNr, &buffer[pos], sizeof(int)); pos += sizeof(int);
+		std::memcpy(&delta.signature, &buffer[pos], sizeof(boost::uint64_t)); pos += sizeof(boost::uint64_t);
+		std::memcpy(&delta.offsets[0], &buffer[pos], delta.offsets.size() * sizeof(int2)); pos += delta.offsets.size() * sizeof(int2);
+		std::memcpy(&delta.childOffsets[0], &buffer[pos], delta.childOffsets.size() * sizeof(int2)); pos += delta.childOffsets.size() * sizeof(int2);
+		std::memcpy(&delta.vertices[0], &buffer[pos], delta.vertices.size() * sizeof(float)); pos += delta.vertices.size() * sizeof(float);
+
+		if (blockNr < 0 || blockNr >= int(blockStates.GetSize())) {
+			blockDeltas.clear();
+			return false;
+		}
+
+		blockDeltas[blockNr] = delta;
+	}
+
+	return true;
+}
+
+
+/**
+ * Try to write the cached block recalculations to file.
+ */
+void CPathEstimator::WriteDeltaFile()
+{
+	if (!FileSystem::CreateDirectory(PATH_CACHE_DIR))
+		return;
+
+	zipFile file = zipOpen(dataDirsAccess.LocateFile(deltaFileName, FileQueryFlags::WRITE).c_str(), APPEND_STATUS_CREATE);
+
+	if (!file)
+		return;
+
+	const unsigned int version = PATHDELTA_VERSION;
+	const unsigned int hash = DeltaHash();
+	const unsigned int numDeltas = blockDeltas.size();
+
+	zipOpenNewFileInZip(file, "pathdelta", NULL, NULL, 0, NULL, 0, NULL, Z_DEFLATED, Z_BEST_COMPRESSION);
+	zipWriteInFileInZip(file, (void*) &version, sizeof(unsigned));
+	zipWriteInFileInZip(file, (void*) &hash, sizeof(unsigned));
+	zipWriteInFileInZip(file, (void*) &numDeltas, sizeof(unsigned));
+
+	for (std::map<int, BlockDelta>::const_iterator it = blockDeltas.begin(); it != blockDeltas.end(); ++it) {
+		const BlockDelta& delta = it->second;
+
+		zipWriteInFileInZip(file, (void*) &it->first, sizeof(int));
+		zipWriteInFileInZip(file, (void*) &delta.signature, sizeof(boost::uint64_t));
+		zipWriteInFileInZip(file, (void*) &delta.offsets[0], delta.offsets.size() * sizeof(int2));
+		zipWriteInFileInZip(file, (void*) &delta.childOffsets[0], delta.childOffsets.size() * sizeof(int2));
+		zipWriteInFileInZip(file, (void*) &delta.vertices[0], delta.vertices.size() * sizeof(float));
+	}
+
+	zipCloseFileInZip(file);
+	zipClose(file, NULL);
+}
+
+
 /**
  * Returns a hash-code identifying the dataset of this estimator.
  */
@@ -914,3 +1273,27 @@ unsigned int CPathEstimator::Hash() const
 {
 	return (readmap->mapChecksum + moveDefHandler->GetCheckSum() + BLOCK_SIZE + PATHESTIMATOR_VERSION);
 }
+
+/**
+ * Returns a hash-code identifying the cached block recalculations;
+ * besides the estimator dataset these also depend on the (run-time
+ * modifiable) terrain-type speeds and on which MoveDefs are in use
+ */
+unsigned int CPathEstimator::DeltaHash() const
+{
+	CRC crc;
+	crc << Hash();
+	crc << CGroundMoveMath::waterDamageCost;
+
+	for (int i = 0; i < CMapInfo::NUM_TERRAIN_TYPES; i++) {
+		const CMapInfo::TerrainType& tt = mapInfo->terrainTypes[i];
+
+		crc << tt.tankSpeed << tt.kbotSpeed << tt.hoverSpeed << tt.shipSpeed;
+	}
+
+	for (vector<MoveDef*>::const_iterator mi = moveDefHandler->moveDefs.begin(); mi != moveDefHandler->moveDefs.end(); ++mi) {
+		crc << int((*mi)->unitDefRefCount > 0);
+	}
+
+	return crc.GetDigest();
+}
@@ -5,6 +5,8 @@
 
 #include <string>
 #include <list>
+#include <map>
+#include <deque>
 #include <queue>
 
 #include "IPath.h"
@@ -12,10 +14,7 @@
 #include "PathDataTypes.h"
 #include "System/float3.h"
 
-#include <boost/thread/thread.hpp>
 #include <boost/detail/atomic_count.hpp>
-#include <boost/thread/mutex.hpp>
-#include <boost/thread/barrier.hpp>
 #include <boost/cstdint.hpp>
 
 struct MoveDef;
@@ -97,6 +96,10 @@ public:
 
 	/**
 	 * called every frame
+	 * Recalculates a bounded batch of obsolete blocks, spread over the
+	 * update path-finder instances (at most one per pool thread). The batch
+	 * size does not depend on the local number of threads, so all the
+	 * clients see the same estimator state in each frame.
 	 */
 	void Update();
 
@@ -116,7 +119,9 @@ private:
 	void InitEstimator(const std::string& cacheFileName, const std::string& map);
 	void InitVertices();
 	void InitBlocks();
-	void CalcOffsetsAndPathCosts(int thread);
+	void InitUpdatePathFinders();
+	void CalcOffsets(int thread);
+	void CalcPathCosts(int thread);
 	void CalculateBlockOffsets(int, int);
 	void EstimatePathCosts(int, int);
 
@@ -126,15 +131,33 @@ private:
 
 
 
-	struct SingleBlock {
-		int2 block;
-		const MoveDef* moveDef;
+	/**
+	 * Recalculated data of one block, remembered together with the
+	 * input it was calculated from. If the block becomes obsolete
+	 * again and its input is still (or again) the same, e.g. after
+	 * reloading a game, the data can be reused instead of running
+	 * the path-finder.
+	 */
+	struct BlockDelta {
+		/// signature of the terrain and structures around the block
+		boost::uint64_t signature;
+		/// block offset per MoveDef
+		std::vector<int2> offsets;
+		/// offsets of the connected blocks the vertices were calculated with
+		std::vector<int2> childOffsets;
+		/// the vertices connected from the block (PATH_DIRECTION_VERTICES per MoveDef)
+		std::vector<float> vertices;
 	};
 
 
 	void FindOffset(const MoveDef&, int, int);
-	void CalculateVertices(const MoveDef&, int, int, int thread = 0);
-	void CalculateVertex(const MoveDef&, int, int, unsigned int, int thread = 0);
+	void CalculateVertices(const MoveDef&, int, int, CPathFinder* pf);
+	void CalculateVertex(const MoveDef&, int, int, unsigned int, CPathFinder* pf);
+
+	void UpdateBlockOffsets(int idx);
+	void UpdateBlockVertices(int idx, CPathFinder* pf);
+	void UpdateBlocksVertices(int firstIdx, int stride);
+	boost::uint64_t GetBlockSignature(int blockX, int blockZ) const;
 
 	IPath::SearchResult InitSearch(const MoveDef&, const CPathFinderDef&, bool);
 	IPath::SearchResult DoSearch(const MoveDef&, const CPathFinderDef&, bool);
@@ -144,7 +167,10 @@ private:
 
 	bool ReadFile(const std::string& cacheFileName, const std::string& map);
 	void WriteFile(const std::string& cacheFileName, const std::string& map);
+	bool ReadDeltaFile();
+	void WriteDeltaFile();
 	unsigned int Hash() const;
+	unsigned int DeltaHash() const;
 
 	/// Number of blocks on the X axis of the map.
 	int nbrOfBlocksX;
@@ -159,8 +185,20 @@ private:
 	std::vector<float> vertices;
 	/// List of blocks changed in last search.
 	std::list<int> dirtyBlocks;
-	/// Blocks that may need an update due to map changes.
-	std::list<SingleBlock> needUpdate;
+	/// Blocks that may need an update due to map changes (in FIFO order).
+	std::deque<int> needUpdate;
+	/// Blocks being recalculated in the current Update() call.
+	std::vector<int> updateBlocks;
+	/// Results for updateBlocks (indexed in parallel).
+	std::vector<BlockDelta> updateDeltas;
+	/// Cached block recalculations, indexed by block number.
+	std::map<int, BlockDelta> blockDeltas;
+	/// Name of the file blockDeltas is loaded from and saved to.
+	std::string deltaFileName;
+	bool deltasChanged;
+	bool haveUpdated;
+	/// Border (in squares) around the blocks included in their signatures.
+	int signatureMargin;
 
 	static const int PATH_DIRECTIONS = 8;
 	static const int PATH_DIRECTION_VERTICES = PATH_DIRECTIONS / 2;
@@ -179,7 +217,10 @@ private:
 	float maxNodeCost;
 
 	std::vector<CPathFinder*> pathFinders;
-	std::vector<boost::thread*> threads;
+	/// Private path-finder instances for Update(), one per pool thread.
+	/// These read the heat map and extra costs of <pathFinder>, so a vertex
+	/// does not depend on the thread it was calculated by.
+	std::vector<CPathFinder*> updatePathFinders;
 
 	CPathFinder* pathFinder;
 	CPathCache* pathCache;
@@ -187,8 +228,6 @@ private:
 	/// currently crc from the zip
 	boost::uint32_t pathChecksum;
 
-	boost::mutex loadMsgMutex;
-	boost::barrier* pathBarrier;
 	boost::detail::atomic_count offsetBlockNum;
 	boost::detail::atomic_count costBlockNum;
 
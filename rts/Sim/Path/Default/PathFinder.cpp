@@ -26,6 +26,7 @@ const CMoveMath::BlockType squareMobileBlockBits = (CMoveMath::BLOCK_MOBILE | CM
 CPathFinder::CPathFinder()
 	: heatMapOffset(0)
 	, heatMapping(true)
+	, costSource(this)
 	, start(ZeroVector)
 	, startxSqr(0)
 	, startzSqr(0)
@@ -340,14 +341,14 @@ bool CPathFinder::TestSquare(
 	}
 
 	// Include heatmap cost adjustment.
-	if (heatMapping && moveDef.heatMapping && GetHeatOwner(square.x, square.y) != ownerId) {
-		heatCostMod += (moveDef.heatMod * GetHeatValue(square.x, square.y));
+	if (costSource->heatMapping && moveDef.heatMapping && costSource->GetHeatOwner(square.x, square.y) != ownerId) {
+		heatCostMod += (moveDef.heatMod * costSource->GetHeatValue(square.x, square.y));
 	}
 
 
 
 	const float dirMoveCost = (heatCostMod * moveCost[enterDirection]);
-	const float extraCost = squareStates.GetNodeExtraCost(square.x, square.y, synced);
+	const float extraCost = costSource->squareStates.GetNodeExtraCost(square.x, square.y, synced);
 	const float nodeCost = (dirMoveCost / squareSpeedMod) + extraCost;
 
 	const float gCost = parentOpenSquare->gCost + nodeCost;  // g
@@ -607,7 +608,16 @@ void CPathFinder::UpdateHeatMap()
 	++heatMapOffset;
 }
 
-int CPathFinder::GetHeatMapIndex(int x, int y)
+void CPathFinder::SetCostSource(const CPathFinder* pf)
+{
+	costSource = pf;
+
+	if (costSource != this) {
+		std::vector<HeatMapValue>().swap(heatmap);
+	}
+}
+
+int CPathFinder::GetHeatMapIndex(int x, int y) const
 {
 	assert(!heatmap.empty());
 
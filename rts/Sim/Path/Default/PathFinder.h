@@ -83,19 +83,28 @@ public:
 		}
 	}
 
-	const int GetHeatOwner(const int& x, const int& y)
+	const int GetHeatOwner(const int& x, const int& y) const
 	{
 		const int i = GetHeatMapIndex(x, y);
 		return heatmap[i].ownerId;
 	}
 
-	const int GetHeatValue(const int& x, const int& y)
+	const int GetHeatValue(const int& x, const int& y) const
 	{
 		const int i = GetHeatMapIndex(x, y);
 		return std::max(0, heatmap[i].value - heatMapOffset);
 	}
 
 
+	/**
+	 * @brief Borrow the heat map and node extra costs of another instance.
+	 *
+	 * Searches by this instance then cost the same as searches by <pf> (which
+	 * must outlive it and not be modified during them), the own heat map is
+	 * released.
+	 */
+	void SetCostSource(const CPathFinder* pf);
+
 	// size of the memory-region we hold allocated (excluding sizeof(*this))
 	unsigned int GetMemFootPrint() const { return ((heatmap.size() * sizeof(HeatMapValue)) + squareStates.GetMemFootPrint()); }
 
@@ -103,7 +112,7 @@ public:
 
 private:
 	// Heat mapping
-	int GetHeatMapIndex(int x, int y);
+	int GetHeatMapIndex(int x, int y) const;
 
 	/**
 	 * Clear things up from last search.
@@ -156,6 +165,8 @@ private:
 	int heatMapOffset;                 ///< heatmap values are relative to this
 	bool heatMapping;
 
+	const CPathFinder* costSource;     ///< heat map and extra costs are read from this (usually itself)
+
 	int2 dirVectors2D[16];             ///< Unit square-movement in given direction.
 	float3 dirVectors3D[16];
 	float moveCost[16];                ///< The cost of moving in given direction.
@@ -2,6 +2,8 @@
 
 #include "System/mmgr.h"
 
+#include <algorithm>
+
 #include "PathManager.h"
 #include "PathConstants.h"
 #include "PathFinder.h"
@@ -10,6 +12,7 @@
 #include "Sim/Misc/GlobalSynced.h"
 #include "Sim/MoveTypes/MoveInfo.h"
 #include "Sim/MoveTypes/MoveMath/MoveMath.h"
+#include "Sim/Objects/SolidObject.h"
 #include "System/Log/ILog.h"
 #include "System/myMath.h"
 #include "System/TimeProfiler.h"
@@ -83,28 +86,254 @@ unsigned int CPathManager::RequestPath(
 	SCOPED_TIMER("PathManager::RequestPath");
 
 	MoveDef* moveDef = moveDefHandler->moveDefs[md->pathType];
-	moveDef->tempOwner = caller;
 
 	// Creates a new multipath.
-	IPath::SearchResult result = IPath::Error;
 	MultiPath* newPath = new MultiPath(startPos, pfDef, moveDef);
 	newPath->finalGoal = goalPos;
 	newPath->caller = caller;
 
-	if (caller) {
-		caller->UnBlock();
+	if (!ExecuteSearch(newPath, pfDef, NULL, synced)) {
+		delete newPath;
+		return 0;
 	}
 
-	const int ownerId = caller? caller->id: 0;
-	unsigned int pathID = 0;
+	return Store(newPath);
+}
+
+
+/*
+Queue requests to be searched by ExecuteQueuedSearches in a later Update.
+*/
+void CPathManager::RequestPaths(
+	const std::vector<PathRequest>& requests,
+	std::vector<unsigned int>& pathIDs
+) {
+	SCOPED_TIMER("PathManager::RequestPaths");
+
+	pathIDs.resize(requests.size());
+
+	for (unsigned int n = 0; n < requests.size(); n++) {
+		const PathRequest& r = requests[n];
+
+		if (!r.synced) {
+			// unsynced requests must not delay (or be delayed by)
+			// synced ones, so they are still answered immediately
+			pathIDs[n] = RequestPath(r.moveDef, r.startPos, r.goalPos, r.goalRadius, r.caller, false);
+			continue;
+		}
+
+		MultiPath* newPath = CreateQueuedPath(r);
+
+		pathIDs[n] = Store(newPath);
+		queuedPaths.push_back(pathIDs[n]);
+	}
+}
+
+
+/*
+Creates the (unsearched) multipath of a request for RequestPaths.
+*/
+CPathManager::MultiPath* CPathManager::CreateQueuedPath(const PathRequest& r) const
+{
+	float3 sp(r.startPos); sp.ClampInBounds();
+	float3 gp(r.goalPos); gp.ClampInBounds();
+
+	CRangedGoalWithCircularConstraint* pfDef = new CRangedGoalWithCircularConstraint(sp, gp, r.goalRadius, 3.0f, 2000);
+	MultiPath* newPath = new MultiPath(sp, pfDef, moveDefHandler->moveDefs[r.moveDef->pathType]);
+	newPath->finalGoal = gp;
+	newPath->goalRadius = r.goalRadius;
+	newPath->caller = r.caller;
+	newPath->queued = true;
+
+	return newPath;
+}
+
+
+/*
+Searches the next MAX_QUEUED_SEARCHES_PER_UPDATE queued requests, each
+from the current position of its caller (if any).
+
+Requests for the same MoveDef whose start and goal positions lie in
+the same estimator blocks (at the resolution they would be searched
+at) share one estimator search, and each only refines its own start.
+*/
+void CPathManager::ExecuteQueuedSearches()
+{
+	if (queuedPaths.empty())
+		return;
+
+	SCOPED_TIMER("PathManager::ExecuteQueuedSearches");
+
+	queuedSearches.clear();
 
-	// choose the PF or the PE depending on the projected 2D goal-distance
+	while (!queuedPaths.empty() && queuedSearches.size() < MAX_QUEUED_SEARCHES_PER_UPDATE) {
+		const unsigned int pathID = queuedPaths.front();
+		const std::map<unsigned int, MultiPath*>::const_iterator pi = pathMap.find(pathID);
+
+		queuedPaths.pop_front();
+
+		// deleted before we got to it
+		if (pi == pathMap.end())
+			continue;
+
+		MultiPath* multiPath = pi->second;
+		QueuedSearch qs;
+
+		if (multiPath->caller != NULL) {
+			// the caller kept moving while the request waited, search
+			// from where it is now rather than from where it asked
+			MultiPath* movedPath = CreateQueuedPath(PathRequest(multiPath->moveDef, multiPath->caller->pos, multiPath->finalGoal, multiPath->goalRadius, multiPath->caller));
+
+			delete multiPath;
+			pathMap[pathID] = (multiPath = movedPath);
+		}
+
+		qs.pathID = pathID;
+		qs.multiPath = multiPath;
+		qs.pfDef = const_cast<CPathFinderDef*>(multiPath->peDef);
+		qs.resolution = GetSearchResolution(qs.pfDef, multiPath->start, multiPath->finalGoal);
+		qs.pathType = multiPath->moveDef->pathType;
+		qs.startBlock = -1;
+		qs.goalBlock = -1;
+		qs.sqGoalRadius = qs.pfDef->sqGoalRadius;
+
+		if (qs.resolution != 0) {
+			const CPathEstimator* pe = (qs.resolution == 1)? medResPE: lowResPE;
+			const int blockSize = pe->GetBlockSize() * SQUARE_SIZE;
+			const int numBlocksX = pe->GetNumBlocksX();
+
+			const int numBlocksZ = pe->GetNumBlocksZ();
+
+			const int sbx = std::min(int(multiPath->start.x) / blockSize, numBlocksX - 1);
+			const int sbz = std::min(int(multiPath->start.z) / blockSize, numBlocksZ - 1);
+			const int gbx = std::min(int(multiPath->finalGoal.x) / blockSize, numBlocksX - 1);
+			const int gbz = std::min(int(multiPath->finalGoal.z) / blockSize, numBlocksZ - 1);
+
+			qs.startBlock = sbz * numBlocksX + sbx;
+			qs.goalBlock = gbz * numBlocksX + gbx;
+		}
+
+		queuedSearches.push_back(qs);
+	}
+
+	// stable, so the order within a group (and thus which request
+	// leads it) only depends on the order of the requests
+	std::stable_sort(queuedSearches.begin(), queuedSearches.end());
+
+	SharedSearch sharedSearch;
+
+	for (unsigned int n = 0; n < queuedSearches.size(); n++) {
+		const QueuedSearch& qs = queuedSearches[n];
+
+		if (n == 0 || !qs.CanShare(queuedSearches[n - 1]))
+			sharedSearch = SharedSearch();
+
+		qs.multiPath->queued = false;
+
+		if (!ExecuteSearch(qs.multiPath, qs.pfDef, (qs.resolution != 0)? &sharedSearch: NULL, true)) {
+			// no path, NextWayPoint will make the caller give up
+			pathMap.erase(qs.pathID);
+			delete qs.multiPath;
+		}
+	}
+}
+
+
+/*
+Determines the resolution a path-request is searched at, depending on
+the projected 2D goal-distance: 0 for the PF, 1 or 2 for the med- and
+low-res PE.
+*/
+int CPathManager::GetSearchResolution(const CPathFinderDef* pfDef, const float3& startPos, const float3& goalPos) const
+{
 	// NOTE: this distance can be far smaller than the actual path length!
 	// FIXME: Why are we taking the height difference into consideration?
 	// It seems more logical to subtract goalRadius / SQUARE_SIZE here
 	const float goalDist2D = pfDef->Heuristic(startPos.x / SQUARE_SIZE, startPos.z / SQUARE_SIZE) + fabs(goalPos.y - startPos.y) / SQUARE_SIZE;
 
-	if (goalDist2D < DETAILED_DISTANCE) {
+	if (goalDist2D < DETAILED_DISTANCE)
+		return 0;
+	if (goalDist2D < ESTIMATE_DISTANCE)
+		return 1;
+
+	return 2;
+}
+
+
+/*
+Searches a path for the multipath and refines its start. If sharedSearch
+holds the estimator result of an earlier request it is used instead of a
+new search, otherwise it receives the result of this one (if shareable).
+Returns false if no path was found.
+*/
+bool CPathManager::ExecuteSearch(MultiPath* newPath, CPathFinderDef* pfDef, SharedSearch* sharedSearch, bool synced)
+{
+	MoveDef* moveDef = moveDefHandler->moveDefs[newPath->moveDef->pathType];
+	CSolidObject* caller = newPath->caller;
+
+	moveDef->tempOwner = caller;
+
+	if (caller) {
+		caller->UnBlock();
+	}
+
+	const int ownerId = caller? caller->id: 0;
+
+	IPath::SearchResult result = IPath::Error;
+
+	if (sharedSearch != NULL && sharedSearch->valid) {
+		newPath->lowResPath = sharedSearch->lowResPath;
+		newPath->medResPath = sharedSearch->medResPath;
+		result = sharedSearch->searchResult;
+
+		// as ArrangePath would have done after its first search
+		#if (PM_UNCONSTRAINED_MEDRES_FALLBACK_SEARCH == 1 && PM_UNCONSTRAINED_LOWRES_FALLBACK_SEARCH == 1)
+		pfDef->DisableConstraint(true);
+		#endif
+	} else {
+		result = ArrangePath(newPath, pfDef, ownerId, synced);
+
+		// only pure estimator paths can be continued from another start
+		if (sharedSearch != NULL && newPath->maxResPath.path.empty()) {
+			sharedSearch->valid = (result == IPath::Ok || result == IPath::GoalOutOfRange);
+			sharedSearch->lowResPath = newPath->lowResPath;
+			sharedSearch->medResPath = newPath->medResPath;
+			sharedSearch->searchResult = result;
+		}
+	}
+
+	const bool haveResult = (result == IPath::Ok || result == IPath::GoalOutOfRange);
+
+	if (haveResult) {
+		LowRes2MedRes(*newPath, newPath->start, ownerId, synced);
+		MedRes2MaxRes(*newPath, newPath->start, ownerId, synced);
+
+		newPath->searchResult = result;
+	}
+
+	if (caller) {
+		caller->Block();
+	}
+
+	moveDef->tempOwner = NULL;
+	return haveResult;
+}
+
+
+/*
+Chooses the PF or the PE depending on the goal-distance, and runs the
+initial search(es) for the multipath.
+*/
+IPath::SearchResult CPathManager::ArrangePath(MultiPath* newPath, CPathFinderDef* pfDef, int ownerId, bool synced)
+{
+	const MoveDef* moveDef = newPath->moveDef;
+	const float3& startPos = newPath->start;
+	const float3& goalPos = newPath->finalGoal;
+
+	IPath::SearchResult result = IPath::Error;
+
+	switch (GetSearchResolution(pfDef, startPos, goalPos)) {
+	case 0: {
 		result = maxResPF->GetPath(*moveDef, startPos, *pfDef, newPath->maxResPath, true, false, MAX_SEARCHED_NODES_PF >> 3, true, ownerId, synced);
 
 		#if (PM_UNCONSTRAINED_MAXRES_FALLBACK_SEARCH == 1)
@@ -122,7 +351,8 @@ unsigned int CPathManager::RequestPath(
 		if (result != IPath::Ok) {
 			result = lowResPE->GetPath(*moveDef, startPos, *pfDef, newPath->lowResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
 		}
-	} else if (goalDist2D < ESTIMATE_DISTANCE) {
+	} break;
+	case 1: {
 		result = medResPE->GetPath(*moveDef, startPos, *pfDef, newPath->medResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
 
 		// CantGetCloser may be a false positive due to PE approximations and large goalRadius
@@ -137,7 +367,8 @@ unsigned int CPathManager::RequestPath(
 		if (result != IPath::Ok) {
 			result = medResPE->GetPath(*moveDef, startPos, *pfDef, newPath->medResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
 		}
-	} else {
+	} break;
+	default: {
 		result = lowResPE->GetPath(*moveDef, startPos, *pfDef, newPath->lowResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
 
 		// CantGetCloser may be a false positive due to PE approximations and large goalRadius
@@ -155,24 +386,10 @@ unsigned int CPathManager::RequestPath(
 		if (result != IPath::Ok) {
 			result = lowResPE->GetPath(*moveDef, startPos, *pfDef, newPath->lowResPath, MAX_SEARCHED_NODES_PE >> 3, synced);
 		}
+	} break;
 	}
 
-	if (result == IPath::Ok || result == IPath::GoalOutOfRange) {
-		LowRes2MedRes(*newPath, startPos, ownerId, synced);
-		MedRes2MaxRes(*newPath, startPos, ownerId, synced);
-
-		newPath->searchResult = result;
-		pathID = Store(newPath);
-	} else {
-		delete newPath;
-	}
-
-	if (caller) {
-		caller->Block();
-	}
-
-	moveDef->tempOwner = NULL;
-	return pathID;
+	return result;
 }
 
 
@@ -309,6 +526,14 @@ float3 CPathManager::NextWayPoint(
 
 	MultiPath* multiPath = pi->second;
 
+	if (multiPath->queued) {
+		// not searched yet (see RequestPaths), just set the caller off
+		// toward its goal; the y-coordinate marks this as a temporary
+		// waypoint (the same convention as QTPFS)
+		const float3 goalDir = (multiPath->finalGoal - callerPos).SafeNormalize() * SQUARE_SIZE;
+		return float3(callerPos.x + goalDir.x, -1.0f, callerPos.z + goalDir.z);
+	}
+
 	if (callerPos == ZeroVector) {
 		if (!multiPath->maxResPath.path.empty())
 			callerPos = multiPath->maxResPath.path.back();
@@ -365,7 +590,7 @@ float3 CPathManager::NextWayPoint(
 	} while (callerPos.SqDistance2D(waypoint) < Square(minDistance) && waypoint != multiPath->maxResPath.pathGoal);
 
 	// indicate this is not a temporary waypoint
-	// (the default PFS does not queue requests)
+	// (queued requests were handled above)
 	waypoint.y = 0.0f;
 
 	return waypoint;
@@ -390,6 +615,95 @@ void CPathManager::DeletePath(unsigned int pathID) {
 
 
 
+bool CPathManager::IsPathQueued(unsigned int pathID) const
+{
+	const std::map<unsigned int, MultiPath*>::const_iterator pi = pathMap.find(pathID);
+	return (pi != pathMap.end() && pi->second->queued);
+}
+
+
+/*
+Saves or restores the requests in queuedPaths (in order and with their
+ID's), only the requests are stored since none of them was searched yet.
+*/
+void CPathManager::SerializeQueuedPaths(creg::ISerializer& s)
+{
+	unsigned int savedNextPathID = nextPathID;
+	int numQueuedPaths = 0;
+
+	if (s.IsWriting()) {
+		for (std::deque<unsigned int>::const_iterator it = queuedPaths.begin(); it != queuedPaths.end(); ++it) {
+			numQueuedPaths += pathMap.count(*it);
+		}
+	}
+
+	s.Serialize(&savedNextPathID, sizeof(unsigned int));
+	s.Serialize(&numQueuedPaths, sizeof(int));
+
+	if (s.IsWriting()) {
+		for (std::deque<unsigned int>::const_iterator it = queuedPaths.begin(); it != queuedPaths.end(); ++it) {
+			const std::map<unsigned int, MultiPath*>::const_iterator pi = pathMap.find(*it);
+
+			if (pi == pathMap.end())
+				continue;
+
+			MultiPath* multiPath = pi->second;
+
+			unsigned int pathID = pi->first;
+			int pathType = multiPath->moveDef->pathType;
+			float3 startPos = multiPath->start;
+
+			s.Serialize(&pathID, sizeof(unsigned int));
+			s.Serialize(&pathType, sizeof(int));
+			s.Serialize(&startPos, sizeof(float3));
+			s.Serialize(&multiPath->finalGoal, sizeof(float3));
+			s.Serialize(&multiPath->goalRadius, sizeof(float));
+			s.SerializeObjectPtr((void**) &multiPath->caller, (multiPath->caller != NULL)? multiPath->caller->GetClass(): NULL);
+		}
+	} else {
+		// ID's handed out after loading must not collide with the restored ones
+		nextPathID = std::max(nextPathID, savedNextPathID);
+
+		for (int n = 0; n < numQueuedPaths; n++) {
+			unsigned int pathID = 0;
+			int pathType = 0;
+			float3 startPos;
+			float3 goalPos;
+			float goalRadius = 0.0f;
+
+			s.Serialize(&pathID, sizeof(unsigned int));
+			s.Serialize(&pathType, sizeof(int));
+			s.Serialize(&startPos, sizeof(float3));
+			s.Serialize(&goalPos, sizeof(float3));
+			s.Serialize(&goalRadius, sizeof(float));
+
+			MultiPath* multiPath = CreateQueuedPath(PathRequest(moveDefHandler->moveDefs[pathType], startPos, goalPos, goalRadius));
+
+			// the caller is resolved once all objects are loaded,
+			// so its pointer has to be read into its final place
+			s.SerializeObjectPtr((void**) &multiPath->caller, NULL);
+
+			if (pathMap.find(pathID) != pathMap.end()) {
+				// only possible when reloading into a running game
+				// (delete it only after its caller-pointer was fixed up)
+				LOG_L(L_WARNING, "[%s] queued path %u is already in use, dropping it", __FUNCTION__, pathID);
+				s.AddPostLoadCallback(&DeleteDroppedPath, multiPath);
+				continue;
+			}
+
+			pathMap[pathID] = multiPath;
+			queuedPaths.push_back(pathID);
+		}
+	}
+}
+
+
+void CPathManager::DeleteDroppedPath(void* multiPath)
+{
+	delete static_cast<MultiPath*>(multiPath);
+}
+
+
 // Tells estimators about changes in or on the map.
 void CPathManager::TerrainChange(unsigned int x1, unsigned int z1, unsigned int x2, unsigned int z2) {
 	medResPE->MapChanged(x1, z1, x2, z2);
@@ -404,6 +718,8 @@ void CPathManager::Update()
 	maxResPF->UpdateHeatMap();
 	medResPE->Update();
 	lowResPE->Update();
+
+	ExecuteQueuedSearches();
 }
 
 // used to deposit heat on the heat-map as a unit moves along its path
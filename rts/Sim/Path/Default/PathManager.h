@@ -4,6 +4,8 @@
 #define PATHMANAGER_H
 
 #include <map>
+#include <deque>
+#include <vector>
 #include <boost/cstdint.hpp> /* Replace with <stdint.h> if appropriate */
 
 #include "Sim/Path/IPathManager.h"
@@ -29,6 +31,7 @@ public:
 	void UpdatePath(const CSolidObject*, unsigned int);
 
 	void DeletePath(unsigned int pathID);
+	bool IsPathQueued(unsigned int pathID) const;
 
 
 	float3 NextWayPoint(
@@ -49,6 +52,11 @@ public:
 		bool synced = true
 	);
 
+	void RequestPaths(
+		const std::vector<PathRequest>& requests,
+		std::vector<unsigned int>& pathIDs
+	);
+
 	/**
 	 * Returns waypoints of the max-resolution path segments.
 	 * @param pathID
@@ -85,6 +93,12 @@ public:
 	void SetHeatOnSquare(int x, int y, int value, int ownerId);
 	const int GetHeatOnSquare(int x, int y);
 
+	/// how many queued requests (see RequestPaths) are answered per Update
+	static const unsigned int MAX_QUEUED_SEARCHES_PER_UPDATE = 64;
+
+protected:
+	void SerializeQueuedPaths(creg::ISerializer& s);
+
 private:
 	unsigned int RequestPath(
 		const MoveDef* moveDef,
@@ -102,7 +116,9 @@ private:
 			, peDef(def)
 			, moveDef(moveDef)
 			, finalGoal(ZeroVector)
+			, goalRadius(0.0f)
 			, caller(NULL)
+			, queued(false)
 		{}
 
 		~MultiPath() { delete peDef; }
@@ -120,9 +136,55 @@ private:
 
 		// Additional information.
 		float3 finalGoal;
+		float goalRadius;
 		CSolidObject* caller;
+
+		/// true while waiting in queuedPaths to be searched
+		bool queued;
 	};
 
+	/// Estimator search result that can be shared by a group of requests
+	struct SharedSearch {
+		SharedSearch(): valid(false), searchResult(IPath::Error) {}
+
+		bool valid;
+		IPath::Path lowResPath;
+		IPath::Path medResPath;
+		IPath::SearchResult searchResult;
+	};
+
+	/// A queued request, ordered such that requests which can share their search are adjacent
+	struct QueuedSearch {
+		bool operator < (const QueuedSearch& s) const {
+			if (pathType != s.pathType) return (pathType < s.pathType);
+			if (resolution != s.resolution) return (resolution < s.resolution);
+			if (startBlock != s.startBlock) return (startBlock < s.startBlock);
+			if (goalBlock != s.goalBlock) return (goalBlock < s.goalBlock);
+			return (sqGoalRadius < s.sqGoalRadius);
+		}
+		bool CanShare(const QueuedSearch& s) const {
+			return (resolution != 0 && !(*this < s) && !(s < *this));
+		}
+
+		unsigned int pathID;
+		MultiPath* multiPath;
+		CPathFinderDef* pfDef;
+
+		/// 0 for the PF, 1 for the med-res PE, 2 for the low-res PE
+		int resolution;
+		int pathType;
+		int startBlock;
+		int goalBlock;
+		float sqGoalRadius;
+	};
+
+	MultiPath* CreateQueuedPath(const PathRequest& request) const;
+	static void DeleteDroppedPath(void* multiPath);
+	int GetSearchResolution(const CPathFinderDef* pfDef, const float3& startPos, const float3& goalPos) const;
+	IPath::SearchResult ArrangePath(MultiPath* newPath, CPathFinderDef* pfDef, int ownerId, bool synced);
+	bool ExecuteSearch(MultiPath* newPath, CPathFinderDef* pfDef, SharedSearch* sharedSearch, bool synced);
+	void ExecuteQueuedSearches();
+
 	unsigned int Store(MultiPath* path);
 	void LowRes2MedRes(MultiPath& path, const float3& startPos, int ownerId, bool synced) const;
 	void MedRes2MaxRes(MultiPath& path, const float3& startPos, int ownerId, bool synced) const;
@@ -133,6 +195,10 @@ private:
 
 	std::map<unsigned int, MultiPath*> pathMap;
 	unsigned int nextPathID;
+
+	/// ID's of the paths requested via RequestPaths, in request order
+	std::deque<unsigned int> queuedPaths;
+	std::vector<QueuedSearch> queuedSearches;
 };
 
 #endif
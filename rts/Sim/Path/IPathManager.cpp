@@ -7,6 +7,11 @@
 
 IPathManager* pathManager = NULL;
 
+CR_BIND_INTERFACE(IPathManager)
+CR_REG_METADATA(IPathManager, (
+	CR_SERIALIZER(Serialize)
+));
+
 IPathManager* IPathManager::GetInstance(unsigned int type) {
 	static IPathManager* pm = NULL;
 
@@ -3,20 +3,72 @@
 #ifndef I_PATH_MANAGER_H
 #define I_PATH_MANAGER_H
 
+#include <cassert>
+#include <vector>
 #include <boost/cstdint.hpp> /* Replace with <stdint.h> if appropriate */
 
 #include "PFSTypes.h"
 #include "System/float3.h"
+#include "System/creg/creg_cond.h"
 
 struct MoveDef;
 class CSolidObject;
 
 class IPathManager {
+	CR_DECLARE(IPathManager);
+
 public:
+	/**
+	 * One (caller, goal) pair of a RequestPaths batch,
+	 * the members mean the same as the RequestPath args
+	 */
+	struct PathRequest {
+		PathRequest(
+			const MoveDef* moveDef,
+			const float3& startPos,
+			const float3& goalPos,
+			float goalRadius = 8.0f,
+			CSolidObject* caller = 0,
+			bool synced = true
+		)
+			: moveDef(moveDef)
+			, startPos(startPos)
+			, goalPos(goalPos)
+			, goalRadius(goalRadius)
+			, caller(caller)
+			, synced(synced)
+		{}
+
+		const MoveDef* moveDef;
+		float3 startPos;
+		float3 goalPos;
+		float goalRadius;
+		CSolidObject* caller;
+		bool synced;
+	};
+
+	/**
+	 * Owner of a request added to a path batch (see AddToPathBatch),
+	 * receives its path-id when the batch is closed
+	 */
+	class IPathBatchCaller {
+	public:
+		virtual ~IPathBatchCaller() {}
+		virtual void PathBatched(unsigned int pathID) = 0;
+	};
+
 	static IPathManager* GetInstance(unsigned int type);
 
+	IPathManager(): pathBatchDepth(0) {}
 	virtual ~IPathManager() {}
 
+	/**
+	 * Saves the requests that are still queued (see RequestPaths), paths
+	 * that were already searched are re-requested by their owners after
+	 * loading
+	 */
+	void Serialize(creg::ISerializer& s) { SerializeQueuedPaths(s); }
+
 	virtual unsigned int GetPathFinderType() const = 0;
 	virtual boost::uint32_t GetPathCheckSum() const { return 0; }
 
@@ -27,6 +79,12 @@ public:
 	 */
 	virtual bool PathUpdated(unsigned int pathID) { return false; }
 
+	/**
+	 * returns if a path requested via RequestPaths is still waiting to be
+	 * searched (and is saved as such, see Serialize)
+	 */
+	virtual bool IsPathQueued(unsigned int pathID) const { return false; }
+
 	virtual void Update() {}
 	virtual void UpdatePath(const CSolidObject* owner, unsigned int pathID) {}
 
@@ -133,6 +191,86 @@ public:
 		bool synced = true
 	) { return 0; }
 
+	/**
+	 * Queue a batch of path requests, eg. for all units given the same
+	 * move order. Every request gets a path-id right away, but its path
+	 * is searched during a later Update; until then NextWayPoint returns
+	 * temporary waypoints (with y = -1) toward the goal, and afterwards
+	 * (-1, 0, -1) if no path was found. Requests with nearby start and
+	 * goal positions may share (parts of) their searches.
+	 * The frame in which a request is answered depends only on the
+	 * order of (synced) requests, so it is the same for all clients.
+	 *
+	 * @param requests
+	 *     The requests, see RequestPath for the meaning of their members.
+	 * @param pathIDs
+	 *     Receives a path-id for each request, or 0 if it was rejected.
+	 */
+	virtual void RequestPaths(
+		const std::vector<PathRequest>& requests,
+		std::vector<unsigned int>& pathIDs
+	) {
+		pathIDs.resize(requests.size());
+
+		for (unsigned int n = 0; n < requests.size(); n++) {
+			const PathRequest& r = requests[n];
+			pathIDs[n] = RequestPath(r.moveDef, r.startPos, r.goalPos, r.goalRadius, r.caller, r.synced);
+		}
+	}
+
+	/**
+	 * Opens a path batch: requests added by AddToPathBatch are collected
+	 * until the matching EndPathBatch, which hands them to RequestPaths
+	 * in one call. Batches can be nested, only the outermost EndPathBatch
+	 * sends the requests.
+	 */
+	void BeginPathBatch() { pathBatchDepth++; }
+	void EndPathBatch() {
+		assert(pathBatchDepth > 0);
+
+		if ((--pathBatchDepth) > 0 || batchRequests.empty())
+			return;
+
+		// callers may request (and batch) again from PathBatched
+		std::vector<PathRequest> requests;
+		std::vector<IPathBatchCaller*> callers;
+		std::vector<unsigned int> pathIDs;
+
+		requests.swap(batchRequests);
+		callers.swap(batchCallers);
+
+		RequestPaths(requests, pathIDs);
+
+		for (unsigned int n = 0; n < callers.size(); n++) {
+			if (callers[n] != NULL) {
+				callers[n]->PathBatched(pathIDs[n]);
+			} else {
+				DeletePath(pathIDs[n]);
+			}
+		}
+	}
+	bool IsPathBatchOpen() const { return (pathBatchDepth > 0); }
+
+	/**
+	 * Adds a request to the open path batch, <caller> receives its path-id
+	 * (and owns the path from then on) when the batch is closed.
+	 */
+	void AddToPathBatch(const PathRequest& request, IPathBatchCaller* caller) {
+		assert(pathBatchDepth > 0);
+
+		batchRequests.push_back(request);
+		batchCallers.push_back(caller);
+	}
+
+	/// for callers that are deleted while their requests are still batched
+	void RemoveFromPathBatch(const IPathBatchCaller* caller) {
+		for (unsigned int n = 0; n < batchCallers.size(); n++) {
+			if (batchCallers[n] == caller) {
+				batchCallers[n] = NULL;
+			}
+		}
+	}
+
 	/**
 	 * Whenever there are any changes in the terrain
 	 * (examples: explosions, new buildings, etc.)
@@ -156,6 +294,15 @@ public:
 	virtual bool SetNodeExtraCost(unsigned int x, unsigned int z, float cost, bool synced) { return false; }
 	virtual float GetNodeExtraCost(unsigned int x, unsigned int z, bool synced) const { return 0.0f; }
 	virtual const float* GetNodeExtraCosts(bool synced) const { return NULL; }
+
+protected:
+	virtual void SerializeQueuedPaths(creg::ISerializer& s) {}
+
+private:
+	unsigned int pathBatchDepth;
+
+	std::vector<PathRequest> batchRequests;
+	std::vector<IPathBatchCaller*> batchCallers;
 };
 
 extern IPathManager* pathManager;
@@ -15,7 +15,6 @@
 #define QTPFS_CORNER_CONNECTED_NODES
 // #define QTPFS_COPY_NEIGHBOR_NODES
 // #define QTPFS_SLOW_ACCURATE_TESSELATION
-// #define QTPFS_OPENMP_ENABLED
 // #define QTPFS_ORTHOPROJECTED_EDGE_TRANSITIONS
 #define QTPFS_STAGGERED_LAYER_UPDATES
 // NOTE: incompatible with QTPFS_ORTHOPROJECTED_EDGE_TRANSITIONS
@@ -5,8 +5,6 @@
 #include <boost/thread/condition.hpp>
 #include <boost/cstdint.hpp>
 
-#include "System/OpenMP_cond.h"
-#include "lib/gml/gml.h" // for gmlCPUCount
 
 #include "PathDefines.hpp"
 #include "PathManager.hpp"
@@ -21,6 +19,7 @@
 #include "System/FileSystem/ArchiveScanner.h"
 #include "System/FileSystem/FileSystem.h"
 #include "System/Log/ILog.h"
+#include "System/Platform/ThreadPool.h"
 #include "System/TimeProfiler.h"
 #include "System/Util.h"
 
@@ -82,23 +81,6 @@ namespace QTPFS {
 	static PMLoadScreen pmLoadScreen;
 	static boost::thread pmLoadThread;
 
-	static size_t GetNumThreads() {
-		size_t numThreads = std::max(0, configHandler->GetInt("HardwareThreadCount"));
-
-		if (numThreads == 0) {
-			// auto-detect
-			#if (BOOST_VERSION >= 103500)
-			numThreads = boost::thread::hardware_concurrency();
-			#elif defined(USE_GML)
-			numThreads = gmlCPUCount();
-			#else
-			numThreads = 1;
-			#endif
-		}
-
-		return numThreads;
-	}
-
 	NodeLayer* PathManager::serializingNodeLayer = NULL;
 }
 
@@ -168,6 +150,7 @@ void QTPFS::PathManager::Load() {
 	searchStateOffset = NODE_STATE_OFFSET;
 	numTerrainChanges = 0;
 	numPathRequests   = 0;
+	numPathBatches    = 0;
 	maxNumLeafNodes   = 0;
 
 	nodeTrees.resize(moveDefHandler->moveDefs.size(), NULL);
@@ -236,119 +219,49 @@ boost::uint64_t QTPFS::PathManager::GetMemFootPrint() const {
 
 
 
-void QTPFS::PathManager::SpawnBoostThreads(MemberFunc f, const SRectangle& r) {
-	static std::vector<boost::thread*> threads(std::min(GetNumThreads(), nodeLayers.size()), NULL);
-
-	for (unsigned int threadNum = 0; threadNum < threads.size(); threadNum++) {
-		threads[threadNum] = new boost::thread(boost::bind(f, this, threadNum, threads.size(), r));
-	}
-
-	for (unsigned int threadNum = 0; threadNum < threads.size(); threadNum++) {
-		threads[threadNum]->join(); delete threads[threadNum];
-	}
-}
-
-
-
 void QTPFS::PathManager::InitNodeLayersThreaded(const SRectangle& rect) {
 	streflop_init<streflop::Simple>();
 
 	char loadMsg[512] = {'\0'};
 	const char* fmtString = "[PathManager::%s] using %u threads for %u node-layers (cached? %s)";
+	const unsigned int numThreads = std::min(ThreadPool::GetNumThreads(), static_cast<unsigned int>(nodeLayers.size()));
 
-	#ifdef QTPFS_OPENMP_ENABLED
-	{
-		#pragma omp parallel
-		if (omp_get_thread_num() == 0) {
-			// "trust" OpenMP implementation to set a pool-size that
-			// matches the CPU threading capacity (eg. the number of
-			// active physical cores * number of threads per core);
-			// too many and esp. too few threads would be wasteful
-			//
-			// TODO: OpenMP needs project-global linking changes
-			sprintf(loadMsg, fmtString, __FUNCTION__, omp_get_num_threads(), nodeLayers.size(), (haveCacheDir? "true": "false"));
-			pmLoadScreen.AddLoadMessage(loadMsg);
-		}
-
-		#ifndef NDEBUG
-		const char* preFmtStr = "  initializing node-layer %u (thread %u)";
-		const char* pstFmtStr = "  initialized node-layer %u (%u MB, %u leafs, ratio %f)";
-		#endif
-
-		#pragma omp parallel for private(loadMsg)
-		for (unsigned int layerNum = 0; layerNum < nodeLayers.size(); layerNum++) {
-			#ifndef NDEBUG
-			sprintf(loadMsg, preFmtStr, layerNum, omp_get_thread_num());
-			pmLoadScreen.AddLoadMessage(loadMsg);
-			#endif
-
-			// construct each tree from scratch IFF no cache-dir exists
-			// (if it does, we only need to initialize speed{Mods, Bins}
-			// since Serialize will fill in the branches)
-			// NOTE:
-			//     silently assumes trees either ALL exist or ALL do not
-			//     (if >= 1 are missing for some player in MP, we desync)
-			InitNodeLayer(layerNum, rect);
-			UpdateNodeLayer(layerNum, rect);
-
-			const QTNode* tree = nodeTrees[layerNum];
-			const NodeLayer& layer = nodeLayers[layerNum];
-			const unsigned int mem = (tree->GetMemFootPrint() + layer.GetMemFootPrint()) / (1024 * 1024);
-
-			#ifndef NDEBUG
-			sprintf(loadMsg, pstFmtStr, layerNum, mem, layer.GetNumLeafNodes(), layer.GetNodeRatio());
-			pmLoadScreen.AddLoadMessage(loadMsg);
-			#endif
-		}
-	}
-	#else
-	{
-		sprintf(loadMsg, fmtString, __FUNCTION__, GetNumThreads(), nodeLayers.size(), (haveCacheDir? "true": "false"));
-		pmLoadScreen.AddLoadMessage(loadMsg);
+	sprintf(loadMsg, fmtString, __FUNCTION__, numThreads, nodeLayers.size(), (haveCacheDir? "true": "false"));
+	pmLoadScreen.AddLoadMessage(loadMsg);
 
-		SpawnBoostThreads(&PathManager::InitNodeLayersThread, rect);
-	}
-	#endif
+	// one task per layer, they differ a lot in cost
+	ThreadPool::parallel_for(0, nodeLayers.size(), boost::bind(&PathManager::InitNodeLayerTask, this, _1, rect), 1);
 
 	streflop_init<streflop::Simple>();
 }
 
-void QTPFS::PathManager::InitNodeLayersThread(
-	unsigned int threadNum,
-	unsigned int numThreads,
-	const SRectangle& rect
-) {
-	const unsigned int layersPerThread = (nodeLayers.size() / numThreads);
-	const unsigned int numExcessLayers = (threadNum == (numThreads - 1))?
-		(nodeLayers.size() % numThreads): 0;
-
-	const unsigned int minLayer = threadNum * layersPerThread;
-	const unsigned int maxLayer = minLayer + layersPerThread + numExcessLayers;
-
+void QTPFS::PathManager::InitNodeLayerTask(unsigned int layerNum, const SRectangle& rect) {
 	#ifndef NDEBUG
 	char loadMsg[512] = {'\0'};
 	const char* preFmtStr = "  initializing node-layer %u (thread %u)";
 	const char* pstFmtStr = "  initialized node-layer %u (%u MB, %u leafs, ratio %f)";
-	#endif
 
-	for (unsigned int layerNum = minLayer; layerNum < maxLayer; layerNum++) {
-		#ifndef NDEBUG
-		sprintf(loadMsg, preFmtStr, layerNum, threadNum);
-		pmLoadScreen.AddLoadMessage(loadMsg);
-		#endif
+	sprintf(loadMsg, preFmtStr, layerNum, ThreadPool::GetThreadNum());
+	pmLoadScreen.AddLoadMessage(loadMsg);
+	#endif
 
-		InitNodeLayer(layerNum, rect);
-		UpdateNodeLayer(layerNum, rect);
+	// construct each tree from scratch IFF no cache-dir exists
+	// (if it does, we only need to initialize speed{Mods, Bins}
+	// since Serialize will fill in the branches)
+	// NOTE:
+	//     silently assumes trees either ALL exist or ALL do not
+	//     (if >= 1 are missing for some player in MP, we desync)
+	InitNodeLayer(layerNum, rect);
+	UpdateNodeLayer(layerNum, rect);
 
-		const QTNode* tree = nodeTrees[layerNum];
-		const NodeLayer& layer = nodeLayers[layerNum];
-		const unsigned int mem = (tree->GetMemFootPrint() + layer.GetMemFootPrint()) / (1024 * 1024);
+	#ifndef NDEBUG
+	const QTNode* tree = nodeTrees[layerNum];
+	const NodeLayer& layer = nodeLayers[layerNum];
+	const unsigned int mem = (tree->GetMemFootPrint() + layer.GetMemFootPrint()) / (1024 * 1024);
 
-		#ifndef NDEBUG
-		sprintf(loadMsg, pstFmtStr, layerNum, mem, layer.GetNumLeafNodes(), layer.GetNodeRatio());
-		pmLoadScreen.AddLoadMessage(loadMsg);
-		#endif
-	}
+	sprintf(loadMsg, pstFmtStr, layerNum, mem, layer.GetNumLeafNodes(), layer.GetNodeRatio());
+	pmLoadScreen.AddLoadMessage(loadMsg);
+	#endif
 }
 
 void QTPFS::PathManager::InitNodeLayer(unsigned int layerNum, const SRectangle& rect) {
@@ -362,39 +275,11 @@ void QTPFS::PathManager::InitNodeLayer(unsigned int layerNum, const SRectangle&
 void QTPFS::PathManager::UpdateNodeLayersThreaded(const SRectangle& rect) {
 	streflop_init<streflop::Simple>();
 
-	#ifdef QTPFS_OPENMP_ENABLED
-	{
-		#pragma omp parallel for
-		for (unsigned int layerNum = 0; layerNum < nodeLayers.size(); layerNum++) {
-			UpdateNodeLayer(layerNum, rect);
-		}
-	}
-	#else
-	{
-		SpawnBoostThreads(&PathManager::UpdateNodeLayersThread, rect);
-	}
-	#endif
+	ThreadPool::parallel_for(0, nodeLayers.size(), boost::bind(&PathManager::UpdateNodeLayer, this, _1, rect), 1);
 
 	streflop_init<streflop::Simple>();
 }
 
-void QTPFS::PathManager::UpdateNodeLayersThread(
-	unsigned int threadNum,
-	unsigned int numThreads,
-	const SRectangle& rect
-) {
-	const unsigned int layersPerThread = (nodeLayers.size() / numThreads);
-	const unsigned int numExcessLayers = (threadNum == (numThreads - 1))?
-		(nodeLayers.size() % numThreads): 0;
-
-	const unsigned int minLayer = threadNum * layersPerThread;
-	const unsigned int maxLayer = minLayer + layersPerThread + numExcessLayers;
-
-	for (unsigned int layerNum = minLayer; layerNum < maxLayer; layerNum++) {
-		UpdateNodeLayer(layerNum, rect);
-	}
-}
-
 void QTPFS::PathManager::UpdateNodeLayer(unsigned int layerNum, const SRectangle& r) {
 	const MoveDef* md = moveDefHandler->moveDefs[layerNum];
 	const CMoveMath* mm = md->moveMath;
@@ -613,6 +498,7 @@ void QTPFS::PathManager::ThreadUpdate() {
 		static unsigned int maxPathTypeUpdate = numPathTypeUpdates;
 
 		sharedPaths.clear();
+		batchPaths.clear();
 
 		for (unsigned int pathTypeUpdate = minPathTypeUpdate; pathTypeUpdate < maxPathTypeUpdate; pathTypeUpdate++) {
 			#ifndef QTPFS_IGNORE_DEAD_PATHS
@@ -706,6 +592,21 @@ void QTPFS::PathManager::ExecuteSearch(
 		}
 		#endif
 
+		// searches queued by the same RequestPaths call always share
+		// (the batch is known to belong together, unlike two arbitrary
+		// requests that happen to have the same source and target node)
+		if (search->GetBatch() != 0) {
+			const BatchPathMap::const_iterator batchPathsIt = batchPaths.find(std::make_pair(search->GetBatch(), path->GetHash()));
+
+			if (batchPathsIt != batchPaths.end()) {
+				search->SharedFinalize(batchPathsIt->second, path);
+				*searchesIt = NULL;
+				searchesIt = searches.erase(searchesIt);
+				delete search;
+				return;
+			}
+		}
+
 		#ifdef QTPFS_LIMIT_TEAM_SEARCHES
 		const unsigned int numCurrSearches = numCurrExecutedSearches[search->GetTeam()];
 		const unsigned int numPrevSearches = numPrevExecutedSearches[search->GetTeam()];
@@ -726,6 +627,10 @@ void QTPFS::PathManager::ExecuteSearch(
 		sharedPaths[path->GetHash()] = path;
 		#endif
 
+		if (search->GetBatch() != 0) {
+			batchPaths[std::make_pair(search->GetBatch(), path->GetHash())] = path;
+		}
+
 		#ifdef QTPFS_TRACE_PATH_SEARCHES
 		pathTraces[path->GetID()] = search->GetExecutionTrace();
 		#endif
@@ -751,7 +656,7 @@ void QTPFS::PathManager::QueueDeadPathSearches(unsigned int pathType) {
 		// re-request LIVE paths that were marked as DEAD by a TerrainChange
 		// for each of these now-dead paths, reset the active point-idx to 0
 		for (deadPathsIt = deadPaths.begin(); deadPathsIt != deadPaths.end(); ++deadPathsIt) {
-			QueueSearch(deadPathsIt->second, NULL, moveDef, ZeroVector, ZeroVector, -1.0f, false);
+			QueueSearch(deadPathsIt->second, NULL, moveDef, ZeroVector, ZeroVector, -1.0f, false, 0);
 		}
 
 		pathCache.KillDeadPaths();
@@ -765,7 +670,8 @@ unsigned int QTPFS::PathManager::QueueSearch(
 	const float3& sourcePoint,
 	const float3& targetPoint,
 	const float radius,
-	const bool synced
+	const bool synced,
+	const unsigned int batch
 ) {
 	// NOTE:
 	//     all paths get deleted by the cache they are in;
@@ -821,6 +727,7 @@ unsigned int QTPFS::PathManager::QueueSearch(
 		newPath->SetTargetPoint(targetPoint);
 		newSearch->SetID(newPath->GetID());
 		newSearch->SetTeam((object != NULL)? object->team: teamHandler->ActiveTeams());
+		newSearch->SetBatch(batch);
 	}
 
 	assert((pathCaches[moveDef->pathType].GetTempPath(newPath->GetID()))->GetID() == 0);
@@ -878,7 +785,27 @@ unsigned int QTPFS::PathManager::RequestPath(
 	bool synced)
 {
 	SCOPED_TIMER("PathManager::RequestPath");
-	return (QueueSearch(NULL, object, moveDef, sourcePoint, targetPoint, radius, synced));
+	return (QueueSearch(NULL, object, moveDef, sourcePoint, targetPoint, radius, synced, 0));
+}
+
+void QTPFS::PathManager::RequestPaths(
+	const std::vector<PathRequest>& requests,
+	std::vector<unsigned int>& pathIDs
+) {
+	SCOPED_TIMER("PathManager::RequestPaths");
+
+	// zero is reserved for unbatched searches
+	if ((++numPathBatches) == 0)
+		++numPathBatches;
+
+	pathIDs.resize(requests.size());
+
+	// all requests are queued anyway, so this only
+	// has to tag them as belonging to the same batch
+	for (unsigned int n = 0; n < requests.size(); n++) {
+		const PathRequest& r = requests[n];
+		pathIDs[n] = QueueSearch(NULL, r.caller, r.moveDef, r.startPos, r.goalPos, r.goalRadius, r.synced, numPathBatches);
+	}
 }
 
 
@@ -50,6 +50,11 @@ namespace QTPFS {
 			bool synced
 		);
 
+		void RequestPaths(
+			const std::vector<PathRequest>& requests,
+			std::vector<unsigned int>& pathIDs
+		);
+
 		float3 NextWayPoint(
 			unsigned int pathID,
 			float3 point,
@@ -80,34 +85,19 @@ namespace QTPFS {
 
 		boost::uint64_t GetMemFootPrint() const;
 
-		typedef void (PathManager::*MemberFunc)(
-			unsigned int threadNum,
-			unsigned int numThreads,
-			const SRectangle& rect
-		);
 		typedef std::map<unsigned int, unsigned int> PathTypeMap;
 		typedef std::map<unsigned int, unsigned int>::iterator PathTypeMapIt;
 		typedef std::map<unsigned int, PathSearchTrace::Execution*> PathTraceMap;
 		typedef std::map<unsigned int, PathSearchTrace::Execution*>::iterator PathTraceMapIt;
 		typedef std::map<boost::uint64_t, IPath*> SharedPathMap;
 		typedef std::map<boost::uint64_t, IPath*>::iterator SharedPathMapIt;
+		typedef std::map<std::pair<unsigned int, boost::uint64_t>, IPath*> BatchPathMap;
 		typedef std::list<IPathSearch*> PathSearchList;
 		typedef std::list<IPathSearch*>::iterator PathSearchListIt;
 
-		void SpawnBoostThreads(MemberFunc f, const SRectangle& r);
-
 		void InitNodeLayersThreaded(const SRectangle& rect);
 		void UpdateNodeLayersThreaded(const SRectangle& rect);
-		void InitNodeLayersThread(
-			unsigned int threadNum,
-			unsigned int numThreads,
-			const SRectangle& rect
-		);
-		void UpdateNodeLayersThread(
-			unsigned int threadNum,
-			unsigned int numThreads,
-			const SRectangle& rect
-		);
+		void InitNodeLayerTask(unsigned int layerNum, const SRectangle& rect);
 		void InitNodeLayer(unsigned int layerNum, const SRectangle& rect);
 		void UpdateNodeLayer(unsigned int layerNum, const SRectangle& r);
 
@@ -126,7 +116,8 @@ namespace QTPFS {
 			const float3& sourcePoint,
 			const float3& targetPoint,
 			const float radius,
-			const bool synced
+			const bool synced,
+			const unsigned int batch
 		);
 
 		void ExecuteSearch(
@@ -150,6 +141,8 @@ namespace QTPFS {
 
 		// maps "hashes" of executed searches to the found paths
 		std::map<boost::uint64_t, IPath*> sharedPaths;
+		// same, but only shared within a RequestPaths batch
+		std::map<std::pair<unsigned int, boost::uint64_t>, IPath*> batchPaths;
 
 		std::vector<unsigned int> numCurrExecutedSearches;
 		std::vector<unsigned int> numPrevExecutedSearches;
@@ -160,6 +153,7 @@ namespace QTPFS {
 		unsigned int searchStateOffset;
 		unsigned int numTerrainChanges;
 		unsigned int numPathRequests;
+		unsigned int numPathBatches;
 		unsigned int maxNumLeafNodes;
 
 		boost::uint32_t pfsCheckSum;
@@ -66,6 +66,7 @@ namespace QTPFS {
 		IPathSearch(unsigned int pathSearchType)
 			: searchID(0)
 			, searchTeam(0)
+			, searchBatch(0)
 			, searchType(pathSearchType)
 			, searchState(0)
 			, searchMagic(0)
@@ -91,12 +92,15 @@ namespace QTPFS {
 
 		void SetID(unsigned int n) { searchID = n; }
 		void SetTeam(unsigned int n) { searchTeam = n; }
+		void SetBatch(unsigned int n) { searchBatch = n; }
 		unsigned int GetID() const { return searchID; }
 		unsigned int GetTeam() const { return searchTeam; }
+		unsigned int GetBatch() const { return searchBatch; }
 
 	protected:
 		unsigned int searchID;     // links us to the temp-path that this search will finalize
 		unsigned int searchTeam;   // which team queued this search
+		unsigned int searchBatch;  // which RequestPaths call queued this search (0 if none)
 
 		unsigned int searchType;   // indicates if Dijkstra (h==0) or A* (h!=0) search is employed
 		unsigned int searchState;  // offset that identifies nodes as part of current search
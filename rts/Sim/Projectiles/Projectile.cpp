@@ -29,12 +29,14 @@ CR_REG_METADATA(CProjectile,
 	CR_MEMBER(collisionFlags),
 
 	CR_MEMBER(quadFieldCellCoors),
+	CR_MEMBER(quadFieldCellIdx),
 
 	CR_MEMBER(mygravity),
 	CR_MEMBER_BEGINFLAG(CM_Config),
 		CR_MEMBER(speed),
 	CR_MEMBER_ENDFLAG(CM_Config),
-	CR_RESERVED(8)
+	CR_RESERVED(8),
+	CR_ALLOCATOR(operator new, operator delete)
 ));
 
 //////////////////////////////////////////////////////////////////////
@@ -53,11 +55,13 @@ CProjectile::CProjectile():
 	ignoreWater(false),
 	deleteMe(false),
 	castShadow(false),
+	updateBatch(UPDATE_BATCH_NONE),
 	speed(ZeroVector),
 	mygravity(mapInfo? mapInfo->map.gravity: 0.0f),
 	ownerId(-1),
 	projectileType(-1U),
-	collisionFlags(0)
+	collisionFlags(0),
+	quadFieldCellIdx(-1)
 {
 	GML_GET_TICKS(lastProjUpdate);
 }
@@ -72,11 +76,13 @@ CProjectile::CProjectile(const float3& pos, const float3& spd, CUnit* owner, boo
 	ignoreWater(false),
 	deleteMe(false),
 	castShadow(false),
+	updateBatch(UPDATE_BATCH_NONE),
 	speed(spd),
 	mygravity(mapInfo? mapInfo->map.gravity: 0.0f),
 	ownerId(-1),
 	projectileType(-1U),
-	collisionFlags(0)
+	collisionFlags(0),
+	quadFieldCellIdx(-1)
 {
 	Init(ZeroVector, owner);
 	GML_GET_TICKS(lastProjUpdate);
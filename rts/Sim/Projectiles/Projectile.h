@@ -12,6 +12,7 @@
 #include "ExplosionGenerator.h"
 #include "Sim/Units/UnitHandler.h"
 #include "System/float3.h"
+#include "System/SlabPool.h"
 #include "System/Vec2.h"
 
 class CUnit;
@@ -27,6 +28,21 @@ class CProjectile: public CExpGenSpawnable
 	CProjectile();
 
 public:
+	/// types whose movement CProjectileHandler integrates in batches
+	enum {
+		UPDATE_BATCH_NONE      = 0,
+		UPDATE_BATCH_EXPLOSIVE = 1,
+		UPDATE_BATCH_LASER     = 2,
+		UPDATE_BATCH_EMG       = 3,
+		UPDATE_BATCH_TRACER    = 4
+	};
+
+	// also covers unsynced projectiles, they are freed during the sim frame too
+	inline void* operator new(size_t size) { return projectileMemPool.Alloc(size); }
+	inline void* operator new(size_t size, void* p) { return p; } // used by creg
+	inline void operator delete(void* p, size_t size) { projectileMemPool.Free(p, size); }
+	inline void operator delete(void* p, void*) {}
+
 	CProjectile(const float3& pos, const float3& speed, CUnit* owner, bool isSynced, bool isWeapon, bool isPiece);
 	virtual ~CProjectile();
 	virtual void Detach();
@@ -55,8 +71,8 @@ public:
 	void SetQuadFieldCellCoors(const int2& cell) { quadFieldCellCoors = cell; }
 	int2 GetQuadFieldCellCoors() const { return quadFieldCellCoors; }
 
-	void SetQuadFieldCellIter(const std::list<CProjectile*>::iterator& it) { quadFieldCellIter = it; }
-	const std::list<CProjectile*>::iterator& GetQuadFieldCellIter() { return quadFieldCellIter; }
+	void SetQuadFieldCellIdx(int idx) { quadFieldCellIdx = idx; }
+	int GetQuadFieldCellIdx() const { return quadFieldCellIdx; }
 
 	unsigned int GetProjectileType() const { return projectileType; }
 	unsigned int GetCollisionFlags() const { return collisionFlags; }
@@ -77,6 +93,8 @@ public:
 	bool castShadow;
 
 	unsigned lastProjUpdate;
+	/// one of UPDATE_BATCH_*, set by the constructor of the type
+	unsigned int updateBatch;
 
 	float3 dir;
 	float3 speed;
@@ -91,7 +109,7 @@ protected:
 	unsigned int collisionFlags;
 
 	int2 quadFieldCellCoors;
-	std::list<CProjectile*>::iterator quadFieldCellIter;
+	int quadFieldCellIdx; ///< index into the projectile array of our quadfield cell
 };
 
 #endif /* PROJECTILE_H */
@@ -0,0 +1,32 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "ProjectileBatch.h"
+
+void ProjectileBatch::resize(size_t size)
+{
+	px.resize(size); py.resize(size); pz.resize(size);
+	vx.resize(size); vy.resize(size); vz.resize(size);
+	gravity.resize(size);
+	ttl.resize(size);
+	ttlStep.resize(size);
+}
+
+void ProjectileBatch::Integrate()
+{
+	const size_t numProjectiles = size();
+
+	if (numProjectiles == 0)
+		return;
+
+	float* x = &px[0]; float* y = &py[0]; float* z = &pz[0];
+	float* dx = &vx[0]; float* dy = &vy[0]; float* dz = &vz[0];
+	const float* g = &gravity[0];
+	int* t = &ttl[0];
+	const int* dt = &ttlStep[0];
+
+	for (size_t i = 0; i < numProjectiles; i++) { dy[i] += g[i]; }
+	for (size_t i = 0; i < numProjectiles; i++) { x[i] += dx[i]; }
+	for (size_t i = 0; i < numProjectiles; i++) { y[i] += dy[i]; }
+	for (size_t i = 0; i < numProjectiles; i++) { z[i] += dz[i]; }
+	for (size_t i = 0; i < numProjectiles; i++) { t[i] -= dt[i]; }
+}
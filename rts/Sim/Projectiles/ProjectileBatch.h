@@ -0,0 +1,30 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef PROJECTILE_BATCH_H
+#define PROJECTILE_BATCH_H
+
+#include <vector>
+#include <cstddef>
+
+/**
+ * Movement state of a run of projectiles that CProjectileHandler moves
+ * together, in SoA layout so the integration loops can be vectorized
+ */
+struct ProjectileBatch {
+	void resize(size_t size);
+	size_t size() const { return px.size(); }
+
+	/**
+	 * Same operations in the same order as CProjectile::Update
+	 * followed by the ttl count-down of the weapon projectiles,
+	 * for all projectiles in the batch
+	 */
+	void Integrate();
+
+	std::vector<float> px, py, pz;
+	std::vector<float> vx, vy, vz;
+	std::vector<float> gravity;
+	std::vector<int> ttl, ttlStep;
+};
+
+#endif // PROJECTILE_BATCH_H
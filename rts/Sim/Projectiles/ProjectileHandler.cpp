@@ -19,15 +19,22 @@
 #include "Sim/Misc/TeamHandler.h"
 #include "Sim/Projectiles/Unsynced/FlyingPiece.h"
 #include "Sim/Projectiles/Unsynced/GfxProjectile.h"
+#include "Sim/Projectiles/Unsynced/TracerProjectile.h"
+#include "Sim/Projectiles/WeaponProjectiles/EmgProjectile.h"
+#include "Sim/Projectiles/WeaponProjectiles/ExplosiveProjectile.h"
+#include "Sim/Projectiles/WeaponProjectiles/LaserProjectile.h"
 #include "Sim/Units/Unit.h"
 #include "Sim/Units/UnitDef.h"
 #include "System/Config/ConfigHandler.h"
 #include "System/EventHandler.h"
 #include "System/Log/ILog.h"
+#include "System/Platform/ThreadPool.h"
 #include "System/TimeProfiler.h"
 #include "System/creg/STL_Map.h"
 #include "System/creg/STL_List.h"
 
+#include <boost/bind.hpp>
+
 // reserve 5% of maxNanoParticles for important stuff such as capture and reclaim other teams' units
 #define NORMAL_NANO_PRIO 0.95f
 #define HIGH_NANO_PRIO 1.0f
@@ -37,6 +44,8 @@ using namespace std;
 
 CONFIG(int, MaxParticles).defaultValue(1000);
 CONFIG(int, MaxNanoParticles).defaultValue(2500);
+CONFIG(bool, BatchedProjectileUpdates).defaultValue(false)
+	.description("Move common straight-line projectiles in batches instead of one at a time. The results are identical, but currently it is slower.");
 
 CProjectileHandler* ph;
 
@@ -87,6 +96,7 @@ CProjectileHandler::CProjectileHandler()
 {
 	maxParticles     = configHandler->GetInt("MaxParticles");
 	maxNanoParticles = configHandler->GetInt("MaxNanoParticles");
+	batchedUpdates   = configHandler->GetBool("BatchedProjectileUpdates");
 
 	currentParticles       = 0;
 	currentNanoParticles   = 0;
@@ -187,48 +197,177 @@ void CProjectileHandler::UpdateProjectileContainer(ProjectileContainer& pc, bool
 		CProjectile* p = *pci;
 
 		if (p->deleteMe) {
-			ProjectileMap::iterator pIt;
+			pci = EraseProjectile(pc, pci);
+		} else if (batchedUpdates && IsBatchable(p)) {
+			// this and the batchable ones directly after it
+			pci = UpdateBatchedProjectiles(pc, pci);
+		} else {
+			PROJECTILE_SANITY_CHECK(p);
 
-			if (p->synced) {
-				//! iterator is always valid
-				pIt = syncedProjectileIDs.find(p->id);
+			p->Update();
+			qf->MovedProjectile(p);
 
-				eventHandler.ProjectileDestroyed((pIt->second).first, (pIt->second).second);
-				syncedProjectileIDs.erase(pIt);
+			PROJECTILE_SANITY_CHECK(p);
+			GML_GET_TICKS(p->lastProjUpdate);
 
-				freeSyncedIDs.push_back(p->id);
+			++pci;
+		}
+	}
+}
+
+ProjectileContainer::iterator CProjectileHandler::EraseProjectile(ProjectileContainer& pc, ProjectileContainer::iterator pci)
+{
+	CProjectile* p = *pci;
+	ProjectileMap::iterator pIt;
+
+	if (p->synced) {
+		//! iterator is always valid
+		pIt = syncedProjectileIDs.find(p->id);
+
+		eventHandler.ProjectileDestroyed((pIt->second).first, (pIt->second).second);
+		syncedProjectileIDs.erase(pIt);
+
+		freeSyncedIDs.push_back(p->id);
+
+		//! push_back this projectile for deletion
+		return pc.erase_delete_synced(pci);
+	}
 
-				//! push_back this projectile for deletion
-				pci = pc.erase_delete_synced(pci);
-			} else {
 #if UNSYNCED_PROJ_NOEVENT
-				eventHandler.UnsyncedProjectileDestroyed(p);
+	eventHandler.UnsyncedProjectileDestroyed(p);
 #else
-				pIt = unsyncedProjectileIDs.find(p->id);
+	pIt = unsyncedProjectileIDs.find(p->id);
 
-				eventHandler.ProjectileDestroyed((pIt->second).first, (pIt->second).second);
-				unsyncedProjectileIDs.erase(pIt);
+	eventHandler.ProjectileDestroyed((pIt->second).first, (pIt->second).second);
+	unsyncedProjectileIDs.erase(pIt);
 
-				freeUnsyncedIDs.push_back(p->id);
+	freeUnsyncedIDs.push_back(p->id);
 #endif
 #if DETACH_SYNCED
-				pci = pc.erase_detach(pci);
+	return pc.erase_detach(pci);
 #else
-				pci = pc.erase_delete(pci);
+	return pc.erase_delete(pci);
 #endif
-			}
+}
+
+
+bool CProjectileHandler::IsBatchable(const CProjectile* p)
+{
+	return (!p->deleteMe && p->updateBatch != CProjectile::UPDATE_BATCH_NONE && !p->luaMoveCtrl);
+}
+
+static inline bool SameFloat3(const float3& a, const float3& b)
+{
+	return (a.x == b.x && a.y == b.y && a.z == b.z);
+}
+
+ProjectileContainer::iterator CProjectileHandler::UpdateBatchedProjectiles(ProjectileContainer& pc, ProjectileContainer::iterator pci)
+{
+	ProjectileBatch& b = projectileBatch;
+
+	batchedProjectiles.clear();
+	batchStartPos.clear();
+	batchStartSpeed.clear();
+	batchStartGravity.clear();
+
+	for (ProjectileContainer::iterator it = pci; it != pc.end() && IsBatchable(*it); ++it) {
+		PROJECTILE_SANITY_CHECK((*it));
+
+		batchedProjectiles.push_back(*it);
+		batchStartPos.push_back((*it)->pos);
+		batchStartSpeed.push_back((*it)->speed);
+		batchStartGravity.push_back((*it)->mygravity);
+	}
+
+	const size_t numProjectiles = batchedProjectiles.size();
+
+	b.resize(numProjectiles);
+
+	for (size_t i = 0; i < numProjectiles; i++) {
+		const CProjectile* p = batchedProjectiles[i];
+
+		b.px[i] = p->pos.x;   b.py[i] = p->pos.y;   b.pz[i] = p->pos.z;
+		b.vx[i] = p->speed.x; b.vy[i] = p->speed.y; b.vz[i] = p->speed.z;
+
+		// adding -0.0f leaves every value (including +0.0f) unchanged,
+		// so types without gravity give the same results as their Update
+		b.gravity[i] = (p->updateBatch == CProjectile::UPDATE_BATCH_EXPLOSIVE)? p->mygravity: -0.0f;
+
+		if (p->weapon) {
+			b.ttl[i] = static_cast<const CWeaponProjectile*>(p)->GetTimeToLive();
+			b.ttlStep[i] = 1;
 		} else {
-			PROJECTILE_SANITY_CHECK(p);
+			b.ttl[i] = 0;
+			b.ttlStep[i] = 0;
+		}
+	}
 
-			p->Update();
-			qf->MovedProjectile(p);
+	b.Integrate();
 
-			PROJECTILE_SANITY_CHECK(p);
-			GML_GET_TICKS(p->lastProjUpdate);
+	// the run is still contiguous in the container, walk it again and
+	// finish every projectile in the order the serial loop would have;
+	// anything appended meanwhile is reached by the caller afterwards
+	for (size_t i = 0; i < numProjectiles; i++) {
+		CProjectile* p = *pci;
 
-			++pci;
+		assert(p == batchedProjectiles[i]);
+
+		// deleted by one of the projectiles updated before it
+		if (p->deleteMe) {
+			pci = EraseProjectile(pc, pci);
+			continue;
 		}
+
+		const bool changed =
+			p->luaMoveCtrl ||
+			!SameFloat3(p->pos, batchStartPos[i]) ||
+			!SameFloat3(p->speed, batchStartSpeed[i]) ||
+			p->mygravity != batchStartGravity[i] ||
+			(p->weapon && static_cast<const CWeaponProjectile*>(p)->GetTimeToLive() != (b.ttl[i] + b.ttlStep[i]));
+
+		if (changed) {
+			// modified (through Lua) by one of the projectiles updated
+			// before it, the integrated state is stale
+			p->Update();
+		} else {
+			p->pos = float3(b.px[i], b.py[i], b.pz[i]);
+			p->speed.y = b.vy[i];
+
+			switch (p->updateBatch) {
+				case CProjectile::UPDATE_BATCH_EXPLOSIVE: {
+					CExplosiveProjectile* ep = static_cast<CExplosiveProjectile*>(p);
+					ep->dir = ep->speed; ep->dir.SafeNormalize();
+					ep->SetTimeToLive(b.ttl[i]);
+					ep->UpdateState();
+				} break;
+				case CProjectile::UPDATE_BATCH_LASER: {
+					CLaserProjectile* lp = static_cast<CLaserProjectile*>(p);
+					lp->SetTimeToLive(b.ttl[i]);
+					lp->UpdateState();
+				} break;
+				case CProjectile::UPDATE_BATCH_EMG: {
+					CEmgProjectile* ep = static_cast<CEmgProjectile*>(p);
+					ep->SetTimeToLive(b.ttl[i]);
+					ep->UpdateState();
+				} break;
+				case CProjectile::UPDATE_BATCH_TRACER: {
+					static_cast<CTracerProjectile*>(p)->UpdateState();
+				} break;
+				default: {
+					assert(false);
+				} break;
+			}
+		}
+
+		qf->MovedProjectile(p);
+
+		PROJECTILE_SANITY_CHECK(p);
+		GML_GET_TICKS(p->lastProjUpdate);
+
+		++pci;
 	}
+
+	return pci;
 }
 
 
@@ -375,20 +514,19 @@ void CProjectileHandler::AddProjectile(CProjectile* p)
 
 
 
-void CProjectileHandler::CheckUnitCollisions(
-	CProjectile* p,
-	std::vector<CUnit*>& tempUnits,
-	CUnit** endUnit,
+void CProjectileHandler::DetectUnitCollision(
+	const CProjectile* p,
+	const std::vector<CUnit*>& units,
 	const float3& ppos0,
-	const float3& ppos1)
+	const float3& ppos1,
+	CollisionCandidate& cc) const
 {
-	CollisionQuery cq;
+	const CUnit* attacker = p->owner();
 
-	for (CUnit** ui = &tempUnits[0]; ui != endUnit; ++ui) {
-		CUnit* unit = *ui;
-		CollisionVolume* volume = unit->collisionVolume;
+	cc.unit = NULL;
 
-		const CUnit* attacker = p->owner();
+	for (std::vector<CUnit*>::const_iterator ui = units.begin(); ui != units.end(); ++ui) {
+		CUnit* unit = *ui;
 
 		// if this unit fired this projectile, always ignore
 		if (attacker == unit) {
@@ -405,91 +543,211 @@ void CProjectileHandler::CheckUnitCollisions(
 			if (unit->IsNeutral()) { continue; }
 		}
 
-		if (CCollisionHandler::DetectHit(unit, ppos0, ppos1, &cq)) {
-			if (cq.lmp != NULL) {
-				unit->SetLastAttackedPiece(cq.lmp, gs->frameNum);
-			}
+		CollisionQuery cq;
 
-			// The current projectile <p> won't reach the raytraced surface impact
-			// position until ::Update() is called (same frame). This is a problem
-			// when dealing with fast low-AOE projectiles since they would do almost
-			// no damage if detonated outside the collision volume. Therefore, smuggle
-			// a bit with its position now (rather than rolling it back in ::Update()
-			// and waiting for the next-frame CheckUnitCol(), which is problematic
-			// for noExplode projectiles).
-
-			const bool raytraced = (volume->GetTestType() == CollisionVolume::COLVOL_HITTEST_CONT);
-			const float3 pimpp =
-				(cq.b0 && cq.b1)? (cq.p0 + cq.p1) * 0.5f:
-				(cq.b0         )? (cq.p0 + ppos1) * 0.5f:
-				                  (ppos0 + cq.p1) * 0.5f;
-
-			p->pos = (raytraced)? pimpp: ppos0;
-			p->Collision(unit);
-			p->pos = (raytraced)? ppos0: p->pos;
+		if (CCollisionHandler::DetectHit(unit, ppos0, ppos1, &cq)) {
+			cc.unit = unit;
+			cc.unitQuery = cq;
 			break;
 		}
 	}
 }
 
-void CProjectileHandler::CheckFeatureCollisions(
-	CProjectile* p,
-	std::vector<CFeature*>& tempFeatures,
-	CFeature** endFeature,
+void CProjectileHandler::DetectFeatureCollision(
+	const CProjectile* p,
+	const std::vector<CFeature*>& features,
 	const float3& ppos0,
-	const float3& ppos1)
+	const float3& ppos1,
+	CollisionCandidate& cc) const
 {
-	if (!p->checkCol) // already collided with unit?
-		return;
+	cc.feature = NULL;
 
 	if ((p->GetCollisionFlags() & Collision::NOFEATURES) != 0)
 		return;
 
-	CollisionQuery cq;
-
-	for (CFeature** fi = &tempFeatures[0]; fi != endFeature; ++fi) {
+	for (std::vector<CFeature*>::const_iterator fi = features.begin(); fi != features.end(); ++fi) {
 		CFeature* feature = *fi;
-		CollisionVolume* volume = feature->collisionVolume;
 
 		if (!feature->blocking) {
 			continue;
 		}
 
+		CollisionQuery cq;
+
 		if (CCollisionHandler::DetectHit(feature, ppos0, ppos1, &cq)) {
-			const bool raytraced = (volume->GetTestType() == CollisionVolume::COLVOL_HITTEST_CONT);
-			const float3 pimpp =
-				(cq.b0 && cq.b1)? (cq.p0 + cq.p1) * 0.5f:
-				(cq.b0         )? (cq.p0 + ppos1) * 0.5f:
-								  (ppos0 + cq.p1) * 0.5f;
-
-			p->pos = (raytraced)? pimpp: ppos0;
-			p->Collision(feature);
-			p->pos = (raytraced)? ppos0: p->pos;
+			cc.feature = feature;
+			cc.featureQuery = cq;
 			break;
 		}
 	}
 }
 
+void CProjectileHandler::ApplyUnitCollision(
+	CProjectile* p,
+	const CollisionCandidate& cc,
+	const float3& ppos0,
+	const float3& ppos1)
+{
+	CUnit* unit = cc.unit;
+	const CollisionVolume* volume = unit->collisionVolume;
+	const CollisionQuery& cq = cc.unitQuery;
+
+	if (cq.lmp != NULL) {
+		unit->SetLastAttackedPiece(cq.lmp, gs->frameNum);
+	}
+
+	// The current projectile <p> won't reach the raytraced surface impact
+	// position until ::Update() is called (same frame). This is a problem
+	// when dealing with fast low-AOE projectiles since they would do almost
+	// no damage if detonated outside the collision volume. Therefore, smuggle
+	// a bit with its position now (rather than rolling it back in ::Update()
+	// and waiting for the next-frame CheckUnitCol(), which is problematic
+	// for noExplode projectiles).
+
+	const bool raytraced = (volume->GetTestType() == CollisionVolume::COLVOL_HITTEST_CONT);
+	const float3 pimpp =
+		(cq.b0 && cq.b1)? (cq.p0 + cq.p1) * 0.5f:
+		(cq.b0         )? (cq.p0 + ppos1) * 0.5f:
+		                  (ppos0 + cq.p1) * 0.5f;
+
+	p->pos = (raytraced)? pimpp: ppos0;
+	p->Collision(unit);
+	p->pos = (raytraced)? ppos0: p->pos;
+}
+
+void CProjectileHandler::ApplyFeatureCollision(
+	CProjectile* p,
+	const CollisionCandidate& cc,
+	const float3& ppos0,
+	const float3& ppos1)
+{
+	CFeature* feature = cc.feature;
+	const CollisionVolume* volume = feature->collisionVolume;
+	const CollisionQuery& cq = cc.featureQuery;
+
+	const bool raytraced = (volume->GetTestType() == CollisionVolume::COLVOL_HITTEST_CONT);
+	const float3 pimpp =
+		(cq.b0 && cq.b1)? (cq.p0 + cq.p1) * 0.5f:
+		(cq.b0         )? (cq.p0 + ppos1) * 0.5f:
+		                  (ppos0 + cq.p1) * 0.5f;
+
+	p->pos = (raytraced)? pimpp: ppos0;
+	p->Collision(feature);
+	p->pos = (raytraced)? ppos0: p->pos;
+}
+
+void CProjectileHandler::QueryCollisionCandidates(int begin, int end) {
+	// scratch buffers are per chunk, chunks may run on any thread
+	std::vector<int> quads;
+	std::vector<CUnit*> units;
+	std::vector<CFeature*> features;
+
+	for (int i = begin; i < end; ++i) {
+		const CProjectile* p = collisionProjectiles[i];
+
+		if (!p->checkCol || p->deleteMe)
+			continue;
+
+		const float3 ppos0 = p->pos;
+		const float3 ppos1 = p->pos + p->speed;
+
+		qf->GetUnitsAndFeaturesExactMT(p->pos, p->radius + p->speed.Length(), quads, units, features);
+
+		DetectUnitCollision(p, units, ppos0, ppos1, collisionCandidates[i]);
+		DetectFeatureCollision(p, features, ppos0, ppos1, collisionCandidates[i]);
+
+		collisionCandidates[i].queried = true;
+		collisionCandidates[i].pos = p->pos;
+		collisionCandidates[i].speed = p->speed;
+		collisionCandidates[i].radius = p->radius;
+	}
+}
+
+void CProjectileHandler::ApplyCollisionCandidate(CProjectile* p, CollisionCandidate& cc, unsigned int changeNum) {
+	if (!p->checkCol || p->deleteMe)
+		return;
+
+	const float3 ppos0 = p->pos;
+	const float3 ppos1 = p->pos + p->speed;
+	const float radius = p->radius + p->speed.Length();
+
+	// redo the query if an earlier collision (through its Lua callins)
+	// moved this projectile or changed the objects around it
+	const bool stale =
+		!cc.queried ||
+		!SameFloat3(cc.pos, p->pos) ||
+		!SameFloat3(cc.speed, p->speed) ||
+		cc.radius != p->radius ||
+		qf->QuadsChangedSince(ppos0, radius, changeNum);
+
+	if (stale) {
+		qf->GetUnitsAndFeaturesExactMT(ppos0, radius, collisionQuads, collisionUnits, collisionFeatures);
+		DetectUnitCollision(p, collisionUnits, ppos0, ppos1, cc);
+		DetectFeatureCollision(p, collisionFeatures, ppos0, ppos1, cc);
+	}
+
+	if (cc.unit != NULL) {
+		ApplyUnitCollision(p, cc, ppos0, ppos1);
+	}
+
+	// already collided with unit?
+	if (!p->checkCol)
+		return;
+
+	if (cc.unit != NULL && qf->QuadsChangedSince(ppos0, radius, changeNum)) {
+		qf->GetUnitsAndFeaturesExactMT(ppos0, radius, collisionQuads, collisionUnits, collisionFeatures);
+		DetectFeatureCollision(p, collisionFeatures, ppos0, ppos1, cc);
+	}
+
+	if (cc.feature != NULL) {
+		ApplyFeatureCollision(p, cc, ppos0, ppos1);
+	}
+}
+
 void CProjectileHandler::CheckUnitFeatureCollisions(ProjectileContainer& pc) {
-	static std::vector<CUnit*> tempUnits(uh->MaxUnits(), NULL);
-	static std::vector<CFeature*> tempFeatures(uh->MaxUnits(), NULL);
+	// phase 1: run the (read-only) broad- and narrow-phase queries
+	// for every projectile in parallel; phase 2: apply the hits on
+	// this thread in container order, which is the order the serial
+	// version used
+	//
+	// a query result is only reused in phase 2 if neither the quads
+	// it covers nor the projectile itself changed (by an earlier
+	// collision's side-effects) in the meantime, otherwise it is
+	// redone serially; either way the outcome is the same as with
+	// purely serial checking
+	//
+	// besides moves, the quads are also marked on every change that
+	// alters the filters or hit tests below without moving an object
+	// (death, ally-team and neutral status, collision volumes), see
+	// CQuadField::MarkObjectChanged
+	collisionProjectiles.clear();
+
+	ProjectileContainer::iterator lastPci = pc.end();
 
 	for (ProjectileContainer::iterator pci = pc.begin(); pci != pc.end(); ++pci) {
-		CProjectile* p = *pci;
+		collisionProjectiles.push_back(*pci);
+		lastPci = pci;
+	}
 
-		if (p->checkCol && !p->deleteMe) {
-			const float3 ppos0 = p->pos;
-			const float3 ppos1 = p->pos + p->speed;
-			const float speedf = p->speed.Length();
+	const int numProjectiles = collisionProjectiles.size();
+	const unsigned int changeNum = qf->GetChangeNum();
 
-			CUnit** endUnit = &tempUnits[0];
-			CFeature** endFeature = &tempFeatures[0];
+	collisionCandidates.clear();
+	collisionCandidates.resize(numProjectiles);
 
-			qf->GetUnitsAndFeaturesExact(p->pos, p->radius + speedf, endUnit, endFeature);
+	ThreadPool::parallel_for_ranges(0, numProjectiles, boost::bind(&CProjectileHandler::QueryCollisionCandidates, this, _1, _2), 64);
 
-			CheckUnitCollisions(p, tempUnits, endUnit, ppos0, ppos1);
-			CheckFeatureCollisions(p, tempFeatures, endFeature, ppos0, ppos1);
-		}
+	for (int i = 0; i < numProjectiles; ++i) {
+		ApplyCollisionCandidate(collisionProjectiles[i], collisionCandidates[i], changeNum);
+	}
+
+	// projectiles created by the collisions above were appended to the
+	// container, the serial loop checked them in the same frame as well
+	ProjectileContainer::iterator pci = (lastPci == pc.end())? pc.begin(): ++lastPci;
+
+	for (; pci != pc.end(); ++pci) {
+		CollisionCandidate cc;
+		ApplyCollisionCandidate(*pci, cc, changeNum);
 	}
 }
 
@@ -9,6 +9,8 @@
 #include <stack>
 #include "lib/gml/ThreadSafeContainers.h"
 
+#include "Sim/Misc/CollisionHandler.h"
+#include "Sim/Projectiles/ProjectileBatch.h"
 #include "System/MemPool.h"
 #include "System/float3.h"
 
@@ -68,8 +70,32 @@ public:
 		return &(it->second);
 	}
 
-	void CheckUnitCollisions(CProjectile*, std::vector<CUnit*>&, CUnit**, const float3&, const float3&);
-	void CheckFeatureCollisions(CProjectile*, std::vector<CFeature*>&, CFeature**, const float3&, const float3&);
+	/**
+	 * Outcome of the (read-only) unit- and feature-collision
+	 * query for one projectile, computed in parallel by
+	 * CheckUnitFeatureCollisions and applied serially
+	 */
+	struct CollisionCandidate {
+		CollisionCandidate(): queried(false), unit(NULL), feature(NULL) {}
+
+		bool queried;      ///< false if the projectile was skipped in phase 1
+		CUnit* unit;       ///< first unit whose volume is hit, if any
+		CFeature* feature; ///< first blocking feature whose volume is hit, if any
+
+		float3 pos;        ///< projectile position, speed and radius the query used
+		float3 speed;
+		float radius;
+
+		CollisionQuery unitQuery;
+		CollisionQuery featureQuery;
+	};
+
+	void DetectUnitCollision(const CProjectile*, const std::vector<CUnit*>&, const float3&, const float3&, CollisionCandidate&) const;
+	void DetectFeatureCollision(const CProjectile*, const std::vector<CFeature*>&, const float3&, const float3&, CollisionCandidate&) const;
+	void ApplyUnitCollision(CProjectile*, const CollisionCandidate&, const float3&, const float3&);
+	void ApplyFeatureCollision(CProjectile*, const CollisionCandidate&, const float3&, const float3&);
+	void QueryCollisionCandidates(int begin, int end);
+	void ApplyCollisionCandidate(CProjectile*, CollisionCandidate&, unsigned int changeNum);
 	void CheckUnitFeatureCollisions(ProjectileContainer&);
 	void CheckGroundCollisions(ProjectileContainer&);
 	void CheckCollisions();
@@ -79,6 +105,9 @@ public:
 
 	void Update();
 	void UpdateProjectileContainer(ProjectileContainer&, bool);
+	ProjectileContainer::iterator UpdateBatchedProjectiles(ProjectileContainer& pc, ProjectileContainer::iterator pci);
+	ProjectileContainer::iterator EraseProjectile(ProjectileContainer& pc, ProjectileContainer::iterator pci);
+	static bool IsBatchable(const CProjectile* p);
 	void UpdateParticleSaturation() {
 		particleSaturation     = (maxParticles     > 0)? (currentParticles     / float(maxParticles    )): 1.0f;
 		nanoParticleSaturation = (maxNanoParticles > 0)? (currentNanoParticles / float(maxNanoParticles)): 1.0f;
@@ -112,6 +141,25 @@ private:
 	std::list<int> freeUnsyncedIDs;           // available unsynced projectile ID's
 	ProjectileMap syncedProjectileIDs;        // ID ==> <projectile, allyteam> map for living synced projectiles
 	ProjectileMap unsyncedProjectileIDs;      // ID ==> <projectile, allyteam> map for living unsynced projectiles
+
+	std::vector<CProjectile*> collisionProjectiles; // per-frame snapshot of the container being collision-checked
+	std::vector<CollisionCandidate> collisionCandidates;
+	std::vector<int> collisionQuads; // scratch space of the serial queries
+	std::vector<CUnit*> collisionUnits;
+	std::vector<CFeature*> collisionFeatures;
+
+	/**
+	 * Scratch space of UpdateBatchedProjectiles, which moves each run of
+	 * batchable projectiles in the container in one go (if enabled); the
+	 * start state of every value it integrates tells which ones were
+	 * changed by others of the run in the meantime
+	 */
+	bool batchedUpdates;
+	std::vector<CProjectile*> batchedProjectiles;
+	std::vector<float3> batchStartPos;
+	std::vector<float3> batchStartSpeed;
+	std::vector<float> batchStartGravity;
+	ProjectileBatch projectileBatch;
 };
 
 
@@ -29,6 +29,7 @@ CTracerProjectile::CTracerProjectile(const float3& pos, const float3& speed, con
 {
 	SetRadiusAndHeight(1.0f, 0.0f);
 	checkCol = false;
+	updateBatch = UPDATE_BATCH_TRACER;
 
 	speedf = this->speed.Length();
 	dir = this->speed / speedf;
@@ -41,6 +42,7 @@ CTracerProjectile::CTracerProjectile()
 	, dir(ZeroVector)
 {
 	checkCol = false;
+	updateBatch = UPDATE_BATCH_TRACER;
 }
 
 void CTracerProjectile::Init(const float3& pos, CUnit* owner)
@@ -62,7 +64,11 @@ CTracerProjectile::~CTracerProjectile()
 void CTracerProjectile::Update()
 {
 	pos += speed;
+	UpdateState();
+}
 
+void CTracerProjectile::UpdateState()
+{
 	drawLength += speedf;
 	length -= speedf;
 	if (length < 0) {
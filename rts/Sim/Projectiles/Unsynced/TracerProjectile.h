@@ -17,6 +17,8 @@ public:
 
 	void Draw();
 	void Update();
+	/// everything Update does after moving
+	void UpdateState();
 	void Init(const float3& pos, CUnit *owner);
 
 private:
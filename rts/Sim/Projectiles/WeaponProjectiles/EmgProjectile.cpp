@@ -31,6 +31,7 @@ CEmgProjectile::CEmgProjectile(
 	color(color)
 {
 	projectileType = WEAPON_EMG_PROJECTILE;
+	updateBatch = UPDATE_BATCH_EMG;
 
 	if (weaponDef) {
 		SetRadiusAndHeight(weaponDef->collisionSize, 0.0f);
@@ -54,7 +55,13 @@ void CEmgProjectile::Update()
 		pos += speed;
 	}
 
-	if (--ttl < 0) {
+	ttl--;
+	UpdateState();
+}
+
+void CEmgProjectile::UpdateState()
+{
+	if (ttl < 0) {
 		intensity -= 0.1f;
 		if (intensity <= 0){
 			deleteMe = true;
@@ -37,6 +37,7 @@ CExplosiveProjectile::CExplosiveProjectile(
 	, curTime(0)
 {
 	projectileType = WEAPON_EXPLOSIVE_PROJECTILE;
+	updateBatch = UPDATE_BATCH_EXPLOSIVE;
 
 	//! either map or weaponDef gravity
 	mygravity = g;
@@ -69,7 +70,13 @@ void CExplosiveProjectile::Update()
 //	}
 	CProjectile::Update();
 
-	if (--ttl == 0) {
+	ttl--;
+	UpdateState();
+}
+
+void CExplosiveProjectile::UpdateState()
+{
+	if (ttl == 0) {
 		Collision();
 	} else {
 		if (ttl > 0) {
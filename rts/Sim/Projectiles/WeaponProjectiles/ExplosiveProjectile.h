@@ -15,6 +15,8 @@ public:
 		float gravity = 0.0f);
 
 	void Update();
+	/// everything Update does after moving and counting down ttl
+	void UpdateState();
 	void Draw();
 	void Collision(CUnit* unit);
 	void Collision();
@@ -52,6 +52,7 @@ CLaserProjectile::CLaserProjectile(
 	stayTime(0)
 {
 	projectileType = WEAPON_LASER_PROJECTILE;
+	updateBatch = UPDATE_BATCH_LASER;
 
 	speedf = speed.Length();
 	dir = speed / speedf;
@@ -84,6 +85,13 @@ void CLaserProjectile::Update()
 		pos += speed;
 	}
 
+	// UpdateState expects ttl to be counted down already (the length update does not read it)
+	ttl--;
+	UpdateState();
+}
+
+void CLaserProjectile::UpdateState()
+{
 	if (checkCol) {
 		// normal
 		curLength += speedf;
@@ -103,7 +111,7 @@ void CLaserProjectile::Update()
 	}
 
 
-	if (--ttl > 0 && checkCol) {
+	if (ttl > 0 && checkCol) {
 		gCEG->Explosion(cegID, pos, ttl, intensity, NULL, 0.0f, NULL, speed);
 	}
 
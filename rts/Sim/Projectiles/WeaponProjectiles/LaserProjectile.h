@@ -16,6 +16,8 @@ public:
 	virtual ~CLaserProjectile();
 	void Draw();
 	void Update();
+	/// everything Update does after moving and counting down ttl
+	void UpdateState();
 	void Collision(CUnit* unit);
 	void Collision(CFeature* feature);
 	void Collision();
@@ -58,6 +58,9 @@ public:
 
 	int colorTeam;
 
+	int GetTimeToLive() const { return ttl; }
+	void SetTimeToLive(int newTTL) { ttl = newTTL; }
+
 protected:
 	float3 startpos;
 
@@ -38,17 +38,14 @@ CCobEngine::CCobEngine()
 CCobEngine::~CCobEngine()
 {
 	//Should delete all things that the scheduler knows
-	for (std::list<CCobThread *>::iterator i = running.begin(); i != running.end(); ++i) {
+	for (std::vector<CCobThread*>::iterator i = running.begin(); i != running.end(); ++i) {
 		delete *i;
 	}
-	for (std::list<CCobThread *>::iterator i = wantToRun.begin(); i != wantToRun.end(); ++i) {
+	for (std::vector<CCobThread*>::iterator i = wantToRun.begin(); i != wantToRun.end(); ++i) {
 		delete *i;
 	}
-	while (sleeping.size() > 0) {
-		CCobThread *tmp;
-		tmp = sleeping.top();
-		sleeping.pop();
-		delete tmp;
+	while (!sleeping.empty()) {
+		delete sleeping.PopAny();
 	}
 }
 
@@ -67,10 +64,10 @@ void CCobEngine::AddThread(CCobThread *thread)
 {
 	switch (thread->state) {
 		case CCobThread::Run:
-			wantToRun.push_front(thread);
+			wantToRun.push_back(thread);
 			break;
 		case CCobThread::Sleep:
-			sleeping.push(thread);
+			sleeping.Insert(thread);
 			break;
 		default:
 			LOG_L(L_ERROR, "thread added to scheduler with unknown state (%d)", thread->state);
@@ -99,7 +96,7 @@ void CCobEngine::Tick(int deltaTime)
 	LOG_L(L_DEBUG, "----");
 
 	// Advance all running threads
-	for (std::list<CCobThread*>::iterator i = running.begin(); i != running.end(); ++i) {
+	for (std::vector<CCobThread*>::iterator i = running.begin(); i != running.end(); ++i) {
 		//LOG_L(L_DEBUG, "Now 1running %d: %s", GCurrentTime, (*i)->GetName().c_str());
 #ifdef _CONSOLE
 		printf("----\n");
@@ -114,39 +111,25 @@ void CCobEngine::Tick(int deltaTime)
 	running.clear();
 
 	// The threads that just ran may have added new threads that should run next tick
-	for (std::list<CCobThread *>::iterator i = wantToRun.begin(); i != wantToRun.end(); ++i) {
-		running.push_front(*i);
-	}
-
-	wantToRun.clear();
+	// (they run in the order they were added, swapping keeps both buffers allocated)
+	running.swap(wantToRun);
 
 	//Check on the sleeping threads
-	if (!sleeping.empty()) {
-		CCobThread* cur = sleeping.top();
-
-		while ((cur != NULL) && (cur->GetWakeTime() < GCurrentTime)) {
-			// Start with removing the executing thread from the queue
-			sleeping.pop();
+	CCobThread* cur = NULL;
 
-			//Run forward again. This can quite possibly readd the thread to the sleeping array again
-			//But it will not interfere since it is guaranteed to sleep > 0 ms
-			//LOG_L(L_DEBUG, "Now 2running %d: %s", GCurrentTime, cur->GetName().c_str());
+	while ((cur = sleeping.PopExpired(GCurrentTime)) != NULL) {
+		//Run forward again. This can quite possibly readd the thread to the sleeping array again
+		//LOG_L(L_DEBUG, "Now 2running %d: %s", GCurrentTime, cur->GetName().c_str());
 #ifdef _CONSOLE
-			printf("+++\n");
+		printf("+++\n");
 #endif
-			if (cur->state == CCobThread::Sleep) {
-				cur->state = CCobThread::Run;
-				TickThread(cur);
-			} else if (cur->state == CCobThread::Dead) {
-				delete cur;
-			} else {
-				LOG_L(L_ERROR, "Sleeping thread strange state %d", cur->state);
-			}
-
-			if (!sleeping.empty())
-				cur = sleeping.top();
-			else
-				cur = NULL;
+		if (cur->state == CCobThread::Sleep) {
+			cur->state = CCobThread::Run;
+			TickThread(cur);
+		} else if (cur->state == CCobThread::Dead) {
+			delete cur;
+		} else {
+			LOG_L(L_ERROR, "Sleeping thread strange state %d", cur->state);
 		}
 	}
 }
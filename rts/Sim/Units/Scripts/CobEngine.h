@@ -10,9 +10,9 @@
  */
 
 #include "CobThread.h"
+#include "CobTimerWheel.h"
 
-#include <list>
-#include <queue>
+#include <vector>
 #include <map>
 
 class CCobThread;
@@ -20,24 +20,20 @@ class CCobInstance;
 class CCobFile;
 
 
-class CCobThreadPtr_less : public std::binary_function<CCobThread*, CCobThread*, bool> {
-public:
-	bool operator() (const CCobThread* const& a, const CCobThread* const& b) const {
-		return a->GetWakeTime() > b->GetWakeTime();
-	}
-};
-
-
 class CCobEngine
 {
 protected:
-	std::list<CCobThread*> running;
+	std::vector<CCobThread*> running;
 	/**
 	 * Threads are added here if they are in Running.
 	 * And moved to real running after running is empty.
 	 */
-	std::list<CCobThread*> wantToRun;
-	std::priority_queue<CCobThread*, std::vector<CCobThread*>, CCobThreadPtr_less> sleeping;
+	std::vector<CCobThread*> wantToRun;
+	/**
+	 * Woken up in order of wake time (and in the order they went
+	 * to sleep for equal wake times) once GCurrentTime passes it.
+	 */
+	CCobTimerWheel<CCobThread> sleeping;
 	CCobThread* curThread;
 	void TickThread(CCobThread* thread);
 public:
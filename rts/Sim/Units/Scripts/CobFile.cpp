@@ -4,6 +4,7 @@
 
 #include "Sim/Misc/GlobalConstants.h"
 #include "CobFile.h"
+#include "CobOpcodes.h"
 #include "System/FileSystem/FileHandler.h"
 #include "System/Log/ILog.h"
 #include "System/Sound/ISound.h"
@@ -156,6 +157,8 @@ CCobFile::CCobFile(CFileHandler &in, string name)
 		swabDWordInPlace(code[i]);
 	}
 
+	DecodeCobCode(code, code_ints, scriptOffsets, scriptLengths, scriptNames, opcodeIndices);
+
 	numStaticVars = ch.NumberOfStaticVars;
 
 	// If this is a TA:K script, read the sound names
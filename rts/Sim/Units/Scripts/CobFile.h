@@ -31,6 +31,8 @@ public:
 	std::map<std::string, int> scriptMap;
 	std::vector<LuaHashString> luaScripts;
 	int* code;
+	/// dense opcode index of every word of code, see DecodeCobCode
+	std::vector<unsigned char> opcodeIndices;
 	int numStaticVars;
 	std::string name;
 };
@@ -76,15 +76,10 @@ CCobInstance::~CCobInstance()
 	//this may be dangerous, is it really desired?
 	//Destroy();
 
-	for (int animType = ATurn; animType <= AMove; animType++) {
-		for (std::list<AnimInfo *>::iterator i = anims[animType].begin(); i != anims[animType].end(); ++i) {
-			// All threads blocking on animations can be killed safely from here since the scheduler does not
-			// know about them
-			for (std::list<IAnimListener *>::iterator j = (*i)->listeners.begin(); j != (*i)->listeners.end(); ++j) {
-				delete *j;
-			}
-			// the anims are deleted in ~CUnitScript
-		}
+	for (std::vector<AnimListenerInfo>::iterator i = animListeners.begin(); i != animListeners.end(); ++i) {
+		// All threads blocking on animations can be killed safely from here since the scheduler does not
+		// know about them
+		delete i->listener;
 	}
 
 	// Can't delete the thread here because that would confuse the scheduler to no end
@@ -0,0 +1,196 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "CobOpcodes.h"
+
+#include <algorithm>
+
+
+CobOpcodeIndex GetCobOpcodeIndex(int opcode)
+{
+	switch (opcode) {
+		case MOVE: return COBOP_MOVE;
+		case TURN: return COBOP_TURN;
+		case SPIN: return COBOP_SPIN;
+		case STOP_SPIN: return COBOP_STOP_SPIN;
+		case SHOW: return COBOP_SHOW;
+		case HIDE: return COBOP_HIDE;
+		case CACHE: return COBOP_CACHE;
+		case DONT_CACHE: return COBOP_DONT_CACHE;
+		case MOVE_NOW: return COBOP_MOVE_NOW;
+		case TURN_NOW: return COBOP_TURN_NOW;
+		case SHADE: return COBOP_SHADE;
+		case DONT_SHADE: return COBOP_DONT_SHADE;
+		case EMIT_SFX: return COBOP_EMIT_SFX;
+
+		case WAIT_TURN: return COBOP_WAIT_TURN;
+		case WAIT_MOVE: return COBOP_WAIT_MOVE;
+		case SLEEP: return COBOP_SLEEP;
+
+		case PUSH_CONSTANT: return COBOP_PUSH_CONSTANT;
+		case PUSH_LOCAL_VAR: return COBOP_PUSH_LOCAL_VAR;
+		case PUSH_STATIC: return COBOP_PUSH_STATIC;
+		case CREATE_LOCAL_VAR: return COBOP_CREATE_LOCAL_VAR;
+		case POP_LOCAL_VAR: return COBOP_POP_LOCAL_VAR;
+		case POP_STATIC: return COBOP_POP_STATIC;
+		case POP_STACK: return COBOP_POP_STACK;
+
+		case ADD: return COBOP_ADD;
+		case SUB: return COBOP_SUB;
+		case MUL: return COBOP_MUL;
+		case DIV: return COBOP_DIV;
+		case MOD: return COBOP_MOD;
+		case BITWISE_AND: return COBOP_BITWISE_AND;
+		case BITWISE_OR: return COBOP_BITWISE_OR;
+		case BITWISE_XOR: return COBOP_BITWISE_XOR;
+		case BITWISE_NOT: return COBOP_BITWISE_NOT;
+
+		case RAND: return COBOP_RAND;
+		case GET_UNIT_VALUE: return COBOP_GET_UNIT_VALUE;
+		case GET: return COBOP_GET;
+
+		case SET_LESS: return COBOP_SET_LESS;
+		case SET_LESS_OR_EQUAL: return COBOP_SET_LESS_OR_EQUAL;
+		case SET_GREATER: return COBOP_SET_GREATER;
+		case SET_GREATER_OR_EQUAL: return COBOP_SET_GREATER_OR_EQUAL;
+		case SET_EQUAL: return COBOP_SET_EQUAL;
+		case SET_NOT_EQUAL: return COBOP_SET_NOT_EQUAL;
+		case LOGICAL_AND: return COBOP_LOGICAL_AND;
+		case LOGICAL_OR: return COBOP_LOGICAL_OR;
+		case LOGICAL_XOR: return COBOP_LOGICAL_XOR;
+		case LOGICAL_NOT: return COBOP_LOGICAL_NOT;
+
+		case START: return COBOP_START;
+		case CALL: return COBOP_REAL_CALL; // see DecodeCobCode
+		case REAL_CALL: return COBOP_REAL_CALL;
+		case LUA_CALL: return COBOP_LUA_CALL;
+		case JUMP: return COBOP_JUMP;
+		case RETURN: return COBOP_RETURN;
+		case JUMP_NOT_EQUAL: return COBOP_JUMP_NOT_EQUAL;
+		case SIGNAL: return COBOP_SIGNAL;
+		case SET_SIGNAL_MASK: return COBOP_SET_SIGNAL_MASK;
+
+		case EXPLODE: return COBOP_EXPLODE;
+		case PLAY_SOUND: return COBOP_PLAY_SOUND;
+
+		case SET: return COBOP_SET;
+		case ATTACH: return COBOP_ATTACH;
+		case DROP: return COBOP_DROP;
+	}
+
+	return COBOP_UNKNOWN;
+}
+
+int GetCobOpcodeNumArgs(int opcode)
+{
+	switch (opcode) {
+		case MOVE: case TURN: case SPIN: case STOP_SPIN:
+		case MOVE_NOW: case TURN_NOW: case WAIT_TURN: case WAIT_MOVE:
+		case START: case CALL: case REAL_CALL: case LUA_CALL:
+			return 2;
+
+		case SHOW: case HIDE: case CACHE: case DONT_CACHE:
+		case SHADE: case DONT_SHADE: case EMIT_SFX:
+		case PUSH_CONSTANT: case PUSH_LOCAL_VAR: case PUSH_STATIC:
+		case POP_LOCAL_VAR: case POP_STATIC:
+		case JUMP: case JUMP_NOT_EQUAL:
+		case EXPLODE: case PLAY_SOUND:
+			return 1;
+	}
+
+	return 0;
+}
+
+bool CobCompare(int opcode, int r1, int r2)
+{
+	switch (opcode) {
+		case SET_LESS: return (r1 < r2);
+		case SET_LESS_OR_EQUAL: return (r1 <= r2);
+		case SET_GREATER: return (r1 > r2);
+		case SET_GREATER_OR_EQUAL: return (r1 >= r2);
+		case SET_EQUAL: return (r1 == r2);
+		case SET_NOT_EQUAL: return (r1 != r2);
+	}
+
+	return false;
+}
+
+static inline bool IsCobCompare(int opcode)
+{
+	switch (opcode) {
+		case SET_LESS: case SET_LESS_OR_EQUAL:
+		case SET_GREATER: case SET_GREATER_OR_EQUAL:
+		case SET_EQUAL: case SET_NOT_EQUAL:
+			return true;
+	}
+
+	return false;
+}
+
+
+static CobOpcodeIndex GetSuperInstruction(const int* code, int pc, int end)
+{
+	const int opcode = code[pc];
+
+	if (opcode == PUSH_CONSTANT) {
+		if ((pc + 3) <= end && code[pc + 2] == SLEEP)
+			return COBOP_PUSHC_SLEEP;
+
+		if ((pc + 7) <= end && code[pc + 2] == PUSH_CONSTANT) {
+			if (code[pc + 4] == TURN) return COBOP_PUSHC_PUSHC_TURN;
+			if (code[pc + 4] == MOVE) return COBOP_PUSHC_PUSHC_MOVE;
+		}
+
+		return COBOP_UNKNOWN;
+	}
+
+	if (opcode == PUSH_LOCAL_VAR || opcode == PUSH_STATIC) {
+		if ((pc + 7) > end)
+			return COBOP_UNKNOWN;
+		if (code[pc + 2] != PUSH_CONSTANT || !IsCobCompare(code[pc + 4]) || code[pc + 5] != JUMP_NOT_EQUAL)
+			return COBOP_UNKNOWN;
+
+		return ((opcode == PUSH_LOCAL_VAR)? COBOP_PUSHL_PUSHC_CMP_JNE: COBOP_PUSHS_PUSHC_CMP_JNE);
+	}
+
+	return COBOP_UNKNOWN;
+}
+
+
+void DecodeCobCode(
+	const int* code,
+	int codeSize,
+	const std::vector<int>& scriptOffsets,
+	const std::vector<int>& scriptLengths,
+	const std::vector<std::string>& scriptNames,
+	std::vector<unsigned char>& opcodeIndices,
+	bool fuse
+) {
+	opcodeIndices.resize(codeSize);
+
+	for (int pc = 0; pc < codeSize; pc++) {
+		opcodeIndices[pc] = GetCobOpcodeIndex(code[pc]);
+
+		if (code[pc] != CALL || (pc + 1) >= codeSize)
+			continue;
+
+		const int scriptNum = code[pc + 1];
+
+		if (scriptNum >= 0 && size_t(scriptNum) < scriptNames.size() && scriptNames[scriptNum].find("lua_") == 0) {
+			opcodeIndices[pc] = COBOP_LUA_CALL;
+		}
+	}
+
+	if (!fuse)
+		return;
+
+	for (size_t n = 0; n < scriptOffsets.size(); n++) {
+		const int end = std::min(codeSize, scriptOffsets[n] + scriptLengths[n]);
+
+		for (int pc = std::max(0, scriptOffsets[n]); pc < end; pc += (1 + GetCobOpcodeNumArgs(code[pc]))) {
+			const CobOpcodeIndex superInstr = GetSuperInstruction(code, pc, end);
+
+			if (superInstr != COBOP_UNKNOWN)
+				opcodeIndices[pc] = superInstr;
+		}
+	}
+}
@@ -0,0 +1,166 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef COB_OPCODES_H
+#define COB_OPCODES_H
+
+#include <string>
+#include <vector>
+
+// Command documentation from http://visualta.tauniverse.com/Downloads/cob-commands.txt
+// And some information from basm0.8 source (basm ops.txt)
+
+// Model interaction
+const int MOVE       = 0x10001000;
+const int TURN       = 0x10002000;
+const int SPIN       = 0x10003000;
+const int STOP_SPIN  = 0x10004000;
+const int SHOW       = 0x10005000;
+const int HIDE       = 0x10006000;
+const int CACHE      = 0x10007000;
+const int DONT_CACHE = 0x10008000;
+const int MOVE_NOW   = 0x1000B000;
+const int TURN_NOW   = 0x1000C000;
+const int SHADE      = 0x1000D000;
+const int DONT_SHADE = 0x1000E000;
+const int EMIT_SFX   = 0x1000F000;
+
+// Blocking operations
+const int WAIT_TURN  = 0x10011000;
+const int WAIT_MOVE  = 0x10012000;
+const int SLEEP      = 0x10013000;
+
+// Stack manipulation
+const int PUSH_CONSTANT    = 0x10021001;
+const int PUSH_LOCAL_VAR   = 0x10021002;
+const int PUSH_STATIC      = 0x10021004;
+const int CREATE_LOCAL_VAR = 0x10022000;
+const int POP_LOCAL_VAR    = 0x10023002;
+const int POP_STATIC       = 0x10023004;
+const int POP_STACK        = 0x10024000; ///< Not sure what this is supposed to do
+
+// Arithmetic operations
+const int ADD         = 0x10031000;
+const int SUB         = 0x10032000;
+const int MUL         = 0x10033000;
+const int DIV         = 0x10034000;
+const int MOD		  = 0x10034001; ///< spring specific
+const int BITWISE_AND = 0x10035000;
+const int BITWISE_OR  = 0x10036000;
+const int BITWISE_XOR = 0x10037000;
+const int BITWISE_NOT = 0x10038000;
+
+// Native function calls
+const int RAND           = 0x10041000;
+const int GET_UNIT_VALUE = 0x10042000;
+const int GET            = 0x10043000;
+
+// Comparison
+const int SET_LESS             = 0x10051000;
+const int SET_LESS_OR_EQUAL    = 0x10052000;
+const int SET_GREATER          = 0x10053000;
+const int SET_GREATER_OR_EQUAL = 0x10054000;
+const int SET_EQUAL            = 0x10055000;
+const int SET_NOT_EQUAL        = 0x10056000;
+const int LOGICAL_AND          = 0x10057000;
+const int LOGICAL_OR           = 0x10058000;
+const int LOGICAL_XOR          = 0x10059000;
+const int LOGICAL_NOT          = 0x1005A000;
+
+// Flow control
+const int START           = 0x10061000;
+const int CALL            = 0x10062000; ///< converted when decoded
+const int REAL_CALL       = 0x10062001; ///< spring custom
+const int LUA_CALL        = 0x10062002; ///< spring custom
+const int JUMP            = 0x10064000;
+const int RETURN          = 0x10065000;
+const int JUMP_NOT_EQUAL  = 0x10066000;
+const int SIGNAL          = 0x10067000;
+const int SET_SIGNAL_MASK = 0x10068000;
+
+// Piece destruction
+const int EXPLODE    = 0x10071000;
+const int PLAY_SOUND = 0x10072000;
+
+// Special functions
+const int SET    = 0x10082000;
+const int ATTACH = 0x10083000;
+const int DROP   = 0x10084000;
+
+
+/**
+ * Dense opcode indices the interpreter dispatches on (a switch over these
+ * compiles to a single jump-table), see DecodeCobCode. Indices past
+ * COBOP_DROP are superinstructions: common sequences of instructions
+ * executed in one step, their operands are read from the original words.
+ */
+enum CobOpcodeIndex {
+	COBOP_UNKNOWN = 0,
+
+	COBOP_MOVE, COBOP_TURN, COBOP_SPIN, COBOP_STOP_SPIN, COBOP_SHOW, COBOP_HIDE,
+	COBOP_CACHE, COBOP_DONT_CACHE, COBOP_MOVE_NOW, COBOP_TURN_NOW, COBOP_SHADE,
+	COBOP_DONT_SHADE, COBOP_EMIT_SFX,
+
+	COBOP_WAIT_TURN, COBOP_WAIT_MOVE, COBOP_SLEEP,
+
+	COBOP_PUSH_CONSTANT, COBOP_PUSH_LOCAL_VAR, COBOP_PUSH_STATIC, COBOP_CREATE_LOCAL_VAR,
+	COBOP_POP_LOCAL_VAR, COBOP_POP_STATIC, COBOP_POP_STACK,
+
+	COBOP_ADD, COBOP_SUB, COBOP_MUL, COBOP_DIV, COBOP_MOD,
+	COBOP_BITWISE_AND, COBOP_BITWISE_OR, COBOP_BITWISE_XOR, COBOP_BITWISE_NOT,
+
+	COBOP_RAND, COBOP_GET_UNIT_VALUE, COBOP_GET,
+
+	COBOP_SET_LESS, COBOP_SET_LESS_OR_EQUAL, COBOP_SET_GREATER, COBOP_SET_GREATER_OR_EQUAL,
+	COBOP_SET_EQUAL, COBOP_SET_NOT_EQUAL,
+	COBOP_LOGICAL_AND, COBOP_LOGICAL_OR, COBOP_LOGICAL_XOR, COBOP_LOGICAL_NOT,
+
+	COBOP_START, COBOP_REAL_CALL, COBOP_LUA_CALL, COBOP_JUMP, COBOP_RETURN,
+	COBOP_JUMP_NOT_EQUAL, COBOP_SIGNAL, COBOP_SET_SIGNAL_MASK,
+
+	COBOP_EXPLODE, COBOP_PLAY_SOUND,
+
+	COBOP_SET, COBOP_ATTACH, COBOP_DROP,
+
+	/// push constant, sleep
+	COBOP_PUSHC_SLEEP,
+	/// push constant, push constant, turn
+	COBOP_PUSHC_PUSHC_TURN,
+	/// push constant, push constant, move
+	COBOP_PUSHC_PUSHC_MOVE,
+	/// push local, push constant, compare, jump if false
+	COBOP_PUSHL_PUSHC_CMP_JNE,
+	/// push static, push constant, compare, jump if false
+	COBOP_PUSHS_PUSHC_CMP_JNE,
+
+	COBOP_COUNT
+};
+
+
+/// @return the dense index of a raw (undecoded) opcode, COBOP_UNKNOWN if invalid
+CobOpcodeIndex GetCobOpcodeIndex(int opcode);
+/// @return the number of operand words following a raw opcode
+int GetCobOpcodeNumArgs(int opcode);
+/// @return the result of one of the SET_* comparison opcodes, false for other opcodes
+bool CobCompare(int opcode, int r1, int r2);
+
+/**
+ * Translates every word of <code> into its dense opcode index.
+ *
+ * Each script is walked from its offset instruction by instruction; words
+ * that are operands still get the index their value would have as opcode,
+ * so jumping anywhere behaves exactly as with the raw code. CALL is
+ * resolved to REAL_CALL or LUA_CALL (by the "lua_" name prefix), and the
+ * first word of a recognized instruction sequence gets the index of its
+ * superinstruction (unless <fuse> is false).
+ */
+void DecodeCobCode(
+	const int* code,
+	int codeSize,
+	const std::vector<int>& scriptOffsets,
+	const std::vector<int>& scriptLengths,
+	const std::vector<std::string>& scriptNames,
+	std::vector<unsigned char>& opcodeIndices,
+	bool fuse = true
+);
+
+#endif // COB_OPCODES_H
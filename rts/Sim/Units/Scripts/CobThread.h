@@ -12,6 +12,7 @@
 
 class CCobFile;
 class CCobInstance;
+template<typename T> class CCobTimerWheel;
 
 
 class CCobThread : public CObject, public CUnitScript::IAnimListener
@@ -48,7 +49,7 @@ public:
 	 */
 	int GetStackVal(int pos);
 	const std::string& GetName();
-	int GetWakeTime() const;
+	int GetWakeTime() const { return wakeTime; }
 	/**
 	 * Shows an errormessage which includes the current state of the script
 	 * interpreter.
@@ -70,7 +71,6 @@ protected:
 	int wakeTime;
 	int PC;
 	vector<int> stack;
-	vector<int> execTrace;
 
 	int paramCount;
 	int retCode;
@@ -88,6 +88,10 @@ protected:
 	void* cbParam1;
 	void* cbParam2;
 
+	friend class CCobTimerWheel<CCobThread>;
+	/// next thread in the same slot of the scheduler's timer wheel
+	CCobThread* wheelNext;
+
 public:
 	enum State {Init, Sleep, Run, Dead, WaitTurn, WaitMove};
 	State state;
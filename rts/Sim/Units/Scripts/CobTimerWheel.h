@@ -0,0 +1,257 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef COB_TIMER_WHEEL_H
+#define COB_TIMER_WHEEL_H
+
+#include <cstddef>
+
+/**
+ * Hierarchical timer wheel holding the sleeping threads of the cob engine.
+ *
+ * Items are linked intrusively: T has to provide a member <T* wheelNext>
+ * (only used by the wheel) and <int GetWakeTime() const>. Inserting an
+ * item is O(1); level 0 has a slot for every millisecond, the higher
+ * levels cover 64 times the range of the level below with slots that are
+ * moved down (cascaded) when the wheel reaches them, items waking up
+ * more than LEVEL_RANGE(NUM_LEVELS - 1) ms into the future wait in an
+ * overflow list that is cascaded every time the top level wraps around.
+ *
+ * Items are popped in order of wake time, items with equal wake times in
+ * the order they were inserted. Items cascaded into a slot were inserted
+ * further ahead of their wake time and thus always before any item with
+ * the same wake time that is already in the slot, so they go in front.
+ */
+template<typename T>
+class CCobTimerWheel
+{
+public:
+	CCobTimerWheel(): curTime(0), numItems(0) {}
+
+	bool empty() const { return (numItems == 0); }
+	size_t size() const { return numItems; }
+
+	/// items waking up before <time> will be popped by the next PopExpired call
+	void Insert(T* item) {
+		numItems++;
+
+		const int wakeTime = item->GetWakeTime();
+
+		if (wakeTime < curTime) {
+			InsertLate(item);
+		} else {
+			GetSlot(wakeTime).PushBack(item);
+		}
+	}
+
+	/**
+	 * Removes and returns the next item that woke up before <time>, or NULL
+	 * once there are no more. <time> may not decrease between calls, items
+	 * inserted between calls (even with a wake time that already passed)
+	 * are taken into account.
+	 */
+	T* PopExpired(int time) {
+		if (numItems == 0) {
+			// nothing to cascade either
+			if (curTime < time)
+				curTime = time;
+
+			return NULL;
+		}
+
+		while (true) {
+			T* item = lateItems.PopFront();
+
+			if (item == NULL) {
+				if (curTime >= time)
+					return NULL;
+
+				item = level0Slots[curTime & LEVEL0_MASK].PopFront();
+			}
+
+			if (item != NULL) {
+				numItems--;
+				return item;
+			}
+
+			// the current millisecond is done
+			curTime++;
+
+			if ((curTime & LEVEL0_MASK) == 0)
+				Cascade();
+		}
+	}
+
+	/// removes and returns any item, NULL if the wheel is empty
+	T* PopAny() {
+		if (numItems == 0)
+			return NULL;
+
+		T* item = lateItems.PopFront();
+
+		for (int level = 0; level < NUM_LEVELS && item == NULL; level++) {
+			for (int n = 0; n < LEVEL_SIZE(level) && item == NULL; n++) {
+				item = GetLevelSlot(level, n).PopFront();
+			}
+		}
+
+		if (item == NULL)
+			item = overflowItems.PopFront();
+
+		numItems--;
+		return item;
+	}
+
+private:
+	static const int NUM_LEVELS = 4;
+	static const int LEVEL0_BITS = 8;
+	static const int LEVELN_BITS = 6;
+	static const int LEVEL0_MASK = (1 << LEVEL0_BITS) - 1;
+	static const int LEVELN_MASK = (1 << LEVELN_BITS) - 1;
+
+	/// number of slots on <level>
+	static int LEVEL_SIZE(int level) { return ((level == 0)? (1 << LEVEL0_BITS): (1 << LEVELN_BITS)); }
+	/// number of low bits of a wake time that are covered by the levels below <level>
+	static int LEVEL_SHIFT(int level) { return ((level == 0)? 0: (LEVEL0_BITS + (level - 1) * LEVELN_BITS)); }
+	/// how far ahead (in ms) <level> reaches
+	static int LEVEL_RANGE(int level) { return (1 << (LEVEL0_BITS + level * LEVELN_BITS)); }
+
+	struct Slot {
+		Slot(): head(NULL), tail(NULL) {}
+
+		bool empty() const { return (head == NULL); }
+
+		void PushBack(T* item) {
+			item->wheelNext = NULL;
+
+			if (tail == NULL) {
+				head = item;
+			} else {
+				tail->wheelNext = item;
+			}
+
+			tail = item;
+		}
+		void PushFront(T* item) {
+			item->wheelNext = head;
+			head = item;
+
+			if (tail == NULL)
+				tail = item;
+		}
+		T* PopFront() {
+			T* item = head;
+
+			if (item != NULL) {
+				head = item->wheelNext;
+				item->wheelNext = NULL;
+
+				if (head == NULL)
+					tail = NULL;
+			}
+
+			return item;
+		}
+		/// takes all items out, the returned chain is linked in reverse order
+		T* DetachReversed() {
+			T* reversed = NULL;
+
+			while (head != NULL) {
+				T* next = head->wheelNext;
+				head->wheelNext = reversed;
+				reversed = head;
+				head = next;
+			}
+
+			tail = NULL;
+			return reversed;
+		}
+
+		T* head;
+		T* tail;
+	};
+
+	Slot& GetLevelSlot(int level, int n) {
+		return ((level == 0)? level0Slots[n]: levelNSlots[level - 1][n]);
+	}
+	/// @return the slot an item waking up at <wakeTime> (>= curTime) belongs into
+	Slot& GetSlot(int wakeTime) {
+		const int delta = wakeTime - curTime;
+
+		for (int level = 0; level < NUM_LEVELS; level++) {
+			if (delta < LEVEL_RANGE(level)) {
+				const int mask = (level == 0)? LEVEL0_MASK: LEVELN_MASK;
+				return GetLevelSlot(level, (wakeTime >> LEVEL_SHIFT(level)) & mask);
+			}
+		}
+
+		return overflowItems;
+	}
+
+	/// keeps the items that are overdue sorted by wake time
+	void InsertLate(T* item) {
+		const int wakeTime = item->GetWakeTime();
+
+		if (lateItems.empty() || lateItems.tail->GetWakeTime() <= wakeTime) {
+			lateItems.PushBack(item);
+			return;
+		}
+		if (lateItems.head->GetWakeTime() > wakeTime) {
+			lateItems.PushFront(item);
+			return;
+		}
+
+		T* prev = lateItems.head;
+
+		while (prev->wheelNext->GetWakeTime() <= wakeTime) {
+			prev = prev->wheelNext;
+		}
+
+		item->wheelNext = prev->wheelNext;
+		prev->wheelNext = item;
+	}
+
+	/// moves the items of <slot> to the slots matching their wake time, keeping their order
+	void Redistribute(Slot& slot) {
+		// pushing them in front in reverse order puts them before all
+		// items with the same wake time that are already in the target
+		T* item = slot.DetachReversed();
+
+		while (item != NULL) {
+			T* next = item->wheelNext;
+			GetSlot(item->GetWakeTime()).PushFront(item);
+			item = next;
+		}
+	}
+
+	/**
+	 * Called whenever curTime reaches a multiple of the level 0 range.
+	 * The lower levels go first: items of a higher level that move all
+	 * the way down are older than those already moved down from a lower
+	 * one, and never land in a slot that was cascaded before them.
+	 */
+	void Cascade() {
+		int level = 1;
+
+		for (; level < NUM_LEVELS; level++) {
+			Redistribute(GetLevelSlot(level, (curTime >> LEVEL_SHIFT(level)) & LEVELN_MASK));
+
+			if ((curTime & (LEVEL_RANGE(level) - 1)) != 0)
+				return;
+		}
+
+		Redistribute(overflowItems);
+	}
+
+private:
+	/// all items waking up before curTime have been popped (except lateItems)
+	int curTime;
+	size_t numItems;
+
+	Slot level0Slots[1 << LEVEL0_BITS];
+	Slot levelNSlots[NUM_LEVELS - 1][1 << LEVELN_BITS];
+	Slot overflowItems;
+	/// items that were inserted with a wake time before curTime
+	Slot lateItems;
+};
+
+#endif // COB_TIMER_WHEEL_H
@@ -73,6 +73,7 @@ CUnitScript::CUnitScript(CUnit* unit, const std::vector<LocalModelPiece*>& piece
 	: unit(unit)
 	, yardOpen(false)
 	, busy(false)
+	, nextAnimID(0)
 	, hasSetSFXOccupy(false)
 	, hasRockUnit(false)
 	, hasStartBuilding(false)
@@ -84,19 +85,9 @@ CUnitScript::CUnitScript(CUnit* unit, const std::vector<LocalModelPiece*>& piece
 
 CUnitScript::~CUnitScript()
 {
-	bool haveAnimations = false;
-
-	for (int animType = ATurn; animType <= AMove; animType++) {
-		for (std::list<AnimInfo*>::iterator i = anims[animType].begin(); i != anims[animType].end(); ++i) {
-			// anim listeners are not owned by the anim in general, so don't delete them here
-			delete *i;
-		}
-
-		haveAnimations = (haveAnimations || !anims[animType].empty());
-	}
-
+	// anim listeners are not owned by the anim in general, so don't delete them here
 	// Remove us from possible animation ticking
-	if (haveAnimations)
+	if (HaveAnimations())
 		GUnitScriptEngine.RemoveInstance(this);
 }
 
@@ -106,14 +97,46 @@ CUnitScript::~CUnitScript()
 
 /**
  * @brief Unblocks all threads waiting on an animation
- * @param anim AnimInfo the corresponding animation
+ * @param anim AnimInfo the corresponding (already removed) animation
+ *
+ * Listeners are matched by the id of the animation they waited on, not
+ * by its type, piece and axis: a listener of an animation started for
+ * the same piece and axis by an earlier AnimFinished must keep waiting.
  */
-void CUnitScript::UnblockAll(AnimInfo* anim)
+void CUnitScript::UnblockAll(const AnimInfo& anim)
 {
-	std::list<IAnimListener *>::iterator li;
+	size_t numKept = 0;
+	size_t n = 0;
+
+	// nearly all animations finish without anyone waiting for them
+	for (; n < animListeners.size(); n++) {
+		const AnimListenerInfo& li = animListeners[n];
+
+		if (li.animID == anim.id)
+			break;
+	}
+
+	if (n == animListeners.size())
+		return;
+
+	// take them out before notifying them, AnimFinished can add
+	// new animations and listeners (or remove other animations)
+	std::vector<IAnimListener*> listeners;
 
-	for (li = anim->listeners.begin(); li != anim->listeners.end(); ++li) {
-		(*li)->AnimFinished(anim->type, anim->piece, anim->axis);
+	for (numKept = n; n < animListeners.size(); n++) {
+		const AnimListenerInfo& li = animListeners[n];
+
+		if (li.animID == anim.id) {
+			listeners.push_back(li.listener);
+		} else {
+			animListeners[numKept++] = li;
+		}
+	}
+
+	animListeners.resize(numKept);
+
+	for (std::vector<IAnimListener*>::const_iterator li = listeners.begin(); li != listeners.end(); ++li) {
+		(*li)->AnimFinished(anim.type, anim.piece, anim.axis);
 	}
 }
 
@@ -215,53 +238,77 @@ bool CUnitScript::DoSpin(float &cur, float dest, float &speed, float accel, int
 
 
 
-void CUnitScript::TickAnims(int deltaTime, AnimType type, std::list< std::list<AnimInfo*>::iterator >& doneAnims) {
+/**
+ * @brief Advances all animations of one type, finished ones are moved
+ *        (in order) to doneAnims so their listeners can be notified
+ *        once everything has been ticked
+ */
+void CUnitScript::TickAnims(int deltaTime, AnimType type, std::vector<AnimInfo>& doneAnims) {
+	std::vector<AnimInfo>& typeAnims = anims[type];
+
+	const int tickRate = 1000 / deltaTime;
+	size_t numActive = 0;
+
+	// NOTE: we should not need to copy-and-set here, because
+	// MoveToward/TurnToward/DoSpin modify pos/rot by reference
 	switch (type) {
 		case AMove: {
-			for (std::list<AnimInfo*>::iterator it = anims[type].begin(); it != anims[type].end(); ++it) {
-				AnimInfo* ai = *it;
+			for (size_t n = 0; n < typeAnims.size(); n++) {
+				AnimInfo& ai = typeAnims[n];
+				float3 pos = pieces[ai.piece]->GetPosition();
 
-				// NOTE: we should not need to copy-and-set here, because
-				// MoveToward/TurnToward/DoSpin modify pos/rot by reference
-				float3 pos = pieces[ai->piece]->GetPosition();
+				const bool done = MoveToward(pos[ai.axis], ai.dest, ai.speed / tickRate);
 
-				if (MoveToward(pos[ai->axis], ai->dest, ai->speed / (1000 / deltaTime))) {
-					ai->done = true; doneAnims.push_back(it);
-				}
+				pieces[ai.piece]->SetPosition(pos);
 
-				pieces[ai->piece]->SetPosition(pos);
+				if (done) {
+					doneAnims.push_back(ai);
+				} else {
+					typeAnims[numActive++] = ai;
+				}
 			}
 		} break;
 
 		case ATurn: {
-			for (std::list<AnimInfo*>::iterator it = anims[type].begin(); it != anims[type].end(); ++it) {
-				AnimInfo* ai = *it;
-				float3 rot = pieces[ai->piece]->GetRotation();
+			for (size_t n = 0; n < typeAnims.size(); n++) {
+				AnimInfo& ai = typeAnims[n];
+				float3 rot = pieces[ai.piece]->GetRotation();
 
-				if (TurnToward(rot[ai->axis], ai->dest, ai->speed / (1000 / deltaTime))) {
-					ai->done = true; doneAnims.push_back(it);
-				}
+				const bool done = TurnToward(rot[ai.axis], ai.dest, ai.speed / tickRate);
+
+				pieces[ai.piece]->SetRotation(rot);
 
-				pieces[ai->piece]->SetRotation(rot);
+				if (done) {
+					doneAnims.push_back(ai);
+				} else {
+					typeAnims[numActive++] = ai;
+				}
 			}
 		} break;
 
 		case ASpin: {
-			for (std::list<AnimInfo*>::iterator it = anims[type].begin(); it != anims[type].end(); ++it) {
-				AnimInfo* ai = *it;
-				float3 rot = pieces[ai->piece]->GetRotation();
+			for (size_t n = 0; n < typeAnims.size(); n++) {
+				AnimInfo& ai = typeAnims[n];
+				float3 rot = pieces[ai.piece]->GetRotation();
 
-				if (DoSpin(rot[ai->axis], ai->dest, ai->speed, ai->accel, 1000 / deltaTime)) {
-					ai->done = true; doneAnims.push_back(it);
-				}
+				const bool done = DoSpin(rot[ai.axis], ai.dest, ai.speed, ai.accel, tickRate);
+
+				pieces[ai.piece]->SetRotation(rot);
 
-				pieces[ai->piece]->SetRotation(rot);
+				if (done) {
+					doneAnims.push_back(ai);
+				} else {
+					typeAnims[numActive++] = ai;
+				}
 			}
 		} break;
 
 		default: {
+			numActive = typeAnims.size();
 		} break;
 	}
+
+	typeAnims.resize(numActive);
 }
 
 /**
@@ -272,29 +319,25 @@ void CUnitScript::TickAnims(int deltaTime, AnimType type, std::list< std::list<A
  */
 bool CUnitScript::Tick(int deltaTime)
 {
-	typedef std::list<AnimInfo*>::iterator AnimInfoIt;
+	// finished animations, reused between calls (Tick is never re-entered)
+	static std::vector<AnimInfo> doneAnims;
 
-	// list of _iterators_ to finished animations,
-	// so we can get rid of them in constant time
-	std::list<AnimInfoIt> doneAnims;
+	doneAnims.clear();
 
 	for (int animType = ATurn; animType <= AMove; animType++) {
 		TickAnims(deltaTime, AnimType(animType), doneAnims);
 	}
 
-	//! Tell listeners to unblock, and remove finished animations from the unit/script.
+	//! Tell listeners to unblock, finished animations are already removed from the unit/script.
 	//! NOTE:
 	//!     removing a finished animation _must_ happen before notifying its listeners,
 	//!     otherwise the callback function (AnimFinished()) can call AddAnimListener()
 	//!     and append it to the listeners-list again (causing an endless loop)!
-	//! NOTE: UnblockAll might result in new anims being added
-	for (std::list<AnimInfoIt>::const_iterator it = doneAnims.begin(); it != doneAnims.end(); ++it) {
-		AnimInfoIt animInfoIt = *it;
-		AnimInfo* animInfo = *animInfoIt;
-
-		anims[animInfo->type].erase(animInfoIt);
-		UnblockAll(animInfo);
-		delete animInfo;
+	//! NOTE: UnblockAll might result in new anims being added, possibly for the
+	//!     same piece and axis as a later entry of doneAnims (they get a new id)
+	for (size_t n = 0; n < doneAnims.size(); n++) {
+		const AnimInfo ai = doneAnims[n];
+		UnblockAll(ai);
 	}
 
 	return (HaveAnimations());
@@ -302,22 +345,24 @@ bool CUnitScript::Tick(int deltaTime)
 
 
 
-std::list<CUnitScript::AnimInfo*>::iterator CUnitScript::FindAnim(AnimType type, int piece, int axis)
+int CUnitScript::FindAnim(AnimType type, int piece, int axis) const
 {
-	for (std::list<AnimInfo*>::iterator i = anims[type].begin(); i != anims[type].end(); ++i) {
-		if (((*i)->piece == piece) && ((*i)->axis == axis))
-			return i;
+	const std::vector<AnimInfo>& typeAnims = anims[type];
+
+	for (size_t n = 0; n < typeAnims.size(); n++) {
+		if ((typeAnims[n].piece == piece) && (typeAnims[n].axis == axis))
+			return n;
 	}
 
-	return anims[type].end();
+	return -1;
 }
 
-void CUnitScript::RemoveAnim(AnimType type, const std::list<AnimInfo*>::iterator& animInfoIt)
+void CUnitScript::RemoveAnim(AnimType type, int animIdx)
 {
-	if (animInfoIt != anims[type].end()) {
-		AnimInfo* ai = *animInfoIt;
-		anims[type].erase(animInfoIt);
- 
+	if (animIdx != -1) {
+		const AnimInfo ai = anims[type][animIdx];
+		anims[type].erase(anims[type].begin() + animIdx);
+
 		// If this was the last animation, remove from currently animating list
 		// FIXME: this could be done in a cleaner way
 		if (!HaveAnimations()) {
@@ -327,8 +372,6 @@ void CUnitScript::RemoveAnim(AnimType type, const std::list<AnimInfo*>::iterator
 		//! We need to unblock threads waiting on this animation, otherwise they will be lost in the void
 		//! NOTE: UnblockAll might result in new anims being added
 		UnblockAll(ai);
-
-		delete ai;
 	}
 }
 
@@ -354,8 +397,7 @@ void CUnitScript::AddAnim(AnimType type, int piece, int axis, float speed, float
 		}
 	}
 
-	std::list<AnimInfo*>::iterator animInfoIt;
-	AnimInfo* ai = NULL;
+	int animIdx = -1;
 	AnimType overrideType = ANone;
 
 	// first find an animation of a type we override
@@ -365,65 +407,66 @@ void CUnitScript::AddAnim(AnimType type, int piece, int axis, float speed, float
 	switch (type) {
 		case ATurn: {
 			overrideType = ASpin;
-			animInfoIt = FindAnim(overrideType, piece, axis);
+			animIdx = FindAnim(overrideType, piece, axis);
 		} break;
 		case ASpin: {
 			overrideType = ATurn;
-			animInfoIt = FindAnim(overrideType, piece, axis);
+			animIdx = FindAnim(overrideType, piece, axis);
 		} break;
 		case AMove: {
 			// ensure we never remove an animation of this type
 			overrideType = AMove;
-			animInfoIt = anims[overrideType].end();
+			animIdx = -1;
 		} break;
 		default: {
 		} break;
 	}
 
-	if (animInfoIt != anims[overrideType].end())
-		RemoveAnim(overrideType, animInfoIt);
+	if (animIdx != -1)
+		RemoveAnim(overrideType, animIdx);
 
 	// now find an animation of our own type
-	animInfoIt = FindAnim(type, piece, axis);
+	animIdx = FindAnim(type, piece, axis);
 
-	if (animInfoIt == anims[type].end()) {
+	if (animIdx == -1) {
 		// If we were not animating before, inform the engine of this so it can schedule us
 		// FIXME: this could be done in a cleaner way
 		if (!HaveAnimations()) {
 			GUnitScriptEngine.AddInstance(this);
 		}
 
-		ai = new AnimInfo();
-		ai->type = type;
-		ai->piece = piece;
-		ai->axis = axis;
-		anims[type].push_back(ai);
-	} else {
-		ai = *animInfoIt;
+		AnimInfo newAnim;
+		newAnim.id = nextAnimID++;
+		newAnim.type = type;
+		newAnim.piece = piece;
+		newAnim.axis = axis;
+
+		animIdx = anims[type].size();
+		anims[type].push_back(newAnim);
 	}
 
-	ai->dest  = destf;
-	ai->speed = speed;
-	ai->accel = accel;
-	ai->done = false;
+	AnimInfo& ai = anims[type][animIdx];
+	ai.dest  = destf;
+	ai.speed = speed;
+	ai.accel = accel;
 }
 
 
 void CUnitScript::Spin(int piece, int axis, float speed, float accel)
 {
-	std::list<AnimInfo*>::iterator animInfoIt = FindAnim(ASpin, piece, axis);
+	const int animIdx = FindAnim(ASpin, piece, axis);
 
 	//If we are already spinning, we may have to decelerate to the new speed
-	if (animInfoIt != anims[ASpin].end()) {
-		AnimInfo* ai = *animInfoIt;
-		ai->dest = speed;
+	if (animIdx != -1) {
+		AnimInfo& ai = anims[ASpin][animIdx];
+		ai.dest = speed;
 
 		if (accel > 0) {
-			ai->accel = accel;
+			ai.accel = accel;
 		} else {
 			//Go there instantly. Or have a defaul accel?
-			ai->speed = speed;
-			ai->accel = 0;
+			ai.speed = speed;
+			ai.accel = 0;
 		}
 	} else {
 		//No accel means we start at desired speed instantly
@@ -437,17 +480,17 @@ void CUnitScript::Spin(int piece, int axis, float speed, float accel)
 
 void CUnitScript::StopSpin(int piece, int axis, float decel)
 {
-	std::list<AnimInfo*>::iterator animInfoIt = FindAnim(ASpin, piece, axis);
+	const int animIdx = FindAnim(ASpin, piece, axis);
 
 	if (decel <= 0) {
-		RemoveAnim(ASpin, animInfoIt);
+		RemoveAnim(ASpin, animIdx);
 	} else {
-		if (animInfoIt == anims[ASpin].end())
+		if (animIdx == -1)
 			return;
 
-		AnimInfo* ai = *animInfoIt;
-		ai->dest = 0;
-		ai->accel = decel;
+		AnimInfo& ai = anims[ASpin][animIdx];
+		ai.dest = 0;
+		ai.accel = decel;
 	}
 }
 
@@ -734,29 +777,24 @@ void CUnitScript::DropUnit(int u)
 //Returns true if there was an animation to listen to
 bool CUnitScript::AddAnimListener(AnimType type, int piece, int axis, IAnimListener *listener)
 {
-	std::list<AnimInfo*>::iterator animInfoIt = FindAnim(type, piece, axis);
-
-	if (animInfoIt != anims[type].end()) {
-		AnimInfo* ai = *animInfoIt;
-
-		if (!ai->done) {
-			ai->listeners.push_back(listener);
-			return true;
-		}
-
-		// if the animation is already finished, listening for
-		// it just adds some overhead since either the current
-		// or the next Tick will remove it and call UnblockAll
-		// (which calls AnimFinished for each listener)
-		//
-		// we could notify the listener here, but a cleaner way
-		// is to treat the animation as if it did not exist and
-		// simply disregard the WaitFor* (no side-effects)
-		//
-		// listener->AnimFinished(ai->type, ai->piece, ai->axis);
-	}
-
-	return false;
+	// finished animations are removed before their listeners are
+	// notified, so listening for one from AnimFinished is treated
+	// as if it did not exist and the WaitFor* is disregarded (no
+	// side-effects)
+	const int animIdx = FindAnim(type, piece, axis);
+
+	if (animIdx == -1)
+		return false;
+
+	AnimListenerInfo li;
+	li.animID = anims[type][animIdx].id;
+	li.type = type;
+	li.axis = axis;
+	li.piece = piece;
+	li.listener = listener;
+
+	animListeners.push_back(li);
+	return true;
 }
 
 
@@ -64,30 +64,44 @@ protected:
 	bool busy;
 
 	struct AnimInfo {
+		unsigned int id;  // unique per script instance, kept when the anim is retargeted
 		AnimType type;
 		int axis;
 		int piece;
 		float speed;
 		float dest;     // means final position when turning or moving, final speed when spinning
 		float accel;    // used for spinning, can be negative
-		bool done;
-		std::list<IAnimListener*> listeners;
 	};
 
-	std::list<AnimInfo*> anims[AMove + 1];
+	struct AnimListenerInfo {
+		unsigned int animID;
+		AnimType type;
+		int axis;
+		int piece;
+		IAnimListener* listener;
+	};
+
+	// there is at most one animation per type, piece and axis; they are
+	// kept by value in contiguous arrays so Tick can sweep through them
+	std::vector<AnimInfo> anims[AMove + 1];
+	// listeners (blocked threads) of all animations, in the order they were added
+	std::vector<AnimListenerInfo> animListeners;
+	// id of the next animation that is started
+	unsigned int nextAnimID;
 
 	bool hasSetSFXOccupy;
 	bool hasRockUnit;
 	bool hasStartBuilding;
 
-	void UnblockAll(AnimInfo* anim);
+	void UnblockAll(const AnimInfo& anim);
 
 	bool MoveToward(float &cur, float dest, float speed);
 	bool TurnToward(float &cur, float dest, float speed);
 	bool DoSpin(float &cur, float dest, float &speed, float accel, int divisor);
 
-	std::list<AnimInfo*>::iterator FindAnim(AnimType anim, int piece, int axis);
-	void RemoveAnim(AnimType type, const std::list<AnimInfo*>::iterator& animInfoIt);
+	/// @return the index of the animation in anims[type], or -1
+	int FindAnim(AnimType type, int piece, int axis) const;
+	void RemoveAnim(AnimType type, int animIdx);
 	void AddAnim(AnimType type, int piece, int axis, float speed, float dest, float accel);
 
 	virtual void ShowScriptError(const std::string& msg) = 0;
@@ -141,7 +155,7 @@ public:
 	const CUnit* GetUnit() const { return unit; }
 
 	bool Tick(int deltaTime);
-	void TickAnims(int deltaTime, AnimType type, std::list< std::list<AnimInfo*>::iterator >& doneAnims);
+	void TickAnims(int deltaTime, AnimType type, std::vector<AnimInfo>& doneAnims);
 
 	// animation, used by CCobThread
 	void Spin(int piece, int axis, float speed, float accel);
@@ -165,7 +179,7 @@ public:
 	void SetUnitVal(int val, int param);
 
 	bool IsInAnimation(AnimType type, int piece, int axis) {
-		return (FindAnim(type, piece, axis) != anims[type].end());
+		return (FindAnim(type, piece, axis) != -1);
 	}
 	bool HaveAnimations() const {
 		return (!anims[ATurn].empty() || !anims[ASpin].empty() || !anims[AMove].empty());
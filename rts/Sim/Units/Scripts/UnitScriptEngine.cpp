@@ -79,7 +79,11 @@ void CUnitScriptEngine::Tick(int deltaTime)
 {
 	SCOPED_TIMER("UnitScriptEngine::Tick");
 
-	// Tick all instances that have registered themselves as animating
+	// Tick all instances that have registered themselves as animating, one
+	// at a time: the listeners of an instance (Lua's MoveFinished etc.) run
+	// before the next instance is ticked and may change its animations or
+	// pieces, so an engine-wide batch would have to re-check every instance
+	// against the state it was gathered from (which costs more than it saves)
 	for (std::list<CUnitScript*>::iterator it = animating.begin(); it != animating.end(); ) {
 		currentScript = *it;
 
@@ -1413,6 +1413,7 @@ bool CUnit::ChangeTeam(int newteam, ChangeType type)
 	uh->unitsByDefs[newteam][unitDef->id].insert(this);
 
 	neutral = false;
+	qf->MarkObjectChanged(this);
 
 	loshandler->MoveUnit(this, false);
 	losStatus[allyteam] = LOS_ALL_MASK_BITS |
@@ -1872,6 +1873,7 @@ void CUnit::KillUnit(bool selfDestruct, bool reclaimed, CUnit* attacker, bool sh
 
 	isDead = true;
 	deathSpeed = speed;
+	qf->MarkObjectChanged(this);
 
 	eventHandler.UnitDestroyed(this, attacker);
 	eoh->UnitDestroyed(*this, attacker);
@@ -2379,5 +2381,6 @@ CR_REG_METADATA(CUnit, (
 //	CR_MEMBER(expReloadScale),
 //	CR_MEMBER(expGrade),
 
+	CR_ALLOCATOR(operator new, operator delete),
 	CR_POSTLOAD(PostLoad)
 ));
@@ -17,6 +17,7 @@
 #include "Lua/LuaUnitMaterial.h"
 #include "Sim/Objects/SolidObject.h"
 #include "System/Matrix44f.h"
+#include "System/SlabPool.h"
 #include "System/Vec2.h"
 
 class CPlayer;
@@ -71,6 +72,11 @@ class CUnit : public CSolidObject
 public:
 	CR_DECLARE(CUnit)
 
+	inline void* operator new(size_t size) { return unitMemPool.Alloc(size); }
+	inline void* operator new(size_t size, void* p) { return p; } // used by creg
+	inline void operator delete(void* p, size_t size) { unitMemPool.Free(p, size); }
+	inline void operator delete(void* p, void*) {}
+
 	CUnit();
 	virtual ~CUnit();
 
@@ -221,6 +221,8 @@ float CWeapon::TargetWeight(const CUnit* targetUnit) const
 }
 
 
+// candidate buffer shared by all weapons (retargeting never nests)
+static std::vector<WeaponTarget> weaponTargets;
 
 static inline bool isBeingServicedOnPad(CUnit* u)
 {
@@ -742,14 +744,15 @@ void CWeapon::SlowUpdate(bool noAutoTargetOverride)
 	if (!noAutoTargetOverride && AllowWeaponTargetCheck()) {
 		lastTargetRetry = gs->frameNum;
 
-		std::multimap<float, CUnit*> targets;
-		std::multimap<float, CUnit*>::const_iterator targetsIt;
-
 		// NOTE:
-		//   sorts by INCREASING order of priority, so lower equals better
+		//   sorted by INCREASING order of priority, so lower equals better
 		//   <targets> can contain duplicates if a unit covers multiple quads
 		//   <targets> is normally sorted such that all bad TC units are at the
 		//   end, but Lua can mess with the ordering arbitrarily
+		//   only as much of <targets> is sorted as we look at
+		std::vector<WeaponTarget>& targets = weaponTargets;
+		size_t numSortedTargets = 0;
+
 		helper->GenerateWeaponTargets(this, targetUnit, targets);
 
 		CUnit* prevTargetUnit = NULL;
@@ -758,8 +761,10 @@ void CWeapon::SlowUpdate(bool noAutoTargetOverride)
 
 		float3 nextTargetPos = ZeroVector;
 
-		for (targetsIt = targets.begin(); targetsIt != targets.end(); ++targetsIt) {
-			CUnit* nextTargetUnit = targetsIt->second;
+		for (size_t n = 0; n < targets.size(); n++) {
+			numSortedTargets = SortWeaponTargets(targets, numSortedTargets, n);
+
+			CUnit* nextTargetUnit = targets[n].unit;
 
 			if (nextTargetUnit == prevTargetUnit)
 				continue; // filter consecutive duplicates
@@ -0,0 +1,53 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef WEAPON_TARGET_H
+#define WEAPON_TARGET_H
+
+#include <algorithm>
+#include <vector>
+#include <cstddef>
+
+class CUnit;
+
+/// candidate target generated by CGameHelper::GenerateWeaponTargets
+struct WeaponTarget {
+	WeaponTarget(): priority(0.0f), order(0), unit(NULL) {}
+	WeaponTarget(float priority, int order, CUnit* unit): priority(priority), order(order), unit(unit) {}
+
+	/**
+	 * Lower priorities are better, candidates with equal priority stay
+	 * in the order they were generated in (like in a std::multimap).
+	 */
+	bool operator < (const WeaponTarget& t) const {
+		if (priority != t.priority)
+			return (priority < t.priority);
+
+		return (order < t.order);
+	}
+
+	float priority;
+	int order;
+	CUnit* unit;
+};
+
+
+/**
+ * Makes sure the targets up to (and including) index <idx> are sorted,
+ * given that the first <numSorted> already are. Retargeting nearly always
+ * stops at one of the first few candidates, so instead of sorting all of
+ * them only a prefix is sorted which doubles in size with every call.
+ *
+ * @return the new number of sorted targets
+ */
+inline size_t SortWeaponTargets(std::vector<WeaponTarget>& targets, size_t numSorted, size_t idx)
+{
+	if (idx < numSorted)
+		return numSorted;
+
+	const size_t newNumSorted = std::min(targets.size(), std::max(idx + 1, std::max(numSorted * 2, size_t(8))));
+
+	std::partial_sort(targets.begin() + numSorted, targets.begin() + newNumSorted, targets.end());
+	return newNumSorted;
+}
+
+#endif // WEAPON_TARGET_H
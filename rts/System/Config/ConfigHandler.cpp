@@ -41,6 +41,7 @@ public:
 	bool IsSet(const string& key) const;
 	bool IsReadOnly(const string& key) const;
 	void Delete(const string& key);
+	void DeleteOverlay(const string& key);
 	string GetConfigFile() const;
 	const StringMap GetData() const;
 	void Update();
@@ -166,6 +167,11 @@ void ConfigHandlerImpl::Delete(const string& key)
 	}
 }
 
+void ConfigHandlerImpl::DeleteOverlay(const string& key)
+{
+	overlay->Delete(key);
+}
+
 bool ConfigHandlerImpl::IsSet(const string& key) const
 {
 	for_each_source_const(it) {
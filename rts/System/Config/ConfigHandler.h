@@ -108,6 +108,12 @@ public:
 	 */
 	virtual void Delete(const std::string& key) = 0;
 
+	/**
+	 * @brief Delete a config variable set with useOverlay only
+	 * @param key name of key to delete
+	 */
+	virtual void DeleteOverlay(const std::string& key) = 0;
+
 	/**
 	 * @brief Get the name of the main (first) config file
 	 */
@@ -3,6 +3,7 @@
 
 #include <list>
 #include <algorithm>
+#include <boost/bind.hpp>
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -23,7 +24,7 @@
 #include "System/CRC.h"
 #include "System/Util.h"
 #include "System/Exceptions.h"
-#include "System/OpenMP_cond.h"
+#include "System/Platform/ThreadPool.h"
 #if       !defined(DEDICATED) && !defined(UNITSYNC)
 #include "System/Platform/Watchdog.h"
 #endif // !defined(DEDICATED) && !defined(UNITSYNC)
@@ -676,6 +677,19 @@ struct CRCPair {
 	unsigned int dataCRC;
 };
 
+static void CalcFileCRCs(IArchive* ar, std::vector<CRCPair>* crcs, int i)
+{
+	CRCPair& crcp = (*crcs)[i];
+	const unsigned int nameCRC = CRC().Update(crcp.filename->data(), crcp.filename->size()).GetDigest();
+	const unsigned fid = ar->FindFile(*crcp.filename);
+	const unsigned int dataCRC = ar->GetCrc32(fid);
+	crcp.nameCRC = nameCRC;
+	crcp.dataCRC = dataCRC;
+#if !defined(DEDICATED) && !defined(UNITSYNC)
+	Watchdog::ClearTimer(WDT_MAIN);
+#endif
+}
+
 /**
  * Get CRC of the data in the specified archive.
  * Returns 0 if file could not be opened.
@@ -712,7 +726,7 @@ unsigned int CArchiveScanner::GetCRC(const std::string& arcName)
 	//! Sort by FileName
 	files.sort();
 
-	//! Push the filenames into a std::vector, cause OMP can better iterate over those
+	//! Push the filenames into a std::vector, cause parallel_for can better iterate over those
 	std::vector<CRCPair> crcs;
 	crcs.reserve(files.size());
 	CRCPair crcp;
@@ -726,19 +740,7 @@ unsigned int CArchiveScanner::GetCRC(const std::string& arcName)
 	//!       it has to load the full file to calc it! For the other formats (sd7, sdz, sdp) the CRC is saved
 	//!       in the metainformation of the container and so the loading is much faster. Neither does any of our
 	//!       current (2011) packing libraries support multithreading :/
-	int i;
-	#pragma omp parallel for private(i)
-	for (i=0; i<crcs.size(); ++i) {
-		CRCPair& crcp = crcs[i];
-		const unsigned int nameCRC = CRC().Update(crcp.filename->data(), crcp.filename->size()).GetDigest();
-		const unsigned fid = ar->FindFile(*crcp.filename);
-		const unsigned int dataCRC = ar->GetCrc32(fid);
-		crcp.nameCRC = nameCRC;
-		crcp.dataCRC = dataCRC;
-	#if !defined(DEDICATED) && !defined(UNITSYNC)
-		Watchdog::ClearTimer(WDT_MAIN);
-	#endif
-	}
+	ThreadPool::parallel_for(0, crcs.size(), boost::bind(&CalcFileCRCs, ar, &crcs, _1));
 
 	//! Add file CRCs to the main archive CRC
 	for (std::vector<CRCPair>::iterator it = crcs.begin(); it != crcs.end(); ++it) {
@@ -118,6 +118,13 @@ bool CVFSHandler::RemoveArchive(const std::string& archiveName)
 	return true;
 }
 
+bool CVFSHandler::HasArchive(const std::string& archiveName) const
+{
+	const std::map<std::string, IArchive*>::const_iterator it = archives.find(archiveName);
+
+	return (it != archives.end() && it->second != NULL);
+}
+
 CVFSHandler::~CVFSHandler()
 {
 	LOG_L(L_DEBUG, "CVFSHandler::~CVFSHandler()");
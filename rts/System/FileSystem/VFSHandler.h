@@ -73,6 +73,9 @@ public:
 	 */
 	bool RemoveArchive(const std::string& archiveName);
 
+	/// @return whether the archive is currently loaded
+	bool HasArchive(const std::string& archiveName) const;
+
 protected:
 	struct FileData {
 		IArchive* ar;
@@ -22,6 +22,7 @@
 #include "Sim/Misc/CategoryHandler.h"
 #include "Sim/Misc/TeamHandler.h"
 #include "Sim/Misc/Wind.h"
+#include "Sim/Path/IPathManager.h"
 #include "Sim/Projectiles/ProjectileHandler.h"
 #include "Sim/Units/CommandAI/BuilderCAI.h"
 #include "Sim/Units/Groups/GroupHandler.h"
@@ -96,6 +97,7 @@ void CGameStateCollector::Serialize(creg::ISerializer& s)
 	s.SerializeObjectInstance(CCategoryHandler::Instance(), CCategoryHandler::Instance()->GetClass());
 	s.SerializeObjectInstance(uh, uh->GetClass());
 	s.SerializeObjectInstance(ph, ph->GetClass());
+	s.SerializeObjectInstance(pathManager, pathManager->GetClass());
 //	std::map<std::string, int> unitRestrictions;
 	s.SerializeObjectInstance(&waitCommandsAI, waitCommandsAI.GetClass());
 	s.SerializeObjectInstance(&wind, wind.GetClass());
@@ -10,10 +10,15 @@
 
 #include <limits.h>
 #include <stdexcept>
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <zlib.h>
 
 CDemoReader::CDemoReader(const std::string& filename, float curTime)
+	: blocksEnd(0)
+	, nextBlockPos(0)
+	, blockReadPos(0)
 {
 	playbackDemo.open(filename.c_str(), std::ios::binary);
 
@@ -26,7 +31,7 @@ CDemoReader::CDemoReader(const std::string& filename, float curTime)
 	fileHeader.swab();
 
 	if (memcmp(fileHeader.magic, DEMOFILE_MAGIC, sizeof(fileHeader.magic))
-		|| fileHeader.version != DEMOFILE_VERSION
+		|| (fileHeader.version != DEMOFILE_VERSION && fileHeader.version != DEMOFILE_VERSION_COMPRESSED)
 		|| fileHeader.headerSize != sizeof(fileHeader)
 		|| fileHeader.playerStatElemSize != sizeof(PlayerStatistics)
 		|| fileHeader.teamStatElemSize != sizeof(TeamStatistics)
@@ -47,25 +52,40 @@ CDemoReader::CDemoReader(const std::string& filename, float curTime)
 		delete[] buf;
 	}
 
-	playbackDemo.read((char*)&chunkHeader, sizeof(chunkHeader));
-	chunkHeader.swab();
-
-	demoTimeOffset = curTime - chunkHeader.modGameTime - 0.1f;
-	nextDemoReadTime = curTime - 0.01f;
+	demoStreamStart = playbackDemo.tellg();
 
 	if (fileHeader.demoStreamSize != 0) {
-		bytesRemaining = fileHeader.demoStreamSize;
+		demoStreamEnd = demoStreamStart + fileHeader.demoStreamSize;
 	}
 	else {
 		// Spring crashed while recording the demo: replay until EOF,
 		// but at most filesize bytes to block watching demo of running game.
 		// For this we must determine the file size.
 		// (if this had still used CFileHandler that would have been easier ;-))
-		long curPos = playbackDemo.tellg();
 		playbackDemo.seekg(0, std::ios::end);
- 		bytesRemaining = (long) playbackDemo.tellg() - curPos;
- 		playbackDemo.seekg(curPos);
+		demoStreamEnd = playbackDemo.tellg();
+		playbackDemo.seekg(demoStreamStart);
 	}
+
+	if (IsCompressed()) {
+		ReadBlockIndex(filename);
+		RewindStream();
+	}
+
+	const bool haveChunk = ReadStream((char*)&chunkHeader, sizeof(chunkHeader));
+	chunkHeader.swab();
+
+	demoTimeOffset = curTime - chunkHeader.modGameTime - 0.1f;
+	nextDemoReadTime = curTime - 0.01f;
+
+	if (fileHeader.demoStreamSize != 0) {
+		bytesRemaining = fileHeader.demoStreamSize;
+	} else {
+		bytesRemaining = demoStreamEnd - demoStreamStart - sizeof(chunkHeader);
+	}
+
+	if (!haveChunk)
+		EndStream();
 }
 
 netcode::RawPacket* CDemoReader::GetData(float readTime)
@@ -78,12 +98,23 @@ netcode::RawPacket* CDemoReader::GetData(float readTime)
 	// check needed
 	if (readTime > nextDemoReadTime) {
 		netcode::RawPacket* buf = new netcode::RawPacket(chunkHeader.length);
-		playbackDemo.read((char*)(buf->data), chunkHeader.length);
+
+		if (!ReadStream((char*)(buf->data), chunkHeader.length)) {
+			// truncated or corrupt, treat it as the end of the demo
+			delete buf;
+			EndStream();
+			return NULL;
+		}
+
 		bytesRemaining -= chunkHeader.length;
 
 		if (!ReachedEnd()) {
 			// read next chunk header
-			playbackDemo.read((char*)&chunkHeader, sizeof(chunkHeader));
+			if (!ReadStream((char*)&chunkHeader, sizeof(chunkHeader))) {
+				EndStream();
+				return buf;
+			}
+
 			chunkHeader.swab();
 			nextDemoReadTime = chunkHeader.modGameTime + demoTimeOffset;
 			bytesRemaining -= sizeof(chunkHeader);
@@ -97,6 +128,10 @@ netcode::RawPacket* CDemoReader::GetData(float readTime)
 
 bool CDemoReader::ReachedEnd() const
 {
+	// chunks never span blocks, only whole blocks can be left
+	if (IsCompressed())
+		return (blockReadPos >= block.size() && (nextBlockPos + std::streamoff(sizeof(DemoStreamBlockHeader))) > blocksEnd);
+
 	if (bytesRemaining <= 0 || playbackDemo.eof())
 		return true;
 	else
@@ -149,3 +184,121 @@ void CDemoReader::LoadStats()
 
 	playbackDemo.seekg(curPos);
 }
+
+
+void CDemoReader::ReadBlockIndex(const std::string& filename)
+{
+	blocksEnd = demoStreamEnd;
+
+	// not written when Spring crashed, the blocks are read until EOF then
+	if (fileHeader.demoStreamSize == 0)
+		return;
+
+	DemoStreamIndexTrailer trailer;
+	playbackDemo.seekg(demoStreamEnd - std::streamoff(sizeof(trailer)));
+	playbackDemo.read((char*) &trailer, sizeof(trailer));
+	trailer.swab();
+
+	const std::streamoff indexSize = std::streamoff(trailer.numBlocks) * sizeof(DemoStreamIndexEntry) + sizeof(trailer);
+
+	if (!playbackDemo.good() || indexSize > (demoStreamEnd - demoStreamStart)) {
+		throw std::runtime_error(std::string("Demofile corrupt (block index): ")+filename);
+	}
+
+	blocksEnd = demoStreamEnd - indexSize;
+	blockIndex.resize(trailer.numBlocks);
+
+	if (!blockIndex.empty()) {
+		playbackDemo.seekg(blocksEnd);
+		playbackDemo.read((char*) &blockIndex[0], blockIndex.size() * sizeof(DemoStreamIndexEntry));
+	}
+
+	for (std::vector<DemoStreamIndexEntry>::iterator it = blockIndex.begin(); it != blockIndex.end(); ++it) {
+		it->swab();
+	}
+}
+
+bool CDemoReader::ReadBlock(std::streamoff pos)
+{
+	block.clear();
+	blockReadPos = 0;
+	// nothing more can be read if this one is broken
+	nextBlockPos = blocksEnd;
+
+	if ((pos + std::streamoff(sizeof(DemoStreamBlockHeader))) > blocksEnd)
+		return false;
+
+	DemoStreamBlockHeader blockHeader;
+	playbackDemo.clear();
+	playbackDemo.seekg(pos);
+	playbackDemo.read((char*) &blockHeader, sizeof(blockHeader));
+	blockHeader.swab();
+
+	const std::streamoff blockEnd = pos + sizeof(blockHeader) + blockHeader.compressedSize;
+
+	// cut off by a crash
+	if (!playbackDemo.good() || blockEnd > blocksEnd)
+		return false;
+
+	compressedBlock.resize(blockHeader.compressedSize);
+
+	if (!compressedBlock.empty())
+		playbackDemo.read(&compressedBlock[0], compressedBlock.size());
+
+	uLongf uncompressedSize = blockHeader.uncompressedSize;
+	block.resize(uncompressedSize);
+
+	if (!block.empty()) {
+		const int ret = uncompress((Bytef*) &block[0], &uncompressedSize, (const Bytef*) &compressedBlock[0], compressedBlock.size());
+
+		if (ret != Z_OK || uncompressedSize != blockHeader.uncompressedSize) {
+			block.clear();
+			return false;
+		}
+	}
+
+	nextBlockPos = blockEnd;
+	return true;
+}
+
+bool CDemoReader::ReadStream(char* data, std::streamoff size)
+{
+	if (!IsCompressed()) {
+		playbackDemo.read(data, size);
+		return playbackDemo.good();
+	}
+
+	while (size > 0) {
+		if (blockReadPos >= block.size() && !ReadBlock(nextBlockPos))
+			return false;
+
+		const size_t n = std::min(size_t(size), block.size() - blockReadPos);
+
+		memcpy(data, &block[blockReadPos], n);
+		blockReadPos += n;
+		data += n;
+		size -= n;
+	}
+
+	return true;
+}
+
+void CDemoReader::RewindStream()
+{
+	if (IsCompressed()) {
+		block.clear();
+		blockReadPos = 0;
+		nextBlockPos = demoStreamStart;
+	} else {
+		playbackDemo.clear();
+		playbackDemo.seekg(demoStreamStart);
+	}
+}
+
+void CDemoReader::EndStream()
+{
+	block.clear();
+	blockReadPos = 0;
+	nextBlockPos = blocksEnd;
+	bytesRemaining = 0;
+}
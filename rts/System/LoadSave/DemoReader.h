@@ -53,9 +53,34 @@ public:
 	/// Not needed for normal demo watching
 	void LoadStats();
 
+	/// whether the demo stream is compressed (DEMOFILE_VERSION_COMPRESSED)
+	bool IsCompressed() const { return (fileHeader.version == DEMOFILE_VERSION_COMPRESSED); }
+	/// index of the compressed blocks, empty for uncompressed or unfinished demos
+	const std::vector<DemoStreamIndexEntry>& GetBlockIndex() const { return blockIndex; }
+
 private:
+	void ReadBlockIndex(const std::string& filename);
+	bool ReadBlock(std::streamoff pos);
+	/// read <size> bytes of the (uncompressed) demo stream
+	bool ReadStream(char* data, std::streamoff size);
+	void RewindStream();
+	/// makes ReachedEnd true, for a stream that cannot be read any further
+	void EndStream();
+
 	std::ifstream playbackDemo;
 
+	std::streamoff demoStreamStart;
+	std::streamoff demoStreamEnd;
+
+	/// end of the compressed blocks, in front of the block index
+	std::streamoff blocksEnd;
+	std::streamoff nextBlockPos;
+	std::vector<DemoStreamIndexEntry> blockIndex;
+	/// the uncompressed current block
+	std::vector<char> block;
+	std::vector<char> compressedBlock;
+	size_t blockReadPos;
+
 	float demoTimeOffset;
 	float nextDemoReadTime;
 	int bytesRemaining;
@@ -9,17 +9,28 @@
 #include "System/FileSystem/FileQueryFlags.h"
 #include "System/FileSystem/FileHandler.h"
 #include "Game/GameVersion.h"
+#include "System/BaseNetProtocol.h"
 #include "Sim/Misc/TeamStatistics.h"
 #include "System/Util.h"
 #include "System/TimeUtil.h"
+#include "System/Config/ConfigHandler.h"
 
 #include "System/Log/ILog.h"
 
 #include <cassert>
 #include <cerrno>
 #include <cstring>
+#include <zlib.h>
+
+CONFIG(bool, DemoCompression).defaultValue(false)
+	.description("Write recorded demos with a compressed demo stream, which older engine versions can not read.");
+
+/// uncompressed size at which a block of a compressed demo stream is written
+static const unsigned int DEMO_BLOCK_SIZE = 256 * 1024;
 
 CDemoRecorder::CDemoRecorder(const std::string& mapName, const std::string& modName)
+	: compressed(configHandler->GetBool("DemoCompression"))
+	, numFrames(0)
 {
 	// We want this folder to exist
 	if (!FileSystem::CreateDirectory("demos"))
@@ -33,7 +44,7 @@ CDemoRecorder::CDemoRecorder(const std::string& mapName, const std::string& modN
 
 	memset(&fileHeader, 0, sizeof(DemoFileHeader));
 	strcpy(fileHeader.magic, DEMOFILE_MAGIC);
-	fileHeader.version = DEMOFILE_VERSION;
+	fileHeader.version = compressed? DEMOFILE_VERSION_COMPRESSED: DEMOFILE_VERSION;
 	fileHeader.headerSize = sizeof(DemoFileHeader);
 	STRNCPY(fileHeader.versionString, versionString.c_str(), sizeof(fileHeader.versionString) - 1);
 
@@ -52,6 +63,11 @@ CDemoRecorder::CDemoRecorder(const std::string& mapName, const std::string& modN
 
 CDemoRecorder::~CDemoRecorder()
 {
+	if (compressed) {
+		WriteBlock();
+		WriteBlockIndex();
+	}
+
 	WriteWinnerList();
 	WritePlayerStats();
 	WriteTeamStats();
@@ -73,15 +89,97 @@ void CDemoRecorder::WriteSetupText(const std::string& text)
 
 void CDemoRecorder::SaveToDemo(const unsigned char* buf, const unsigned length, const float modGameTime)
 {
+	BeginChunk(length, modGameTime);
+	WriteStreamData((const char*) buf, length);
+	EndChunk();
+
+	if (length > 0 && (buf[0] == NETMSG_NEWFRAME || buf[0] == NETMSG_KEYFRAME))
+		numFrames++;
+}
+
+void CDemoRecorder::BeginChunk(const unsigned length, const float modGameTime)
+{
+	// chunks never span blocks
+	if (compressed && blockData.size() >= DEMO_BLOCK_SIZE)
+		WriteBlock();
+
+	if (compressed && blockData.empty()) {
+		DemoStreamIndexEntry entry;
+		entry.blockOffset = fileHeader.demoStreamSize;
+		entry.frameNum = numFrames;
+		entry.modGameTime = modGameTime;
+		blockIndex.push_back(entry);
+	}
+
 	DemoStreamChunkHeader chunkHeader;
 
 	chunkHeader.modGameTime = modGameTime;
 	chunkHeader.length = length;
 	chunkHeader.swab();
-	demoStream.write((char*) &chunkHeader, sizeof(chunkHeader));
-	demoStream.write((char*) buf, length);
-	fileHeader.demoStreamSize += length + sizeof(chunkHeader);
+	WriteStreamData((const char*) &chunkHeader, sizeof(chunkHeader));
+}
+
+void CDemoRecorder::EndChunk()
+{
+	// uncompressed demos can be watched while they are recorded
+	if (!compressed)
+		demoStream.flush();
+}
+
+void CDemoRecorder::WriteStreamData(const char* data, const unsigned length)
+{
+	if (compressed) {
+		blockData.insert(blockData.end(), data, data + length);
+	} else {
+		demoStream.write(data, length);
+		fileHeader.demoStreamSize += length;
+	}
+}
+
+/** @brief Compress the chunks collected so far into a block and write it. */
+void CDemoRecorder::WriteBlock()
+{
+	if (blockData.empty())
+		return;
+
+	uLongf compressedSize = compressBound(blockData.size());
+	std::vector<Bytef> compressedData(compressedSize);
+
+	if (compress(&compressedData[0], &compressedSize, (const Bytef*) &blockData[0], blockData.size()) != Z_OK) {
+		LOG_L(L_ERROR, "[DemoRecorder::%s] failed to compress %u bytes of demo stream", __FUNCTION__, (unsigned) blockData.size());
+		compressedSize = 0;
+	}
+
+	DemoStreamBlockHeader blockHeader;
+
+	blockHeader.compressedSize = compressedSize;
+	blockHeader.uncompressedSize = (compressedSize > 0)? blockData.size(): 0;
+	blockHeader.swab();
+	demoStream.write((char*) &blockHeader, sizeof(blockHeader));
+	demoStream.write((char*) &compressedData[0], compressedSize);
+	fileHeader.demoStreamSize += sizeof(blockHeader) + compressedSize;
 	demoStream.flush();
+
+	blockData.clear();
+}
+
+/** @brief Write the block index and trailer at the end of a compressed demo stream. */
+void CDemoRecorder::WriteBlockIndex()
+{
+	for (std::vector<DemoStreamIndexEntry>::iterator it = blockIndex.begin(); it != blockIndex.end(); ++it) {
+		DemoStreamIndexEntry& entry = *it;
+		entry.swab();
+		demoStream.write((char*) &entry, sizeof(DemoStreamIndexEntry));
+	}
+
+	DemoStreamIndexTrailer trailer;
+
+	trailer.numBlocks = blockIndex.size();
+	trailer.swab();
+	demoStream.write((char*) &trailer, sizeof(trailer));
+
+	fileHeader.demoStreamSize += blockIndex.size() * sizeof(DemoStreamIndexEntry) + sizeof(trailer);
+	blockIndex.clear();
 }
 
 void CDemoRecorder::SetName(const std::string& mapname, const std::string& modname)
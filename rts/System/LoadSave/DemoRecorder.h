@@ -22,7 +22,7 @@ public:
 
 	void WriteSetupText(const std::string& text);
 	void SaveToDemo(const unsigned char* buf,const unsigned length, const float modGameTime);
-	
+
 	/**
 	@brief assign a map name for the demo file
 	When this function is called, we can rename our demo file so that
@@ -41,6 +41,12 @@ public:
 	void SetWinningAllyTeams(const std::vector<unsigned char>& winningAllyTeams);
 
 private:
+	void BeginChunk(const unsigned length, const float modGameTime);
+	void EndChunk();
+	void WriteStreamData(const char* data, const unsigned length);
+	void WriteBlock();
+	void WriteBlockIndex();
+
 	void WriteFileHeader(bool updateStreamLength = true);
 	void WritePlayerStats();
 	void WriteTeamStats();
@@ -50,6 +56,14 @@ private:
 	std::vector<PlayerStatistics> playerStats;
 	std::vector< std::vector<TeamStatistics> > teamStats;
 	std::vector<unsigned char> winningAllyTeams;
+
+	/// whether the demo stream is written in compressed blocks (DemoCompression)
+	bool compressed;
+	/// frames recorded so far
+	int numFrames;
+	/// uncompressed chunks of the current block
+	std::vector<char> blockData;
+	std::vector<DemoStreamIndexEntry> blockIndex;
 };
 
 
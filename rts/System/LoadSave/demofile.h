@@ -23,6 +23,12 @@
  */
 #define DEMOFILE_VERSION 5
 
+/**
+ * Version of demofiles with a compressed demo stream. These are laid out like
+ * DEMOFILE_VERSION demos, except for the demo stream (see DemoStreamBlockHeader).
+ */
+#define DEMOFILE_VERSION_COMPRESSED 6
+
 #pragma pack(push, 1)
 
 /**
@@ -115,6 +121,59 @@ struct DemoStreamChunkHeader
 	}
 };
 
+/**
+ * @brief Spring compressed demo stream block header
+ *
+ * In DEMOFILE_VERSION_COMPRESSED demos, the demo stream layout is as follows:
+ *
+ * - DemoStreamBlockHeader
+ * - compressedSize bytes zlib compressed chunks (DemoStreamChunkHeader and
+ *   data, as in uncompressed demos; chunks never span blocks)
+ * - DemoStreamBlockHeader
+ * - ...
+ * - Block index, one DemoStreamIndexEntry for each block
+ * - DemoStreamIndexTrailer
+ *
+ * The index is only written when the recording finished properly, i.e. not
+ * when the demoStreamSize in the DemoFileHeader is 0.
+ */
+struct DemoStreamBlockHeader
+{
+	boost::uint32_t compressedSize;   ///< Length of the compressed data following this header.
+	boost::uint32_t uncompressedSize; ///< Length of the chunks in this block.
+
+	/// Change structure from host endian to little endian or vice versa.
+	void swab() {
+		swabDWordInPlace(compressedSize);
+		swabDWordInPlace(uncompressedSize);
+	}
+};
+
+struct DemoStreamIndexEntry
+{
+	boost::uint32_t blockOffset; ///< Offset of the DemoStreamBlockHeader from the start of the demo stream.
+	int frameNum;                ///< Number of frames (NETMSG_NEWFRAME / NETMSG_KEYFRAME packets) before the block.
+	float modGameTime;           ///< Gametime of the first chunk in the block.
+
+	/// Change structure from host endian to little endian or vice versa.
+	void swab() {
+		swabDWordInPlace(blockOffset);
+		swabDWordInPlace(frameNum);
+		swabFloatInPlace(modGameTime);
+	}
+};
+
+/** The last bytes of a compressed demo stream. */
+struct DemoStreamIndexTrailer
+{
+	boost::uint32_t numBlocks;   ///< Number of DemoStreamIndexEntry in front of this.
+
+	/// Change structure from host endian to little endian or vice versa.
+	void swab() {
+		swabDWordInPlace(numBlocks);
+	}
+};
+
 #pragma pack(pop)
 
 #endif // DEMO_FILE_H
@@ -1,5 +1,6 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
+#include <assert.h>
 #include <string.h>
 #include <stdexcept>
 #include "System/mmgr.h"
@@ -31,11 +32,27 @@ RawPacket::RawPacket(const unsigned newLength)
 	}
 }
 
+RawPacket::RawPacket(boost::shared_ptr<const RawPacket> newOwner, const unsigned offset, const unsigned newLength)
+	: data(newOwner->data + offset)
+	, length(newLength)
+	, owner(newOwner)
+{
+	assert((offset + length) <= owner->length);
+}
+
 RawPacket::~RawPacket()
 {
-	if (length > 0) {
+	if (length > 0 && !owner) {
 		delete[] data;
 	}
 }
 
+boost::shared_ptr<const RawPacket> RawPacket::Slice(const boost::shared_ptr<const RawPacket>& packet, const unsigned offset, const unsigned length)
+{
+	if (offset == 0 && length == packet->length) {
+		return packet;
+	}
+	return boost::shared_ptr<const RawPacket>(new RawPacket(packet, offset, length));
+}
+
 } // namespace netcode
@@ -4,6 +4,7 @@
 #define RAW_PACKET_H
 
 #include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
 
 namespace netcode
 {
@@ -27,13 +28,36 @@ public:
 	 */
 	RawPacket(const unsigned length);
 
+	/**
+	 * @brief create a packet referencing a part of another packets data
+	 * Nothing is copied, the referenced packet is kept alive as long as
+	 * this one exists.
+	 * @param owner the packet holding the data
+	 * @param offset where the referenced data starts inside owner
+	 * @param length the length of the referenced data
+	 */
+	RawPacket(boost::shared_ptr<const RawPacket> owner, const unsigned offset, const unsigned length);
+
 	/**
 	 * @brief Free the memory
 	 */
 	~RawPacket();
 
+	/**
+	 * @brief get a part of a packet without copying its data
+	 * @return packet itself if the part covers all of it, otherwise a new
+	 *   packet referencing the part
+	 */
+	static boost::shared_ptr<const RawPacket> Slice(const boost::shared_ptr<const RawPacket>& packet, const unsigned offset, const unsigned length);
+
+	/// true if the data is owned by another packet
+	bool IsReference() const { return (owner.get() != NULL); }
+
 	unsigned char* data;
 	const unsigned length;
+
+private:
+	boost::shared_ptr<const RawPacket> owner;
 };
 
 } // namespace netcode
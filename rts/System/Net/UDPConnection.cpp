@@ -16,6 +16,7 @@
 
 #include "Socket.h"
 #include "ProtocolDef.h"
+#include "RawPacket.h"
 #include "Exception.h"
 #include "System/Config/ConfigHandler.h"
 #include "System/CRC.h"
@@ -76,8 +77,9 @@ void Chunk::UpdateChecksum(CRC& crc) const {
 
 	crc << chunkNumber;
 	crc << (unsigned int)chunkSize;
-	if (!data.empty()) {
-		crc.Update(&data[0], data.size());
+	std::vector< boost::shared_ptr<const RawPacket> >::const_iterator di;
+	for (di = data.begin(); di != data.end(); ++di) {
+		crc.Update((*di)->data, (*di)->length);
 	}
 }
 
@@ -123,9 +125,12 @@ public:
 		pos += sizeof(t);
 	}
 
-	void Unpack(std::vector<uint8_t>& t, unsigned unpackLength) {
-		std::copy(data + pos, data + pos + unpackLength, std::back_inserter(t));
-		pos += unpackLength;
+	void Skip(unsigned skipLength) {
+		pos += skipLength;
+	}
+
+	unsigned Position() const {
+		return pos;
 	}
 
 	unsigned Remaining() const {
@@ -157,13 +162,17 @@ public:
 		std::copy(_data.begin(), _data.end(), std::back_inserter(data));
 	}
 
+	void Pack(const RawPacket& _data) {
+		std::copy(_data.data, _data.data + _data.length, std::back_inserter(data));
+	}
+
 private:
 	std::vector<uint8_t>& data;
 };
 
-Packet::Packet(const unsigned char* data, unsigned length)
+Packet::Packet(boost::shared_ptr<const RawPacket> data)
 {
-	Unpacker buf(data, length);
+	Unpacker buf(data->data, data->length);
 	buf.Unpack(lastContinuous);
 	buf.Unpack(nakType);
 	buf.Unpack(checksum);
@@ -187,7 +196,10 @@ Packet::Packet(const unsigned char* data, unsigned length)
 		buf.Unpack(temp->chunkNumber);
 		buf.Unpack(temp->chunkSize);
 		if (buf.Remaining() >= temp->chunkSize) {
-			buf.Unpack(temp->data, temp->chunkSize);
+			if (temp->chunkSize > 0) {
+				temp->data.push_back(RawPacket::Slice(data, buf.Position(), temp->chunkSize));
+				buf.Skip(temp->chunkSize);
+			}
 			chunks.push_back(temp);
 		} else {
 			// defective, ignore
@@ -214,7 +226,10 @@ void Packet::Serialize(std::vector<uint8_t>& data)
 	for (ci = chunks.begin(); ci != chunks.end(); ++ci) {
 		buf.Pack((*ci)->chunkNumber);
 		buf.Pack((*ci)->chunkSize);
-		buf.Pack((*ci)->data);
+		std::vector< boost::shared_ptr<const RawPacket> >::const_iterator di;
+		for (di = (*ci)->data.begin(); di != (*ci)->data.end(); ++di) {
+			buf.Pack(**di);
+		}
 	}
 }
 
@@ -266,8 +281,7 @@ void UDPConnection::InitConnection(ip::udp::endpoint address, boost::shared_ptr<
 
 UDPConnection::~UDPConnection()
 {
-	delete fragmentBuffer;
-	fragmentBuffer = NULL;
+	fragmentBuffer.reset();
 	Flush(true);
 }
 
@@ -321,12 +335,13 @@ void UDPConnection::Update()
 		netservice.poll();
 		size_t bytes_avail = 0;
 		while ((bytes_avail = mySocket->available()) > 0) {
-			std::vector<uint8_t> buffer(bytes_avail);
+			RawPacket* buffer = new RawPacket(bytes_avail);
+			boost::shared_ptr<const RawPacket> bufferPtr(buffer);
 			ip::udp::endpoint sender_endpoint;
 			size_t bytesReceived;
 			ip::udp::socket::message_flags flags = 0;
 			boost::system::error_code err;
-			bytesReceived = mySocket->receive_from(boost::asio::buffer(buffer), sender_endpoint, flags, err);
+			bytesReceived = mySocket->receive_from(boost::asio::buffer(buffer->data, bytes_avail), sender_endpoint, flags, err);
 
 			if (CheckErrorCode(err)) {
 				break;
@@ -335,7 +350,7 @@ void UDPConnection::Update()
 			if (bytesReceived < Packet::headerSize) {
 				continue;
 			}
-			Packet data(&buffer[0], bytesReceived);
+			Packet data(RawPacket::Slice(bufferPtr, 0, bytesReceived));
 			if (IsUsingAddress(sender_endpoint)) {
 				ProcessRawPacket(data);
 			}
@@ -414,37 +429,44 @@ void UDPConnection::ProcessRawPacket(Packet& incoming)
 			++droppedChunks;
 			continue;
 		}
-		waitingPackets.insert((*ci)->chunkNumber, new RawPacket(&(*ci)->data[0], (*ci)->data.size()));
+		waitingPackets[(*ci)->chunkNumber] = *ci;
 	}
 
 	packetMap::iterator wpi;
 	// process all in order packets that we have waiting
 	while ((wpi = waitingPackets.find(lastInOrder+1)) != waitingPackets.end()) {
-		std::vector<boost::uint8_t> buf;
+		const ChunkPtr chunk = wpi->second;
+		lastInOrder++;
+		waitingPackets.erase(wpi);
+
+		if (chunk->data.empty()) {
+			continue;
+		}
+		// chunks received by us consist of a single part of their datagram
+		boost::shared_ptr<const RawPacket> buf = chunk->data[0];
 		if (fragmentBuffer) {
-			buf.resize(fragmentBuffer->length);
 			// combine with fragment buffer
-			std::copy(fragmentBuffer->data, fragmentBuffer->data+fragmentBuffer->length, buf.begin());
-			delete fragmentBuffer;
-			fragmentBuffer = NULL;
+			// this is the only case where the received data is copied,
+			// messages completely inside a chunk reference the datagram
+			RawPacket* combined = new RawPacket(fragmentBuffer->length + buf->length);
+			std::copy(fragmentBuffer->data, fragmentBuffer->data + fragmentBuffer->length, combined->data);
+			std::copy(buf->data, buf->data + buf->length, combined->data + fragmentBuffer->length);
+			buf.reset(combined);
+			fragmentBuffer.reset();
 		}
 
-		lastInOrder++;
-		std::copy(wpi->second->data, wpi->second->data + wpi->second->length, std::back_inserter(buf));
-		waitingPackets.erase(wpi);
-
-		for (unsigned pos = 0; pos < buf.size(); ) {
-			unsigned char* bufp = &buf[pos];
-			unsigned msglength = buf.size() - pos;
+		for (unsigned pos = 0; pos < buf->length; ) {
+			const unsigned char* bufp = buf->data + pos;
+			unsigned msglength = buf->length - pos;
 
 			int pktlength = ProtocolDef::GetInstance()->PacketLength(bufp, msglength);
 			if (ProtocolDef::GetInstance()->IsValidLength(pktlength, msglength)) { // this returns false for zero/invalid pktlength
-				msgQueue.push_back(boost::shared_ptr<const RawPacket>(new RawPacket(bufp, pktlength)));
+				msgQueue.push_back(RawPacket::Slice(buf, pos, pktlength));
 				pos += pktlength;
 			} else {
 				if (pktlength >= 0) {
 					// partial packet in buffer
-					fragmentBuffer = new RawPacket(bufp, msglength);
+					fragmentBuffer = RawPacket::Slice(buf, pos, msglength);
 					break;
 				}
 				LOG_L(L_ERROR,
@@ -478,8 +500,12 @@ void UDPConnection::Flush(const bool forced)
 	}
 
 	if (forced || (!waitMore && outgoingLength > requiredLength)) {
-		boost::uint8_t buffer[udpMaxPacketSize];
+		// chunks reference the outgoing packets instead of copying them,
+		// so a packet sent to multiple connections is shared by all of them
+		std::vector< boost::shared_ptr<const RawPacket> > chunkData;
 		unsigned pos = 0;
+		/// how much of the first outgoing packet is already in a chunk
+		unsigned packetPos = 0;
 		// Manually fragment packets to respect configured UDP_MTU.
 		// This is an attempt to fix the bug where players drop out of the game if
 		// someone in the game gives a large order.
@@ -492,7 +518,7 @@ void UDPConnection::Flush(const bool forced)
 					|| partialPacket
 					|| forced;
 			if (!outgoingData.empty() && sendMore) {
-				boost::shared_ptr<const RawPacket>& packet = *(outgoingData.begin());
+				const boost::shared_ptr<const RawPacket>& packet = *(outgoingData.begin());
 				if (!partialPacket && !ProtocolDef::GetInstance()->IsValidPacket(packet->data, packet->length)) {
 					LOG_L(L_ERROR,
 							"Discarding outgoing invalid packet: ID %d, LEN %d",
@@ -500,22 +526,21 @@ void UDPConnection::Flush(const bool forced)
 							packet->length);
 					outgoingData.pop_front();
 				} else {
-					unsigned numBytes = std::min((unsigned)maxChunkSize - pos, packet->length);
+					unsigned numBytes = std::min((unsigned)maxChunkSize - pos, packet->length - packetPos);
 					assert(packet->length > 0);
-					memcpy(buffer+pos, packet->data, numBytes);
+					chunkData.push_back(RawPacket::Slice(packet, packetPos, numBytes));
 					pos+= numBytes;
+					packetPos += numBytes;
 					outgoing.DataSent(numBytes, true);
-					partialPacket = (numBytes != packet->length);
-					if (partialPacket) {
-						// partially transfered
-						packet.reset(new RawPacket(packet->data + numBytes, packet->length - numBytes));
-					} else { // full packet copied
+					partialPacket = (packetPos != packet->length);
+					if (!partialPacket) { // full packet added
 						outgoingData.pop_front();
+						packetPos = 0;
 					}
 				}
 			}
 			if ((pos > 0) && (outgoingData.empty() || (pos == maxChunkSize) || !sendMore)) {
-				CreateChunk(buffer, pos, currentNum++);
+				CreateChunk(chunkData, pos, currentNum++);
 				pos = 0;
 			}
 		} while (!outgoingData.empty() && sendMore);
@@ -604,7 +629,7 @@ void UDPConnection::Init()
 	lastNak = -1;
 	sentOverhead = 0;
 	recvOverhead = 0;
-	fragmentBuffer = 0;
+	fragmentBuffer.reset();
 	resentChunks = 0;
 	sentPackets = recvPackets = 0;
 	droppedChunks = 0;
@@ -621,13 +646,13 @@ void UDPConnection::Init()
 #endif
 }
 
-void UDPConnection::CreateChunk(const unsigned char* data, const unsigned length, const int packetNum)
+void UDPConnection::CreateChunk(std::vector< boost::shared_ptr<const RawPacket> >& data, const unsigned length, const int packetNum)
 {
 	assert((length > 0) && (length < 255));
 	ChunkPtr buf(new Chunk);
 	buf->chunkNumber = packetNum;
 	buf->chunkSize = length;
-	std::copy(data, data+length, std::back_inserter(buf->data));
+	buf->data.swap(data);
 	newChunks.push_back(buf);
 	lastChunkCreated = spring_gettime();
 }
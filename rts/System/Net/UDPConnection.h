@@ -3,11 +3,12 @@
 #ifndef _UDP_CONNECTION_H
 #define _UDP_CONNECTION_H
 
-#include <boost/ptr_container/ptr_map.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/asio/ip/udp.hpp>
 #include <deque>
 #include <list>
+#include <map>
+#include <vector>
 
 #include "Connection.h"
 #include "System/Misc/SpringTime.h"
@@ -30,14 +31,15 @@ class Chunk
 {
 public:
 	unsigned GetSize() const {
-		return data.size() + headerSize;
+		return chunkSize + headerSize;
 	}
 	void UpdateChecksum(CRC& crc) const;
 	static const unsigned maxSize = 254;
 	static const unsigned headerSize = 5;
 	int32_t chunkNumber;
 	uint8_t chunkSize;
-	std::vector<uint8_t> data;
+	/// the payload, as parts of the packets it was cut from (not copied)
+	std::vector< boost::shared_ptr<const RawPacket> > data;
 };
 typedef boost::shared_ptr<Chunk> ChunkPtr;
 
@@ -45,7 +47,8 @@ class Packet
 {
 public:
 	static const unsigned headerSize = 6;
-	Packet(const unsigned char* data, unsigned length);
+	/// the chunks of the new packet reference data, instead of copying it
+	Packet(boost::shared_ptr<const RawPacket> data);
 	Packet(int lastContinuous, int nak);
 
 	unsigned GetSize() const;
@@ -134,9 +137,9 @@ private:
 
 	void Init();
 
-	/// add header to data and send it
-	void CreateChunk(const unsigned char* data, const unsigned length,
-			const int packetNum);
+	/// add header to data and send it (data is taken over, leaving it empty)
+	void CreateChunk(std::vector< boost::shared_ptr<const RawPacket> >& data,
+			const unsigned length, const int packetNum);
 	void SendIfNecessary(bool flushed);
 	void AckChunks(int lastAck);
 
@@ -147,7 +150,7 @@ private:
 	spring_time lastReceiveTime;
 	spring_time lastSendTime;
 
-	typedef boost::ptr_map<int,RawPacket> packetMap;
+	typedef std::map<int, ChunkPtr> packetMap;
 	typedef std::list< boost::shared_ptr<const RawPacket> > packetList;
 	/// address of the other end
 	boost::asio::ip::udp::endpoint addr;
@@ -193,7 +196,7 @@ private:
 	/// Our socket
 	boost::shared_ptr<boost::asio::ip::udp::socket> mySocket;
 
-	RawPacket* fragmentBuffer;
+	boost::shared_ptr<const RawPacket> fragmentBuffer;
 
 	// Traffic statistics and stuff
 
@@ -21,6 +21,7 @@
 #include "System/mmgr.h"
 
 #include "ProtocolDef.h"
+#include "RawPacket.h"
 #include "UDPConnection.h"
 #include "Socket.h"
 #include "System/Log/ILog.h"
@@ -125,11 +126,12 @@ void UDPListener::Update() {
 	size_t bytes_avail = 0;
 
 	while ((bytes_avail = mySocket->available()) > 0) {
-		std::vector<uint8_t> buffer(bytes_avail);
+		RawPacket* buffer = new RawPacket(bytes_avail);
+		boost::shared_ptr<const RawPacket> bufferPtr(buffer);
 		ip::udp::endpoint sender_endpoint;
 		boost::asio::ip::udp::socket::message_flags flags = 0;
 		boost::system::error_code err;
-		size_t bytesReceived = mySocket->receive_from(boost::asio::buffer(buffer), sender_endpoint, flags, err);
+		size_t bytesReceived = mySocket->receive_from(boost::asio::buffer(buffer->data, bytes_avail), sender_endpoint, flags, err);
 
 		ConnMap::iterator ci = conn.find(sender_endpoint);
 		bool knownConnection = (ci != conn.end());
@@ -143,7 +145,7 @@ void UDPListener::Update() {
 		if (bytesReceived < Packet::headerSize)
 			continue;
 
-		Packet data(&buffer[0], bytesReceived);
+		Packet data(RawPacket::Slice(bufferPtr, 0, bytesReceived));
 
 		if (knownConnection) {
 			ci->second.lock()->ProcessRawPacket(data);
@@ -0,0 +1,448 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifdef _MSC_VER
+	#include <windows.h>
+#endif
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <stdexcept>
+#include <sstream>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/thread/tss.hpp>
+#if defined(__USE_GNU) && !defined(WIN32)
+	#include <sys/prctl.h>
+#endif
+
+#include "lib/streflop/streflop_cond.h"
+
+
+namespace ThreadPool {
+	typedef TaskGroup::Task Task;
+
+	static inline int AtomicAdd(volatile int* v, int n)
+	{
+	#ifdef _MSC_VER
+		return (InterlockedExchangeAdd(reinterpret_cast<volatile long*>(v), n) + n);
+	#else
+		return __sync_add_and_fetch(v, n);
+	#endif
+	}
+
+	static inline int AtomicExchange(volatile int* v, int n)
+	{
+	#ifdef _MSC_VER
+		return InterlockedExchange(reinterpret_cast<volatile long*>(v), n);
+	#else
+		// full barrier, __sync_lock_test_and_set is only an acquire barrier
+		__sync_synchronize();
+		return __sync_lock_test_and_set(v, n);
+	#endif
+	}
+
+
+	// a deque lock is only ever held for a push or pop, so spinning is
+	// cheaper than putting the thread to sleep (which a mutex might do)
+	class SpinLock {
+	public:
+		SpinLock(): locked(0) {}
+
+		void Lock() {
+			for (unsigned int n = 0; AtomicExchange(&locked, 1) != 0; ) {
+				while (locked != 0) {
+					if ((++n % 1024) == 0) {
+						boost::this_thread::yield();
+					}
+				}
+			}
+		}
+		void Unlock() { AtomicExchange(&locked, 0); }
+
+	private:
+		volatile int locked;
+	};
+
+	struct WorkQueue {
+		WorkQueue(): size(0) {}
+
+		SpinLock lock;
+		std::deque<Task*> tasks;
+
+		// allows peeking at the deque without taking the lock
+		volatile int size;
+	};
+
+
+	// queue 0 is shared by all threads which are not pool workers
+	static std::vector<WorkQueue*> queues;
+	static std::vector<boost::thread*> workers;
+	static boost::thread_specific_ptr<unsigned int> workerNum;
+
+	static volatile int numQueuedTasks = 0;
+	static volatile int numSleepingWorkers = 0;
+	static volatile int exiting = 0;
+	static volatile int inited = 0;
+
+	static boost::mutex initMutex;
+	static boost::mutex sleepMutex;
+	static boost::condition_variable sleepCond;
+
+
+	static void PushTask(Task* task)
+	{
+		WorkQueue* queue = queues[GetThreadNum()];
+
+		queue->lock.Lock();
+		queue->tasks.push_back(task);
+		queue->size = queue->tasks.size();
+		queue->lock.Unlock();
+
+		AtomicAdd(&numQueuedTasks, 1);
+	}
+
+	static void WakeWorkers()
+	{
+		if (numSleepingWorkers == 0)
+			return;
+
+		boost::mutex::scoped_lock lock(sleepMutex);
+		sleepCond.notify_all();
+	}
+
+	static Task* PopTask(unsigned int threadNum)
+	{
+		const unsigned int numQueues = queues.size();
+
+		// own queue first (newest task), then steal the oldest
+		// task of the next thread that has any
+		for (unsigned int n = 0; n < numQueues; n++) {
+			WorkQueue* queue = queues[(threadNum + n) % numQueues];
+
+			if (queue->size == 0)
+				continue;
+
+			Task* task = NULL;
+
+			queue->lock.Lock();
+
+			if (!queue->tasks.empty()) {
+				if (n == 0) {
+					task = queue->tasks.back();
+					queue->tasks.pop_back();
+				} else {
+					task = queue->tasks.front();
+					queue->tasks.pop_front();
+				}
+
+				queue->size = queue->tasks.size();
+			}
+
+			queue->lock.Unlock();
+
+			if (task != NULL) {
+				AtomicAdd(&numQueuedTasks, -1);
+				return task;
+			}
+		}
+
+		return NULL;
+	}
+
+	static bool RunTask(unsigned int threadNum)
+	{
+		Task* task = PopTask(threadNum);
+
+		if (task == NULL)
+			return false;
+
+		try {
+			task->func();
+		} catch (const std::exception& ex) {
+			const std::string error = ex.what();
+			task->group->TaskDone(task, &error);
+			return true;
+		} catch (...) {
+			const std::string error = "unknown exception";
+			task->group->TaskDone(task, &error);
+			return true;
+		}
+
+		task->group->TaskDone(task, NULL);
+		return true;
+	}
+
+
+	static void WorkerLoop(unsigned int threadNum)
+	{
+		workerNum.reset(new unsigned int(threadNum));
+
+	#if defined(__USE_GNU) && !defined(WIN32)
+		std::ostringstream name;
+		name << "worker" << threadNum;
+		prctl(PR_SET_NAME, name.str().c_str(), 0, 0, 0);
+	#endif
+
+		// workers can run synced code, same FPU state as the main thread
+	#if defined(STREFLOP_X87) || defined(STREFLOP_SSE) || defined(STREFLOP_SOFT)
+		streflop_init<streflop::Simple>();
+	#if defined(__SUPPORT_SNAN__) && !defined(USE_GML)
+		streflop::feraiseexcept(streflop::FPU_Exceptions(FE_INVALID | FE_DIVBYZERO | FE_OVERFLOW));
+	#endif
+	#endif
+
+		while (exiting == 0) {
+			if (RunTask(threadNum))
+				continue;
+
+			boost::mutex::scoped_lock lock(sleepMutex);
+			AtomicAdd(&numSleepingWorkers, 1);
+
+			// PushTask increments numQueuedTasks before WakeWorkers
+			// checks numSleepingWorkers, so no wake-up can get lost
+			while (numQueuedTasks == 0 && exiting == 0) {
+				sleepCond.wait(lock);
+			}
+
+			AtomicAdd(&numSleepingWorkers, -1);
+		}
+	}
+
+
+	static void StopWorkers()
+	{
+		AtomicExchange(&exiting, 1);
+
+		{
+			boost::mutex::scoped_lock lock(sleepMutex);
+			sleepCond.notify_all();
+		}
+
+		for (unsigned int n = 0; n < workers.size(); n++) {
+			workers[n]->join();
+			delete workers[n];
+		}
+
+		for (unsigned int n = 0; n < queues.size(); n++) {
+			assert(queues[n]->tasks.empty());
+			delete queues[n];
+		}
+
+		workers.clear();
+		queues.clear();
+
+		AtomicExchange(&exiting, 0);
+	}
+
+	static void StartWorkers(unsigned int numThreads)
+	{
+		if (numThreads == 0)
+			numThreads = boost::thread::hardware_concurrency();
+		if (numThreads == 0)
+			numThreads = 1;
+
+		queues.resize(numThreads, NULL);
+
+		for (unsigned int n = 0; n < numThreads; n++) {
+			queues[n] = new WorkQueue();
+		}
+		for (unsigned int n = 1; n < numThreads; n++) {
+			workers.push_back(new boost::thread(boost::bind(&WorkerLoop, n)));
+		}
+
+		AtomicExchange(&inited, 1);
+	}
+
+	static void EnsureInit()
+	{
+		if (inited != 0)
+			return;
+
+		boost::mutex::scoped_lock lock(initMutex);
+
+		if (inited == 0) {
+			StartWorkers(0);
+		}
+	}
+
+
+	void SetThreadCount(unsigned int numThreads)
+	{
+		boost::mutex::scoped_lock lock(initMutex);
+
+		StopWorkers();
+		StartWorkers(numThreads);
+	}
+
+	void Shutdown()
+	{
+		boost::mutex::scoped_lock lock(initMutex);
+
+		StopWorkers();
+		StartWorkers(1);
+	}
+
+	unsigned int GetNumThreads()
+	{
+		EnsureInit();
+		return queues.size();
+	}
+
+	unsigned int GetThreadNum()
+	{
+		const unsigned int* num = workerNum.get();
+		return ((num != NULL)? *num: 0);
+	}
+
+
+
+	TaskGroup::TaskGroup()
+		: numPending(0)
+		, haveError(0)
+		, waiting(false)
+	{
+	}
+
+	TaskGroup::~TaskGroup()
+	{
+		assert(numPending == 0);
+	}
+
+	TaskGroup::TaskID TaskGroup::AddTask(const boost::function<void()>& func)
+	{
+		assert(!waiting);
+
+		tasks.push_back(Task());
+		tasks.back().func = func;
+
+		return (tasks.size() - 1);
+	}
+
+	void TaskGroup::AddDependency(TaskID task, TaskID dependency)
+	{
+		assert(!waiting);
+		assert(task < tasks.size());
+		assert(dependency < tasks.size());
+		assert(task != dependency);
+
+		tasks[dependency].successors.push_back(task);
+		tasks[task].numDeps += 1;
+	}
+
+	void TaskGroup::TaskDone(Task* task, const std::string* taskError)
+	{
+		if (taskError != NULL && AtomicExchange(&haveError, 1) == 0) {
+			error = *taskError;
+		}
+
+		bool pushed = false;
+
+		for (unsigned int n = 0; n < task->successors.size(); n++) {
+			Task* successor = &tasks[task->successors[n]];
+
+			if (AtomicAdd(&successor->numDeps, -1) == 0) {
+				PushTask(successor);
+				pushed = true;
+			}
+		}
+
+		if (pushed) {
+			WakeWorkers();
+		}
+
+		// must be the last access to this group, Wait
+		// returns (and the group may be destroyed) as
+		// soon as numPending reaches zero
+		AtomicAdd(&numPending, -1);
+	}
+
+	void TaskGroup::Wait()
+	{
+		EnsureInit();
+
+		if (tasks.empty())
+			return;
+
+		assert(!waiting);
+		waiting = true;
+		numPending = tasks.size();
+
+		// collect the initially ready tasks before pushing any, a
+		// finished task could otherwise make a successor look ready
+		// here after TaskDone already pushed it
+		std::vector<Task*> readyTasks;
+
+		for (unsigned int n = 0; n < tasks.size(); n++) {
+			tasks[n].group = this;
+
+			if (tasks[n].numDeps == 0) {
+				readyTasks.push_back(&tasks[n]);
+			}
+		}
+
+		assert(!readyTasks.empty());
+
+		for (unsigned int n = 0; n < readyTasks.size(); n++) {
+			PushTask(readyTasks[n]);
+		}
+
+		WakeWorkers();
+
+		const unsigned int threadNum = GetThreadNum();
+
+		while (numPending > 0) {
+			if (!RunTask(threadNum)) {
+				boost::this_thread::yield();
+			}
+		}
+
+		tasks.clear();
+		waiting = false;
+
+		if (haveError != 0) {
+			haveError = 0;
+			throw std::runtime_error(error);
+		}
+	}
+
+
+
+	static void RunRange(const boost::function<void(int)>* func, int begin, int end)
+	{
+		for (int i = begin; i < end; i++) {
+			(*func)(i);
+		}
+	}
+
+	void parallel_for(int begin, int end, const boost::function<void(int)>& func, int chunkSize)
+	{
+		parallel_for_ranges(begin, end, boost::bind(&RunRange, &func, _1, _2), chunkSize);
+	}
+
+	void parallel_for_ranges(int begin, int end, const boost::function<void(int, int)>& func, int chunkSize)
+	{
+		if (end <= begin)
+			return;
+
+		const int numItems = end - begin;
+		const int numThreads = GetNumThreads();
+
+		if (chunkSize <= 0)
+			chunkSize = std::max(1, numItems / (numThreads * 4));
+
+		if (numThreads == 1 || numItems <= chunkSize) {
+			func(begin, end);
+			return;
+		}
+
+		TaskGroup group;
+
+		for (int i = begin; i < end; i += chunkSize) {
+			group.AddTask(boost::bind(func, i, std::min(i + chunkSize, end)));
+		}
+
+		group.Wait();
+	}
+};
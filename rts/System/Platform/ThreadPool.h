@@ -0,0 +1,111 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _THREADPOOL_H
+#define _THREADPOOL_H
+
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+
+/**
+ * Engine-wide work-stealing task scheduler.
+ *
+ * Each worker thread owns a task deque: it pushes and pops its own tasks
+ * at the back (LIFO, the data is likely still in cache) and when that runs
+ * empty it steals from the front of another thread's deque (FIFO, oldest
+ * tasks first). A thread waiting for a TaskGroup executes pending tasks
+ * itself instead of blocking, so nested parallel_for's neither deadlock
+ * nor need extra threads.
+ *
+ * The pool has a fixed number of threads (by default one per core,
+ * including the thread that waits), use it instead of OpenMP or
+ * ad-hoc boost::threads for CPU-bound work so we never run more busy
+ * threads than there are cores.
+ *
+ * NOTE:
+ *   tasks that keep per-thread data indexed by GetThreadNum() must not
+ *   wait for other tasks themselves, or the waiting thread could run a
+ *   second task with the same index in the meantime
+ */
+namespace ThreadPool {
+	/**
+	 * (Re)starts the worker threads.
+	 * @param numThreads total number of threads including the calling one,
+	 *   0 means one per core; must not be called while tasks are running
+	 */
+	void SetThreadCount(unsigned int numThreads);
+	/// stops all worker threads, tasks run on the waiting thread afterwards
+	void Shutdown();
+
+	/// number of threads that can execute tasks concurrently (always >= 1)
+	unsigned int GetNumThreads();
+	/// index of the calling thread, [1, GetNumThreads()) for workers and 0 for any other thread
+	unsigned int GetThreadNum();
+
+
+	/**
+	 * A graph of tasks: each added task runs once all tasks it depends on
+	 * have finished. Add all tasks and dependencies first, then call Wait.
+	 */
+	class TaskGroup {
+	public:
+		typedef unsigned int TaskID;
+
+		TaskGroup();
+		~TaskGroup();
+
+		TaskID AddTask(const boost::function<void()>& func);
+		/// <task> will not start before <dependency> has finished
+		void AddDependency(TaskID task, TaskID dependency);
+
+		/**
+		 * Queues all tasks and helps executing them (and any other pending
+		 * tasks) until every task of this group has finished.
+		 * If a task throws, the remaining tasks are still executed and the
+		 * first exception's message is rethrown here as std::runtime_error.
+		 */
+		void Wait();
+
+	public:
+		struct Task {
+			Task(): group(NULL), numDeps(0) {}
+
+			boost::function<void()> func;
+			std::vector<TaskID> successors;
+
+			TaskGroup* group;
+			volatile int numDeps;
+		};
+
+		// called by the scheduler when a task of this group has finished
+		void TaskDone(Task* task, const std::string* error);
+
+	private:
+		TaskGroup(const TaskGroup&);
+		TaskGroup& operator = (const TaskGroup&);
+
+		std::vector<Task> tasks;
+		std::string error;
+
+		volatile int numPending;
+		volatile int haveError;
+		bool waiting;
+	};
+
+
+	/**
+	 * Calls func(i) for every i in [begin, end), split into tasks of
+	 * <chunkSize> iterations (0 picks a size that gives every thread a
+	 * few chunks). Iterations must be independent of each other; the
+	 * results must not depend on which thread executes which chunk.
+	 */
+	void parallel_for(int begin, int end, const boost::function<void(int)>& func, int chunkSize = 0);
+
+	/**
+	 * Same as parallel_for, but calls func(first, last) once per chunk
+	 * [first, last); useful when each chunk needs its own scratch data.
+	 */
+	void parallel_for_ranges(int begin, int end, const boost::function<void(int, int)>& func, int chunkSize = 0);
+};
+
+#endif // _THREADPOOL_H
@@ -0,0 +1,144 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/SlabPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+#include "lib/gml/gmlmut.h"
+
+CSlabPool unitMemPool;
+CSlabPool featureMemPool;
+CSlabPool projectileMemPool;
+
+const size_t CSlabPool::SIZE_GRANULARITY;
+const size_t CSlabPool::SLAB_SIZE;
+const size_t CSlabPool::MIN_BLOCKS_PER_SLAB;
+
+
+CSlabPool::CSlabPool()
+	: numAllocated(0)
+	, numSlabBytes(0)
+{
+	GetPools().push_back(this);
+}
+
+CSlabPool::~CSlabPool()
+{
+	std::vector<CSlabPool*>& pools = GetPools();
+	pools.erase(std::find(pools.begin(), pools.end(), this));
+
+	for (size_t n = 0; n < sizeClasses.size(); n++) {
+		delete sizeClasses[n];
+	}
+	for (size_t n = 0; n < slabs.size(); n++) {
+		#ifdef USE_MMGR
+		delete[] slabs[n];
+		#else
+		::operator delete(slabs[n]);
+		#endif
+	}
+}
+
+std::vector<CSlabPool*>& CSlabPool::GetPools()
+{
+	// function-local so pools defined in other translation
+	// units can register themselves during static init
+	static std::vector<CSlabPool*> pools;
+	return pools;
+}
+
+
+void CSlabPool::AllocSlab(SizeClass* sizeClass, size_t blockSize)
+{
+	const size_t numBlocks = std::max(MIN_BLOCKS_PER_SLAB, SLAB_SIZE / blockSize);
+
+	#ifdef USE_MMGR
+	char* slab = new char[numBlocks * blockSize];
+	#else
+	char* slab = static_cast<char*>(::operator new(numBlocks * blockSize));
+	#endif
+
+	// link all blocks of the new slab into the free-list (in
+	// address order, so consecutive allocations are adjacent)
+	for (size_t n = 0; n < (numBlocks - 1); n++) {
+		*reinterpret_cast<void**>(slab + n * blockSize) = slab + (n + 1) * blockSize;
+	}
+
+	*reinterpret_cast<void**>(slab + (numBlocks - 1) * blockSize) = sizeClass->nextFree;
+
+	sizeClass->nextFree = slab;
+	slabs.push_back(slab);
+	numSlabBytes += (numBlocks * blockSize);
+}
+
+void* CSlabPool::Alloc(size_t numBytes)
+{
+	GML_STDMUTEX_LOCK(slab); // Alloc
+
+	const size_t classIdx = (std::max(numBytes, sizeof(void*)) + SIZE_GRANULARITY - 1) / SIZE_GRANULARITY;
+
+	if (classIdx >= sizeClasses.size())
+		sizeClasses.resize(classIdx + 1, NULL);
+	if (sizeClasses[classIdx] == NULL)
+		sizeClasses[classIdx] = new SizeClass();
+
+	SizeClass* sizeClass = sizeClasses[classIdx];
+
+	if (sizeClass->nextFree == NULL)
+		AllocSlab(sizeClass, classIdx * SIZE_GRANULARITY);
+
+	void* pnt = sizeClass->nextFree;
+	sizeClass->nextFree = *reinterpret_cast<void**>(pnt);
+
+	numAllocated += 1;
+	return pnt;
+}
+
+void CSlabPool::Free(void* pnt, size_t numBytes)
+{
+	if (pnt == NULL)
+		return;
+
+	GML_STDMUTEX_LOCK(slab); // Free
+
+	const size_t classIdx = (std::max(numBytes, sizeof(void*)) + SIZE_GRANULARITY - 1) / SIZE_GRANULARITY;
+
+	assert(classIdx < sizeClasses.size() && sizeClasses[classIdx] != NULL);
+	sizeClasses[classIdx]->freed.push_back(pnt);
+
+	numAllocated -= 1;
+}
+
+
+void CSlabPool::ReleaseFreed()
+{
+	GML_STDMUTEX_LOCK(slab); // ReleaseFreed
+
+	for (size_t n = 0; n < sizeClasses.size(); n++) {
+		SizeClass* sizeClass = sizeClasses[n];
+
+		if (sizeClass == NULL)
+			continue;
+
+		std::vector<void*>& freed = sizeClass->freed;
+
+		// the most recently freed block (likely still in cache) is handed out first
+		for (size_t i = 0; i < freed.size(); i++) {
+			*reinterpret_cast<void**>(freed[i]) = sizeClass->nextFree;
+			sizeClass->nextFree = freed[i];
+		}
+
+		freed.clear();
+	}
+}
+
+void CSlabPool::ReleaseFreedAll()
+{
+	std::vector<CSlabPool*>& pools = GetPools();
+
+	for (size_t n = 0; n < pools.size(); n++) {
+		pools[n]->ReleaseFreed();
+	}
+}
@@ -0,0 +1,71 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef _SLAB_POOL_H_
+#define _SLAB_POOL_H_
+
+#include <vector>
+#include <cstring> // for size_t
+
+/**
+ * Allocator for large numbers of short- to long-lived objects of one
+ * class hierarchy (units, features, projectiles), a class uses it through
+ * its own operator new/delete (and CR_ALLOCATOR, so creg-loaded objects
+ * come from the pool too).
+ *
+ * Blocks are grouped by size (rounded up to SIZE_GRANULARITY bytes) and
+ * carved out of large slabs, so objects of the same type stay together
+ * and the global heap does not fragment over long games. Slabs are only
+ * released when the pool is destroyed.
+ *
+ * Freed blocks are not reused before the next ReleaseFreed call (once per
+ * sim frame), so memory of objects deleted during a frame stays valid
+ * until the frame is over.
+ */
+class CSlabPool
+{
+public:
+	CSlabPool();
+	~CSlabPool();
+
+	void* Alloc(size_t numBytes);
+	void Free(void* pnt, size_t numBytes);
+
+	/// makes the blocks freed since the last call available again
+	void ReleaseFreed();
+	/// calls ReleaseFreed on every existing pool
+	static void ReleaseFreedAll();
+
+	size_t GetNumAllocatedBlocks() const { return numAllocated; }
+	size_t GetNumSlabBytes() const { return numSlabBytes; }
+
+	static const size_t SIZE_GRANULARITY = 16;
+	static const size_t SLAB_SIZE = 64 * 1024;
+	static const size_t MIN_BLOCKS_PER_SLAB = 16;
+
+private:
+	struct SizeClass {
+		SizeClass(): nextFree(NULL) {}
+
+		void* nextFree;
+		std::vector<void*> freed;
+	};
+
+	CSlabPool(const CSlabPool&);
+	CSlabPool& operator = (const CSlabPool&);
+
+	void AllocSlab(SizeClass* sizeClass, size_t blockSize);
+
+	static std::vector<CSlabPool*>& GetPools();
+
+	std::vector<SizeClass*> sizeClasses;
+	std::vector<char*> slabs;
+
+	size_t numAllocated;
+	size_t numSlabBytes;
+};
+
+extern CSlabPool unitMemPool;
+extern CSlabPool featureMemPool;
+extern CSlabPool projectileMemPool;
+
+#endif // _SLAB_POOL_H_
@@ -23,6 +23,7 @@
 #include "Game/Game.h"
 #include "Game/GlobalUnsynced.h"
 #include "Game/PreGame.h"
+#include "Game/SimBenchmark.h"
 #include "Game/LoadScreen.h"
 #include "Game/UI/KeyBindings.h"
 #include "Game/UI/MouseHandler.h"
@@ -31,6 +32,7 @@
 #include "System/Input/InputHandler.h"
 #include "System/Input/Joystick.h"
 #include "System/MsgStrings.h"
+#include "Lua/LuaCallInCheck.h"
 #include "Lua/LuaOpenGL.h"
 #include "Menu/SelectMenu.h"
 #include "Rendering/GlobalRendering.h"
@@ -50,12 +52,14 @@
 #include "System/myMath.h"
 #include "System/OpenMP_cond.h"
 #include "System/TimeProfiler.h"
+#include "System/TraceProfiler.h"
 #include "System/Util.h"
 #include "System/FileSystem/DataDirLocater.h"
 #include "System/FileSystem/FileSystemInitializer.h"
 #include "System/FileSystem/FileHandler.h"
 #include "System/Platform/CmdLineParams.h"
 #include "System/Platform/Misc.h"
+#include "System/Platform/ThreadPool.h"
 #include "System/Platform/errorhandler.h"
 #include "System/Platform/CrashHandler.h"
 #include "System/Platform/Threading.h"
@@ -103,7 +107,11 @@ CONFIG(int, WindowPosX).defaultValue(32);
 CONFIG(int, WindowPosY).defaultValue(32);
 CONFIG(int, WindowState).defaultValue(0);
 CONFIG(bool, WindowBorderless).defaultValue(false);
-CONFIG(int, HardwareThreadCount).defaultValue(0).safemodeValue(1);
+CONFIG(int, HardwareThreadCount).defaultValue(0).safemodeValue(1).description("Number of threads used for parallel work, 0 means one per core.");
+CONFIG(bool, TraceProfiling).defaultValue(false).description("Record all profiled sections from startup on and write them to TraceProfilingFile on exit, in Chrome trace format.");
+CONFIG(std::string, TraceProfilingFile).defaultValue("trace.json");
+CONFIG(bool, LuaProfiling).defaultValue(false).description("Collect per call-in Lua timing and allocation counters from startup on and write them to LuaProfilingFile on exit, as JSON.");
+CONFIG(std::string, LuaProfilingFile).defaultValue("luaprofile.json");
 CONFIG(std::string, name).defaultValue(UnnamedPlayerName);
 
 
@@ -213,6 +221,15 @@ bool SpringApp::Initialize()
 	}
 #endif
 
+	// worker threads for parallel simulation and loading work,
+	// sized once here so nothing else spawns threads of its own
+	ThreadPool::SetThreadCount(std::max(0, configHandler->GetInt("HardwareThreadCount")));
+
+	if (configHandler->GetBool("TraceProfiling"))
+		TraceProfiler::Start();
+	if (configHandler->GetBool("LuaProfiling"))
+		LuaCallInProfiler::Start();
+
 	// Install Watchdog
 	Watchdog::Install();
 	Watchdog::RegisterThread(WDT_MAIN, true);
@@ -736,6 +753,9 @@ void SpringApp::ParseCmdLine()
 	cmdline->AddSwitch(0,   "list-config-vars",   "Dump a list of config vars and meta data to stdout");
 	cmdline->AddSwitch('i', "isolation",          "Limit the data-dir (games & maps) scanner to one directory");
 	cmdline->AddString(0,   "isolation-dir",      "Specify the isolation-mode data-dir (see --isolation)");
+#ifdef HEADLESS_BENCHMARK
+	cmdline->AddString(0,   "benchmark-output",   "Write the benchmark results to this file (default: benchmark.json)");
+#endif
 
 	try {
 		cmdline->Parse();
@@ -849,6 +869,13 @@ void SpringApp::Startup()
 #endif
 		activeController = new SelectMenu(server);
 	}
+#ifdef HEADLESS_BENCHMARK
+	else if (inputFile.rfind("sdf") != inputFile.size() - 3)
+	{
+		LOG_L(L_FATAL, "The benchmark version of the engine can only replay demo-files.");
+		exit(1);
+	}
+#endif
 	else if (inputFile.rfind("sdf") == inputFile.size() - 3)
 	{
 		std::string demoFileName = inputFile;
@@ -870,6 +897,10 @@ void SpringApp::Startup()
 		CSyncDebugger::GetInstance()->Initialize(true, 64); //FIXME: add actual number of player
 #endif
 
+#ifdef HEADLESS_BENCHMARK
+		simBenchmark = new CSimBenchmark(demoFileName, cmdline->IsSet("benchmark-output")? cmdline->GetString("benchmark-output"): "benchmark.json");
+#endif
+
 		pregame = new CPreGame(startsetup);
 		pregame->LoadDemo(demoFileName);
 	}
@@ -1034,11 +1065,17 @@ void SpringApp::Shutdown()
 {
 	if (gu) gu->globalQuit = true;
 
+	if (configHandler->GetBool("TraceProfiling"))
+		TraceProfiler::Dump(configHandler->GetString("TraceProfilingFile"));
+	if (configHandler->GetBool("LuaProfiling"))
+		LuaCallInProfiler::Dump(configHandler->GetString("LuaProfilingFile"));
+
 #define DeleteAndNull(x) delete x; x = NULL;
 
 	GML::Exit();
 	DeleteAndNull(pregame);
 	DeleteAndNull(game);
+	DeleteAndNull(simBenchmark);
 	DeleteAndNull(gameServer);
 	DeleteAndNull(gameSetup);
 	CLoadScreen::DeleteInstance();
@@ -1066,6 +1103,7 @@ void SpringApp::Shutdown()
 	DeleteAndNull(startsetup);
 	DeleteAndNull(luaSocketRestrictions);
 
+	ThreadPool::Shutdown();
 	FileSystemInitializer::Cleanup();
 
 	Watchdog::Uninstall();
@@ -21,9 +21,21 @@ BasicTimer::BasicTimer(const char* const myname) : name(myname), starttime(SDL_G
 
 ScopedTimer::~ScopedTimer()
 {
+	boost::int64_t preciseTime = 0;
+
+	if (preciseStartTime >= 0) {
+		const boost::int64_t preciseEndTime = TraceProfiler::GetTime();
+
+		// events that started before recording did are dropped by the dump
+		if (TraceProfiler::IsRecording())
+			TraceProfiler::AddEvent(name, preciseStartTime, preciseEndTime);
+
+		preciseTime = preciseEndTime - preciseStartTime;
+	}
+
 	int& ref = refs[name];
 	if (--ref == 0)
-		profiler.AddTime(name, SDL_GetTicks() - starttime, autoShowGraph);
+		profiler.AddTime(name, SDL_GetTicks() - starttime, preciseTime, autoShowGraph);
 }
 
 ScopedOnceTimer::~ScopedOnceTimer()
@@ -87,7 +99,7 @@ float CTimeProfiler::GetPercent(const char* name)
 	return profile[name].percent;
 }
 
-void CTimeProfiler::AddTime(const std::string& name, unsigned time, bool showGraph)
+void CTimeProfiler::AddTime(const std::string& name, unsigned time, boost::int64_t preciseTime, bool showGraph)
 {
 	GML_STDMUTEX_LOCK_NOPROF(time); // AddTime
 
@@ -95,11 +107,15 @@ void CTimeProfiler::AddTime(const std::string& name, unsigned time, bool showGra
 	if ( (pi = profile.find(name)) != profile.end() ) {
 		// profile already exists
 		pi->second.total+=time;
+		pi->second.preciseTotal+=preciseTime;
+		pi->second.calls+=1;
 		pi->second.current+=time;
 		pi->second.frames[currentPosition]+=time;
 	} else {
 		// create a new profile
 		profile[name].total=time;
+		profile[name].preciseTotal=preciseTime;
+		profile[name].calls=1;
 		profile[name].current=time;
 		profile[name].percent=0;
 		memset(profile[name].frames, 0, TimeRecord::frames_size*sizeof(unsigned));
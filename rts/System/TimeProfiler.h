@@ -9,6 +9,7 @@
 #include <cstring>
 
 #include "System/float3.h"
+#include "System/TraceProfiler.h"
 
 // disable this if you want minimal profiling
 // (sim time is still measured because of game slowdown)
@@ -37,14 +38,26 @@ class ScopedTimer : public BasicTimer
 public:
 	ScopedTimer(const char* const name, bool autoShow = false): BasicTimer(name) {
 		autoShowGraph = autoShow;
+		preciseStartTime = (WantPreciseTime())? TraceProfiler::GetTime(): -1;
 	}
 	/**
-	 * @brief destroy and add time to profiler
+	 * @brief destroy and add time to profiler (and the trace, if recording)
 	 */
 	~ScopedTimer();
 
 private:
+	/// the precise clock is only read for the trace and the benchmark totals
+	static bool WantPreciseTime() {
+	#ifdef HEADLESS_BENCHMARK
+		return true;
+	#else
+		return TraceProfiler::IsRecording();
+	#endif
+	}
+
 	bool autoShowGraph;
+	/// microseconds (see TraceProfiler::GetTime), -1 if not measured
+	boost::int64_t preciseStartTime;
 };
 
 
@@ -65,10 +78,14 @@ class CTimeProfiler
 {
 public:
 	struct TimeRecord {
-		TimeRecord() : total(0), current(0), percent(0), color(0,0,0), showGraph(false), peak(0), newpeak(false) { 
+		TimeRecord() : total(0), preciseTotal(0), calls(0), current(0), percent(0), color(0,0,0), showGraph(false), peak(0), newpeak(false) { 
 			memset(frames, 0, sizeof(frames));
 		}
 		unsigned total;
+		/// same as total, but in microseconds (only measured while tracing
+		/// and by the headless-bench build, see ScopedTimer)
+		boost::int64_t preciseTotal;
+		unsigned calls;
 		unsigned current;
 		static const unsigned frames_size = 128;
 		unsigned frames[frames_size];
@@ -83,7 +100,7 @@ public:
 	~CTimeProfiler();
 
 	float GetPercent(const char *name);
-	void AddTime(const std::string& name, unsigned time, bool showGraph = false);
+	void AddTime(const std::string& name, unsigned time, boost::int64_t preciseTime, bool showGraph = false);
 	void Update();
 
 	void PrintProfilingInfo() const;
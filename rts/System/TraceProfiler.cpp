@@ -0,0 +1,241 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifdef WIN32
+	#include <windows.h>
+#else
+	#include <sys/time.h>
+	#include <time.h>
+#endif
+
+#include "System/TraceProfiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <set>
+#include <vector>
+#include <sstream>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+#include "System/mmgr.h"
+#include "System/FileSystem/DataDirsAccess.h"
+#include "System/FileSystem/FileQueryFlags.h"
+#include "System/Log/ILog.h"
+#include "System/Platform/ThreadPool.h"
+#include "System/Platform/Threading.h"
+
+#ifdef _MSC_VER
+	#define MEMORY_BARRIER() MemoryBarrier()
+#else
+	#define MEMORY_BARRIER() __sync_synchronize()
+#endif
+
+
+namespace TraceProfiler {
+	struct Event {
+		const char* name;
+		boost::int64_t startTime;
+		boost::int32_t duration;
+		boost::int32_t frameNum;
+	};
+
+	// one per thread that ever recorded an event; only the owning
+	// thread writes, Dump reads concurrently and drops whatever
+	// could have been overwritten while it was copying
+	struct ThreadTrace {
+		// 64K events (1.5MB) per thread, roughly 10-20s of a busy game
+		static const unsigned int RING_SIZE = 1 << 16;
+
+		ThreadTrace(): numEvents(0) {}
+
+		Event events[RING_SIZE];
+		volatile unsigned int numEvents;
+
+		std::string threadName;
+		std::map<std::string, const char*> nameCache;
+	};
+
+
+	volatile bool recording = false;
+
+	static volatile int curFrameNum = 0;
+	static volatile boost::int64_t recordStartTime = 0;
+
+	static boost::mutex tracesMutex;
+	static std::vector<ThreadTrace*> traces;
+	// interned names of AddEvent(std::string) calls, set nodes never move
+	static std::set<std::string> names;
+
+	// the buffers are kept after their thread exited, Dump still needs them
+	static void KeepThreadTrace(ThreadTrace*) {}
+	static boost::thread_specific_ptr<ThreadTrace> threadTrace(&KeepThreadTrace);
+
+
+	static ThreadTrace* GetThreadTrace()
+	{
+		ThreadTrace* trace = threadTrace.get();
+
+		if (trace != NULL)
+			return trace;
+
+		trace = new ThreadTrace();
+
+		boost::mutex::scoped_lock lock(tracesMutex);
+		std::ostringstream buf;
+
+		if (Threading::IsMainThread()) {
+			buf << "main";
+		} else if (ThreadPool::GetThreadNum() != 0) {
+			buf << "worker" << ThreadPool::GetThreadNum();
+		} else {
+			buf << "thread" << traces.size();
+		}
+
+		trace->threadName = buf.str();
+		traces.push_back(trace);
+		threadTrace.reset(trace);
+		return trace;
+	}
+
+	static void WriteEscaped(FILE* file, const char* str)
+	{
+		for (; *str != 0; ++str) {
+			if (*str == '"' || *str == '\\') {
+				fputc('\\', file);
+			}
+			if (static_cast<unsigned char>(*str) >= 0x20) {
+				fputc(*str, file);
+			}
+		}
+	}
+
+
+	void Start()
+	{
+		recordStartTime = GetTime();
+		recording = true;
+	}
+
+	void Stop()
+	{
+		recording = false;
+	}
+
+	boost::int64_t GetTime()
+	{
+	#ifdef WIN32
+		static LARGE_INTEGER frequency = {{0, 0}};
+		LARGE_INTEGER count;
+
+		if (frequency.QuadPart == 0)
+			QueryPerformanceFrequency(&frequency);
+
+		QueryPerformanceCounter(&count);
+		return ((count.QuadPart / frequency.QuadPart) * 1000000 + ((count.QuadPart % frequency.QuadPart) * 1000000) / frequency.QuadPart);
+	#elif defined(__APPLE__)
+		timeval tv;
+		gettimeofday(&tv, NULL);
+		return (boost::int64_t(tv.tv_sec) * 1000000 + tv.tv_usec);
+	#else
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (boost::int64_t(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000);
+	#endif
+	}
+
+	void SetFrameNum(int frameNum)
+	{
+		curFrameNum = frameNum;
+	}
+
+	void AddEvent(const char* name, boost::int64_t startTime, boost::int64_t endTime)
+	{
+		ThreadTrace* trace = GetThreadTrace();
+
+		const unsigned int n = trace->numEvents;
+		Event& event = trace->events[n % ThreadTrace::RING_SIZE];
+
+		event.name = name;
+		event.startTime = startTime;
+		event.duration = endTime - startTime;
+		event.frameNum = curFrameNum;
+
+		// the event has to be complete before Dump can see it
+		MEMORY_BARRIER();
+		trace->numEvents = n + 1;
+	}
+
+	void AddEvent(const std::string& name, boost::int64_t startTime, boost::int64_t endTime)
+	{
+		ThreadTrace* trace = GetThreadTrace();
+		std::map<std::string, const char*>::const_iterator it = trace->nameCache.find(name);
+
+		if (it == trace->nameCache.end()) {
+			boost::mutex::scoped_lock lock(tracesMutex);
+			it = trace->nameCache.insert(std::make_pair(name, names.insert(name).first->c_str())).first;
+		}
+
+		AddEvent(it->second, startTime, endTime);
+	}
+
+	std::string Dump(const std::string& fileName)
+	{
+		const std::string filePath = dataDirsAccess.LocateFile(fileName, FileQueryFlags::WRITE | FileQueryFlags::CREATE_DIRS);
+		FILE* file = fopen(filePath.c_str(), "w");
+
+		if (file == NULL) {
+			LOG_L(L_ERROR, "[TraceProfiler::%s] could not open \"%s\" for writing", __FUNCTION__, filePath.c_str());
+			return "";
+		}
+
+		boost::mutex::scoped_lock lock(tracesMutex);
+		std::vector<Event> events;
+
+		fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+		fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"spring\"}}");
+
+		for (unsigned int t = 0; t < traces.size(); t++) {
+			const ThreadTrace* trace = traces[t];
+			const unsigned int ringSize = ThreadTrace::RING_SIZE;
+
+			// copy first and check afterwards which of the copied
+			// events the owner may have overwritten in the meantime
+			const unsigned int numEvents = trace->numEvents;
+			const unsigned int firstEvent = (numEvents > ringSize)? (numEvents - ringSize): 0;
+
+			MEMORY_BARRIER();
+			events.clear();
+
+			for (unsigned int n = firstEvent; n < numEvents; n++) {
+				events.push_back(trace->events[n % ringSize]);
+			}
+
+			MEMORY_BARRIER();
+
+			const unsigned int numEventsAfter = trace->numEvents;
+			const unsigned int firstValidEvent = (numEventsAfter > ringSize)? (numEventsAfter - ringSize): 0;
+			const unsigned int numSkipped = (firstValidEvent > firstEvent)? std::min(firstValidEvent - firstEvent, numEvents - firstEvent): 0;
+
+			fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", t, trace->threadName.c_str());
+
+			for (unsigned int n = numSkipped; n < events.size(); n++) {
+				const Event& event = events[n];
+
+				if (event.startTime < recordStartTime)
+					continue;
+
+				fprintf(file, ",\n{\"name\":\"");
+				WriteEscaped(file, event.name);
+				fprintf(file, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%d,\"args\":{\"frame\":%d}}",
+						t, (long long) (event.startTime - recordStartTime), event.duration, event.frameNum);
+			}
+		}
+
+		fprintf(file, "\n]}\n");
+		fclose(file);
+
+		LOG("[TraceProfiler] wrote %s", filePath.c_str());
+		return filePath;
+	}
+};
@@ -0,0 +1,49 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#ifndef TRACE_PROFILER_H
+#define TRACE_PROFILER_H
+
+#include <string>
+#include <boost/cstdint.hpp>
+
+/**
+ * Records every ScopedTimer (SCOPED_TIMER) scope as a begin/duration
+ * event with microsecond resolution, per thread and tagged with the
+ * current sim frame, so nested sim stages of a single (lagging) frame
+ * can be inspected afterwards.
+ *
+ * Each thread writes into its own fixed-size ring buffer without any
+ * locking; when it is full the oldest events are overwritten.
+ * Dump() writes the buffers in Chrome trace-event JSON format, which
+ * chrome://tracing and Perfetto (ui.perfetto.dev) can open.
+ */
+namespace TraceProfiler {
+	/// starts recording, discards all previously recorded events
+	void Start();
+	void Stop();
+
+	extern volatile bool recording;
+	inline bool IsRecording() { return recording; }
+
+	/// microseconds since an arbitrary fixed point
+	boost::int64_t GetTime();
+
+	/// sim frame that subsequently recorded events get tagged with
+	void SetFrameNum(int frameNum);
+
+	/**
+	 * @param name is stored as pointer, pass a string literal
+	 *   or use the std::string overload (which copies it once)
+	 */
+	void AddEvent(const char* name, boost::int64_t startTime, boost::int64_t endTime);
+	void AddEvent(const std::string& name, boost::int64_t startTime, boost::int64_t endTime);
+
+	/**
+	 * Writes all recorded events to <fileName> (a path relative to the
+	 * writable data-dir); can be called while recording.
+	 * @return the full path that was written, or an empty string on failure
+	 */
+	std::string Dump(const std::string& fileName);
+};
+
+#endif // TRACE_PROFILER_H
@@ -5,6 +5,7 @@
 
 #include <string>
 #include <sstream>
+#include <vector>
 #include <algorithm>
 
 #include "System/maindefines.h"
@@ -133,6 +134,25 @@ namespace proc {
 	unsigned int GetProcSSEBits();
 }
 
+/**
+ * @brief Removes the first occurrence of e from v in O(1) after the search
+ * Overwrites the found element with the last one and pops the back, so the
+ * relative order of the remaining elements is NOT preserved.
+ * @return true if e was found (and removed)
+ */
+template<typename T>
+static inline bool VectorEraseUnordered(std::vector<T>& v, const T& e)
+{
+	typename std::vector<T>::iterator it = std::find(v.begin(), v.end(), e);
+
+	if (it == v.end())
+		return false;
+
+	*it = v.back();
+	v.pop_back();
+	return true;
+}
+
 // set.erase(iterator++) is prone to crash with MSVC
 template <class S, class I>
 inline I set_erase(S &s, I i) {
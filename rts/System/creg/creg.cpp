@@ -121,7 +121,9 @@ Class::Class() :
 	binder(0),
 	base(0),
 	serializeProc(0),
-	postLoadProc(0)
+	postLoadProc(0),
+	allocProc(0),
+	freeProc(0)
 {}
 
 Class::~Class()
@@ -223,7 +225,17 @@ void Class::SetMemberFlag(const char* name, ClassMemberFlag f)
 
 void* Class::CreateInstance()
 {
-	void* inst = operator_new(binder->size);
+	void* inst = NULL;
+
+	for (Class* c = this; c; c = c->base) {
+		if (c->allocProc) {
+			inst = c->allocProc(binder->size);
+			break;
+		}
+	}
+
+	if (inst == NULL)
+		inst = operator_new(binder->size);
 
 	if (binder->constructor) {
 		binder->constructor(inst);
@@ -237,6 +249,13 @@ void Class::DeleteInstance(void* inst)
 		binder->destructor(inst);
 	}
 
+	for (Class* c = this; c; c = c->base) {
+		if (c->freeProc) {
+			c->freeProc(inst, binder->size);
+			return;
+		}
+	}
+
 	operator_delete(inst);
 }
 
@@ -172,6 +172,9 @@ namespace creg {
 		Class* base;
 		void (_DummyStruct::*serializeProc)(ISerializer& s);
 		void (_DummyStruct::*postLoadProc)();
+		/// custom allocation functions, used for this class and all derived classes
+		void* (*allocProc)(size_t size);
+		void (*freeProc)(void* inst, size_t size);
 
 		friend class ClassBinder;
 	};
@@ -508,6 +511,17 @@ namespace creg {
  */
 #define CR_POSTLOAD(PostLoadFunc) \
 	(class_->postLoadProc = (void(creg::_DummyStruct::*)())&Type::PostLoadFunc)
+
+/** @def CR_ALLOCATOR
+ * Registers custom allocation functions for the class/struct and all classes
+ * derived from it, they are used when instances are created during loading
+ * and should match the class' own operator new/delete.
+ *
+ * @param AllocFunc static allocation function, void* AllocFunc(size_t size)
+ * @param FreeFunc static free function, void FreeFunc(void* inst, size_t size)
+ */
+#define CR_ALLOCATOR(AllocFunc, FreeFunc) \
+	(class_->allocProc = &Type::AllocFunc, class_->freeProc = &Type::FreeFunc)
 };
 
 #endif // _CREG_H
@@ -3,6 +3,8 @@
 #ifndef MYMATH_H
 #define MYMATH_H
 
+#include <utility>
+
 #include "Sim/Misc/GlobalConstants.h"
 #include "System/Vec2.h"
 #include "System/float3.h"
@@ -1,6 +1,11 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
+#include <cstdio>
+#include <list>
 #include <string>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -18,12 +23,16 @@
 #include "System/FileSystem/ArchiveScanner.h"
 #include "System/FileSystem/VFSHandler.h"
 #include "System/FileSystem/FileHandler.h"
+#include "System/FileSystem/FileSystem.h"
+#include "System/FileSystem/FileSystemAbstraction.h"
 #include "System/LoadSave/DemoRecorder.h"
 #include "System/Log/ILog.h"
 #include "System/LogOutput.h"
+#include "System/Misc/SpringTime.h"
 #include "System/Platform/CmdLineParams.h"
 #include "System/Platform/CrashHandler.h"
 #include "System/Platform/errorhandler.h"
+#include "System/Platform/Threading.h"
 #include "System/Config/ConfigHandler.h"
 #include "System/GlobalConfig.h"
 #include "System/Exceptions.h"
@@ -52,7 +61,7 @@ extern "C"
 #endif
 
 
-void ParseCmdLine(int argc, char* argv[], std::string* script_txt)
+void ParseCmdLine(int argc, char* argv[], std::string* script_txt, std::string* games_dir)
 {
 	#undef  LOG_SECTION_CURRENT
 	#define LOG_SECTION_CURRENT LOG_SECTION_DEFAULT
@@ -66,6 +75,7 @@ void ParseCmdLine(int argc, char* argv[], std::string* script_txt)
 	cmdline.AddSwitch(0,   "list-config-vars",   "Dump a list of config vars and meta data to stdout");
 	cmdline.AddSwitch('i', "isolation",          "Limit the data-dir (games & maps) scanner to one directory");
 	cmdline.AddString(0,   "isolation-dir",      "Specify the isolation-mode data-dir (see --isolation)");
+	cmdline.AddString(0,   "games-dir",          "Host a game for every start script (*.txt) moved into this directory, all in this process; started scripts are renamed to *.txt.started");
 
 	try {
 		cmdline.Parse();
@@ -90,7 +100,10 @@ void ParseCmdLine(int argc, char* argv[], std::string* script_txt)
 
 
 	*script_txt = cmdline.GetInputFile();
-	if (script_txt->empty() && !cmdline.IsSet("list-config-vars")) {
+	if (cmdline.IsSet("games-dir")) {
+		*games_dir = cmdline.GetString("games-dir");
+	}
+	if (script_txt->empty() && games_dir->empty() && !cmdline.IsSet("list-config-vars")) {
 		cmdline.PrintUsage();
 		exit(1);
 	}
@@ -134,29 +147,58 @@ void zzz(unsigned int secs) {
 #endif
 }
 
-int main(int argc, char* argv[])
+/**
+ * @brief read the start positions of a setup from its map archive
+ * The archives of the map are only added to the VFS for this and removed
+ * afterwards, as all games hosted by this process share the VFS, and an
+ * earlier game's mapinfo.lua would shadow the one of this game's map.
+ */
+void LoadStartPositionsFromArchive(CGameSetup* setup)
 {
-#ifdef _WIN32
-	try {
-#endif
-	std::string scriptName;
-	std::string scriptText;
+	const std::vector<std::string>& archives = archiveScanner->GetArchives(setup->mapName);
 
-	ParseCmdLine(argc, argv, &scriptName);
+	if (archives.empty())
+		throw content_error("Could not find any archives for '" + setup->mapName + "'.");
 
-	// Initialize crash reporting
-	CrashHandler::Install();
+	std::vector<std::string> addedArchives;
 
-	SDL_Init(SDL_INIT_TIMER);
-	logOutput.Initialize();
+	try {
+		for (std::vector<std::string>::const_iterator ai = archives.begin(); ai != archives.end(); ++ai) {
+			// shared with the base content or another game's map
+			if (vfsHandler->HasArchive(*ai))
+				continue;
+			if (!vfsHandler->AddArchive(*ai, false))
+				throw content_error("Failed loading archive '" + *ai + "' of map '" + setup->mapName + "'.");
+
+			addedArchives.push_back(*ai);
+		}
 
-	LOG("report any errors to Mantis or the forums.");
-	LOG("loading script from file: %s", scriptName.c_str());
+		setup->LoadStartPositions(); // full mode
+	} catch (...) {
+		for (std::vector<std::string>::const_iterator ai = addedArchives.begin(); ai != addedArchives.end(); ++ai) {
+			vfsHandler->RemoveArchive(*ai);
+		}
+		throw;
+	}
 
-	FileSystemInitializer::Initialize();
+	for (std::vector<std::string>::const_iterator ai = addedArchives.begin(); ai != addedArchives.end(); ++ai) {
+		vfsHandler->RemoveArchive(*ai);
+	}
+}
 
-	CGameServer* server = NULL;
-	CGameSetup* gameSetup = NULL;
+/**
+ * @brief load a start script and create the server for its game
+ * @param gameSetup set to the setup of the game, owned by the server
+ * @param ownThread see CGameServer::CGameServer
+ * @return the new server, or NULL if the script is invalid
+ */
+CGameServer* CreateGameServer(const std::string& scriptName, const CGameSetup** gameSetup, bool ownThread)
+{
+	// config values set from the previous script; the server reads them
+	// when it is created, so they only have to be gone before the next
+	static std::vector<std::string> scriptConfigKeys;
+
+	std::string scriptText;
 	ClientSetup settings;
 	CFileHandler fh(scriptName);
 
@@ -166,49 +208,233 @@ int main(int argc, char* argv[])
 	if (!fh.LoadStringData(scriptText))
 		throw content_error("script cannot be read: " + scriptName);
 
+	for (std::vector<std::string>::const_iterator ki = scriptConfigKeys.begin(); ki != scriptConfigKeys.end(); ++ki) {
+		configHandler->DeleteOverlay(*ki);
+	}
+
+	scriptConfigKeys.clear();
+
 	settings.Init(scriptText);
-	gameSetup = new CGameSetup(); // to store the gamedata inside
+	scriptConfigKeys = settings.configOverlayKeys;
 
-	if (!gameSetup->Init(scriptText)) {
+	CGameSetup* setup = new CGameSetup(); // to store the gamedata inside
+
+	if (!setup->Init(scriptText)) {
 		// read the script provided by cmdline
 		LOG_L(L_ERROR, "failed to load script %s", scriptName.c_str());
-		return 1;
+		delete setup;
+		return NULL;
+	}
+
+	if (!ownThread && setup->hostDemo) {
+		// skipping in a demo runs synchronously in Poll, which would stall every other game
+		LOG_L(L_ERROR, "script %s hosts a demo, which is not supported with --games-dir", scriptName.c_str());
+		delete setup;
+		return NULL;
 	}
 
-	// Create the server, it will run in a separate thread
 	GameData data;
 	UnsyncedRNG rng;
 
-	rng.Seed(gameSetup->gameSetupText.length());
+	rng.Seed(setup->gameSetupText.length());
 	rng.Seed(scriptName.length());
 	data.SetRandomSeed(rng.RandInt());
 
 	//  Use script provided hashes if they exist
-	if (gameSetup->mapHash != 0) {
-		data.SetMapChecksum(gameSetup->mapHash);
-		gameSetup->LoadStartPositions(false); // reduced mode
+	if (setup->mapHash != 0) {
+		data.SetMapChecksum(setup->mapHash);
+		setup->LoadStartPositions(false); // reduced mode
 	} else {
-		data.SetMapChecksum(archiveScanner->GetArchiveCompleteChecksum(gameSetup->mapName));
+		data.SetMapChecksum(archiveScanner->GetArchiveCompleteChecksum(setup->mapName));
 
-		CFileHandler f("maps/" + gameSetup->mapName);
+		CFileHandler f("maps/" + setup->mapName);
 		if (!f.FileExists()) {
-			vfsHandler->AddArchiveWithDeps(gameSetup->mapName, false);
+			LoadStartPositionsFromArchive(setup);
+		} else {
+			setup->LoadStartPositions(); // full mode
 		}
-		gameSetup->LoadStartPositions(); // full mode
 	}
 
-	if (gameSetup->modHash != 0) {
-		data.SetModChecksum(gameSetup->modHash);
+	if (setup->modHash != 0) {
+		data.SetModChecksum(setup->modHash);
 	} else {
-		const std::string& modArchive = archiveScanner->ArchiveFromName(gameSetup->modName);
+		const std::string& modArchive = archiveScanner->ArchiveFromName(setup->modName);
 		const unsigned int modCheckSum = archiveScanner->GetArchiveCompleteChecksum(modArchive);
 		data.SetModChecksum(modCheckSum);
 	}
 
 	LOG("starting server...");
 
-	data.SetSetup(gameSetup->gameSetupText);
-	server = new CGameServer(settings.hostIP, settings.hostPort, &data, gameSetup);
+	data.SetSetup(setup->gameSetupText);
+	*gameSetup = setup;
+	return new CGameServer(settings.hostIP, settings.hostPort, &data, setup, ownThread);
+}
+
+void PrintGameInfo(const CGameServer* server, const CGameSetup* gameSetup)
+{
+	const boost::scoped_ptr<CDemoRecorder>& demoRec = server->GetDemoRecorder();
+	const boost::uint8_t* gameID = (demoRec->GetFileHeader()).gameID;
+
+	LOG("recording demo: %s", (demoRec->GetName()).c_str());
+	LOG("using mod: %s", (gameSetup->modName).c_str());
+	LOG("using map: %s", (gameSetup->mapName).c_str());
+	LOG("GameID: %02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x", gameID[0], gameID[1], gameID[2], gameID[3], gameID[4], gameID[5], gameID[6], gameID[7], gameID[8], gameID[9], gameID[10], gameID[11], gameID[12], gameID[13], gameID[14], gameID[15]);
+}
+
+
+
+/**
+ * Multi-game hosting (--games-dir)
+ *
+ * All games share the archive scanner and VFS of this process. Instead of
+ * one thread per game, a single network loop updates every server; each
+ * game keeps its own UDP port (its HostPort), as that is what the clients
+ * connect to, and its listener demultiplexes the clients by endpoint.
+ */
+struct HostedGame {
+	std::string scriptName;
+	const CGameSetup* gameSetup;
+	CGameServer* server;
+	bool printedInfo;
+	bool failed;
+	/// set once the server has also said goodbye to its clients
+	bool finished;
+};
+
+static std::list<HostedGame> hostedGames;
+static boost::mutex hostedGamesMutex;
+
+void HostedGamesNetLoop()
+{
+	Threading::SetThreadName("netcode");
+
+	while (true) {
+		spring_sleep(spring_msecs(10));
+
+		boost::mutex::scoped_lock lock(hostedGamesMutex);
+		for (std::list<HostedGame>::iterator gi = hostedGames.begin(); gi != hostedGames.end(); ++gi) {
+			if (gi->failed || gi->finished)
+				continue;
+			try {
+				// also drives the goodbye of finished games, without blocking the others
+				gi->finished = !gi->server->Poll();
+			} catch (const std::exception& ex) {
+				// do not let one broken game take down all the others
+				LOG_L(L_ERROR, "game %s failed: %s", gi->scriptName.c_str(), ex.what());
+				gi->failed = true;
+			}
+		}
+	}
+}
+
+void StartNewGames(const std::string& gamesDir)
+{
+	std::vector<std::string> scripts;
+	FileSystemAbstraction::FindFiles(scripts, "", FileSystemAbstraction::EnsurePathSepAtEnd(gamesDir), FileSystem::ConvertGlobToRegex("*.txt"), 0);
+
+	for (std::vector<std::string>::const_iterator si = scripts.begin(); si != scripts.end(); ++si) {
+		// rename it first, so the script is picked up only once
+		const std::string scriptName = *si + ".started";
+		if (rename(si->c_str(), scriptName.c_str()) != 0) {
+			LOG_L(L_ERROR, "failed to rename script %s, not starting its game", si->c_str());
+			continue;
+		}
+
+		LOG("loading script from file: %s", si->c_str());
+
+		HostedGame game;
+		game.scriptName = *si;
+		game.gameSetup = NULL;
+		game.printedInfo = false;
+		game.failed = false;
+		game.finished = false;
+
+		try {
+			game.server = CreateGameServer(scriptName, &game.gameSetup, false);
+		} catch (const std::exception& ex) {
+			LOG_L(L_ERROR, "failed to start game %s: %s", si->c_str(), ex.what());
+			continue;
+		}
+
+		if (game.server != NULL) {
+			boost::mutex::scoped_lock lock(hostedGamesMutex);
+			hostedGames.push_back(game);
+		}
+	}
+}
+
+void HostGames(const std::string& gamesDir)
+{
+	LOG("hosting the games of all start scripts moved into: %s", gamesDir.c_str());
+
+	boost::thread netThread(&HostedGamesNetLoop);
+
+	// runs until the process gets terminated
+	while (true) {
+		StartNewGames(gamesDir);
+
+		std::vector<HostedGame> finishedGames;
+		{
+			boost::mutex::scoped_lock lock(hostedGamesMutex);
+			for (std::list<HostedGame>::iterator gi = hostedGames.begin(); gi != hostedGames.end(); ) {
+				if (gi->failed || gi->finished) {
+					finishedGames.push_back(*gi);
+					gi = hostedGames.erase(gi);
+					continue;
+				}
+				if (!gi->printedInfo && gi->server->HasGameID()) {
+					gi->printedInfo = true;
+					LOG("game %s started", gi->scriptName.c_str());
+					PrintGameInfo(gi->server, gi->gameSetup);
+				}
+				++gi;
+			}
+		}
+
+		// outside of the lock, a failed server still says goodbye here
+		for (std::vector<HostedGame>::iterator gi = finishedGames.begin(); gi != finishedGames.end(); ++gi) {
+			LOG("game %s finished", gi->scriptName.c_str());
+			delete gi->server;
+		}
+
+		// wait 1 second between checks
+		zzz(1);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+#ifdef _WIN32
+	try {
+#endif
+	std::string scriptName;
+	std::string gamesDir;
+
+	ParseCmdLine(argc, argv, &scriptName, &gamesDir);
+
+	// Initialize crash reporting
+	CrashHandler::Install();
+
+	SDL_Init(SDL_INIT_TIMER);
+	logOutput.Initialize();
+
+	LOG("report any errors to Mantis or the forums.");
+
+	FileSystemInitializer::Initialize();
+
+	if (!gamesDir.empty()) {
+		HostGames(gamesDir);
+		return 0;
+	}
+
+	LOG("loading script from file: %s", scriptName.c_str());
+
+	const CGameSetup* gameSetup = NULL;
+	CGameServer* server = CreateGameServer(scriptName, &gameSetup, true);
+
+	if (server == NULL) {
+		return 1;
+	}
 
 	while (!server->HasGameID()) {
 		// wait until gameID has been generated or
@@ -225,14 +451,7 @@ int main(int argc, char* argv[])
 
 		if (printData) {
 			printData = false;
-
-			const boost::scoped_ptr<CDemoRecorder>& demoRec = server->GetDemoRecorder();
-			const boost::uint8_t* gameID = (demoRec->GetFileHeader()).gameID;
-
-			LOG("recording demo: %s", (demoRec->GetName()).c_str());
-			LOG("using mod: %s", (gameSetup->modName).c_str());
-			LOG("using map: %s", (gameSetup->mapName).c_str());
-			LOG("GameID: %02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x%02x", gameID[0], gameID[1], gameID[2], gameID[3], gameID[4], gameID[5], gameID[6], gameID[7], gameID[8], gameID[9], gameID[10], gameID[11], gameID[12], gameID[13], gameID[14], gameID[15]);
+			PrintGameInfo(server, gameSetup);
 		}
 
 		// wait 1 second between checks
@@ -266,6 +266,7 @@ boost::mutex ntexmutex;
 boost::mutex lodmutex;
 boost::mutex catmutex;
 boost::mutex grpchgmutex;
+boost::mutex slabmutex;
 
 #include <boost/thread/recursive_mutex.hpp>
 boost::recursive_mutex unitmutex;
@@ -77,6 +77,7 @@ extern boost::mutex ntexmutex;
 extern boost::mutex lodmutex;
 extern boost::mutex catmutex;
 extern boost::mutex grpchgmutex;
+extern boost::mutex slabmutex;
 
 #include <boost/thread/recursive_mutex.hpp>
 extern boost::recursive_mutex unitmutex;
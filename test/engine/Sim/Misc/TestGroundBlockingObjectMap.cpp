@@ -0,0 +1,396 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+// Tests the engine's CGroundBlockingObjectMap (GroundBlockingObjectMap.cpp is
+// compiled into this file) against a std::map per square, which is how the
+// map stored its objects before the cells were packed into slots, while
+// objects are added, removed and saved and loaded again. The engine types it
+// works on are replaced by minimal stand-ins with the members it uses;
+// defining the include guards of their headers makes it use the stand-ins.
+
+#include <map>
+#include <vector>
+#include <string.h>
+#include <stdlib.h>
+
+#include "System/creg/creg_cond.h"
+#include "System/float3.h"
+#include "System/Vec2.h"
+#include "System/Misc/BitwiseEnum.h"
+
+#define BOOST_TEST_MODULE GroundBlockingObjectMap
+#include <boost/test/unit_test.hpp>
+
+#define _GLOBAL_SYNCED_H
+#include "Sim/Misc/GlobalConstants.h"
+class CGlobalSynced {
+public:
+	int mapx;
+	int mapy;
+};
+static CGlobalSynced globalSynced;
+static CGlobalSynced* gs = &globalSynced;
+
+#define I_PATH_MANAGER_H
+class IPathManager {
+public:
+	void TerrainChange(unsigned int x1, unsigned int z1, unsigned int x2, unsigned int z2) {}
+};
+static IPathManager* pathManager = NULL;
+
+#define SOLID_OBJECT_H
+enum YardmapStates {
+	YARDMAP_OPEN        = 0,
+	YARDMAP_YARD        = 1,
+	YARDMAP_YARDINV     = 2,
+	YARDMAP_BLOCKED     = 0xFF & ~YARDMAP_YARDINV,
+	YARDMAP_YARDBLOCKED = YARDMAP_YARD,
+	YARDMAP_YARDFREE    = ~YARDMAP_YARD,
+};
+typedef BitwiseEnum<YardmapStates> YardMapStatus;
+
+struct MoveDef;
+class CSolidObject {
+public:
+	CSolidObject(int id, int x, int z, int xsize, int zsize, bool immobile)
+		: id(id)
+		, pos(x, z)
+		, immobile(immobile)
+		, xsize(xsize)
+		, zsize(zsize)
+		, isMarkedOnBlockingMap(false)
+		, moveDef(NULL)
+		, blockMap(NULL)
+	{}
+
+	// built without creg (see test/CMakeLists.txt), only the names have to exist
+	static creg::Class* StaticClass() { return NULL; }
+	creg::Class* GetClass() const { return NULL; }
+
+	int GetBlockingMapID() const { return id; }
+	int2 GetMapPos() const { return pos; }
+	YardMapStatus GetGroundBlockingAtPos(float3 gpos) const { return YARDMAP_BLOCKED; }
+
+	int id;
+	int2 pos;
+
+	bool immobile;
+	int xsize;
+	int zsize;
+	bool isMarkedOnBlockingMap;
+	MoveDef* moveDef;
+	int2 mapPos;
+	const YardMapStatus* blockMap;
+};
+
+#include "Sim/Misc/GroundBlockingObjectMap.cpp"
+
+// defined in Serializer.cpp, which is not part of this test
+creg::ISerializer::~ISerializer() {}
+
+
+static const int mapSize = 16;
+
+/**
+ * Saves into and loads from a byte buffer. Like creg, it only writes
+ * the loaded object pointers once everything has been read, so they
+ * have to stay at the address they were read to until then.
+ */
+class BufferSerializer: public creg::ISerializer {
+public:
+	BufferSerializer(): writing(true), readPos(0) {}
+
+	void StartReading() { writing = false; readPos = 0; }
+
+	bool IsWriting() { return writing; }
+
+	void Serialize(void* data, int byteSize) {
+		if (writing) {
+			buffer.insert(buffer.end(), (char*) data, (char*) data + byteSize);
+		} else {
+			memcpy(data, &buffer[readPos], byteSize);
+			readPos += byteSize;
+		}
+	}
+	void SerializeInt(void* data, int byteSize) { Serialize(data, byteSize); }
+
+	void SerializeObjectPtr(void** ptr, creg::Class* objectClass) {
+		if (writing) {
+			Serialize(ptr, sizeof(void*));
+		} else {
+			void* obj = NULL;
+			Serialize(&obj, sizeof(void*));
+			pointerFixups.push_back(std::make_pair(ptr, obj));
+			*ptr = NULL;
+		}
+	}
+	void SerializeObjectInstance(void* inst, creg::Class* objectClass) {}
+	void AddPostLoadCallback(void (*cb)(void* userdata), void* userdata) {}
+
+	void FixPointers() {
+		for (size_t n = 0; n < pointerFixups.size(); n++) {
+			*pointerFixups[n].first = pointerFixups[n].second;
+		}
+		pointerFixups.clear();
+	}
+
+private:
+	bool writing;
+	size_t readPos;
+
+	std::vector<char> buffer;
+	std::vector< std::pair<void**, void*> > pointerFixups;
+};
+
+
+typedef std::map<int, CSolidObject*> ModelCell;
+
+/// the objects blocking every square, kept like the map stored them before
+struct BlockingModel {
+	BlockingModel(): cells(mapSize * mapSize) {}
+
+	void Add(CSolidObject* o) {
+		for (int z = o->mapPos.y; z < o->mapPos.y + o->zsize; z++) {
+			for (int x = o->mapPos.x; x < o->mapPos.x + o->xsize; x++) {
+				cells[x + z * mapSize][o->id] = o;
+			}
+		}
+	}
+	void Remove(CSolidObject* o) {
+		for (int z = o->mapPos.y; z < o->mapPos.y + o->zsize; z++) {
+			for (int x = o->mapPos.x; x < o->mapPos.x + o->xsize; x++) {
+				cells[x + z * mapSize].erase(o->id);
+			}
+		}
+	}
+
+	std::vector<ModelCell> cells;
+};
+
+static void CheckCells(const CGroundBlockingObjectMap& map, const BlockingModel& model)
+{
+	for (int sq = 0; sq < mapSize * mapSize; sq++) {
+		const BlockingMapCell cell = map.GetCell(sq);
+		const ModelCell& modelCell = model.cells[sq];
+
+		BOOST_REQUIRE_EQUAL(cell.size(), modelCell.size());
+
+		ModelCell::const_iterator mit = modelCell.begin();
+		bool structure = false;
+
+		for (BlockingMapCellIt it = cell.begin(); it != cell.end(); ++it, ++mit) {
+			BOOST_REQUIRE_EQUAL(it->first, mit->first);
+			BOOST_REQUIRE_EQUAL(it->second, mit->second);
+			structure |= it->second->immobile;
+		}
+
+		const int x = sq % mapSize;
+		const int z = sq / mapSize;
+
+		BOOST_REQUIRE_EQUAL(map.GroundBlockedUnsafe(sq), modelCell.empty()? NULL: modelCell.begin()->second);
+		BOOST_REQUIRE_EQUAL(map.FootprintEmpty(x, z, x, z, 1), modelCell.empty());
+		BOOST_REQUIRE_EQUAL(map.FootprintStructureFree(x, z, x, z, 1), !structure);
+	}
+}
+
+static void SetMapSize()
+{
+	gs->mapx = mapSize;
+	gs->mapy = mapSize;
+}
+
+
+BOOST_AUTO_TEST_CASE(InsertAndErase)
+{
+	SetMapSize();
+
+	CGroundBlockingObjectMap map(mapSize * mapSize);
+	CSolidObject unit(7, 3, 4, 2, 2, false);
+	CSolidObject building(2, 3, 4, 2, 3, true);
+
+	map.AddGroundBlockingObject(&unit);
+	BOOST_CHECK(unit.isMarkedOnBlockingMap);
+	BOOST_CHECK_EQUAL(map.GroundBlocked(3, 4), &unit);
+	BOOST_CHECK_EQUAL(map.GroundBlocked(4, 5), &unit);
+	BOOST_CHECK(map.GroundBlocked(5, 5) == NULL);
+	BOOST_CHECK(map.GroundBlocked(-1, 0) == NULL);
+	BOOST_CHECK(!map.GroundBlocked(3, 4, &unit));
+	BOOST_CHECK(!map.FootprintEmpty(0, 0, 7, 7, 1));
+	BOOST_CHECK(map.FootprintStructureFree(0, 0, 7, 7, 1));
+
+	// immobile objects are aligned to even squares
+	map.AddGroundBlockingObject(&building);
+	BOOST_CHECK_EQUAL(building.mapPos.x, 2);
+	BOOST_CHECK_EQUAL(building.mapPos.y, 4);
+	BOOST_CHECK(!map.FootprintStructureFree(2, 6, 2, 6, 1));
+	BOOST_CHECK(map.GroundBlocked(3, 4, &unit));
+
+	// entries are sorted by ID, the lowest is returned first
+	const BlockingMapCell cell = map.GetCell(3 + 4 * mapSize);
+	BOOST_REQUIRE_EQUAL(cell.size(), 2U);
+	BOOST_CHECK_EQUAL(cell.begin()->first, 2);
+	BOOST_CHECK_EQUAL(cell.find(7)->second, &unit);
+	BOOST_CHECK(cell.find(5) == cell.end());
+
+	map.RemoveGroundBlockingObject(&building);
+	BOOST_CHECK(!building.isMarkedOnBlockingMap);
+	BOOST_CHECK(map.FootprintStructureFree(0, 0, mapSize - 1, mapSize - 1, 1));
+	BOOST_CHECK_EQUAL(map.GroundBlocked(3, 4), &unit);
+
+	map.RemoveGroundBlockingObject(&unit);
+	BOOST_CHECK(map.FootprintEmpty(0, 0, mapSize - 1, mapSize - 1, 1));
+	BOOST_CHECK(!map.FootprintEmpty(0, 0, mapSize, mapSize - 1, 1));
+
+	// removing an object twice leaves the map as it is
+	map.RemoveGroundBlockingObject(&unit);
+	BOOST_CHECK(map.FootprintEmpty(0, 0, mapSize - 1, mapSize - 1, 1));
+}
+
+
+BOOST_AUTO_TEST_CASE(Overflow)
+{
+	SetMapSize();
+
+	CGroundBlockingObjectMap map(mapSize * mapSize);
+	BlockingModel model;
+	std::vector<CSolidObject*> objects;
+
+	// more objects on one square than fit inline, and more than the
+	// count bits of the square's word can hold, added in an order which
+	// makes every insert go somewhere else in the sorted cell
+	for (int n = 0; n < 20; n++) {
+		const int id = (n * 7) % 20;
+		objects.push_back(new CSolidObject(id, 4, 4, 1, 1, (id == 13)));
+
+		map.AddGroundBlockingObject(objects.back());
+		model.Add(objects.back());
+		CheckCells(map, model);
+	}
+
+	const int sq = 4 + 4 * mapSize;
+	BOOST_CHECK_EQUAL(map.GetCell(sq).size(), 20U);
+	BOOST_CHECK(map.GroundBlocked(4, 4, objects[0]));
+
+	// back to inline storage and then empty, from the middle and the ends
+	for (int n = 0; n < 20; n++) {
+		CSolidObject* o = objects[(n * 11) % 20];
+
+		map.RemoveGroundBlockingObject(o);
+		model.Remove(o);
+		CheckCells(map, model);
+	}
+
+	BOOST_CHECK(map.GetCell(sq).empty());
+
+	map.AddGroundBlockingObject(objects[0]);
+	model.Add(objects[0]);
+	CheckCells(map, model);
+
+	// the slot of a square that became empty is used for the next one
+	const BlockingMapEntry* slotEntries = map.GetCell(sq).begin();
+	CSolidObject other(21, 8, 8, 1, 1, false);
+
+	map.RemoveGroundBlockingObject(objects[0]);
+	map.AddGroundBlockingObject(&other);
+	BOOST_CHECK(map.GetCell(8 + 8 * mapSize).begin() == slotEntries);
+
+	for (size_t n = 0; n < objects.size(); n++) {
+		delete objects[n];
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(RandomAddRemove)
+{
+	SetMapSize();
+	srand(1);
+
+	CGroundBlockingObjectMap map(mapSize * mapSize);
+	BlockingModel model;
+	std::vector<CSolidObject*> objects;
+
+	for (int n = 0; n < 100; n++) {
+		const int xsize = 1 + rand() % 4;
+		const int zsize = 1 + rand() % 4;
+		// immobile objects can be aligned one square towards the origin
+		const int x = rand() % (mapSize - xsize);
+		const int z = rand() % (mapSize - zsize);
+
+		objects.push_back(new CSolidObject(n, x, z, xsize, zsize, (rand() % 4) == 0));
+	}
+
+	for (int n = 0; n < 2000; n++) {
+		CSolidObject* o = objects[rand() % objects.size()];
+
+		if (o->isMarkedOnBlockingMap) {
+			map.RemoveGroundBlockingObject(o);
+			model.Remove(o);
+		} else {
+			map.AddGroundBlockingObject(o);
+			model.Add(o);
+		}
+
+		if ((n % 50) == 0)
+			CheckCells(map, model);
+	}
+
+	CheckCells(map, model);
+
+	for (size_t n = 0; n < objects.size(); n++) {
+		delete objects[n];
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(SaveAndLoad)
+{
+	SetMapSize();
+
+	CGroundBlockingObjectMap map(mapSize * mapSize);
+	BlockingModel model;
+	std::vector<CSolidObject*> objects;
+
+	// inline and overflowing squares, with a few freed slots in between
+	for (int n = 0; n < 30; n++) {
+		objects.push_back(new CSolidObject(n, (n % 6) * 2, (n % 3) * 2, 3, 3, (n % 5) == 0));
+
+		map.AddGroundBlockingObject(objects.back());
+		model.Add(objects.back());
+	}
+	for (int n = 0; n < 30; n += 4) {
+		map.RemoveGroundBlockingObject(objects[n]);
+		model.Remove(objects[n]);
+	}
+
+	CheckCells(map, model);
+
+	BufferSerializer s;
+	map.Serialize(s);
+
+	// load into a map that already has (other) contents
+	CGroundBlockingObjectMap loadedMap(4);
+	CSolidObject stale(99, 0, 0, 2, 2, true);
+	gs->mapx = gs->mapy = 2;
+	loadedMap.AddGroundBlockingObject(&stale);
+	SetMapSize();
+
+	s.StartReading();
+	loadedMap.Serialize(s);
+	s.FixPointers();
+	loadedMap.PostLoad();
+
+	CheckCells(loadedMap, model);
+
+	// and it keeps working after loading
+	for (int n = 1; n < 30; n += 4) {
+		loadedMap.RemoveGroundBlockingObject(objects[n]);
+		model.Remove(objects[n]);
+	}
+	loadedMap.AddGroundBlockingObject(objects[0]);
+	model.Add(objects[0]);
+
+	CheckCells(loadedMap, model);
+
+	for (size_t n = 0; n < objects.size(); n++) {
+		delete objects[n];
+	}
+}
@@ -0,0 +1,466 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+// Tests the engine's CQuadField (QuadField.cpp is compiled into this file)
+// against brute-force searches over all objects while they are inserted,
+// moved and removed. The engine types it works on are replaced by minimal
+// stand-ins with the members CQuadField uses; defining the include guards
+// of their headers makes QuadField.cpp use the stand-ins.
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <stdlib.h>
+
+#include "System/creg/creg_cond.h"
+#include "System/float3.h"
+#include "System/Vec2.h"
+
+// built without creg (see test/CMakeLists.txt), CQuadField::Serialize
+// only needs the name to exist
+#undef CR_DECLARE_STRUCT
+#define CR_DECLARE_STRUCT(TStr) static creg::Class* StaticClass() { return NULL; }
+
+#define BOOST_TEST_MODULE QuadField
+#include <boost/test/unit_test.hpp>
+
+#define _GLOBAL_SYNCED_H
+class CGlobalSynced {
+public:
+	int frameNum;
+	int tempNum;
+	int mapx;
+	int mapy;
+};
+
+#define TEAMHANDLER_H
+class CTeamHandler {
+public:
+	CTeamHandler(): allianceChangeNum(0) {}
+
+	unsigned int ActiveAllyTeams() const { return allies.size(); }
+	bool Ally(int a, int b) const { return allies[a][b]; }
+	void SetAlly(int a, int b, bool allied) { allies[a][b] = allied; allianceChangeNum++; }
+	unsigned int GetAllianceChangeNum() const { return allianceChangeNum; }
+
+	std::vector< std::vector<bool> > allies;
+	unsigned int allianceChangeNum;
+};
+
+#define SOLID_OBJECT_H
+class CSolidObject {
+public:
+	CSolidObject(): radius(0.0f), tempNum(0), blocking(true) {}
+
+	float3 pos;
+	float3 midPos;
+	float radius;
+	int tempNum;
+	bool blocking;
+};
+
+#define UNIT_H
+class CUnit: public CSolidObject {
+public:
+	CUnit(): allyteam(0) {}
+
+	int allyteam;
+	std::vector<int> quads;
+};
+
+#define _FEATURE_H
+class CFeature: public CSolidObject {
+};
+
+#define PROJECTILE_H
+class CProjectile {
+public:
+	CProjectile(): radius(0.0f), synced(true), quadFieldCellIdx(-1) {}
+
+	void SetQuadFieldCellCoors(const int2& cell) { quadFieldCellCoors = cell; }
+	int2 GetQuadFieldCellCoors() const { return quadFieldCellCoors; }
+	void SetQuadFieldCellIdx(int idx) { quadFieldCellIdx = idx; }
+	int GetQuadFieldCellIdx() const { return quadFieldCellIdx; }
+
+	float3 pos;
+	float radius;
+	bool synced;
+
+private:
+	int2 quadFieldCellCoors;
+	int quadFieldCellIdx;
+};
+
+static CGlobalSynced globalSynced;
+static CTeamHandler globalTeamHandler;
+
+CGlobalSynced* gs = &globalSynced;
+CTeamHandler* teamHandler = &globalTeamHandler;
+
+#include "Sim/Misc/QuadField.cpp"
+
+
+static const int numAllyTeams = 3;
+static const int numUnits = 300;
+static const int numFeatures = 200;
+static const int numProjectiles = 300;
+static const int numQueries = 200;
+
+static inline float randf()
+{
+	return rand() / float(RAND_MAX);
+}
+
+static float3 RandPos()
+{
+	// partly outside the map, which the quad-field has to clamp
+	return float3(randf() * (float3::maxxpos + 200.0f) - 100.0f, randf() * 100.0f, randf() * (float3::maxzpos + 200.0f) - 100.0f);
+}
+
+template<typename T> static std::vector<T*> Sorted(std::vector<T*> v)
+{
+	std::sort(v.begin(), v.end());
+	return v;
+}
+
+template<typename T> static bool HasDuplicates(const std::vector<T*>& v)
+{
+	const std::vector<T*> s = Sorted(v);
+	return (std::adjacent_find(s.begin(), s.end()) != s.end());
+}
+
+template<typename T> static std::vector<T*> BruteForce(std::vector<T>& objects, const float3& pos, float radius, bool spherical, bool onlyBlocking, bool objectRadius = true)
+{
+	std::vector<T*> found;
+
+	for (size_t i = 0; i < objects.size(); i++) {
+		T* o = &objects[i];
+		const float totRad = radius + (objectRadius? o->radius: 0.0f);
+		const float sqDist = spherical? (pos - o->midPos).SqLength(): (pos - o->midPos).SqLength2D();
+
+		if (onlyBlocking && !o->blocking)
+			continue;
+		if (sqDist >= (totRad * totRad))
+			continue;
+
+		found.push_back(o);
+	}
+
+	return Sorted(found);
+}
+
+static std::vector<CProjectile*> BruteForceProjectiles(std::vector<CProjectile>& projectiles, const float3& pos, float radius)
+{
+	std::vector<CProjectile*> found;
+
+	for (size_t i = 0; i < projectiles.size(); i++) {
+		const float totRad = radius + projectiles[i].radius;
+
+		if ((pos - projectiles[i].pos).SqLength() < (totRad * totRad)) {
+			found.push_back(&projectiles[i]);
+		}
+	}
+
+	return Sorted(found);
+}
+
+
+struct QuadFieldFixture {
+	QuadFieldFixture() {
+		srand(4321);
+
+		gs->frameNum = 0;
+		gs->tempNum = 1;
+		gs->mapx = 512;
+		gs->mapy = 384;
+
+		float3::maxxpos = gs->mapx * SQUARE_SIZE - 1;
+		float3::maxzpos = gs->mapy * SQUARE_SIZE - 1;
+
+		// ally-teams 0 and 1 are allied, 2 is on its own
+		teamHandler->allies.assign(numAllyTeams, std::vector<bool>(numAllyTeams, false));
+		for (int a = 0; a < numAllyTeams; a++) {
+			teamHandler->allies[a][a] = true;
+		}
+		teamHandler->allies[0][1] = true;
+		teamHandler->allies[1][0] = true;
+
+		quadField = new CQuadField();
+
+		units.resize(numUnits);
+		features.resize(numFeatures);
+		projectiles.resize(numProjectiles);
+
+		for (int i = 0; i < numUnits; i++) {
+			units[i].pos = units[i].midPos = RandPos();
+			units[i].radius = 5.0f + randf() * 300.0f;
+			units[i].allyteam = i % numAllyTeams;
+			units[i].blocking = ((i % 5) != 0);
+			quadField->MovedUnit(&units[i]);
+		}
+		for (int i = 0; i < numFeatures; i++) {
+			features[i].pos = features[i].midPos = RandPos();
+			features[i].radius = 5.0f + randf() * 100.0f;
+			features[i].blocking = ((i % 3) != 0);
+			quadField->AddFeature(&features[i]);
+		}
+		for (int i = 0; i < numProjectiles; i++) {
+			projectiles[i].pos = RandPos();
+			projectiles[i].radius = randf() * 10.0f;
+			quadField->AddProjectile(&projectiles[i]);
+		}
+	}
+	~QuadFieldFixture() {
+		delete quadField;
+	}
+
+	void MoveObjects() {
+		for (int i = 0; i < numUnits; i++) {
+			// mostly small steps (which often stay within the same quads), some teleports
+			if ((rand() % 10) == 0) {
+				units[i].pos = RandPos();
+			} else {
+				units[i].pos += float3(randf() * 64.0f - 32.0f, 0.0f, randf() * 64.0f - 32.0f);
+			}
+
+			units[i].midPos = units[i].pos;
+			quadField->MovedUnit(&units[i]);
+		}
+		for (int i = 0; i < numProjectiles; i++) {
+			projectiles[i].pos += float3(randf() * 200.0f - 100.0f, 0.0f, randf() * 200.0f - 100.0f);
+			quadField->MovedProjectile(&projectiles[i]);
+		}
+
+		gs->frameNum++;
+	}
+
+	// checks every query type at random positions against the brute-force results
+	void CheckQueries() {
+		std::vector<int> quads;
+		std::vector<CUnit*> mtUnits;
+		std::vector<CFeature*> mtFeatures;
+
+		for (int q = 0; q < numQueries; q++) {
+			const float3 pos = RandPos();
+			const float radius = randf() * 600.0f;
+
+			const std::vector<CUnit*> exactUnits = Sorted(quadField->GetUnitsExact(pos, radius, true));
+			BOOST_CHECK(exactUnits == BruteForce(units, pos, radius, true, false));
+			BOOST_CHECK(Sorted(quadField->GetUnitsExact(pos, radius, false)) == BruteForce(units, pos, radius, false, false));
+			BOOST_CHECK(Sorted(quadField->GetFeaturesExact(pos, radius)) == BruteForce(features, pos, radius, true, false));
+			// (the overload with <spherical> ignores the features' radii)
+			BOOST_CHECK(Sorted(quadField->GetFeaturesExact(pos, radius, true)) == BruteForce(features, pos, radius, true, false, false));
+			BOOST_CHECK(Sorted(quadField->GetFeaturesExact(pos, radius, false)) == BruteForce(features, pos, radius, false, false, false));
+			BOOST_CHECK(Sorted(quadField->GetProjectilesExact(pos, radius)) == BruteForceProjectiles(projectiles, pos, radius));
+
+			std::vector<CSolidObject*> solids = Sorted(quadField->GetSolidsExact(pos, radius));
+			std::vector<CSolidObject*> bruteSolids;
+			const std::vector<CUnit*> blockingUnits = BruteForce(units, pos, radius, true, true);
+			const std::vector<CFeature*> blockingFeatures = BruteForce(features, pos, radius, true, true);
+			bruteSolids.insert(bruteSolids.end(), blockingUnits.begin(), blockingUnits.end());
+			bruteSolids.insert(bruteSolids.end(), blockingFeatures.begin(), blockingFeatures.end());
+			BOOST_CHECK(solids == Sorted(bruteSolids));
+
+			// GetUnits does not test distances, but has to contain every unit in range once
+			const std::vector<CUnit*> quadUnits = Sorted(quadField->GetUnits(pos, radius));
+			BOOST_CHECK(!HasDuplicates(quadUnits));
+			BOOST_CHECK(std::includes(quadUnits.begin(), quadUnits.end(), exactUnits.begin(), exactUnits.end()));
+
+			// the thread-safe variant has to return the same objects in the same order
+			CUnit* unitBuf[numUnits + 1];
+			CFeature* featureBuf[numFeatures + 1];
+			CUnit** unitEnd = unitBuf;
+			CFeature** featureEnd = featureBuf;
+			quadField->GetUnitsAndFeaturesExact(pos, radius, unitEnd, featureEnd);
+			quadField->GetUnitsAndFeaturesExactMT(pos, radius, quads, mtUnits, mtFeatures);
+			BOOST_CHECK(mtUnits == std::vector<CUnit*>(unitBuf, unitEnd));
+			BOOST_CHECK(mtFeatures == std::vector<CFeature*>(featureBuf, featureEnd));
+			BOOST_CHECK(Sorted(mtFeatures) == BruteForce(features, pos, radius, true, false));
+
+			// rectangle queries compare the 2D position only
+			const float3 mins = pos - float3(radius, 0.0f, radius * 0.5f);
+			const float3 maxs = pos + float3(radius, 0.0f, radius * 0.5f);
+			std::vector<CUnit*> rectUnits;
+			for (int i = 0; i < numUnits; i++) {
+				const float3& p = units[i].midPos;
+				if (p.x >= mins.x && p.x <= maxs.x && p.z >= mins.z && p.z <= maxs.z) {
+					rectUnits.push_back(&units[i]);
+				}
+			}
+			BOOST_CHECK(Sorted(quadField->GetUnitsExact(mins, maxs)) == Sorted(rectUnits));
+		}
+	}
+
+	// every object has to be stored exactly in the quads it overlaps
+	void CheckQuads() {
+		for (int i = 0; i < numUnits; i++) {
+			BOOST_CHECK(units[i].quads == quadField->GetQuads(units[i].pos, units[i].radius));
+		}
+
+		for (int q = 0; q < quadField->GetNumQuadsX() * quadField->GetNumQuadsZ(); q++) {
+			const CQuadField::Quad& quad = quadField->GetQuad(q);
+
+			for (size_t i = 0; i < quad.units.size(); i++) {
+				const std::vector<int>& unitQuads = quad.units[i]->quads;
+				BOOST_CHECK(std::find(unitQuads.begin(), unitQuads.end(), q) != unitQuads.end());
+			}
+			for (size_t i = 0; i < quad.projectiles.size(); i++) {
+				BOOST_CHECK_EQUAL(quad.projectiles[i]->GetQuadFieldCellIdx(), int(i));
+			}
+
+			size_t numTeamUnits = 0;
+			for (int a = 0; a < numAllyTeams; a++) {
+				numTeamUnits += quad.teamUnits[a].size();
+			}
+			BOOST_CHECK_EQUAL(numTeamUnits, quad.units.size());
+		}
+	}
+
+	void CheckEnemyUnits() {
+		for (int q = 0; q < quadField->GetNumQuadsX() * quadField->GetNumQuadsZ(); q++) {
+			const CQuadField::Quad& quad = quadField->GetQuad(q);
+
+			for (int a = 0; a < numAllyTeams; a++) {
+				std::vector<CUnit*> enemies;
+
+				for (int t = 0; t < numAllyTeams; t++) {
+					if (!teamHandler->Ally(a, t)) {
+						enemies.insert(enemies.end(), quad.teamUnits[t].begin(), quad.teamUnits[t].end());
+					}
+				}
+
+				BOOST_CHECK(quadField->GetEnemyUnits(q, a) == enemies);
+			}
+		}
+	}
+
+	CQuadField* quadField;
+
+	std::vector<CUnit> units;
+	std::vector<CFeature> features;
+	std::vector<CProjectile> projectiles;
+};
+
+
+BOOST_FIXTURE_TEST_SUITE(QuadField, QuadFieldFixture)
+
+BOOST_AUTO_TEST_CASE(Insert)
+{
+	CheckQuads();
+	CheckQueries();
+}
+
+BOOST_AUTO_TEST_CASE(Move)
+{
+	for (int frame = 0; frame < 20; frame++) {
+		MoveObjects();
+		CheckQuads();
+		CheckQueries();
+	}
+}
+
+BOOST_AUTO_TEST_CASE(Remove)
+{
+	std::vector<CUnit> keptUnits;
+	std::vector<CFeature> keptFeatures;
+	std::vector<CProjectile> keptProjectiles;
+
+	// remove every other object; the remaining ones are searched
+	// for by address, so they have to stay where they are
+	for (int i = 0; i < numUnits; i += 2) {
+		quadField->RemoveUnit(&units[i]);
+		BOOST_CHECK(units[i].quads.empty());
+	}
+	for (int i = 0; i < numFeatures; i += 2) {
+		quadField->RemoveFeature(&features[i]);
+	}
+	for (int i = 0; i < numProjectiles; i += 2) {
+		quadField->RemoveProjectile(&projectiles[i]);
+		BOOST_CHECK_EQUAL(projectiles[i].GetQuadFieldCellIdx(), -1);
+	}
+
+	for (int q = 0; q < quadField->GetNumQuadsX() * quadField->GetNumQuadsZ(); q++) {
+		const CQuadField::Quad& quad = quadField->GetQuad(q);
+
+		for (size_t i = 0; i < quad.units.size(); i++) {
+			BOOST_CHECK(((quad.units[i] - &units[0]) % 2) == 1);
+		}
+		for (size_t i = 0; i < quad.features.size(); i++) {
+			BOOST_CHECK(((quad.features[i] - &features[0]) % 2) == 1);
+		}
+		for (size_t i = 0; i < quad.projectiles.size(); i++) {
+			BOOST_CHECK(((quad.projectiles[i] - &projectiles[0]) % 2) == 1);
+			BOOST_CHECK_EQUAL(quad.projectiles[i]->GetQuadFieldCellIdx(), int(i));
+		}
+	}
+
+	// the brute-force searches must not find the removed objects either
+	for (int i = 0; i < numUnits; i += 2) {
+		units[i].pos = units[i].midPos = float3(-1e6f, 0.0f, -1e6f);
+	}
+	for (int i = 0; i < numFeatures; i += 2) {
+		features[i].pos = features[i].midPos = float3(-1e6f, 0.0f, -1e6f);
+	}
+	for (int i = 0; i < numProjectiles; i += 2) {
+		projectiles[i].pos = float3(-1e6f, 0.0f, -1e6f);
+	}
+
+	CheckQueries();
+}
+
+BOOST_AUTO_TEST_CASE(EnemyUnits)
+{
+	for (int frame = 0; frame < 10; frame++) {
+		CheckEnemyUnits();
+
+		// ally-team 2 joins 0 and 1 halfway through, in the middle
+		// of a frame (as Lua's SetAlly can do)
+		if (frame == 5) {
+			for (int a = 0; a < numAllyTeams; a++) {
+				for (int b = 0; b < numAllyTeams; b++) {
+					teamHandler->SetAlly(a, b, true);
+				}
+			}
+
+			CheckEnemyUnits();
+		}
+
+		MoveObjects();
+	}
+}
+
+BOOST_AUTO_TEST_CASE(ChangeNums)
+{
+	CUnit& unit = units[0];
+	const unsigned int changeNum = quadField->GetChangeNum();
+
+	BOOST_CHECK(!quadField->QuadsChangedSince(unit.pos, unit.radius, changeNum));
+
+	quadField->MarkObjectChanged(&unit);
+	BOOST_CHECK(quadField->GetChangeNum() != changeNum);
+	BOOST_CHECK(quadField->QuadsChangedSince(unit.pos, unit.radius, changeNum));
+
+	const unsigned int changeNum2 = quadField->GetChangeNum();
+	quadField->MovedUnit(&unit);
+	BOOST_CHECK(quadField->QuadsChangedSince(unit.pos, unit.radius, changeNum2));
+
+	// queries that do not overlap any of the unit's quads see no change
+
+	const std::vector<int>& unitQuads = unit.quads;
+	for (int q = 0; q < quadField->GetNumQuadsX() * quadField->GetNumQuadsZ(); q++) {
+		if (std::find(unitQuads.begin(), unitQuads.end(), q) != unitQuads.end())
+			continue;
+
+		const float3 quadPos((q % quadField->GetNumQuadsX() + 0.5f) * CQuadField::QUAD_SIZE, 0.0f, (q / quadField->GetNumQuadsX() + 0.5f) * CQuadField::QUAD_SIZE);
+		const std::vector<int> queryQuads = quadField->GetQuads(quadPos, 1.0f);
+
+		bool overlaps = false;
+		for (size_t i = 0; i < queryQuads.size(); i++) {
+			overlaps |= (std::find(unitQuads.begin(), unitQuads.end(), queryQuads[i]) != unitQuads.end());
+		}
+		if (!overlaps) {
+			BOOST_CHECK(!quadField->QuadsChangedSince(quadPos, 1.0f, changeNum2));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,218 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+// Microbenchmark for the CQuadField cell storage: compares the old
+// std::list buckets (push_front + linear erase, freshly allocated result
+// vectors) with the current contiguous buckets (push_back + swap-remove,
+// reused result buffers) under a QuadField-like move/query workload, and
+// checks that both return the same objects for every query.
+
+#include "System/Util.h"
+#include <algorithm>
+#include <list>
+#include <vector>
+#include <stdlib.h>
+#include <time.h>
+
+#define BOOST_TEST_MODULE QuadFieldBuckets
+#include <boost/test/unit_test.hpp>
+
+static const int numQuadsX = 32;
+static const int numQuadsZ = 32;
+static const int numObjects = 4000;
+static const int numFrames = 100;
+static const int numQueries = 2000;
+
+struct Object {
+	float x, z;
+	int tempNum;
+	std::vector<int> quads;
+};
+
+static inline float randf()
+{
+	return rand() / float(RAND_MAX);
+}
+
+static void GetQuads(float x, float z, float radius, std::vector<int>& quads)
+{
+	quads.clear();
+
+	const int minx = std::max(int(x - radius), 0);
+	const int minz = std::max(int(z - radius), 0);
+	const int maxx = std::min(int(x + radius), numQuadsX - 1);
+	const int maxz = std::min(int(z + radius), numQuadsZ - 1);
+
+	for (int qz = minz; qz <= maxz; ++qz) {
+		for (int qx = minx; qx <= maxx; ++qx) {
+			quads.push_back(qz * numQuadsX + qx);
+		}
+	}
+}
+
+
+struct ListBuckets {
+	std::vector< std::list<Object*> > cells;
+	int tempNum;
+
+	ListBuckets(): cells(numQuadsX * numQuadsZ), tempNum(0) {}
+
+	void Add(Object* o, const std::vector<int>& quads) {
+		for (std::vector<int>::const_iterator qi = quads.begin(); qi != quads.end(); ++qi) {
+			cells[*qi].push_front(o);
+		}
+	}
+	void Remove(Object* o, const std::vector<int>& quads) {
+		for (std::vector<int>::const_iterator qi = quads.begin(); qi != quads.end(); ++qi) {
+			std::list<Object*>::iterator oi = std::find(cells[*qi].begin(), cells[*qi].end(), o);
+			if (oi != cells[*qi].end()) {
+				cells[*qi].erase(oi);
+			}
+		}
+	}
+	std::vector<Object*> Query(const std::vector<int>& quads) {
+		std::vector<Object*> ret;
+		++tempNum;
+
+		for (std::vector<int>::const_iterator qi = quads.begin(); qi != quads.end(); ++qi) {
+			for (std::list<Object*>::const_iterator oi = cells[*qi].begin(); oi != cells[*qi].end(); ++oi) {
+				if ((*oi)->tempNum == tempNum) { continue; }
+				(*oi)->tempNum = tempNum;
+				ret.push_back(*oi);
+			}
+		}
+
+		return ret;
+	}
+};
+
+struct VectorBuckets {
+	std::vector< std::vector<Object*> > cells;
+	int tempNum;
+
+	VectorBuckets(): cells(numQuadsX * numQuadsZ), tempNum(0) {}
+
+	void Add(Object* o, const std::vector<int>& quads) {
+		for (std::vector<int>::const_iterator qi = quads.begin(); qi != quads.end(); ++qi) {
+			cells[*qi].push_back(o);
+		}
+	}
+	void Remove(Object* o, const std::vector<int>& quads) {
+		for (std::vector<int>::const_iterator qi = quads.begin(); qi != quads.end(); ++qi) {
+			VectorEraseUnordered(cells[*qi], o);
+		}
+	}
+	void Query(const std::vector<int>& quads, std::vector<Object*>& ret) {
+		ret.clear();
+		++tempNum;
+
+		for (std::vector<int>::const_iterator qi = quads.begin(); qi != quads.end(); ++qi) {
+			for (std::vector<Object*>::const_iterator oi = cells[*qi].begin(); oi != cells[*qi].end(); ++oi) {
+				if ((*oi)->tempNum == tempNum) { continue; }
+				(*oi)->tempNum = tempNum;
+				ret.push_back(*oi);
+			}
+		}
+	}
+};
+
+
+template<typename Buckets>
+static double RunMoves(Buckets& buckets, std::vector<Object>& objects, unsigned int seed)
+{
+	srand(seed);
+
+	std::vector<int> newQuads;
+	const clock_t t0 = clock();
+
+	for (int f = 0; f < numFrames; ++f) {
+		for (std::vector<Object>::iterator oi = objects.begin(); oi != objects.end(); ++oi) {
+			oi->x = std::max(0.0f, std::min(numQuadsX - 0.01f, oi->x + (randf() - 0.5f) * 0.5f));
+			oi->z = std::max(0.0f, std::min(numQuadsZ - 0.01f, oi->z + (randf() - 0.5f) * 0.5f));
+
+			GetQuads(oi->x, oi->z, 0.25f, newQuads);
+
+			if (newQuads == oi->quads)
+				continue;
+
+			buckets.Remove(&*oi, oi->quads);
+			buckets.Add(&*oi, newQuads);
+			oi->quads = newQuads;
+		}
+	}
+
+	return double(clock() - t0) / CLOCKS_PER_SEC;
+}
+
+static void InitObjects(std::vector<Object>& objects)
+{
+	srand(1234);
+	objects.resize(numObjects);
+
+	for (std::vector<Object>::iterator oi = objects.begin(); oi != objects.end(); ++oi) {
+		oi->x = randf() * (numQuadsX - 0.01f);
+		oi->z = randf() * (numQuadsZ - 0.01f);
+		oi->tempNum = 0;
+		GetQuads(oi->x, oi->z, 0.25f, oi->quads);
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(QuadFieldBuckets)
+{
+	std::vector<Object> listObjects;
+	std::vector<Object> vectorObjects;
+	InitObjects(listObjects);
+	InitObjects(vectorObjects);
+
+	ListBuckets listBuckets;
+	VectorBuckets vectorBuckets;
+
+	for (int n = 0; n < numObjects; ++n) {
+		listBuckets.Add(&listObjects[n], listObjects[n].quads);
+		vectorBuckets.Add(&vectorObjects[n], vectorObjects[n].quads);
+	}
+
+	const double listMoveTime = RunMoves(listBuckets, listObjects, 5678);
+	const double vectorMoveTime = RunMoves(vectorBuckets, vectorObjects, 5678);
+
+	std::vector<int> quads;
+	std::vector<Object*> vectorResult;
+	std::vector<int> listIndices;
+	std::vector<int> vectorIndices;
+
+	double listQueryTime = 0.0;
+	double vectorQueryTime = 0.0;
+
+	srand(91011);
+
+	for (int q = 0; q < numQueries; ++q) {
+		GetQuads(randf() * numQuadsX, randf() * numQuadsZ, 1.0f + randf() * 3.0f, quads);
+
+		clock_t t0 = clock();
+		const std::vector<Object*> listResult = listBuckets.Query(quads);
+		listQueryTime += double(clock() - t0) / CLOCKS_PER_SEC;
+
+		t0 = clock();
+		vectorBuckets.Query(quads, vectorResult);
+		vectorQueryTime += double(clock() - t0) / CLOCKS_PER_SEC;
+
+		// iteration order differs, compare the object identities
+		listIndices.clear();
+		vectorIndices.clear();
+
+		for (size_t i = 0; i < listResult.size(); ++i) {
+			listIndices.push_back(listResult[i] - &listObjects[0]);
+		}
+		for (size_t i = 0; i < vectorResult.size(); ++i) {
+			vectorIndices.push_back(vectorResult[i] - &vectorObjects[0]);
+		}
+
+		std::sort(listIndices.begin(), listIndices.end());
+		std::sort(vectorIndices.begin(), vectorIndices.end());
+
+		BOOST_CHECK(listIndices == vectorIndices);
+	}
+
+	BOOST_TEST_MESSAGE("moves:   std::list " << listMoveTime << "s, std::vector " << vectorMoveTime << "s");
+	BOOST_TEST_MESSAGE("queries: std::list " << listQueryTime << "s, std::vector " << vectorQueryTime << "s");
+}
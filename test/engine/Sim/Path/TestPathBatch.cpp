@@ -0,0 +1,201 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Sim/Path/IPathManager.h"
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#define BOOST_TEST_MODULE PathBatch
+#include <boost/test/unit_test.hpp>
+
+// answers RequestPath at once and RequestPaths in the next Update, where
+// requests with the same start and goal share their search (like the
+// default path-manager does for requests in the same estimator blocks)
+class TestPathManager: public IPathManager {
+public:
+	TestPathManager(): nextPathID(0), numSearches(0), numBatches(0) {}
+
+	unsigned int GetPathFinderType() const { return PFS_TYPE_DEFAULT; }
+
+	void Update() {
+		std::map<std::pair<float, float>, float3> sharedSearches;
+
+		while (!queuedPaths.empty()) {
+			const unsigned int pathID = queuedPaths.front();
+			const std::pair<float, float> key(queuedStarts[pathID].x, queuedGoals[pathID].x);
+
+			queuedPaths.pop_front();
+
+			if (sharedSearches.find(key) == sharedSearches.end())
+				sharedSearches[key] = Search(queuedStarts[pathID], queuedGoals[pathID]);
+
+			paths[pathID] = sharedSearches[key];
+		}
+	}
+
+	void DeletePath(unsigned int pathID) {
+		paths.erase(pathID);
+		deletedPaths.push_back(pathID);
+	}
+
+	float3 NextWayPoint(unsigned int pathID, float3, float, int, int, bool) {
+		if (paths.find(pathID) != paths.end())
+			return paths[pathID];
+		if (queuedGoals.find(pathID) != queuedGoals.end())
+			return float3(queuedGoals[pathID].x, -1.0f, queuedGoals[pathID].z);
+
+		return float3(-1.0f, -1.0f, -1.0f);
+	}
+
+	unsigned int RequestPath(const MoveDef*, const float3& startPos, const float3& goalPos, float, CSolidObject*, bool) {
+		paths[++nextPathID] = Search(startPos, goalPos);
+		return nextPathID;
+	}
+
+	void RequestPaths(const std::vector<PathRequest>& requests, std::vector<unsigned int>& pathIDs) {
+		pathIDs.resize(requests.size());
+		numBatches += 1;
+
+		for (unsigned int n = 0; n < requests.size(); n++) {
+			pathIDs[n] = ++nextPathID;
+
+			queuedPaths.push_back(pathIDs[n]);
+			queuedStarts[pathIDs[n]] = requests[n].startPos;
+			queuedGoals[pathIDs[n]] = requests[n].goalPos;
+		}
+	}
+
+	float3 Search(const float3& startPos, const float3& goalPos) {
+		numSearches += 1;
+		return float3((startPos.x + goalPos.x) * 0.5f, 0.0f, (startPos.z + goalPos.z) * 0.5f);
+	}
+
+	unsigned int nextPathID;
+	unsigned int numSearches;
+	unsigned int numBatches;
+
+	std::map<unsigned int, float3> paths;
+	std::deque<unsigned int> queuedPaths;
+	std::map<unsigned int, float3> queuedStarts;
+	std::map<unsigned int, float3> queuedGoals;
+	std::vector<unsigned int> deletedPaths;
+};
+
+class TestCaller: public IPathManager::IPathBatchCaller {
+public:
+	void PathBatched(unsigned int pathID) { pathIDs.push_back(pathID); }
+
+	std::vector<unsigned int> pathIDs;
+};
+
+// a group of units in two clusters, ordered to the same goal
+static void CreateRequests(std::vector<IPathManager::PathRequest>& requests)
+{
+	const float3 goalPos(4000.0f, 0.0f, 4000.0f);
+
+	for (int n = 0; n < 20; n++) {
+		const float3 startPos((n % 2) * 1000.0f, 0.0f, (n % 2) * 1000.0f);
+		requests.push_back(IPathManager::PathRequest(NULL, startPos, goalPos));
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(BatchedMatchesSingleRequests)
+{
+	std::vector<IPathManager::PathRequest> requests;
+	CreateRequests(requests);
+
+	TestPathManager singlePM;
+	TestPathManager batchPM;
+	std::vector<TestCaller> callers(requests.size());
+
+	batchPM.BeginPathBatch();
+	for (unsigned int n = 0; n < requests.size(); n++) {
+		batchPM.AddToPathBatch(requests[n], &callers[n]);
+	}
+	BOOST_CHECK(callers[0].pathIDs.empty());
+	batchPM.EndPathBatch();
+
+	BOOST_CHECK_EQUAL(batchPM.numBatches, 1U);
+
+	for (unsigned int n = 0; n < requests.size(); n++) {
+		BOOST_REQUIRE_EQUAL(callers[n].pathIDs.size(), 1U);
+		// not searched yet, a temporary waypoint
+		BOOST_CHECK_EQUAL(batchPM.NextWayPoint(callers[n].pathIDs[0], ZeroVector, 0.0f, 0, 0, true).y, -1.0f);
+	}
+
+	batchPM.Update();
+
+	for (unsigned int n = 0; n < requests.size(); n++) {
+		const IPathManager::PathRequest& r = requests[n];
+		const unsigned int pathID = singlePM.RequestPath(r.moveDef, r.startPos, r.goalPos, r.goalRadius, r.caller, r.synced);
+
+		const float3 singleWayPoint = singlePM.NextWayPoint(pathID, ZeroVector, 0.0f, 0, 0, true);
+		const float3 batchWayPoint = batchPM.NextWayPoint(callers[n].pathIDs[0], ZeroVector, 0.0f, 0, 0, true);
+
+		BOOST_CHECK_EQUAL(singleWayPoint.x, batchWayPoint.x);
+		BOOST_CHECK_EQUAL(singleWayPoint.y, batchWayPoint.y);
+		BOOST_CHECK_EQUAL(singleWayPoint.z, batchWayPoint.z);
+	}
+
+	BOOST_CHECK_EQUAL(singlePM.numSearches, requests.size());
+	BOOST_CHECK_EQUAL(batchPM.numSearches, 2U);
+}
+
+BOOST_AUTO_TEST_CASE(NestedBatches)
+{
+	std::vector<IPathManager::PathRequest> requests;
+	CreateRequests(requests);
+
+	TestPathManager pm;
+	TestCaller caller;
+
+	pm.BeginPathBatch();
+	pm.BeginPathBatch();
+	pm.AddToPathBatch(requests[0], &caller);
+	pm.EndPathBatch();
+
+	BOOST_CHECK(pm.IsPathBatchOpen());
+	BOOST_CHECK(caller.pathIDs.empty());
+
+	pm.AddToPathBatch(requests[1], &caller);
+	pm.EndPathBatch();
+
+	BOOST_CHECK(!pm.IsPathBatchOpen());
+	BOOST_CHECK_EQUAL(pm.numBatches, 1U);
+	BOOST_CHECK_EQUAL(caller.pathIDs.size(), 2U);
+}
+
+BOOST_AUTO_TEST_CASE(EmptyBatch)
+{
+	TestPathManager pm;
+
+	pm.BeginPathBatch();
+	pm.EndPathBatch();
+
+	BOOST_CHECK_EQUAL(pm.numBatches, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(RemovedCaller)
+{
+	std::vector<IPathManager::PathRequest> requests;
+	CreateRequests(requests);
+
+	TestPathManager pm;
+	TestCaller keptCaller;
+	TestCaller removedCaller;
+
+	pm.BeginPathBatch();
+	pm.AddToPathBatch(requests[0], &removedCaller);
+	pm.AddToPathBatch(requests[1], &keptCaller);
+	pm.RemoveFromPathBatch(&removedCaller);
+	pm.EndPathBatch();
+
+	BOOST_CHECK(removedCaller.pathIDs.empty());
+	BOOST_REQUIRE_EQUAL(keptCaller.pathIDs.size(), 1U);
+
+	// nobody owns the removed caller's path, so it is released
+	BOOST_REQUIRE_EQUAL(pm.deletedPaths.size(), 1U);
+	BOOST_CHECK(pm.deletedPaths[0] != keptCaller.pathIDs[0]);
+}
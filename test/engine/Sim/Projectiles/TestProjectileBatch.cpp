@@ -0,0 +1,165 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "Sim/Projectiles/ProjectileBatch.h"
+
+#include <cstdlib>
+#include <ctime>
+#include <vector>
+
+#define BOOST_TEST_MODULE ProjectileBatch
+#include <boost/test/unit_test.hpp>
+
+// stand-ins for the engine classes, with the per-object Update
+// CProjectileHandler called before projectiles were batched
+struct Projectile {
+	Projectile(): px(0.0f), py(0.0f), pz(0.0f), vx(0.0f), vy(0.0f), vz(0.0f), gravity(0.0f), ttl(0), weapon(false) {}
+	virtual ~Projectile() {}
+	virtual void Update() {
+		vy += gravity;
+		px += vx; py += vy; pz += vz;
+	}
+
+	float px, py, pz;
+	float vx, vy, vz;
+	float gravity;
+	int ttl;
+	bool weapon;
+};
+
+struct WeaponProjectile: public Projectile {
+	WeaponProjectile() { weapon = true; }
+	void Update() {
+		Projectile::Update();
+		ttl--;
+	}
+};
+
+static float RandFloat(float scale)
+{
+	return (rand() / float(RAND_MAX) - 0.5f) * scale;
+}
+
+static void CreateProjectiles(std::vector<Projectile*>& projectiles, size_t count)
+{
+	srand(1234);
+
+	for (size_t i = 0; i < count; i++) {
+		Projectile* p = ((i % 3) == 0)? new Projectile(): new WeaponProjectile();
+
+		p->px = RandFloat(8192.0f); p->py = RandFloat(512.0f); p->pz = RandFloat(8192.0f);
+		p->vx = RandFloat(20.0f);   p->vy = RandFloat(20.0f);  p->vz = RandFloat(20.0f);
+		// batched types without gravity add -0.0f (see UpdateBatchedProjectiles)
+		p->gravity = ((i % 2) == 0)? RandFloat(0.5f): -0.0f;
+		p->ttl = rand() % 100;
+
+		projectiles.push_back(p);
+	}
+}
+
+static void DeleteProjectiles(std::vector<Projectile*>& projectiles)
+{
+	for (size_t i = 0; i < projectiles.size(); i++) {
+		delete projectiles[i];
+	}
+	projectiles.clear();
+}
+
+static void UpdateSerial(std::vector<Projectile*>& projectiles)
+{
+	for (size_t i = 0; i < projectiles.size(); i++) {
+		projectiles[i]->Update();
+	}
+}
+
+static void UpdateBatched(std::vector<Projectile*>& projectiles, ProjectileBatch& b)
+{
+	const size_t numProjectiles = projectiles.size();
+
+	b.resize(numProjectiles);
+
+	for (size_t i = 0; i < numProjectiles; i++) {
+		const Projectile* p = projectiles[i];
+
+		b.px[i] = p->px; b.py[i] = p->py; b.pz[i] = p->pz;
+		b.vx[i] = p->vx; b.vy[i] = p->vy; b.vz[i] = p->vz;
+		b.gravity[i] = p->gravity;
+		b.ttl[i] = p->ttl;
+		b.ttlStep[i] = p->weapon? 1: 0;
+	}
+
+	b.Integrate();
+
+	for (size_t i = 0; i < numProjectiles; i++) {
+		Projectile* p = projectiles[i];
+
+		p->px = b.px[i]; p->py = b.py[i]; p->pz = b.pz[i];
+		p->vy = b.vy[i];
+		p->ttl = b.ttl[i];
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(Empty)
+{
+	ProjectileBatch b;
+	b.Integrate();
+	BOOST_CHECK_EQUAL(b.size(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(SameAsSerialUpdate)
+{
+	std::vector<Projectile*> serial;
+	std::vector<Projectile*> batched;
+	ProjectileBatch b;
+
+	CreateProjectiles(serial, 1001);
+	CreateProjectiles(batched, 1001);
+
+	for (int frame = 0; frame < 50; frame++) {
+		UpdateSerial(serial);
+		UpdateBatched(batched, b);
+	}
+
+	for (size_t i = 0; i < serial.size(); i++) {
+		// bit-identical, not just close
+		BOOST_CHECK(serial[i]->px == batched[i]->px);
+		BOOST_CHECK(serial[i]->py == batched[i]->py);
+		BOOST_CHECK(serial[i]->pz == batched[i]->pz);
+		BOOST_CHECK(serial[i]->vx == batched[i]->vx);
+		BOOST_CHECK(serial[i]->vy == batched[i]->vy);
+		BOOST_CHECK(serial[i]->vz == batched[i]->vz);
+		BOOST_CHECK_EQUAL(serial[i]->ttl, batched[i]->ttl);
+	}
+
+	DeleteProjectiles(serial);
+	DeleteProjectiles(batched);
+}
+
+BOOST_AUTO_TEST_CASE(Benchmark)
+{
+	// a large battle has a few thousand live projectiles
+	std::vector<Projectile*> serial;
+	std::vector<Projectile*> batched;
+	ProjectileBatch b;
+
+	CreateProjectiles(serial, 5000);
+	CreateProjectiles(batched, 5000);
+
+	clock_t t0 = clock();
+	for (int frame = 0; frame < 2000; frame++) {
+		UpdateSerial(serial);
+	}
+	const double serialTime = double(clock() - t0) / CLOCKS_PER_SEC;
+
+	t0 = clock();
+	for (int frame = 0; frame < 2000; frame++) {
+		UpdateBatched(batched, b);
+	}
+	const double batchedTime = double(clock() - t0) / CLOCKS_PER_SEC;
+
+	BOOST_CHECK(serial[0]->px == batched[0]->px);
+	BOOST_TEST_MESSAGE("serial update " << serialTime << "s, batched update " << batchedTime << "s");
+
+	DeleteProjectiles(serial);
+	DeleteProjectiles(batched);
+}
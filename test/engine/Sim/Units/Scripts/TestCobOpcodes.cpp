@@ -0,0 +1,144 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+// Checks DecodeCobCode (the dispatch of CCobThread::Tick on the decoded
+// opcode indices is timed in TestCobThread).
+
+#include "Sim/Units/Scripts/CobOpcodes.h"
+#include <vector>
+#include <string>
+
+#define BOOST_TEST_MODULE CobOpcodes
+#include <boost/test/unit_test.hpp>
+
+static const int numIterations = 200;
+
+
+struct Script {
+	std::vector<int> code;
+	std::vector<int> offsets;
+	std::vector<int> lengths;
+	std::vector<std::string> names;
+
+	void Begin(const std::string& name) {
+		names.push_back(name);
+		offsets.push_back(code.size());
+		lengths.push_back(0);
+	}
+	int Emit(int op) {
+		code.push_back(op);
+		lengths.back()++;
+		return (code.size() - 1);
+	}
+	int Emit(int op, int arg) {
+		const int pc = Emit(op);
+		Emit(arg);
+		return pc;
+	}
+	int Emit(int op, int arg1, int arg2) {
+		const int pc = Emit(op, arg1);
+		Emit(arg2);
+		return pc;
+	}
+};
+
+
+/*
+ *	static-var sum;
+ *	Loop() {
+ *		var i;
+ *		while (i < numIterations) { sum = sum + i * 3; i = i + 1; }
+ *		return sum;
+ *	}
+ */
+static Script MakeLoopScript(int* loopPC = NULL, int* endPC = NULL)
+{
+	Script s;
+	s.Begin("Loop");
+	s.Emit(CREATE_LOCAL_VAR);
+
+	const int loop = s.Emit(PUSH_LOCAL_VAR, 0);
+	s.Emit(PUSH_CONSTANT, numIterations);
+	s.Emit(SET_LESS);
+	const int jne = s.Emit(JUMP_NOT_EQUAL, -1);
+
+	s.Emit(PUSH_STATIC, 0);
+	s.Emit(PUSH_LOCAL_VAR, 0);
+	s.Emit(PUSH_CONSTANT, 3);
+	s.Emit(MUL);
+	s.Emit(ADD);
+	s.Emit(POP_STATIC, 0);
+	s.Emit(PUSH_LOCAL_VAR, 0);
+	s.Emit(PUSH_CONSTANT, 1);
+	s.Emit(ADD);
+	s.Emit(POP_LOCAL_VAR, 0);
+	s.Emit(JUMP, loop);
+
+	const int end = s.Emit(PUSH_STATIC, 0);
+	s.Emit(RETURN);
+	s.code[jne + 1] = end;
+
+	if (loopPC != NULL) *loopPC = loop;
+	if (endPC != NULL) *endPC = end;
+
+	// CCobFile pads the code
+	s.code.resize(s.code.size() + 4, 0);
+	return s;
+}
+
+
+BOOST_AUTO_TEST_CASE(Decode)
+{
+	int loopPC = 0;
+	int endPC = 0;
+
+	const Script s = MakeLoopScript(&loopPC, &endPC);
+	std::vector<unsigned char> indices;
+
+	DecodeCobCode(&s.code[0], s.code.size(), s.offsets, s.lengths, s.names, indices, false);
+
+	BOOST_CHECK_EQUAL(indices.size(), s.code.size());
+	BOOST_CHECK_EQUAL(indices[0], COBOP_CREATE_LOCAL_VAR);
+	BOOST_CHECK_EQUAL(indices[loopPC], COBOP_PUSH_LOCAL_VAR);
+	BOOST_CHECK_EQUAL(indices[endPC], COBOP_PUSH_STATIC);
+
+	DecodeCobCode(&s.code[0], s.code.size(), s.offsets, s.lengths, s.names, indices, true);
+
+	// only the first word of a fused sequence changes
+	BOOST_CHECK_EQUAL(indices[loopPC], COBOP_PUSHL_PUSHC_CMP_JNE);
+	BOOST_CHECK_EQUAL(indices[loopPC + 2], COBOP_PUSH_CONSTANT);
+	BOOST_CHECK_EQUAL(indices[loopPC + 4], COBOP_SET_LESS);
+	BOOST_CHECK_EQUAL(indices[loopPC + 5], COBOP_JUMP_NOT_EQUAL);
+	// <numIterations> is not an opcode
+	BOOST_CHECK_EQUAL(indices[loopPC + 3], COBOP_UNKNOWN);
+}
+
+
+BOOST_AUTO_TEST_CASE(DecodeCalls)
+{
+	Script s;
+	s.Begin("Main");
+	const int pushSleep = s.Emit(PUSH_CONSTANT, 100);
+	s.Emit(SLEEP);
+	const int turn = s.Emit(PUSH_CONSTANT, 10);
+	s.Emit(PUSH_CONSTANT, 20);
+	s.Emit(TURN, 1, 2);
+	const int call = s.Emit(CALL, 1, 0);
+	const int luaCall = s.Emit(CALL, 2, 0);
+	// sequence cut off by the end of the script
+	const int pushc = s.Emit(PUSH_CONSTANT, 5);
+	s.Begin("Other");
+	s.Emit(SLEEP);
+	s.Emit(RETURN);
+	s.Begin("lua_Func");
+	s.Emit(RETURN);
+
+	std::vector<unsigned char> indices;
+	DecodeCobCode(&s.code[0], s.code.size(), s.offsets, s.lengths, s.names, indices);
+
+	BOOST_CHECK_EQUAL(indices[pushSleep], COBOP_PUSHC_SLEEP);
+	BOOST_CHECK_EQUAL(indices[turn], COBOP_PUSHC_PUSHC_TURN);
+	BOOST_CHECK_EQUAL(indices[turn + 2], COBOP_PUSH_CONSTANT);
+	BOOST_CHECK_EQUAL(indices[call], COBOP_REAL_CALL);
+	BOOST_CHECK_EQUAL(indices[luaCall], COBOP_LUA_CALL);
+	BOOST_CHECK_EQUAL(indices[pushc], COBOP_PUSH_CONSTANT);
+}
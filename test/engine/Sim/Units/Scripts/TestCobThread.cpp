@@ -0,0 +1,368 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+// Loads a COB image with the real CCobFile and runs it with the real
+// CCobThread::Tick, comparing the cost of dispatching on the plainly decoded
+// opcode indices with dispatching on the indices with superinstructions.
+// The unit, Lua, sound and file-system dependencies are replaced by the
+// minimal stand-ins below (their include guards keep the real headers out).
+
+#include <list>
+#include <string>
+#include <vector>
+#include <string.h>
+#include <time.h>
+
+using std::string;
+using std::vector;
+
+
+#define OBJECT_H
+class CObject {
+public:
+	enum DependenceType {DEPENDENCE_COBTHREAD};
+
+	virtual ~CObject() {}
+	void AddDeathDependence(CObject* obj, DependenceType dep) {}
+	virtual void DependentDied(CObject* o) {}
+};
+
+
+#define LUA_HASH_STRING_H
+class LuaHashString {
+public:
+	LuaHashString(const std::string& s): str(s) {}
+	const std::string& GetString() const { return str; }
+private:
+	std::string str;
+};
+
+
+#define LUA_RULES_H
+#define MAX_LUA_COB_ARGS 10
+class CUnit;
+class CLuaRules {
+public:
+	void Cob2Lua(const LuaHashString& funcName, const CUnit* unit, int& argsCount, int args[MAX_LUA_COB_ARGS]) {}
+};
+static CLuaRules* luaRules = NULL;
+
+
+#define _GLOBAL_SYNCED_H
+class CGlobalSynced {
+public:
+	int randInt() { return 0; }
+};
+static CGlobalSynced* gs = NULL;
+
+
+#define _I_SOUND_H_
+class ISound {
+public:
+	bool HasSoundItem(const std::string& name) const { return false; }
+	size_t GetSoundId(const std::string& name) { return 0; }
+};
+static ISound* sound = NULL;
+
+
+#define _FILE_HANDLER_H
+class CFileHandler {
+public:
+	CFileHandler(const std::vector<char>& data): data(data) {}
+	int FileSize() const { return data.size(); }
+	int Read(void* buf, int length) { memcpy(buf, &data[0], length); return length; }
+private:
+	const std::vector<char>& data;
+};
+
+
+#define COB_INSTANCE_H
+typedef void (*CBCobThreadFinish) (int retCode, void* p1, void* p2);
+class CCobThread;
+class CUnitScript: public CObject {
+public:
+	enum AnimType {ANone = -1, ATurn = 0, ASpin = 1, AMove = 2};
+
+	struct IAnimListener {
+		virtual ~IAnimListener() {}
+		virtual void AnimFinished(AnimType type, int piece, int axis) = 0;
+	};
+};
+class CCobInstance: public CUnitScript {
+public:
+	CCobInstance(int numStaticVars): staticVars(numStaticVars, 0), numTurns(0) {}
+
+	void Turn(int piece, int axis, int speed, int destination) { numTurns++; }
+	void Move(int piece, int axis, int speed, int destination) {}
+	void Spin(int piece, int axis, int speed, int accel) {}
+	void StopSpin(int piece, int axis, int decel) {}
+	void TurnNow(int piece, int axis, int destination) {}
+	void MoveNow(int piece, int axis, int destination) {}
+	bool AddAnimListener(CUnitScript::AnimType type, int piece, int axis, CUnitScript::IAnimListener* listener) { return false; }
+	int GetUnitVal(int val, int p1, int p2, int p3, int p4) { return 0; }
+	void SetUnitVal(int val, int param) {}
+	void Explode(int piece, int flags) {}
+	void PlayUnitSound(int snr, int attr) {}
+	void EmitSfx(int type, int piece) {}
+	void Signal(int signal) {}
+	void SetVisibility(int piece, bool visible) {}
+	void ShowFlare(int piece) {}
+	void AttachUnit(int piece, int unit) {}
+	void DropUnit(int unit) {}
+	CUnit* GetUnit() { return NULL; }
+
+	std::vector<int> staticVars;
+	std::list<CCobThread*> threads;
+
+	int numTurns;
+};
+
+
+#define COB_ENGINE_H
+class CCobEngine {
+public:
+	void AddThread(CCobThread* thread) {}
+};
+static CCobEngine GCobEngine;
+static int GCurrentTime = 0;
+
+
+#include "Sim/Units/Scripts/CobFile.cpp"
+#include "Sim/Units/Scripts/CobThread.cpp"
+
+#define BOOST_TEST_MODULE CobThread
+#include <boost/test/unit_test.hpp>
+
+static const int numIterations = 200;
+static const int numRuns = 5000;
+
+
+struct CobImage {
+	std::vector<int> code;
+	std::vector<int> offsets;
+	std::vector<std::string> names;
+	std::vector<std::string> pieces;
+
+	void Begin(const std::string& name) {
+		names.push_back(name);
+		offsets.push_back(code.size());
+	}
+	int Emit(int op) {
+		code.push_back(op);
+		return (code.size() - 1);
+	}
+	int Emit(int op, int arg) {
+		const int pc = Emit(op);
+		Emit(arg);
+		return pc;
+	}
+	int Emit(int op, int arg1, int arg2) {
+		const int pc = Emit(op, arg1);
+		Emit(arg2);
+		return pc;
+	}
+
+	// lays out a (little-endian) .cob file, the code has to come last
+	std::vector<char> Write(int numStaticVars) const {
+		std::vector<int> header(13, 0);
+		std::vector<char> strings;
+		std::vector<int> nameOffsets;
+
+		const int headerSize = header.size() * 4;
+		const int tablesSize = (names.size() * 2 + pieces.size()) * 4;
+
+		for (size_t n = 0; n < names.size() + pieces.size(); n++) {
+			const std::string& s = (n < names.size())? names[n]: pieces[n - names.size()];
+			nameOffsets.push_back(headerSize + tablesSize + strings.size());
+			strings.insert(strings.end(), s.begin(), s.end());
+			strings.push_back(0);
+		}
+		strings.resize((strings.size() + 3) & ~3, 0);
+
+		header[0] = 4;
+		header[1] = names.size();
+		header[2] = pieces.size();
+		header[3] = code.size();
+		header[4] = numStaticVars;
+		header[6] = headerSize;
+		header[7] = headerSize + names.size() * 4;
+		header[8] = headerSize + names.size() * 8;
+		header[9] = headerSize + tablesSize + strings.size();
+
+		std::vector<int> words(header);
+		words.insert(words.end(), offsets.begin(), offsets.end());
+		words.insert(words.end(), nameOffsets.begin(), nameOffsets.end());
+
+		std::vector<char> data((char*) &words[0], (char*) &words[0] + words.size() * 4);
+		data.insert(data.end(), strings.begin(), strings.end());
+		data.insert(data.end(), (const char*) &code[0], (const char*) &code[0] + code.size() * 4);
+		return data;
+	}
+};
+
+
+/*
+ *	piece base, turret;
+ *	static-var sum;
+ *
+ *	Loop() {
+ *		var i;
+ *		while (i < numIterations) {
+ *			turn turret to y-axis 100 speed 200;
+ *			call-script Accumulate(i);
+ *			i = i + 1;
+ *		}
+ *		return sum;
+ *	}
+ *
+ *	Accumulate(x) {
+ *		sum = sum + x * 3;
+ *		return 0;
+ *	}
+ */
+static std::vector<char> MakeLoopCob(int* loopPC = NULL, int* turnPC = NULL)
+{
+	CobImage c;
+	c.pieces.push_back("base");
+	c.pieces.push_back("turret");
+
+	c.Begin("Loop");
+	c.Emit(CREATE_LOCAL_VAR);
+
+	const int loop = c.Emit(PUSH_LOCAL_VAR, 0);
+	c.Emit(PUSH_CONSTANT, numIterations);
+	c.Emit(SET_LESS);
+	const int jne = c.Emit(JUMP_NOT_EQUAL, -1);
+
+	const int turn = c.Emit(PUSH_CONSTANT, 100);
+	c.Emit(PUSH_CONSTANT, 200);
+	c.Emit(TURN, 1, 1);
+	c.Emit(PUSH_LOCAL_VAR, 0);
+	c.Emit(CALL, 1, 1);
+	c.Emit(PUSH_LOCAL_VAR, 0);
+	c.Emit(PUSH_CONSTANT, 1);
+	c.Emit(ADD);
+	c.Emit(POP_LOCAL_VAR, 0);
+	c.Emit(JUMP, loop);
+
+	c.code[jne + 1] = c.Emit(PUSH_STATIC, 0);
+	c.Emit(RETURN);
+
+	c.Begin("Accumulate");
+	c.Emit(CREATE_LOCAL_VAR);
+	c.Emit(PUSH_STATIC, 0);
+	c.Emit(PUSH_LOCAL_VAR, 0);
+	c.Emit(PUSH_CONSTANT, 3);
+	c.Emit(MUL);
+	c.Emit(ADD);
+	c.Emit(POP_STATIC, 0);
+	c.Emit(PUSH_CONSTANT, 0);
+	c.Emit(RETURN);
+
+	if (loopPC != NULL) *loopPC = loop;
+	if (turnPC != NULL) *turnPC = turn;
+
+	return c.Write(1);
+}
+
+static int RunLoop(CCobFile& file, CCobInstance& owner)
+{
+	CCobThread* thread = new CCobThread(file, &owner);
+	thread->Start(file.GetFunctionId("Loop"), std::vector<int>(), false);
+
+	while (thread->Tick()) {
+	}
+
+	const int result = (thread->state == CCobThread::Dead)? owner.staticVars[0]: -1;
+	delete thread;
+	return result;
+}
+
+// decode the loaded code again, with or without superinstructions
+static void Redecode(CCobFile& file, bool superInstructions)
+{
+	const int codeSize = file.opcodeIndices.size();
+	DecodeCobCode(file.code, codeSize, file.scriptOffsets, file.scriptLengths, file.scriptNames, file.opcodeIndices, superInstructions);
+}
+
+
+BOOST_AUTO_TEST_CASE(LoadAndRun)
+{
+	int loopPC = 0;
+	int turnPC = 0;
+
+	const std::vector<char> data = MakeLoopCob(&loopPC, &turnPC);
+	CFileHandler fh(data);
+	CCobFile file(fh, "loop.cob");
+
+	BOOST_CHECK_EQUAL(file.scriptNames.size(), 2U);
+	BOOST_CHECK_EQUAL(file.pieceNames[1], "turret");
+	BOOST_CHECK_EQUAL(file.GetFunctionId("Accumulate"), 1);
+	BOOST_CHECK_EQUAL(file.opcodeIndices[loopPC], COBOP_PUSHL_PUSHC_CMP_JNE);
+	BOOST_CHECK_EQUAL(file.opcodeIndices[turnPC], COBOP_PUSHC_PUSHC_TURN);
+
+	CCobInstance owner(file.numStaticVars);
+
+	BOOST_CHECK_EQUAL(RunLoop(file, owner), 3 * numIterations * (numIterations - 1) / 2);
+	BOOST_CHECK_EQUAL(owner.numTurns, numIterations);
+	BOOST_CHECK(owner.threads.empty());
+}
+
+
+BOOST_AUTO_TEST_CASE(EmptyCode)
+{
+	const std::vector<char> data = MakeLoopCob();
+	CFileHandler fh(data);
+	CCobFile file(fh, "loop.cob");
+
+	// the loader pads the code, so only a file without decoded code has none
+	file.opcodeIndices.clear();
+
+	CCobInstance owner(file.numStaticVars);
+	CCobThread* thread = new CCobThread(file, &owner);
+	thread->Start(file.GetFunctionId("Loop"), std::vector<int>(), false);
+
+	BOOST_CHECK(!thread->Tick());
+	BOOST_CHECK(thread->state == CCobThread::Dead);
+	delete thread;
+}
+
+
+BOOST_AUTO_TEST_CASE(TickBenchmark)
+{
+	const std::vector<char> data = MakeLoopCob();
+	CFileHandler fh(data);
+	CCobFile file(fh, "loop.cob");
+
+	CCobInstance plainOwner(file.numStaticVars);
+	CCobInstance fusedOwner(file.numStaticVars);
+	int plainResult = 0;
+	int fusedResult = 0;
+
+	Redecode(file, false);
+
+	clock_t t0 = clock();
+
+	for (int n = 0; n < numRuns; n++) {
+		plainOwner.staticVars[0] = 0;
+		plainResult = RunLoop(file, plainOwner);
+	}
+
+	const double plainTime = double(clock() - t0) / CLOCKS_PER_SEC;
+
+	Redecode(file, true);
+
+	t0 = clock();
+
+	for (int n = 0; n < numRuns; n++) {
+		fusedOwner.staticVars[0] = 0;
+		fusedResult = RunLoop(file, fusedOwner);
+	}
+
+	const double fusedTime = double(clock() - t0) / CLOCKS_PER_SEC;
+
+	BOOST_CHECK(plainResult != -1);
+	BOOST_CHECK_EQUAL(plainResult, fusedResult);
+	BOOST_CHECK_EQUAL(plainOwner.numTurns, fusedOwner.numTurns);
+
+	BOOST_TEST_MESSAGE("CCobThread::Tick on decoded opcodes " << plainTime << "s, with superinstructions " << fusedTime << "s");
+}
@@ -0,0 +1,250 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+// Checks that CCobTimerWheel wakes up sleeping threads in order of wake
+// time, and in the order they went to sleep for equal wake times, by
+// running a simulated CCobEngine::Tick loop on it and on a reference
+// scheduler, and compares its speed with the std::priority_queue it replaced.
+
+#include "Sim/Units/Scripts/CobTimerWheel.h"
+#include <algorithm>
+#include <vector>
+#include <queue>
+#include <time.h>
+
+#define BOOST_TEST_MODULE CobTimerWheel
+#include <boost/test/unit_test.hpp>
+
+static const int tickTime = 33;
+
+
+struct Thread {
+	Thread(): id(0), wakeTime(0), wheelNext(NULL) {}
+
+	int GetWakeTime() const { return wakeTime; }
+
+	int id;
+	int wakeTime;
+	Thread* wheelNext;
+};
+
+
+/// sorted by wake time and insertion order
+struct ReferenceScheduler {
+	struct Entry {
+		Entry(Thread* t, unsigned int order): t(t), order(order) {}
+
+		bool operator < (const Entry& e) const {
+			if (t->wakeTime != e.t->wakeTime)
+				return (t->wakeTime < e.t->wakeTime);
+			return (order < e.order);
+		}
+
+		Thread* t;
+		unsigned int order;
+	};
+
+	ReferenceScheduler(): numInserted(0) {}
+
+	void Insert(Thread* t) {
+		entries.insert(std::upper_bound(entries.begin(), entries.end(), Entry(t, numInserted)), Entry(t, numInserted));
+		numInserted++;
+	}
+	Thread* PopExpired(int time) {
+		if (entries.empty() || entries.front().t->wakeTime >= time)
+			return NULL;
+
+		Thread* t = entries.front().t;
+		entries.erase(entries.begin());
+		return t;
+	}
+
+	std::vector<Entry> entries;
+	unsigned int numInserted;
+};
+
+
+/// the sleep a thread goes to after waking up at <wakeTime> (<0 means it dies)
+static int GetSleepTime(const Thread& t, int& seed)
+{
+	seed = seed * 1103515245 + 12345;
+	const int r = (seed >> 16) & 0x7fff;
+
+	switch (t.id % 8) {
+		case 0: return -1;                  // never wakes up again
+		case 1: return ((r % 4) * 100);     // typical animation loops (ties!)
+		case 2: return (r % 40);
+		case 3: return (r % 500);
+		case 4: return (300 + (r % 20000)); // crosses level 1
+		case 5: return ((r % 64) == 0)? (r * 3000): (r % 1000); // crosses the higher levels
+		case 6: return ((r % 16) == 0)? -(r % 50) - 2: 0; // wake time before GCurrentTime
+		default: return (r % 100);
+	}
+}
+
+template<typename Scheduler>
+static std::vector<int> Simulate(Scheduler& scheduler, std::vector<Thread>& threads, int numTicks)
+{
+	std::vector<int> wakeOrder;
+	int seed = 1;
+	int curTime = 0;
+
+	// the remaining threads are started later
+	const size_t numInitialThreads = threads.size() / 2;
+	size_t numStartedThreads = numInitialThreads;
+
+	for (size_t n = 0; n < threads.size(); n++) {
+		threads[n].id = n;
+		threads[n].wakeTime = (n * 7) % 300;
+
+		if (n < numInitialThreads)
+			scheduler.Insert(&threads[n]);
+	}
+
+	for (int tick = 0; tick < numTicks; tick++) {
+		curTime += tickTime;
+
+		Thread* t = NULL;
+
+		while ((t = scheduler.PopExpired(curTime)) != NULL) {
+			wakeOrder.push_back(t->id);
+
+			const int sleepTime = GetSleepTime(*t, seed);
+
+			if (sleepTime == -1)
+				continue;
+			// do not let it wake up over and over within the same tick
+			if (sleepTime < 0 && (wakeOrder.size() % 4) != 0)
+				continue;
+
+			t->wakeTime = curTime + sleepTime;
+			scheduler.Insert(t);
+		}
+
+		// threads started between ticks (CCobThread::Start, AnimFinished)
+		if ((tick % 10) == 0 && numStartedThreads < threads.size()) {
+			t = &threads[numStartedThreads++];
+			t->wakeTime = curTime + (tick % 3) - 1;
+			scheduler.Insert(t);
+		}
+	}
+
+	return wakeOrder;
+}
+
+
+BOOST_AUTO_TEST_CASE(WakeOrder)
+{
+	std::vector<Thread> wheelThreads(1000);
+	std::vector<Thread> refThreads(1000);
+
+	CCobTimerWheel<Thread> wheel;
+	ReferenceScheduler ref;
+
+	// covers more than two wrap-arounds of level 2
+	const std::vector<int> wheelOrder = Simulate(wheel, wheelThreads, 2 * (1 << 20) / tickTime + 100);
+	const std::vector<int> refOrder = Simulate(ref, refThreads, 2 * (1 << 20) / tickTime + 100);
+
+	BOOST_CHECK_EQUAL(wheelOrder.size(), refOrder.size());
+	BOOST_CHECK(wheelOrder == refOrder);
+	BOOST_CHECK_EQUAL(wheel.size(), ref.entries.size());
+
+	size_t numLeft = 0;
+
+	while (wheel.PopAny() != NULL) {
+		numLeft++;
+	}
+
+	BOOST_CHECK_EQUAL(numLeft, ref.entries.size());
+	BOOST_CHECK(wheel.empty());
+}
+
+
+BOOST_AUTO_TEST_CASE(Overflow)
+{
+	CCobTimerWheel<Thread> wheel;
+	std::vector<Thread> threads(3);
+
+	// further ahead than the top level reaches
+	threads[0].wakeTime = (1 << 27) + 5;
+	threads[1].wakeTime = (1 << 27) + 5;
+	threads[2].wakeTime = 1000;
+
+	for (size_t n = 0; n < threads.size(); n++) {
+		threads[n].id = n;
+		wheel.Insert(&threads[n]);
+	}
+
+	BOOST_CHECK(wheel.PopExpired(1000) == NULL);
+	BOOST_CHECK(wheel.PopExpired(1001) == &threads[2]);
+	BOOST_CHECK(wheel.PopExpired((1 << 27) + 5) == NULL);
+	BOOST_CHECK(wheel.PopExpired((1 << 27) + 6) == &threads[0]);
+	BOOST_CHECK(wheel.PopExpired((1 << 27) + 6) == &threads[1]);
+	BOOST_CHECK(wheel.empty());
+}
+
+
+struct Thread_less {
+	bool operator() (const Thread* a, const Thread* b) const {
+		return a->GetWakeTime() > b->GetWakeTime();
+	}
+};
+
+BOOST_AUTO_TEST_CASE(SleepBenchmark)
+{
+	// many animation threads sleeping in short loops
+	const int numThreads = 20000;
+	const int numTicks = 3000;
+
+	std::vector<Thread> threads(numThreads);
+	std::priority_queue<Thread*, std::vector<Thread*>, Thread_less> heap;
+	CCobTimerWheel<Thread> wheel;
+
+	int numHeapWakeUps = 0;
+	int numWheelWakeUps = 0;
+
+	for (int n = 0; n < numThreads; n++) {
+		threads[n].id = n;
+		threads[n].wakeTime = n % 100;
+		heap.push(&threads[n]);
+	}
+
+	clock_t t0 = clock();
+
+	for (int tick = 1; tick <= numTicks; tick++) {
+		const int curTime = tick * tickTime;
+
+		while (heap.top()->GetWakeTime() < curTime) {
+			Thread* t = heap.top();
+			heap.pop();
+			t->wakeTime = curTime + 30 + (t->id % 7) * 10;
+			heap.push(t);
+			numHeapWakeUps++;
+		}
+	}
+
+	const double heapTime = double(clock() - t0) / CLOCKS_PER_SEC;
+
+	for (int n = 0; n < numThreads; n++) {
+		threads[n].wakeTime = n % 100;
+		wheel.Insert(&threads[n]);
+	}
+
+	t0 = clock();
+
+	for (int tick = 1; tick <= numTicks; tick++) {
+		const int curTime = tick * tickTime;
+
+		Thread* t = NULL;
+
+		while ((t = wheel.PopExpired(curTime)) != NULL) {
+			t->wakeTime = curTime + 30 + (t->id % 7) * 10;
+			wheel.Insert(t);
+			numWheelWakeUps++;
+		}
+	}
+
+	const double wheelTime = double(clock() - t0) / CLOCKS_PER_SEC;
+
+	BOOST_CHECK_EQUAL(numHeapWakeUps, numWheelWakeUps);
+	BOOST_TEST_MESSAGE("priority_queue " << heapTime << "s, timer wheel " << wheelTime << "s");
+}
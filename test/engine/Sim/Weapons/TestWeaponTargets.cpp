@@ -0,0 +1,182 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+// Microbenchmark for weapon target selection: compares the old path
+// (candidates inserted into a freshly allocated std::multimap, iterated in
+// order) with the current one (candidates appended to a reused vector,
+// sorted lazily by SortWeaponTargets) using the selection loop of
+// CWeapon::SlowUpdate, and checks that both pick the same target.
+
+#include "Sim/Weapons/WeaponTarget.h"
+#include <map>
+#include <vector>
+#include <stdlib.h>
+#include <time.h>
+
+#define BOOST_TEST_MODULE WeaponTargets
+#include <boost/test/unit_test.hpp>
+
+// stand-in for the engine class, with just the fields the target choice reads
+class CUnit { public: int id; bool badTarget; bool unreachable; };
+
+static const int numUnits = 2000;
+static const int numRetargets = 20000;
+static const int maxCandidates = 200;
+
+static inline float randf()
+{
+	return rand() / float(RAND_MAX);
+}
+
+struct Candidate {
+	float priority;
+	CUnit* unit;
+};
+
+// same decisions as CWeapon::SlowUpdate, TryTarget replaced by a flag
+template<typename Iterator>
+static CUnit* SelectTarget(Iterator it, Iterator end)
+{
+	CUnit* badTargetUnit = NULL;
+
+	for (; it != end; ++it) {
+		CUnit* unit = it.Unit();
+
+		if (unit->unreachable)
+			continue;
+
+		if (unit->badTarget) {
+			if (badTargetUnit == NULL)
+				badTargetUnit = unit;
+			continue;
+		}
+
+		return unit;
+	}
+
+	return badTargetUnit;
+}
+
+struct MultiMapIterator {
+	typedef std::multimap<float, CUnit*>::const_iterator It;
+	It it;
+
+	MultiMapIterator(It it): it(it) {}
+	CUnit* Unit() const { return it->second; }
+	void operator ++ () { ++it; }
+	bool operator != (const MultiMapIterator& i) const { return (it != i.it); }
+};
+
+struct LazyIterator {
+	std::vector<WeaponTarget>* targets;
+	size_t* numSorted;
+	size_t n;
+
+	LazyIterator(std::vector<WeaponTarget>* targets, size_t* numSorted, size_t n): targets(targets), numSorted(numSorted), n(n) {}
+	CUnit* Unit() const {
+		*numSorted = SortWeaponTargets(*targets, *numSorted, n);
+		return (*targets)[n].unit;
+	}
+	void operator ++ () { ++n; }
+	bool operator != (const LazyIterator& i) const { return (n != i.n); }
+};
+
+
+BOOST_AUTO_TEST_CASE(SortedOrder)
+{
+	srand(1);
+
+	std::vector<WeaponTarget> targets;
+	std::multimap<float, CUnit*> sortedTargets;
+	std::vector<CUnit> units(100);
+
+	for (int k = 0; k < 100; k++) {
+		targets.clear();
+		sortedTargets.clear();
+
+		for (unsigned int n = 0; n < units.size(); n++) {
+			// few distinct priorities, so there are many ties
+			const float priority = rand() % 10;
+
+			targets.push_back(WeaponTarget(priority, targets.size(), &units[rand() % units.size()]));
+			sortedTargets.insert(std::pair<float, CUnit*>(priority, targets.back().unit));
+		}
+
+		size_t numSorted = 0;
+		size_t n = 0;
+
+		for (std::multimap<float, CUnit*>::const_iterator it = sortedTargets.begin(); it != sortedTargets.end(); ++it, ++n) {
+			numSorted = SortWeaponTargets(targets, numSorted, n);
+
+			BOOST_CHECK_EQUAL(targets[n].priority, it->first);
+			BOOST_CHECK_EQUAL(targets[n].unit, it->second);
+		}
+
+		BOOST_CHECK_EQUAL(n, targets.size());
+	}
+}
+
+
+BOOST_AUTO_TEST_CASE(SelectSameTargets)
+{
+	srand(2);
+
+	std::vector<CUnit> units(numUnits);
+	std::vector< std::vector<Candidate> > retargets(numRetargets);
+
+	for (int n = 0; n < numUnits; n++) {
+		units[n].id = n;
+		units[n].badTarget = (randf() < 0.1f);
+		units[n].unreachable = (randf() < 0.3f);
+	}
+
+	for (int k = 0; k < numRetargets; k++) {
+		const int numCandidates = rand() % maxCandidates;
+
+		for (int n = 0; n < numCandidates; n++) {
+			Candidate c;
+			c.priority = (randf() < 0.2f)? 1000.0f: (randf() * 10000.0f);
+			c.unit = &units[rand() % numUnits];
+			retargets[k].push_back(c);
+		}
+	}
+
+	std::vector<CUnit*> mapResults(numRetargets);
+	std::vector<CUnit*> lazyResults(numRetargets);
+
+	clock_t t0 = clock();
+
+	for (int k = 0; k < numRetargets; k++) {
+		std::multimap<float, CUnit*> targets;
+
+		for (unsigned int n = 0; n < retargets[k].size(); n++) {
+			targets.insert(std::pair<float, CUnit*>(retargets[k][n].priority, retargets[k][n].unit));
+		}
+
+		mapResults[k] = SelectTarget(MultiMapIterator(targets.begin()), MultiMapIterator(targets.end()));
+	}
+
+	const double mapTime = double(clock() - t0) / CLOCKS_PER_SEC;
+
+	t0 = clock();
+
+	std::vector<WeaponTarget> targets;
+
+	for (int k = 0; k < numRetargets; k++) {
+		targets.clear();
+
+		for (unsigned int n = 0; n < retargets[k].size(); n++) {
+			targets.push_back(WeaponTarget(retargets[k][n].priority, targets.size(), retargets[k][n].unit));
+		}
+
+		size_t numSorted = 0;
+		lazyResults[k] = SelectTarget(LazyIterator(&targets, &numSorted, 0), LazyIterator(&targets, &numSorted, targets.size()));
+	}
+
+	const double lazyTime = double(clock() - t0) / CLOCKS_PER_SEC;
+
+	for (int k = 0; k < numRetargets; k++) {
+		BOOST_CHECK_EQUAL(mapResults[k], lazyResults[k]);
+	}
+
+	BOOST_TEST_MESSAGE("std::multimap " << mapTime << "s, lazily sorted std::vector " << lazyTime << "s");
+}
@@ -0,0 +1,148 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/Platform/ThreadPool.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <boost/bind.hpp>
+
+#define BOOST_TEST_MODULE ThreadPool
+#include <boost/test/unit_test.hpp>
+
+static std::vector<int> counts;
+static std::vector<int> order;
+static volatile int orderPos = 0;
+
+static void Count(int i)
+{
+	// every index is visited by exactly one thread, no atomics needed
+	counts[i] += 1;
+}
+
+static void CountInto(std::vector<int>* v, int i)
+{
+	(*v)[i] += 1;
+}
+
+static void CountRange(int begin, int end)
+{
+	for (int i = begin; i < end; i++) {
+		counts[i] += 1;
+	}
+}
+
+static void CountNested(int i)
+{
+	// waiting inside a task must not deadlock, the waiting
+	// thread executes the (nested) chunks itself if needed
+	std::vector<int> nested(64, 0);
+	ThreadPool::parallel_for(0, nested.size(), boost::bind(&CountInto, &nested, _1), 4);
+
+	if (std::count(nested.begin(), nested.end(), 1) == 64) {
+		counts[i] += 1;
+	}
+}
+
+static void Record(int id)
+{
+	order[__sync_fetch_and_add(&orderPos, 1)] = id;
+}
+
+static void Throw()
+{
+	throw std::runtime_error("task failed");
+}
+
+
+BOOST_AUTO_TEST_CASE(ParallelFor)
+{
+	for (unsigned int numThreads = 1; numThreads <= 4; numThreads++) {
+		ThreadPool::SetThreadCount(numThreads);
+		BOOST_CHECK(ThreadPool::GetNumThreads() == numThreads);
+
+		counts.assign(100000, 0);
+		ThreadPool::parallel_for(0, counts.size(), boost::bind(&Count, _1));
+
+		for (unsigned int i = 0; i < counts.size(); i++) {
+			BOOST_REQUIRE(counts[i] == 1);
+		}
+
+		// empty and single-chunk ranges
+		ThreadPool::parallel_for(5, 5, boost::bind(&Count, _1));
+		ThreadPool::parallel_for(0, 3, boost::bind(&Count, _1), 16);
+
+		BOOST_CHECK(counts[0] == 2 && counts[2] == 2 && counts[3] == 1 && counts[5] == 1);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(NestedParallelFor)
+{
+	ThreadPool::SetThreadCount(4);
+
+	counts.assign(1000, 0);
+	ThreadPool::parallel_for(0, counts.size(), boost::bind(&CountNested, _1));
+
+	for (unsigned int i = 0; i < counts.size(); i++) {
+		BOOST_REQUIRE(counts[i] == 1);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(ParallelForRanges)
+{
+	ThreadPool::SetThreadCount(4);
+
+	counts.assign(10007, 0);
+	ThreadPool::parallel_for_ranges(0, counts.size(), boost::bind(&CountRange, _1, _2), 64);
+
+	for (unsigned int i = 0; i < counts.size(); i++) {
+		BOOST_REQUIRE(counts[i] == 1);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(TaskGraph)
+{
+	ThreadPool::SetThreadCount(4);
+
+	for (unsigned int n = 0; n < 100; n++) {
+		// diamond: 0 -> {1, 2} -> 3
+		ThreadPool::TaskGroup group;
+		order.assign(4, -1);
+		orderPos = 0;
+
+		const ThreadPool::TaskGroup::TaskID a = group.AddTask(boost::bind(&Record, 0));
+		const ThreadPool::TaskGroup::TaskID b = group.AddTask(boost::bind(&Record, 1));
+		const ThreadPool::TaskGroup::TaskID c = group.AddTask(boost::bind(&Record, 2));
+		const ThreadPool::TaskGroup::TaskID d = group.AddTask(boost::bind(&Record, 3));
+
+		group.AddDependency(b, a);
+		group.AddDependency(c, a);
+		group.AddDependency(d, b);
+		group.AddDependency(d, c);
+		group.Wait();
+
+		BOOST_CHECK(order[0] == 0);
+		BOOST_CHECK((order[1] == 1 && order[2] == 2) || (order[1] == 2 && order[2] == 1));
+		BOOST_CHECK(order[3] == 3);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(TaskException)
+{
+	ThreadPool::SetThreadCount(2);
+
+	ThreadPool::TaskGroup group;
+	counts.assign(1, 0);
+
+	const ThreadPool::TaskGroup::TaskID a = group.AddTask(&Throw);
+	const ThreadPool::TaskGroup::TaskID b = group.AddTask(boost::bind(&Count, 0));
+
+	// successors of a failed task still run
+	group.AddDependency(b, a);
+
+	BOOST_CHECK_THROW(group.Wait(), std::runtime_error);
+	BOOST_CHECK(counts[0] == 1);
+
+	ThreadPool::Shutdown();
+	BOOST_CHECK(ThreadPool::GetNumThreads() == 1);
+}
@@ -0,0 +1,67 @@
+/* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
+
+#include "System/SlabPool.h"
+
+#include <set>
+#include <vector>
+
+#define BOOST_TEST_MODULE SlabPool
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE(SizeClasses)
+{
+	CSlabPool pool;
+
+	char* a = static_cast<char*>(pool.Alloc(40));
+	char* b = static_cast<char*>(pool.Alloc(40));
+	char* c = static_cast<char*>(pool.Alloc(200));
+
+	// blocks of one size come from the same slab, one after another
+	BOOST_CHECK_EQUAL(b - a, 48);
+	BOOST_CHECK(c < a || c >= a + CSlabPool::SLAB_SIZE);
+	BOOST_CHECK_EQUAL(pool.GetNumAllocatedBlocks(), 3);
+
+	pool.Free(a, 40);
+	pool.Free(b, 40);
+	pool.Free(c, 200);
+	BOOST_CHECK_EQUAL(pool.GetNumAllocatedBlocks(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(DeferredFree)
+{
+	CSlabPool pool;
+	std::set<void*> freed;
+
+	for (int n = 0; n < 100; n++) {
+		freed.insert(pool.Alloc(64));
+	}
+	for (std::set<void*>::const_iterator it = freed.begin(); it != freed.end(); ++it) {
+		pool.Free(*it, 64);
+	}
+
+	// nothing freed in this "frame" may be handed out again
+	for (int n = 0; n < 100; n++) {
+		BOOST_CHECK(freed.find(pool.Alloc(64)) == freed.end());
+	}
+
+	pool.ReleaseFreed();
+	const size_t numSlabBytes = pool.GetNumSlabBytes();
+
+	// afterwards all of it is reused before new slabs are allocated
+	for (int n = 0; n < 100; n++) {
+		BOOST_CHECK(freed.find(pool.Alloc(64)) != freed.end());
+	}
+
+	BOOST_CHECK_EQUAL(pool.GetNumSlabBytes(), numSlabBytes);
+}
+
+BOOST_AUTO_TEST_CASE(ReleaseFreedAll)
+{
+	CSlabPool pool;
+
+	void* a = pool.Alloc(100);
+	pool.Free(a, 100);
+
+	CSlabPool::ReleaseFreedAll();
+	BOOST_CHECK_EQUAL(pool.Alloc(100), a);
+}
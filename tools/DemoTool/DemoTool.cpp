@@ -1,14 +1,27 @@
 /* This file is part of the Spring engine (GPL v2 or later), see LICENSE.html */
 
+#include <algorithm>
 #include <string>
 #include <iostream>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <vector>
 #include <boost/program_options.hpp>
+#include <boost/thread.hpp>
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <dirent.h>
+	#include <sys/stat.h>
+#endif
 
 #include "StringSerializer.h"
 
 #include "System/LoadSave/DemoReader.h"
 #include "System/BaseNetProtocol.h"
 #include "System/Net/RawPacket.h"
+#include "Sim/Misc/GlobalConstants.h"
 #include "Sim/Units/CommandAI/Command.h"
 
 namespace po = boost::program_options;
@@ -26,6 +39,7 @@ no console output (you still could use this.exe > z.tzt though).
 
 void TrafficDump(CDemoReader& reader, bool trafficStats);
 void WriteTeamstatHistory(CDemoReader& reader, unsigned team, const std::string& file);
+int BatchAnalysis(const std::string& dir, const std::string& outPrefix, unsigned numThreads);
 
 int main (int argc, char* argv[])
 {
@@ -40,10 +54,14 @@ int main (int argc, char* argv[])
 	all.add_options()("dump,d", "Only dump networc traffic saved in demo");
 	all.add_options()("stats,s", "Print all game, player and team stats");
 	all.add_options()("header,H", "Print demoheader content");
+	all.add_options()("index,i", "Print the block index of compressed demos");
 	all.add_options()("playerstats,p", "Print playerstats");
 	all.add_options()("teamstats,t", "Print teamstats");
 	all.add_options()("team", po::value<unsigned>(), "Select team");
 	all.add_options()("teamsstatcsv", po::value<std::string>(), "Write teamstats in a csv file");
+	all.add_options()("batch,b", po::value<std::string>(), "Analyse all demos in a directory (recursive)");
+	all.add_options()("out,o", po::value<std::string>()->default_value("demotool"), "Prefix of the csv files written in batch mode");
+	all.add_options()("threads,j", po::value<unsigned>()->default_value(0), "Number of demos analysed in parallel in batch mode (0: one per core)");
 
 	po::store(po::command_line_parser(argc, argv).options(all).positional(p).run(), vm);
 	po::notify(vm);
@@ -53,8 +71,13 @@ int main (int argc, char* argv[])
 		std::cout << "demotool Usage: " << std::endl;
 		all.print(std::cout);
 		std::cout << "example: demotool myReplay.sdf -d > myReplay_sdf_demotool.txt" << std::endl;
+		std::cout << "example: demotool -b demos -o league -j 8" << std::endl;
 		return 0;
 	}
+	if (vm.count("batch"))
+	{
+		return BatchAnalysis(vm["batch"].as<std::string>(), vm["out"].as<std::string>(), vm["threads"].as<unsigned>());
+	}
 	if (vm.count("demofile"))
 	{
 		filename = vm["demofile"].as<std::string>();
@@ -92,6 +115,15 @@ int main (int argc, char* argv[])
 		buf << reader.GetFileHeader();
 		std::wcout << buf.str();
 	}
+	if (vm.count("index"))
+	{
+		const std::vector<DemoStreamIndexEntry>& index = reader.GetBlockIndex();
+		std::cout << "-- Block index: " << index.size() << " blocks --" << std::endl;
+		for (unsigned i = 0; i < index.size(); ++i)
+		{
+			std::cout << "Offset: " << index[i].blockOffset << " Frame: " << index[i].frameNum << " Time: " << index[i].modGameTime << std::endl;
+		}
+	}
 	if (vm.count("playerstats") || printStats)
 	{
 		const std::vector<PlayerStatistics> statvec = reader.GetPlayerStats();
@@ -297,11 +329,40 @@ void TrafficDump(CDemoReader& reader, bool trafficStats)
 }
 
 template<typename T>
-void PrintSep(std::ofstream& file, T value)
+void PrintSep(std::ostream& file, T value)
 {
 	file << value << ";";
 }
 
+static const char* teamStatsColumns =
+	"MetalUsed;EnergyUsed;MetalProduced;EnergyProduced;MetalExcess;EnergyExcess;"
+	"MetalReceived;EnergyReceived;MetalSent;EnergySent;DamageDealt;DamageReceived;"
+	"UnitsProduced;UnitsDied;UnitsReceived;UnitsSent;UnitsCaptured;"
+	"UnitsOutCaptured;UnitsKilled";
+
+void PrintTeamStatistics(std::ostream& out, const TeamStatistics& stats)
+{
+	PrintSep(out, stats.metalUsed);
+	PrintSep(out, stats.energyUsed);
+	PrintSep(out, stats.metalProduced);
+	PrintSep(out, stats.energyProduced);
+	PrintSep(out, stats.metalExcess);
+	PrintSep(out, stats.energyExcess);
+	PrintSep(out, stats.metalReceived);
+	PrintSep(out, stats.energyReceived);
+	PrintSep(out, stats.metalSent);
+	PrintSep(out, stats.energySent);
+	PrintSep(out, stats.damageDealt);
+	PrintSep(out, stats.damageReceived);
+	PrintSep(out, stats.unitsProduced);
+	PrintSep(out, stats.unitsDied);
+	PrintSep(out, stats.unitsReceived);
+	PrintSep(out, stats.unitsSent);
+	PrintSep(out, stats.unitsCaptured);
+	PrintSep(out, stats.unitsOutCaptured);
+	PrintSep(out, stats.unitsKilled);
+}
+
 void WriteTeamstatHistory(CDemoReader& reader, unsigned team, const std::string& file)
 {
 	const DemoFileHeader header = reader.GetFileHeader();
@@ -311,32 +372,11 @@ void WriteTeamstatHistory(CDemoReader& reader, unsigned team, const std::string&
 		int time = 0;
 		std::ofstream out(file.c_str());
 		out << "Team Statistics for " << team << std::endl;
-		out << "Time[sec];MetalUsed;EnergyUsed;MetalProduced;EnergyProduced;MetalExcess;EnergyExcess;"
-		    << "EnergyReceived;MetalSent;EnergySent;DamageDealt;DamageReceived;"
-		    << "UnitsProduced;UnitsDied;UnitsReceived;UnitsSent;nitsCaptured;"
-		    << "UnitsOutCaptured;UnitsKilled" << std::endl;
+		out << "Time[sec];" << teamStatsColumns << std::endl;
 		for (unsigned i = 0; i < statvec[team].size(); ++i)
 		{
 			PrintSep(out, time);
-			PrintSep(out, statvec[team][i].metalUsed);
-			PrintSep(out, statvec[team][i].energyUsed);
-			PrintSep(out, statvec[team][i].metalProduced);
-			PrintSep(out, statvec[team][i].energyProduced);
-			PrintSep(out, statvec[team][i].metalExcess);
-			PrintSep(out, statvec[team][i].energyExcess);
-			PrintSep(out, statvec[team][i].metalReceived);
-			PrintSep(out, statvec[team][i].energyReceived);
-			PrintSep(out, statvec[team][i].metalSent);
-			PrintSep(out, statvec[team][i].energySent);
-			PrintSep(out, statvec[team][i].damageDealt);
-			PrintSep(out, statvec[team][i].damageReceived);
-			PrintSep(out, statvec[team][i].unitsProduced);
-			PrintSep(out, statvec[team][i].unitsDied);
-			PrintSep(out, statvec[team][i].unitsReceived);
-			PrintSep(out, statvec[team][i].unitsSent);
-			PrintSep(out, statvec[team][i].unitsCaptured);
-			PrintSep(out, statvec[team][i].unitsOutCaptured);
-			PrintSep(out, statvec[team][i].unitsKilled);
+			PrintTeamStatistics(out, statvec[team][i]);
 			out << std::endl;
 			time += header.teamStatPeriod;
 		}
@@ -347,3 +387,292 @@ void WriteTeamstatHistory(CDemoReader& reader, unsigned team, const std::string&
 		exit(1);
 	}
 };
+
+
+/*
+Batch mode: analyses all demos (*.sdf) below a directory in parallel, reading
+each of them once, and writes one semicolon separated table per kind of data,
+with one row per item and the demo file in the first column:
+
+<prefix>_commands.csv  every unit command given by a player (or its Lua / AIs)
+<prefix>_players.csv   number of commands and actions per minute of each player
+<prefix>_teamstats.csv the team statistics saved at the end of each demo
+*/
+
+static void FindDemos(const std::string& dir, std::vector<std::string>& demos)
+{
+#ifdef _WIN32
+	WIN32_FIND_DATA wfd;
+	HANDLE hFind = FindFirstFile((dir + "\\*").c_str(), &wfd);
+
+	if (hFind != INVALID_HANDLE_VALUE) {
+		do {
+			const std::string name = wfd.cFileName;
+			if (name == "." || name == "..")
+				continue;
+			if (wfd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+				FindDemos(dir + "\\" + name, demos);
+			} else if (name.size() > 4 && name.compare(name.size() - 4, 4, ".sdf") == 0) {
+				demos.push_back(dir + "\\" + name);
+			}
+		} while (FindNextFile(hFind, &wfd));
+		FindClose(hFind);
+	}
+#else
+	DIR* dp = opendir(dir.c_str());
+	struct dirent* ep;
+
+	if (dp == NULL)
+		return;
+
+	while ((ep = readdir(dp))) {
+		const std::string name = ep->d_name;
+		if (name[0] == '.')
+			continue;
+
+		// d_type is DT_UNKNOWN on some filesystems
+		struct stat info;
+		if (stat((dir + "/" + name).c_str(), &info) != 0)
+			continue;
+
+		if (S_ISDIR(info.st_mode)) {
+			FindDemos(dir + "/" + name, demos);
+		} else if (name.size() > 4 && name.compare(name.size() - 4, 4, ".sdf") == 0) {
+			demos.push_back(dir + "/" + name);
+		}
+	}
+	closedir(dp);
+#endif
+}
+
+struct DemoAnalysis
+{
+	struct PlayerData {
+		PlayerData(): numCommands(0), numLuaCommands(0), lastFrame(0) {}
+
+		std::string name;
+		/// NETMSG_COMMAND, i.e. given through the UI
+		unsigned numCommands;
+		/// NETMSG_AICOMMAND(S|_TRACKED), i.e. given by Lua or a Skirmish AI
+		unsigned numLuaCommands;
+		int lastFrame;
+	};
+
+	/// rows of each table
+	std::ostringstream commands;
+	std::ostringstream players;
+	std::ostringstream teamStats;
+};
+
+/// reads through <reader> once and fills the tables
+static void AnalyseDemo(CDemoReader& reader, const std::string& demo, DemoAnalysis& analysis)
+{
+	std::map<int, DemoAnalysis::PlayerData> players;
+	int frame = 0;
+
+	while (!reader.ReachedEnd())
+	{
+		netcode::RawPacket* packet = reader.GetData(3.40282347e+38f);
+		if (packet == NULL)
+			continue;
+
+		const unsigned char* buffer = packet->data;
+		const unsigned length = packet->length;
+
+		switch ((length > 0)? buffer[0]: NETMSG_LAST)
+		{
+			case NETMSG_KEYFRAME:
+			case NETMSG_NEWFRAME:
+				++frame;
+				break;
+			case NETMSG_PLAYERNAME:
+				if (length > 3)
+					players[buffer[2]].name = std::string((const char*) buffer + 3, std::find(buffer + 3, buffer + length, 0) - (buffer + 3));
+				break;
+			case NETMSG_COMMAND:
+				// ushort size, uchar player, int id, uchar options, float params[]
+				if (length >= 9) {
+					DemoAnalysis::PlayerData& player = players[buffer[3]];
+					const int cmdId = *(int*)(buffer + 4);
+					player.numCommands++;
+					player.lastFrame = frame;
+					analysis.commands << demo << ";" << frame << ";" << (unsigned)buffer[3] << ";ui;" << cmdId << ";" << GetCommandName(cmdId) << ";" << (unsigned)buffer[8] << ";" << (length - 9) / sizeof(float) << "\n";
+				}
+				break;
+			case NETMSG_AICOMMAND:
+			case NETMSG_AICOMMAND_TRACKED: {
+				// ushort size, uchar player, uchar aiID, short unitID, int id, uchar options, [int aiCommandId], float params[]
+				const unsigned paramsStart = (buffer[0] == NETMSG_AICOMMAND)? 12: 16;
+				if (length >= paramsStart) {
+					DemoAnalysis::PlayerData& player = players[buffer[3]];
+					const int cmdId = *(int*)(buffer + 7);
+					player.numLuaCommands++;
+					player.lastFrame = frame;
+					analysis.commands << demo << ";" << frame << ";" << (unsigned)buffer[3] << ";" << ((buffer[4] == MAX_AIS)? "lua": "ai") << ";" << cmdId << ";" << GetCommandName(cmdId) << ";" << (unsigned)buffer[11] << ";" << (length - paramsStart) / sizeof(float) << "\n";
+				}
+			} break;
+			case NETMSG_AICOMMANDS: {
+				// ushort size, uchar player, uchar aiID, uchar pairwise, uint sameCmdID, uchar sameCmdOpt, ushort sameCmdParamSize,
+				// ushort unitCount, short unitIDs[], ushort commandCount, {[int id], [uchar options], [ushort numParams], float params[]}[]
+				// one row per order a unit receives, like NETMSG_AICOMMAND
+				if (length < 15)
+					break;
+
+				const bool pairwise = (buffer[5] != 0);
+				const int sameCmdId = *(int*)(buffer + 6);
+				const unsigned char sameCmdOpt = buffer[10];
+				const unsigned short sameCmdParamSize = *(unsigned short*)(buffer + 11);
+				const unsigned short unitCount = *(unsigned short*)(buffer + 13);
+
+				unsigned pos = 15 + unitCount * 2;
+				if (pos + 2 > length)
+					break;
+
+				const unsigned short commandCount = *(unsigned short*)(buffer + pos);
+				pos += 2;
+
+				DemoAnalysis::PlayerData& player = players[buffer[3]];
+
+				for (unsigned c = 0; c < commandCount; ++c) {
+					const unsigned headerSize = ((sameCmdId == 0)? 4: 0) + ((sameCmdOpt == 0xFF)? 1: 0) + ((sameCmdParamSize == 0xFFFF)? 2: 0);
+					if (pos + headerSize > length)
+						break;
+
+					const int cmdId = (sameCmdId == 0)? *(int*)(buffer + pos): sameCmdId;
+					pos += (sameCmdId == 0)? 4: 0;
+					const unsigned char cmdOpt = (sameCmdOpt == 0xFF)? buffer[pos]: sameCmdOpt;
+					pos += (sameCmdOpt == 0xFF)? 1: 0;
+					const unsigned short numParams = (sameCmdParamSize == 0xFFFF)? *(unsigned short*)(buffer + pos): sameCmdParamSize;
+					pos += (sameCmdParamSize == 0xFFFF)? 2: 0;
+					pos += numParams * sizeof(float);
+					if (pos > length)
+						break;
+
+					// pairwise: command c goes to unit c, else every command to every unit
+					const unsigned numOrders = pairwise? ((c < unitCount)? 1: 0): unitCount;
+
+					for (unsigned u = 0; u < numOrders; ++u) {
+						player.numLuaCommands++;
+						player.lastFrame = frame;
+						analysis.commands << demo << ";" << frame << ";" << (unsigned)buffer[3] << ";" << ((buffer[4] == MAX_AIS)? "lua": "ai") << ";" << cmdId << ";" << GetCommandName(cmdId) << ";" << (unsigned)cmdOpt << ";" << numParams << "\n";
+					}
+				}
+			} break;
+			default:
+				break;
+		}
+		delete packet;
+	}
+
+	const float minutes = std::max(frame, 1) / float(GAME_SPEED * 60);
+
+	for (std::map<int, DemoAnalysis::PlayerData>::const_iterator it = players.begin(); it != players.end(); ++it)
+	{
+		const DemoAnalysis::PlayerData& player = it->second;
+		analysis.players << demo << ";" << it->first << ";" << player.name << ";" << player.numCommands << ";" << player.numLuaCommands << ";"
+			<< player.lastFrame << ";" << minutes << ";" << (player.numCommands / minutes) << "\n";
+	}
+
+	reader.LoadStats();
+
+	const std::vector< std::vector<TeamStatistics> >& teamStats = reader.GetTeamStats();
+	const int teamStatPeriod = reader.GetFileHeader().teamStatPeriod;
+
+	for (unsigned team = 0; team < teamStats.size(); ++team)
+	{
+		for (unsigned i = 0; i < teamStats[team].size(); ++i)
+		{
+			analysis.teamStats << demo << ";" << team << ";" << (i * teamStatPeriod) << ";";
+			PrintTeamStatistics(analysis.teamStats, teamStats[team][i]);
+			analysis.teamStats << "\n";
+		}
+	}
+}
+
+struct BatchState
+{
+	BatchState(): nextDemo(0), numFailed(0) {}
+
+	std::vector<std::string> demos;
+	size_t nextDemo;
+	unsigned numFailed;
+
+	std::ofstream commands;
+	std::ofstream players;
+	std::ofstream teamStats;
+
+	boost::mutex mutex;
+};
+
+static void BatchWorker(BatchState* state)
+{
+	while (true)
+	{
+		std::string demo;
+		{
+			boost::mutex::scoped_lock lock(state->mutex);
+			if (state->nextDemo >= state->demos.size())
+				return;
+			demo = state->demos[state->nextDemo++];
+		}
+
+		DemoAnalysis analysis;
+
+		try {
+			CDemoReader reader(demo, 0.0f);
+			AnalyseDemo(reader, demo, analysis);
+		} catch (const std::exception& ex) {
+			boost::mutex::scoped_lock lock(state->mutex);
+			std::cerr << "Skipping " << demo << ": " << ex.what() << std::endl;
+			state->numFailed++;
+			continue;
+		}
+
+		// rows of one demo stay together
+		boost::mutex::scoped_lock lock(state->mutex);
+		state->commands << analysis.commands.str();
+		state->players << analysis.players.str();
+		state->teamStats << analysis.teamStats.str();
+	}
+}
+
+int BatchAnalysis(const std::string& dir, const std::string& outPrefix, unsigned numThreads)
+{
+	InitCommandNames();
+
+	BatchState state;
+	FindDemos(dir, state.demos);
+
+	if (state.demos.empty())
+	{
+		std::cout << "No demos found in " << dir << std::endl;
+		return 1;
+	}
+
+	state.commands.open((outPrefix + "_commands.csv").c_str());
+	state.players.open((outPrefix + "_players.csv").c_str());
+	state.teamStats.open((outPrefix + "_teamstats.csv").c_str());
+
+	if (!state.commands || !state.players || !state.teamStats)
+	{
+		std::cout << "Could not open the output files " << outPrefix << "_*.csv" << std::endl;
+		return 1;
+	}
+
+	state.commands << "Demo;Frame;Player;Source;CommandId;Command;Options;NumParams" << std::endl;
+	state.players << "Demo;Player;Name;Commands;LuaCommands;LastCommandFrame;Minutes;APM" << std::endl;
+	state.teamStats << "Demo;Team;Time[sec];" << teamStatsColumns << std::endl;
+
+	if (numThreads == 0)
+		numThreads = std::max(1u, boost::thread::hardware_concurrency());
+
+	numThreads = std::min(numThreads, (unsigned) state.demos.size());
+
+	boost::thread_group workers;
+	for (unsigned i = 0; i < numThreads; ++i)
+		workers.create_thread(boost::bind(&BatchWorker, &state));
+	workers.join_all();
+
+	std::cout << "Analysed " << (state.demos.size() - state.numFailed) << " of " << state.demos.size() << " demos on " << numThreads << " threads" << std::endl;
+	return 0;
+}